@@ -11,6 +11,7 @@
 #include <glm/trigonometric.hpp>
 #include <imgui.h>
 #include <light.hpp>
+#include <lod_group.hpp>
 #include <material.hpp>
 #include <mesh_filter.hpp>
 #include <mesh_renderer.hpp>
@@ -295,15 +296,23 @@ struct DisplayTraits<Mesh> {
     auto vao = mesh->vao;
     if (ImGui::InputInt("Vertex Array Object", &vao))
       mesh->vao = vao;
-    auto ebo = mesh->ebo;
-    if (ImGui::InputInt("Element Buffer Object", &ebo))
-      mesh->ebo = ebo;
+    if (mesh->ebo != 0) {
+      auto ebo = mesh->ebo;
+      if (ImGui::InputInt("Element Buffer Object", &ebo))
+        mesh->ebo = ebo;
+    }
     auto vertexCount = mesh->vertexCount;
     if (ImGui::InputInt("Vertex Count", &vertexCount))
       mesh->vertexCount = vertexCount;
     auto indexCount = mesh->indexCount;
     if (ImGui::InputInt("Index Count", &indexCount))
       mesh->indexCount = indexCount;
+    auto firstIndex = mesh->firstIndex;
+    if (ImGui::InputInt("First Index", &firstIndex))
+      mesh->firstIndex = firstIndex;
+    auto baseVertex = mesh->baseVertex;
+    if (ImGui::InputInt("Base Vertex", &baseVertex))
+      mesh->baseVertex = baseVertex;
     auto minBounds = mesh->bounds.min;
     if (ImGui::InputFloat3("Minimum Bounds", glm::value_ptr(minBounds)))
       mesh->bounds.min = minBounds;
@@ -320,7 +329,33 @@ struct DisplayTraits<MeshFilter> {
   static void DisplayProperties(MeshFilter* filter, EditorContext& context) {
     if (!filter)
       return;
+    auto bounds = filter->mesh.bounds;
     DisplayTraits<Mesh>::DisplayProperties(&filter->mesh, context);
+    if (filter->mesh.bounds.min != bounds.min || filter->mesh.bounds.max != bounds.max)
+      filter->dirty = true;
+  }
+};
+template <>
+struct DisplayTraits<LODGroup> {
+  static const std::string GetName() {
+    return "LOD Group";
+  }
+  static void DisplayProperties(LODGroup* group, EditorContext& context) {
+    if (!group)
+      return;
+    ImGui::Text("Current Level: %u", group->current);
+    for (size_t i = 0; i < group->levels.size(); ++i) {
+      auto& level = group->levels[i];
+      ImGui::PushID(static_cast<int>(i));
+      if (ImGui::TreeNode("Level", "Level %zu", i)) {
+        auto screenSize = level.screenSize;
+        if (ImGui::SliderFloat("Screen Size", &screenSize, .0f, 1.0f))
+          level.screenSize = screenSize;
+        DisplayTraits<Mesh>::DisplayProperties(&level.mesh, context);
+        ImGui::TreePop();
+      }
+      ImGui::PopID();
+    }
   }
 };
 template <>
@@ -22,6 +22,7 @@
 #include <imgui_internal.h>
 #include <imgui_sink.hpp>
 #include <light.hpp>
+#include <lod_group.hpp>
 #include <material.hpp>
 #include <memory>
 #include <mesh.hpp>
@@ -211,6 +212,41 @@ void Editor::DisplayScene() {
   if (showFPS) {
     ImGui::SetCursorPos(ImVec2(ImGui::GetTextLineHeight(), ImGui::GetFrameHeight() + ImGui::GetTextLineHeight()));
     ImGui::Text("%zu", GetFPS());
+    if (renderSystem) {
+      const auto& stats = renderSystem->GetRenderStats();
+      ImGui::SetCursorPosX(ImGui::GetTextLineHeight());
+      ImGui::Text("Drawn: %zu, Culled: %zu, Occluded: %zu, Reduced LOD: %zu", stats.drawn, stats.culled, stats.occluded, stats.reducedDetail);
+      ImGui::SetCursorPosX(ImGui::GetTextLineHeight());
+      ImGui::Text("Draw List: %.3f ms, Draw Calls: %zu, Upload: %.1f KiB", stats.buildTime, stats.drawCalls, stats.uploadBytes / 1024.f);
+      ImGui::SetCursorPosX(ImGui::GetTextLineHeight());
+      ImGui::Text("State Calls: %zu, Skipped: %zu", stats.stateCalls.issued, stats.stateCalls.skipped);
+      auto poolStats = renderSystem->GetPoolStats();
+      ImGui::SetCursorPosX(ImGui::GetTextLineHeight());
+      ImGui::Text("Textures: %.1f MiB, %zu live, %zu idle, %.0f%% hits", poolStats.textures.bytes / 1048576.f, poolStats.textures.liveCount, poolStats.textures.idleCount, poolStats.textures.GetHitRate() * 100.f);
+      ImGui::SetCursorPosX(ImGui::GetTextLineHeight());
+      ImGui::Text("Renderbuffers: %.1f MiB, %zu live, %zu idle, %.0f%% hits", poolStats.renderbuffers.bytes / 1048576.f, poolStats.renderbuffers.liveCount, poolStats.renderbuffers.idleCount, poolStats.renderbuffers.GetHitRate() * 100.f);
+      auto config = GetConfig();
+      auto configChanged = false;
+      ImGui::SetCursorPosX(ImGui::GetTextLineHeight());
+      configChanged |= ImGui::Checkbox("Dynamic Resolution", &config.dynamicResolution);
+      ImGui::SameLine();
+      ImGui::Text("Scale: %.3f", renderSystem->GetRenderScale());
+      ImGui::SetCursorPosX(ImGui::GetTextLineHeight());
+      ImGui::SetNextItemWidth(ImGui::GetFontSize() * 10.f);
+      if (config.dynamicResolution) {
+        configChanged |= ImGui::SliderFloat("Target Frame Time (ms)", &config.targetFrameTime, 4.f, 50.f, "%.1f");
+        ImGui::SetCursorPosX(ImGui::GetTextLineHeight());
+        ImGui::SetNextItemWidth(ImGui::GetFontSize() * 10.f);
+        configChanged |= ImGui::SliderFloat("Hysteresis", &config.resolutionHysteresis, 0.f, .5f, "%.2f");
+      } else
+        configChanged |= ImGui::SliderFloat("Render Scale", &config.renderScale, config.minRenderScale, config.maxRenderScale, "%.2f");
+      if (configChanged)
+        Configure(config);
+      ImGui::SetCursorPosX(ImGui::GetTextLineHeight());
+      auto occlusionCulling = GetOcclusionCulling();
+      if (ImGui::Checkbox("Occlusion Culling", &occlusionCulling))
+        SetOcclusionCulling(occlusionCulling);
+    }
   }
   static char commandBuffer[256] = "";
   static bool displayMessage = false;
@@ -245,6 +281,8 @@ std::string Editor::GetComponentName(IComponent* component) {
     return DisplayTraits<Camera>::GetName();
   if (auto light = component->As<Light>())
     return DisplayTraits<Light>::GetName();
+  if (auto group = component->As<LODGroup>())
+    return DisplayTraits<LODGroup>::GetName();
   if (auto material = component->As<Material>())
     return DisplayTraits<Material>::GetName();
   if (auto mesh = component->As<Mesh>())
@@ -268,6 +306,8 @@ ComponentType Editor::GetComponentType(IComponent* component) {
     return ComponentTraits<Camera>::GetType();
   if (auto light = component->As<Light>())
     return ComponentTraits<Light>::GetType();
+  if (auto group = component->As<LODGroup>())
+    return ComponentTraits<LODGroup>::GetType();
   if (auto material = component->As<Material>())
     return ComponentTraits<Material>::GetType();
   if (auto mesh = component->As<Mesh>())
@@ -320,6 +360,11 @@ void Editor::DisplayComponents() {
       return;
     }
   }
+  if (GetEntityComponent<MeshFilter>(context.selectedEntity)) {
+    auto occluder = IsEntityOccluder(context.selectedEntity);
+    if (ImGui::Checkbox("Occluder", &occluder))
+      SetEntityOccluder(context.selectedEntity, occluder);
+  }
   if (ImGui::BeginPopupContextWindow("Add", ImGuiPopupFlags_NoOpenOverItems | ImGuiPopupFlags_MouseButtonRight)) {
     auto availableComponents = GetMissingEntityComponents(context.selectedEntity);
     for (const auto& comp : availableComponents)
@@ -614,6 +659,8 @@ void Editor::DisplayProperties(IComponent* component) {
     DisplayTraits<Camera>::DisplayProperties(camera, context);
   else if (auto light = component->As<Light>())
     DisplayTraits<Light>::DisplayProperties(light, context);
+  else if (auto group = component->As<LODGroup>())
+    DisplayTraits<LODGroup>::DisplayProperties(group, context);
   else if (auto material = component->As<Material>())
     DisplayTraits<Material>::DisplayProperties(material, context);
   else if (auto mesh = component->As<Mesh>())
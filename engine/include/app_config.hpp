@@ -7,6 +7,20 @@ struct KUKI_ENGINE_API AppConfig {
   std::filesystem::path logoPath;
   int screenWidth{1920};
   int screenHeight{1080};
+  /// @brief Whether the scene's render scale follows the frame time, renderScale is then only the initial scale
+  bool dynamicResolution{false};
+  /// @brief Fraction of the screen size the scene is rendered at before it is upscaled by the post-processing pass
+  float renderScale{1.f};
+  float minRenderScale{.5f};
+  float maxRenderScale{1.f};
+  /// @brief Frame time that dynamic resolution adjusts the render scale toward, in milliseconds
+  float targetFrameTime{16.667f};
+  /// @brief Fraction of the target frame time the average frame time must be off by before the render scale changes
+  float resolutionHysteresis{.1f};
+  /// @brief Directory of the files the engine derives from the assets to start faster, such as program binaries
+  std::filesystem::path cacheDirectory{"cache"};
+  /// @brief Whether skyboxes light diffuse surfaces with spherical harmonics projected on the CPU instead of an irradiance cube map baked on the GPU
+  bool irradianceSH{true};
   AppConfig(std::string = "Kuki Game", std::filesystem::path = "", int = 1920, int = 1080);
 };
 } // namespace kuki
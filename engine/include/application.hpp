@@ -6,7 +6,10 @@
 #include <id.hpp>
 #include <input_manager.hpp>
 #include <kuki_engine_export.h>
+#include <limits>
+#include <occlusion_culler.hpp>
 #include <primitive.hpp>
+#include <ray.hpp>
 #include <scene.hpp>
 #include <scene_manager.hpp>
 #include <system.hpp>
@@ -107,6 +110,21 @@ public:
   std::vector<std::string> GetMissingEntityComponents(const ID);
   void SortEntityTransforms();
   void UpdateEntityTransforms();
+  void UpdateSpatialIndex();
+  size_t GetSpatialEntityCount();
+  const BoundingBox* GetEntitySpatialBounds(ID);
+  void SetSpatialIndexType(SpatialIndexType);
+  SpatialIndexType GetSpatialIndexType();
+  void SetOcclusionCulling(bool);
+  bool GetOcclusionCulling();
+  void SetEntityOccluder(ID, bool = true);
+  bool IsEntityOccluder(ID);
+  OcclusionStats GetOcclusionStats();
+  bool RaycastEntities(const Ray&, SpatialHit<ID>&, float = std::numeric_limits<float>::max());
+  std::vector<SpatialHit<ID>> RaycastAllEntities(const Ray&, float = std::numeric_limits<float>::max());
+  std::vector<ID> OverlapEntitiesAABB(const BoundingBox&);
+  std::vector<ID> OverlapEntitiesSphere(const glm::vec3&, float);
+  std::vector<SpatialHit<ID>> GetNearestEntities(const glm::vec3&, size_t);
   template <typename... T, typename F>
   void ForFirstEntity(F&&);
   template <typename... T, typename F>
@@ -125,10 +143,13 @@ public:
   void ForAllEntities(F&&);
   template <typename F>
   void ForEachVisibleEntity(const Camera&, F&&);
+  /// @brief Execute a function on the entities whose component of the given spatial type (Transform or MeshFilter) changed since the last spatial index update
+  template <typename T, typename F>
+  void ForEachChangedEntity(F&&);
   template <typename F>
-  void ForEachOctreeNode(F&&);
+  void ForEachSpatialNode(F&&);
   template <typename F>
-  void ForEachOctreeLeafNode(F&&);
+  void ForEachSpatialLeafNode(F&&);
   template <typename... T>
   bool EntityHasComponents(const ID);
   template <typename... T>
@@ -283,19 +304,26 @@ void Application::ForEachVisibleEntity(const Camera& camera, F&& func) {
     return;
   scene->ForEachVisibleEntity(camera, func);
 }
+template <typename T, typename F>
+void Application::ForEachChangedEntity(F&& func) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return;
+  scene->entityManager.ForEachChanged<T>(func);
+}
 template <typename F>
-void Application::ForEachOctreeNode(F&& func) {
+void Application::ForEachSpatialNode(F&& func) {
   auto scene = GetActiveScene();
   if (!scene)
     return;
-  scene->ForEachOctreeNode(func);
+  scene->ForEachSpatialNode(func);
 }
 template <typename F>
-void Application::ForEachOctreeLeafNode(F&& func) {
+void Application::ForEachSpatialLeafNode(F&& func) {
   auto scene = GetActiveScene();
   if (!scene)
     return;
-  scene->ForEachOctreeLeafNode(func);
+  scene->ForEachSpatialLeafNode(func);
 }
 template <typename... T>
 std::tuple<T*...> Application::GetEntityComponents(const ID id) {
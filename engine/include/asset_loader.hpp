@@ -3,6 +3,7 @@
 #include <assimp/material.h>
 #include <assimp/scene.h>
 #include <bone_data.hpp>
+#include <cstdint>
 #include <entity_manager.hpp>
 #include <event_queue.hpp>
 #include <filesystem>
@@ -11,6 +12,8 @@
 #include <id.hpp>
 #include <kuki_engine_export.h>
 #include <primitive.hpp>
+#include <skybox.hpp>
+#include <spherical_harmonics.hpp>
 #include <string>
 #include <texture.hpp>
 #include <vector>
@@ -33,6 +36,11 @@ struct TextureData {
   int width{};
   int height{};
   int channels{1};
+  /// @brief Hash of the pixels, the size, the channels and the type of an HDR or EXR image, the key of the maps baked from it
+  uint64_t hash{};
+  /// @brief Irradiance of an HDR or EXR image if hasIrradiance is set, see AppConfig::irradianceSH
+  SphericalHarmonics irradiance{};
+  bool hasIrradiance{false};
 };
 struct MaterialData {
   std::string name{};
@@ -85,7 +93,6 @@ private:
   Mesh CreateMesh(const aiMesh*);
   Mesh CreateMesh(const std::vector<Vertex>&, bool = false);
   Mesh CreateMesh(const std::vector<Vertex>&, const std::vector<unsigned int>&, bool = false);
-  Mesh CreateVertexBuffer(Mesh&, const std::vector<Vertex>&, bool = false);
   std::future<ID> QueueNodeCreation(const NodeData&);
   std::future<Material> QueueMaterialCreation(const MaterialData&);
   std::future<Mesh> QueueMeshCreation(aiMesh*);
@@ -93,12 +100,13 @@ private:
   Texture CreateTexture(const TextureData&);
   TextureData LoadTexture(const std::filesystem::path&, TextureType = TextureType::Albedo);
   void CalculateBounds(Mesh&, const std::vector<Vertex>&);
-  void CreateIndexBuffer(Mesh&, const std::vector<unsigned int>&);
   Texture CreateCubeMapFromEquirect(Texture);
   Texture CreateIrradianceMapFromCubeMap(Texture);
   Texture CreatePrefilterMapFromCubeMap(Texture);
   Texture CreateBRDF_LUT();
   Texture CreateCubeMapPreview(Texture);
+  bool LoadSkybox(uint64_t, Skybox&);
+  void StoreSkybox(uint64_t, const Skybox&);
 public:
   AssetLoader(Application*, EntityManager&);
   /// @brief Process pending load operations
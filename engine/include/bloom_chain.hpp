@@ -0,0 +1,49 @@
+#pragma once
+#include <cstddef>
+#include <glm/ext/vector_int2.hpp>
+#include <kuki_engine_export.h>
+#include <mesh.hpp>
+#include <shader.hpp>
+#include <vector>
+namespace kuki {
+/// @brief Half-float targets of the bloom pass, a chain of levels each half the size of the previous one, the first half the size of the image
+/// @details The bright parts of the image are downsampled through the chain and then upsampled back, each level adding its blurred copy to the next larger one; this spreads the glow wider than full resolution blur passes at a fraction of their cost
+class KUKI_ENGINE_API BloomChain {
+private:
+  struct Level {
+    unsigned int texture;
+    /// @brief Framebuffer with the texture as its only attachment, set up once
+    unsigned int framebuffer;
+    glm::ivec2 size;
+  };
+  int maxLevelCount;
+  glm::ivec2 imageSize{0};
+  std::vector<Level> levels;
+public:
+  static constexpr int DefaultLevelCount = 6;
+  /// @brief Levels smaller than this along either axis are not created
+  static constexpr int MinLevelSize = 4;
+  /// @param levelCount Maximum number of levels
+  BloomChain(int = DefaultLevelCount);
+  ~BloomChain();
+  BloomChain(const BloomChain&) = delete;
+  BloomChain& operator=(const BloomChain&) = delete;
+  /// @brief Create the levels for an image size, or keep them if the size is the same as before (requires a current OpenGL context)
+  /// @return true if there is at least one level and all framebuffers are complete
+  bool Resize(int, int);
+  size_t GetLevelCount() const;
+  /// @return OpenGL ID of the texture of a level
+  unsigned int GetTexture(size_t) const;
+  /// @return OpenGL ID of the framebuffer that renders to a level
+  unsigned int GetFramebuffer(size_t) const;
+  glm::ivec2 GetSize(size_t) const;
+  /// @brief Downsample the bright parts of an image through the levels and upsample them back, the first level then holds the sum of all levels (requires a current OpenGL context)
+  /// @param image OpenGL ID of the image, of the size the chain was created for
+  /// @param brightShader Program of the downsample passes
+  /// @param blurShader Program of the upsample passes
+  /// @param frame Mesh that covers the viewport
+  void Apply(unsigned int, Shader&, Shader&, const Mesh*);
+  /// @brief Delete the textures and framebuffers
+  void Clear();
+};
+} // namespace kuki
@@ -1,8 +1,10 @@
 #pragma once
 #include <component.hpp>
+#include <cstddef>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/vector_float3.hpp>
 #include <kuki_engine_export.h>
+#include <vector>
 namespace kuki {
 struct KUKI_ENGINE_API BoundingBox {
   /// @brief Minimum local bounds of the mesh at scale 1
@@ -13,5 +15,22 @@ struct KUKI_ENGINE_API BoundingBox {
   BoundingBox(glm::vec3, glm::vec3);
   /// @brief Get the world space bounds
   BoundingBox GetWorldBounds(const glm::mat4&);
+  /// @return true if the two boxes overlap (touching counts), false otherwise
+  bool Intersects(const BoundingBox&) const;
+  /// @brief Get the squared distance from the given point to the closest point of the box (0 if the point is inside)
+  float GetDistanceSquared(const glm::vec3&) const;
+};
+/// @brief A structure-of-arrays collection of bounding boxes (stored as centers and half extents) for batch processing
+struct KUKI_ENGINE_API BoundingBoxBatch {
+  std::vector<float> centerX;
+  std::vector<float> centerY;
+  std::vector<float> centerZ;
+  std::vector<float> extentX;
+  std::vector<float> extentY;
+  std::vector<float> extentZ;
+  void Add(const BoundingBox&);
+  void Reserve(size_t);
+  void Clear();
+  size_t Size() const;
 };
 } // namespace kuki
@@ -44,6 +44,8 @@ struct KUKI_ENGINE_API Camera final : public IComponent {
   /// @param distanceFactor Zoom out amount in `float`
   void Frame(const BoundingBox&, float = 1.1f);
   bool IntersectsFrustum(const BoundingBox&) const;
+  /// @brief Get the projected height of the bounding sphere of a world space box over the viewport height (1 fills the screen vertically)
+  float GetScreenSize(const BoundingBox&) const;
 private:
   void UpdateBasis();
   void UpdateTransform();
@@ -1,9 +1,11 @@
 #pragma once
 #include <component.hpp>
 #include <id.hpp>
+#include <mesh_filter.hpp>
 #include <stack>
 #include <transform.hpp>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 namespace kuki {
@@ -17,6 +19,9 @@ public:
   virtual void Sort() = 0;
   virtual void Update() = 0;
 };
+/// @brief Component types whose changes affect the spatial bounds of an entity
+template <typename T>
+concept IsSpatial = std::is_same_v<T, Transform> || std::is_same_v<T, MeshFilter>;
 template <typename T>
 class ComponentManager final : public IComponentManager {
 private:
@@ -24,6 +29,8 @@ private:
   std::unordered_map<ID, size_t> entityToComponent;
   std::vector<ID> componentToEntity;
   size_t inactiveCount{}; // TODO: to reclaim some memory, shrink the array if inactive count gets too high
+  /// @brief Entities whose component was added, removed, or updated since the last ClearChanged call (only tracked for spatial types)
+  std::unordered_set<ID> changed;
 public:
   size_t ActiveCount();
   size_t InactiveCount();
@@ -41,6 +48,9 @@ public:
   void Update() override;
   template <typename F>
   void ForEach(F&&);
+  template <typename F>
+  void ForEachChanged(F&&);
+  void ClearChanged();
 };
 template <typename T>
 size_t ComponentManager<T>::ActiveCount() {
@@ -62,6 +72,8 @@ T& ComponentManager<T>::Add(const ID id) {
     components.emplace_back();
   entityToComponent.insert({id, componentId});
   componentToEntity.push_back(id);
+  if constexpr (IsSpatial<T>)
+    changed.insert(id);
   return components[componentId];
 }
 template <typename T>
@@ -84,6 +96,8 @@ void ComponentManager<T>::Remove(const ID id) {
   entityToComponent.erase(id);
   componentToEntity.pop_back();
   inactiveCount++;
+  if constexpr (IsSpatial<T>)
+    changed.insert(id);
   if constexpr (std::is_same_v<T, Transform>)
     // TODO: implement a partial sort function
     Sort();
@@ -116,6 +130,17 @@ void ComponentManager<T>::ForEach(F&& func) {
   }
 }
 template <typename T>
+template <typename F>
+void ComponentManager<T>::ForEachChanged(F&& func) {
+  auto func_ = std::forward<F>(func);
+  for (const auto id : changed)
+    func_(id);
+}
+template <typename T>
+void ComponentManager<T>::ClearChanged() {
+  changed.clear();
+}
+template <typename T>
 void ComponentManager<T>::Sort() {}
 template <typename T>
 void ComponentManager<T>::Update() {}
@@ -169,6 +194,16 @@ inline void ComponentManager<Transform>::Sort() {
   inactiveCount = 0;
 }
 template <>
+inline void ComponentManager<MeshFilter>::Update() {
+  for (auto i = 0; i < ActiveCount(); ++i) {
+    auto& filter = components[i];
+    if (filter.dirty) {
+      filter.dirty = false;
+      changed.insert(componentToEntity[i]);
+    }
+  }
+}
+template <>
 inline void ComponentManager<Transform>::Update() {
   auto count = ActiveCount();
   if (count == 0)
@@ -181,8 +216,10 @@ inline void ComponentManager<Transform>::Update() {
       parentTransform = &components[it->second];
     if (parentTransform && parentTransform->dirty)
       transform.dirty = true;
-    if (transform.dirty)
+    if (transform.dirty) {
       transform.Update(parentTransform);
+      changed.insert(componentToEntity[i]);
+    }
   }
   for (auto& c : components)
     c.dirty = false;
@@ -5,6 +5,7 @@
 #include <glm/ext/vector_float4.hpp>
 #include <kuki_engine_export.h>
 #include <light.hpp>
+#include <lod_group.hpp>
 #include <mesh.hpp>
 #include <mesh_filter.hpp>
 #include <mesh_renderer.hpp>
@@ -17,6 +18,7 @@ enum class ComponentType : uint8_t {
   BoneData,
   Camera,
   Light,
+  LODGroup,
   Material,
   MeshFilter,
   Mesh,
@@ -31,6 +33,7 @@ enum class ComponentMask : size_t {
   BoneData = static_cast<size_t>(1) << static_cast<uint8_t>(ComponentType::BoneData),
   Camera = static_cast<size_t>(1) << static_cast<uint8_t>(ComponentType::Camera),
   Light = static_cast<size_t>(1) << static_cast<uint8_t>(ComponentType::Light),
+  LODGroup = static_cast<size_t>(1) << static_cast<uint8_t>(ComponentType::LODGroup),
   Material = static_cast<size_t>(1) << static_cast<uint8_t>(ComponentType::Material),
   MeshFilter = static_cast<size_t>(1) << static_cast<uint8_t>(ComponentType::MeshFilter),
   Mesh = static_cast<size_t>(1) << static_cast<uint8_t>(ComponentType::Mesh),
@@ -84,6 +87,18 @@ struct ComponentTraits<Light> {
   }
 };
 template <>
+struct ComponentTraits<LODGroup> {
+  static const std::string GetName() {
+    return "LODGroup";
+  }
+  static ComponentType GetType() {
+    return ComponentType::LODGroup;
+  }
+  static ComponentMask GetMask() {
+    return ComponentMask::LODGroup;
+  }
+};
+template <>
 struct ComponentTraits<Material> {
   static const std::string GetName() {
     return "Material";
@@ -0,0 +1,56 @@
+#pragma once
+#include <component.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <id.hpp>
+#include <kuki_engine_export.h>
+#include <material_table.hpp>
+#include <render_queue.hpp>
+#include <unordered_map>
+#include <vector>
+namespace kuki {
+/// @brief Draw packets built over a chunk of the visible entities, the jobs of different chunks can be built concurrently and are merged into the render queue on the context thread
+class KUKI_ENGINE_API DrawJob {
+private:
+  /// @brief A draw request whose material index and sort key are resolved when the job is merged
+  struct Packet {
+    ID id;
+    RenderItem item;
+    MaterialType type;
+    uint16_t mesh;
+    float depth;
+    /// @brief Index of the material in the job's materials
+    uint32_t material;
+  };
+  std::vector<Packet> packets;
+  /// @brief Distinct materials of the chunk, the packets of equal materials share one
+  std::vector<MaterialTable::PreparedMaterial> materials;
+  std::unordered_map<uint64_t, uint32_t> hashToMaterial;
+  std::vector<MaterialIndex> resolved;
+public:
+  /// @brief Transform row of the packets whose entity has no row yet
+  static constexpr uint32_t NoTransformRow = ~uint32_t{0};
+  /// @brief Number of entities of the chunk that have a mesh
+  size_t visible{0};
+  /// @brief Number of entities of the chunk drawn at a reduced level of detail
+  size_t reduced{0};
+  /// @brief Remove the packets and materials while keeping the allocated memory
+  void Clear();
+  /// @brief Add a draw request, it only reads the material so jobs over different chunks can add concurrently
+  /// @param id Entity of the request
+  /// @param item Mesh, material and world transform of the entity, its transform row is NoTransformRow if the entity has none yet
+  /// @param type Shader of the material
+  /// @param depth Distance to the camera over the far plane distance
+  /// @param material Material prepared against the material table, see MaterialTable::Prepare
+  void Add(ID, const RenderItem&, MaterialType, float, const MaterialTable::PreparedMaterial&);
+  /// @brief Add the distinct materials to the table and push the packets into the queue (requires a current OpenGL context if a material has new textures)
+  /// @param table Material table of the frame
+  /// @param queue Render queue of the frame
+  /// @param getTransformRow Called for the packets whose entity has no transform row, returns the row it is given
+  void Merge(MaterialTable&, RenderQueue&, const std::function<uint32_t(ID, const glm::mat4&)>&);
+  size_t GetPacketCount() const;
+  size_t GetMaterialCount() const;
+};
+} // namespace kuki
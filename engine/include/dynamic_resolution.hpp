@@ -0,0 +1,28 @@
+#pragma once
+#include <app_config.hpp>
+#include <cstddef>
+#include <kuki_engine_export.h>
+namespace kuki {
+/// @brief Adjusts the scene's render scale so that the average frame time approaches the target of the app config
+/// @details The cost of a frame is assumed to grow with its pixel count, the square of the scale; the scale moves in fixed steps so that few distinct target sizes are requested from the pools, and waits for the average to settle after each change
+class KUKI_ENGINE_API DynamicResolution {
+private:
+  float scale{1.f};
+  /// @brief Exponential moving average of the frame time in milliseconds, 0 before the first frame at the current scale
+  float averageTime{0.f};
+  size_t settleFrames{0};
+public:
+  static constexpr float ScaleStep = 1.f / 16.f;
+  /// @brief Weight of the latest frame in the average frame time
+  static constexpr float Smoothing = .1f;
+  /// @brief Number of frames to wait after the scale changes before it may change again
+  static constexpr size_t SettleFrameCount = 30;
+  /// @brief Feed the time of the last frame
+  /// @param frameTime Frame time in milliseconds
+  /// @param config Config with the target and limits, the fixed render scale is returned if dynamic resolution is off
+  /// @return Render scale for the next frame
+  float Update(float, const AppConfig&);
+  float GetScale() const;
+  float GetAverageTime() const;
+};
+} // namespace kuki
@@ -90,6 +90,11 @@ public:
   void SortComponents();
   template <typename C>
   void UpdateComponents();
+  /// @brief Execute a function on entities whose component of the specified type changed since the last ClearChanged call
+  template <typename C, typename F>
+  void ForEachChanged(F&&);
+  template <typename C>
+  void ClearChanged();
   void Update();
   /// @brief Execute a function on the first entity with specified components
   template <typename... C, typename F>
@@ -198,12 +203,12 @@ ComponentManager<C>* EntityManager::GetManager() {
   auto type = std::type_index(typeid(C));
   auto it = typeToManager.find(type);
   if (it == typeToManager.end()) {
-    typeToManager.emplace(type, new ComponentManager<C>());
+    it = typeToManager.emplace(type, new ComponentManager<C>()).first;
     nameToType.emplace(ComponentTraits<C>::GetName(), type);
     idToType.emplace(ComponentTraits<C>::GetType(), type);
     typeToMask.emplace(type, ComponentTraits<C>::GetMask());
   }
-  return static_cast<ComponentManager<C>*>(typeToManager[type]);
+  return static_cast<ComponentManager<C>*>(it->second);
 }
 template <typename C>
 size_t EntityManager::GetComponentMask() const {
@@ -227,4 +232,12 @@ void EntityManager::UpdateComponents() {
     return;
   manager->Update();
 }
+template <typename C, typename F>
+void EntityManager::ForEachChanged(F&& func) {
+  GetManager<C>()->ForEachChanged(func);
+}
+template <typename C>
+void EntityManager::ClearChanged() {
+  GetManager<C>()->ClearChanged();
+}
 } // namespace kuki
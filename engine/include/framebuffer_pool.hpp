@@ -5,8 +5,8 @@ namespace kuki {
 class KUKI_ENGINE_API FramebufferPool final : public Pool<TextureParams, unsigned int> {
 protected:
   unsigned int Allocate(const TextureParams&) override;
+  void Free(const TextureParams&, unsigned int&) override;
 public:
   ~FramebufferPool() override;
-  void Clear() override;
 };
 } // namespace kuki
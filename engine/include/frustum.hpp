@@ -1,10 +1,20 @@
 #pragma once
 #include <bounding_box.hpp>
 #include <component.hpp>
+#include <cstdint>
 #include <kuki_engine_export.h>
 #include <plane.hpp>
+#include <vector>
 namespace kuki {
+/// @brief Result of classifying a bounding box against the frustum
+enum class FrustumTest : uint8_t {
+  Outside,
+  Intersect,
+  Inside
+};
 struct KUKI_ENGINE_API Frustum {
+  /// @brief Plane mask with all six planes active
+  static constexpr uint8_t AllPlanes = 0b111111;
   Plane top{};
   Plane bottom{};
   Plane right{};
@@ -12,5 +22,14 @@ struct KUKI_ENGINE_API Frustum {
   Plane far{};
   Plane near{};
   bool InFrustum(const BoundingBox&) const;
+  /// @brief Classify a bounding box against the planes that are set in the mask
+  /// @param mask Active planes; cleared for the planes the box is fully in front of, so children can skip them
+  /// @param lastPlane Plane to test first; updated to the rejecting plane when the box is outside
+  FrustumTest Classify(const BoundingBox&, uint8_t&, uint8_t&) const;
+  /// @brief Test a batch of bounding boxes against the frustum using SIMD instructions (if available), set bit `i % 64` of mask word `i / 64` if box `i` is visible
+  void InFrustum(const BoundingBoxBatch&, std::vector<uint64_t>&) const;
+  /// @brief Scalar reference implementation of the batch frustum test
+  void InFrustumScalar(const BoundingBoxBatch&, std::vector<uint64_t>&) const;
+  bool operator==(const Frustum&) const = default;
 };
 } // namespace kuki
@@ -0,0 +1,76 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <kuki_engine_export.h>
+#include <unordered_map>
+namespace kuki {
+/// @brief Number of OpenGL calls a state cache issued and skipped
+struct KUKI_ENGINE_API GLStateStats {
+  size_t issued{};
+  /// @brief Number of calls that would not have changed the state
+  size_t skipped{};
+};
+/// @brief Filters out the binds and vertex format changes that would not change the OpenGL state
+/// @details Other code (the editor UI, post-processing, asset previews) changes the state behind its back, so it only tracks the state between Begin and End; outside of them every call is issued and nothing is counted
+class KUKI_ENGINE_API GLStateCache {
+private:
+  struct VertexBuffer {
+    unsigned int buffer;
+    intptr_t offset;
+    int stride;
+    bool operator==(const VertexBuffer&) const = default;
+  };
+  struct IntegerAttribute {
+    unsigned int binding;
+    int size;
+    unsigned int type;
+    unsigned int divisor;
+    bool operator==(const IntegerAttribute&) const = default;
+  };
+  bool active{false};
+  unsigned int program{0};
+  unsigned int vertexArray{0};
+  unsigned int activeUnit{0};
+  /// @brief Texture bound to each unit and target, keyed by unit in the upper and target in the lower 32 bits
+  std::unordered_map<uint64_t, unsigned int> textures;
+  std::unordered_map<unsigned int, unsigned int> buffers;
+  /// @brief Vertex buffer of each vertex array binding, keyed by vertex array in the upper and binding index in the lower 32 bits
+  std::unordered_map<uint64_t, VertexBuffer> vertexBuffers;
+  /// @brief Format of each vertex array attribute set through the cache, keyed like the vertex buffers
+  std::unordered_map<uint64_t, IntegerAttribute> attributes;
+  GLStateStats stats{};
+  /// @brief Count a call, store the value if it changes the cached one
+  /// @return true if the call must be issued
+  template <typename T>
+  bool Update(T&, const T&);
+public:
+  /// @brief Forget the cached state and reset the counters, the state is then tracked until End
+  void Begin();
+  /// @brief Unbind the vertex array and buffers bound since Begin, stop tracking the state and forget it
+  void End();
+  bool IsActive() const;
+  void UseProgram(unsigned int);
+  void BindVertexArray(unsigned int);
+  /// @brief Bind a texture to a texture unit, setting the active texture unit if needed
+  void BindTexture(unsigned int, unsigned int, unsigned int);
+  /// @brief Bind a buffer to a non-indexed target
+  void BindBuffer(unsigned int, unsigned int);
+  /// @brief Bind a buffer to a binding index of a vertex array
+  /// @param vao OpenGL ID of the vertex array
+  /// @param binding Binding index
+  /// @param buffer OpenGL ID of the buffer
+  /// @param offset Offset of the first element in bytes
+  /// @param stride Distance between elements in bytes
+  void BindVertexBuffer(unsigned int, unsigned int, unsigned int, intptr_t, int);
+  /// @brief Specify and enable an integer attribute of a vertex array that reads from a binding index with a divisor
+  /// @param vao OpenGL ID of the vertex array
+  /// @param attrib Attribute index
+  /// @param binding Binding index
+  /// @param size Number of components
+  /// @param type Component type
+  /// @param divisor Number of instances per element, 0 for per-vertex attributes
+  void SetIntegerAttribute(unsigned int, unsigned int, unsigned int, int, unsigned int, unsigned int);
+  /// @return Calls issued and skipped since Begin
+  const GLStateStats& GetStats() const;
+};
+} // namespace kuki
@@ -0,0 +1,68 @@
+#pragma once
+#include <cstddef>
+#include <kuki_engine_export.h>
+#include <span>
+#include <vector>
+namespace kuki {
+/// @brief Per-frame statistics of an instance buffer
+struct KUKI_ENGINE_API InstanceBufferStats {
+  /// @brief Number of bytes written since the last frame began
+  size_t bytes{};
+  /// @brief Number of times the CPU waited for the GPU to finish reading a region before writing to it
+  size_t stalls{};
+  /// @brief Number of times the buffer was reallocated because a frame did not fit in a region
+  size_t grows{};
+};
+/// @brief A persistently mapped buffer for per-instance attributes, split into regions that are written in turn, one per frame in flight
+/// @details Batches copy their data straight into mapped memory and bind it by offset; a fence placed at the end of each frame tells when the GPU no longer reads its region
+class KUKI_ENGINE_API InstanceBuffer {
+private:
+  unsigned int id{0};
+  std::byte* mapped{nullptr};
+  size_t regionSize;
+  size_t regionCount;
+  size_t region{0};
+  size_t head{0};
+  /// @brief Fence of each region (GLsync), null if the region is not in use by the GPU
+  std::vector<void*> fences;
+  /// @brief Buffers replaced by a larger one during the frame, deleted by the next NextFrame call so the ranges bound to them stay valid until then
+  std::vector<unsigned int> retired;
+  InstanceBufferStats stats{};
+  bool Allocate();
+  /// @brief Unmap the buffer and move it to the retired buffers
+  void Retire();
+  void WaitRegion(size_t);
+public:
+  static constexpr size_t DefaultRegionSize = 4 << 20;
+  static constexpr size_t DefaultRegionCount = 3;
+  /// @brief Alignment of the offsets returned by Write, large enough for any vertex attribute type
+  static constexpr size_t Alignment = 16;
+  /// @param regionSize Initial size of each region in bytes, it grows when a frame writes more
+  /// @param regionCount Number of frames the CPU may run ahead of the GPU
+  InstanceBuffer(size_t = DefaultRegionSize, size_t = DefaultRegionCount);
+  ~InstanceBuffer();
+  InstanceBuffer(const InstanceBuffer&) = delete;
+  InstanceBuffer& operator=(const InstanceBuffer&) = delete;
+  /// @brief Fence the writes of the current frame and move to the next region, waiting for the GPU if it still reads from it
+  void NextFrame();
+  /// @brief Copy data into the current region, the buffer is created on the first write (requires a current OpenGL context)
+  /// @param data Data to copy
+  /// @param size Size of the data in bytes
+  /// @param alignment Alignment of the returned offset, raised to Alignment if smaller (e.g. the offset alignment of shader storage buffers)
+  /// @return Offset of the data in the buffer, call GetId after writing since the buffer is replaced when it grows
+  size_t Write(const void*, size_t, size_t = Alignment);
+  template <typename T>
+  size_t Write(std::span<const T>, size_t = Alignment);
+  /// @brief Unmap and delete the buffers and the fences
+  void Clear();
+  /// @return OpenGL ID of the buffer
+  unsigned int GetId() const;
+  size_t GetRegionSize() const;
+  size_t GetRegionCount() const;
+  const InstanceBufferStats& GetStats() const;
+};
+template <typename T>
+size_t InstanceBuffer::Write(std::span<const T> data, size_t alignment) {
+  return Write(data.data(), data.size_bytes(), alignment);
+}
+} // namespace kuki
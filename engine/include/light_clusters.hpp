@@ -0,0 +1,83 @@
+#pragma once
+#include <camera.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/ext/vector_uint2.hpp>
+#include <glm/ext/vector_uint3.hpp>
+#include <kuki_engine_export.h>
+#include <light.hpp>
+#include <span>
+#include <vector>
+namespace kuki {
+/// @brief A point light as the shaders read it from the light buffer, laid out with the std430 rules
+struct KUKI_ENGINE_API LightEntry {
+  /// @brief World position, the range of the light in w
+  glm::vec4 position{0.f};
+  glm::vec4 diffuse{0.f};
+  glm::vec4 specular{0.f};
+  /// @brief Constant, linear and quadratic attenuation terms
+  glm::vec4 attenuation{0.f};
+};
+static_assert(sizeof(LightEntry) == 64, "LightEntry must match the std430 layout of the shaders");
+/// @brief Where a cluster's lights are in the index list
+struct KUKI_ENGINE_API LightCluster {
+  uint32_t offset{};
+  uint32_t count{};
+};
+/// @brief Bins the point lights into the clusters of a camera's view frustum, tiles on the screen split into slices of exponentially growing depth, so that a fragment only shades the lights whose range reaches its cluster
+class KUKI_ENGINE_API LightClusters {
+private:
+  glm::uvec3 size;
+  glm::mat4 view{1.f};
+  glm::mat4 projection{1.f};
+  float nearPlane{.1f};
+  float farPlane{100.f};
+  /// @brief Scale and bias that map the logarithm of a view depth to a slice
+  glm::vec2 depthScaleBias{0.f};
+  std::vector<LightEntry> lights;
+  std::vector<LightCluster> clusters;
+  std::vector<uint32_t> indices;
+  /// @brief Light, slice and tile range of each slice a light reaches, collected by the first pass to fill the clusters in the second
+  struct Span {
+    uint32_t light;
+    uint32_t slice;
+    glm::uvec2 min;
+    glm::uvec2 max;
+  };
+  std::vector<Span> spans;
+  uint32_t GetSlice(float) const;
+  float GetSliceDepth(uint32_t) const;
+  /// @brief Get the range of tiles covered by a view space box
+  bool GetTiles(const glm::vec3&, const glm::vec3&, glm::uvec2&, glm::uvec2&) const;
+public:
+  static constexpr unsigned int DefaultTilesX = 16;
+  static constexpr unsigned int DefaultTilesY = 9;
+  static constexpr unsigned int DefaultSlices = 24;
+  /// @brief Binding points of the lights, clusters and light indices shader storage buffers
+  static constexpr unsigned int LightBindingPoint = 3;
+  static constexpr unsigned int ClusterBindingPoint = 4;
+  static constexpr unsigned int IndexBindingPoint = 5;
+  /// @brief Fraction of its unattenuated intensity below which a light is cut off, this bounds its range
+  static constexpr float Cutoff = 1.f / 256.f;
+  /// @param tilesX Number of tiles across the screen
+  /// @param tilesY Number of tiles down the screen
+  /// @param slices Number of depth slices between the near and far planes
+  LightClusters(unsigned int = DefaultTilesX, unsigned int = DefaultTilesY, unsigned int = DefaultSlices);
+  /// @brief Collect the point lights and bin them into the clusters of the camera, the directional lights are ignored
+  void Build(const Camera&, std::span<const Light* const>);
+  /// @brief Get the distance at which the attenuation of a light drops below the cutoff
+  static float GetRange(const Light&);
+  /// @brief Get the index of the cluster that contains a view space position, as the shaders compute it
+  size_t GetClusterIndex(const glm::vec3&) const;
+  /// @return Number of tiles across, down and slices
+  glm::uvec3 GetSize() const;
+  glm::vec2 GetDepthScaleBias() const;
+  const std::vector<LightEntry>& GetLights() const;
+  const std::vector<LightCluster>& GetClusters() const;
+  const std::vector<uint32_t>& GetIndices() const;
+};
+} // namespace kuki
@@ -0,0 +1,28 @@
+#pragma once
+#include <component.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <kuki_engine_export.h>
+#include <mesh.hpp>
+#include <vector>
+namespace kuki {
+struct KUKI_ENGINE_API LODLevel {
+  Mesh mesh{};
+  /// @brief Minimum screen size (projected height of the world bounds over the viewport height) at which this level is used
+  float screenSize{};
+};
+/// @brief Meshes of decreasing detail that replace the MeshFilter's mesh when drawn, the MeshFilter's mesh still provides the culling bounds
+struct KUKI_ENGINE_API LODGroup final : public IComponent {
+  LODGroup();
+  /// @brief Levels from the most to the least detailed, with decreasing screen sizes; the last level is used below its screen size too
+  std::vector<LODLevel> levels;
+  /// @brief Level selected in the last frame, the starting point of the hysteresis
+  uint8_t current{};
+  /// @brief Select the level for the given screen size and remember it
+  /// @param screenSize Projected height of the world bounds over the viewport height
+  /// @param bias Multiplier of the screen size, values below 1 switch to coarser levels earlier to save frame time
+  /// @param hysteresis Fraction of a threshold the screen size must move past before the level changes, to avoid flickering at the boundaries
+  /// @return Index of the selected level
+  uint8_t Select(float, float = 1.f, float = .1f);
+};
+} // namespace kuki
@@ -0,0 +1,131 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <glm/ext/vector_float4.hpp>
+#include <kuki_engine_export.h>
+#include <material.hpp>
+#include <unordered_map>
+#include <vector>
+namespace kuki {
+/// @brief A material as the shaders read it from the material table, laid out with the std430 rules
+struct KUKI_ENGINE_API MaterialEntry {
+  /// @brief Albedo of a lit material, base color of an unlit one
+  glm::vec4 albedo{1.f};
+  glm::vec4 specular{0.f};
+  glm::vec4 emissive{0.f};
+  float metalness{.5f};
+  float occlusion{1.f};
+  float roughness{.5f};
+  /// @brief Texture mask of the material, without the bits of the textures that are not in a texture array
+  int textureMask{0};
+  /// @brief Layer of each texture in its texture array, in the order of MaterialProperty
+  std::array<int, 8> layers{};
+};
+static_assert(sizeof(MaterialEntry) == 96, "MaterialEntry must match the std430 layout of the shaders");
+/// @brief Location of a texture in the texture arrays
+struct KUKI_ENGINE_API TextureLayer {
+  /// @brief Index of the texture array plus one, 0 if the texture could not be packed
+  uint16_t array{};
+  int layer{};
+};
+/// @brief Where an instance finds its material
+struct KUKI_ENGINE_API MaterialIndex {
+  /// @brief Index of the entry in the material table
+  uint32_t entry{};
+  /// @brief Index of the texture arrays the material samples, instances that share it can be drawn by the same call
+  uint16_t textureSet{};
+};
+/// @brief Packs the material textures into texture arrays bucketed by size, format and sampling, and collects the materials of a frame into a table the shaders index per instance
+/// @details Instances whose textures are in the same arrays can share a draw call even if their textures differ, since each reads its layers from its table entry
+class KUKI_ENGINE_API MaterialTable {
+public:
+  static constexpr size_t SlotCount = 7;
+  /// @brief Binding point of the material table's shader storage buffer
+  static constexpr unsigned int BindingPoint = 1;
+  static constexpr int DefaultLayerCount = 16;
+  /// @brief Texture array of each texture slot, 0 if the slot is unused
+  using TextureSet = std::array<uint16_t, SlotCount>;
+  /// @brief Index of the set of untextured materials, see Add
+  static constexpr uint16_t EmptyTextureSet = 0;
+  /// @brief A material resolved against the textures that are already in the arrays, see Prepare
+  struct PreparedMaterial {
+    MaterialEntry entry{};
+    TextureSet textureSet{};
+    /// @brief Texture of each enabled slot that is not in an array yet, packed when the material is added
+    std::array<unsigned int, SlotCount> pending{};
+    bool operator==(const PreparedMaterial&) const;
+  };
+private:
+  struct ArrayKey {
+    int width;
+    int height;
+    int levels;
+    int internalFormat;
+    int wrapS;
+    int wrapT;
+    int minFilter;
+    int magFilter;
+    std::array<int, 4> swizzle;
+    bool operator==(const ArrayKey&) const = default;
+  };
+  struct TextureArray {
+    ArrayKey key;
+    unsigned int id;
+    int count;
+    int capacity;
+  };
+  int initialLayerCount;
+  int maxLayerCount{0};
+  std::vector<TextureArray> arrays;
+  std::unordered_map<unsigned int, TextureLayer> textureToLayer;
+  std::vector<MaterialEntry> entries;
+  std::unordered_map<uint64_t, uint32_t> hashToEntry;
+  /// @brief Sets added this frame, the set at index i has index i + 1 since EmptyTextureSet is not stored
+  std::vector<TextureSet> textureSets;
+  std::unordered_map<uint64_t, uint16_t> hashToTextureSet;
+  bool Grow(TextureArray&);
+  /// @brief Resolve the texture of each slot whose bit is set in the entry's texture mask, clearing the bits of the textures that cannot be packed
+  PreparedMaterial Prepare(const MaterialEntry&, const std::array<int, SlotCount>&) const;
+public:
+  /// @param layerCount Initial number of layers of a texture array, it doubles when full
+  MaterialTable(int = DefaultLayerCount);
+  ~MaterialTable();
+  MaterialTable(const MaterialTable&) = delete;
+  MaterialTable& operator=(const MaterialTable&) = delete;
+  /// @brief Get the location of a 2D texture in the texture arrays, copying it into an array of textures with the same size, format and sampling on first use (requires a current OpenGL context)
+  /// @details The texture must not change afterwards, since the arrays keep a copy of it, and EvictTexture must be called before it is deleted
+  TextureLayer GetLayer(unsigned int);
+  /// @brief Forget the location of a texture that is about to be deleted, so that a new texture that gets the same OpenGL ID is packed on its own
+  /// @details The copy keeps its layer until Clear, materials prepared before the call still sample it
+  void EvictTexture(unsigned int);
+  /// @return OpenGL ID of the texture array that holds a copy of the texture, 0 if it cannot be packed
+  unsigned int GetArray(unsigned int);
+  /// @return OpenGL ID of a texture array, 0 for index 0
+  unsigned int GetArrayId(uint16_t) const;
+  size_t GetArrayCount() const;
+  /// @brief Add an entry to the table unless an equal one exists
+  /// @return Index of the entry
+  uint32_t Add(const MaterialEntry&);
+  /// @brief Add a set of texture arrays unless an equal one exists
+  /// @return Index of the set, EmptyTextureSet if the set is empty or if the frame already has as many sets as the 16-bit index can tell apart
+  uint16_t Add(const TextureSet&);
+  /// @brief Build the entry of a material without changing the table, so that it can run on multiple threads while no other member function runs
+  PreparedMaterial Prepare(const LitMaterial&) const;
+  PreparedMaterial Prepare(const UnlitMaterial&) const;
+  PreparedMaterial Prepare(const Material&) const;
+  /// @return Hash of the prepared material, equal ones have equal hashes
+  static uint64_t Hash(const PreparedMaterial&);
+  /// @brief Add a prepared material, packing its pending textures (requires a current OpenGL context)
+  MaterialIndex Add(const PreparedMaterial&);
+  /// @brief Add a material and the texture arrays of its enabled textures
+  MaterialIndex Add(const LitMaterial&);
+  MaterialIndex Add(const UnlitMaterial&);
+  MaterialIndex Add(const Material&);
+  /// @brief Remove the entries and the texture sets while keeping the texture arrays, call this once per frame
+  void ClearEntries();
+  const std::vector<MaterialEntry>& GetEntries() const;
+  /// @brief Delete the texture arrays and remove everything
+  void Clear();
+};
+} // namespace kuki
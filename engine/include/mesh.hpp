@@ -6,10 +6,15 @@ namespace kuki {
 struct KUKI_ENGINE_API Mesh final : public IComponent {
   Mesh();
   int vao{};
+  /// @brief Element buffer of a mesh that owns one, 0 for meshes in a shared mesh buffer, whose element buffer is replaced when it grows (the vertex array always refers to the current one)
   int ebo{};
   /// @brief Number of vertices in the mesh; may include duplicates if no EBO is used
   int vertexCount{};
   int indexCount{};
+  /// @brief Offset of the mesh's first index in the index buffer, non-zero for meshes in a shared mesh buffer
+  int firstIndex{};
+  /// @brief Value added to the mesh's indices to get the vertex in the vertex buffer
+  int baseVertex{};
   BoundingBox bounds{};
 };
 } // namespace kuki
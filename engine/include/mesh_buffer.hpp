@@ -0,0 +1,56 @@
+#pragma once
+#include <cstddef>
+#include <kuki_engine_export.h>
+#include <mesh.hpp>
+#include <primitive.hpp>
+#include <span>
+namespace kuki {
+/// @brief Arguments of an indexed indirect draw, laid out as OpenGL reads them from the indirect buffer
+struct KUKI_ENGINE_API DrawElementsCommand {
+  unsigned int count{};
+  unsigned int instanceCount{};
+  unsigned int firstIndex{};
+  int baseVertex{};
+  /// @brief Index of the first instance in the instanced attribute buffers
+  unsigned int baseInstance{};
+};
+/// @brief Vertex and index buffers shared by all meshes of a vertex format, with a single vertex array
+/// @details Meshes are appended to the buffers and refer to their range with the first index and the base vertex, so meshes that share the format can be drawn by a single multi-draw call
+class KUKI_ENGINE_API MeshBuffer {
+private:
+  unsigned int vao{0};
+  unsigned int vbo{0};
+  unsigned int ebo{0};
+  bool skinned;
+  size_t vertexCapacity;
+  size_t indexCapacity;
+  size_t vertexCount{0};
+  size_t indexCount{0};
+  void Allocate();
+  /// @brief Grow the buffers to fit the given number of vertices and indices, copying the existing meshes
+  void Reserve(size_t, size_t);
+public:
+  static constexpr size_t DefaultVertexCapacity = 1 << 16;
+  static constexpr size_t DefaultIndexCapacity = 1 << 18;
+  /// @param skinned Whether the vertex format includes the bone attributes
+  /// @param vertexCapacity Initial number of vertices, the buffers grow when it is exceeded
+  /// @param indexCapacity Initial number of indices
+  MeshBuffer(bool = false, size_t = DefaultVertexCapacity, size_t = DefaultIndexCapacity);
+  ~MeshBuffer();
+  MeshBuffer(const MeshBuffer&) = delete;
+  MeshBuffer& operator=(const MeshBuffer&) = delete;
+  /// @brief Copy a mesh into the shared buffers, the buffers are created on the first call (requires a current OpenGL context)
+  /// @param vertices Vertices of the mesh
+  /// @param indices Indices of the mesh, relative to its first vertex; meshes without indices are given sequential ones so that every mesh can be drawn indirectly
+  /// @return Mesh that refers to the shared vertex array, without bounds or an element buffer of its own
+  Mesh Add(std::span<const Vertex>, std::span<const unsigned int> = {});
+  /// @brief Delete the buffers and the vertex array, the meshes added so far become invalid
+  void Clear();
+  unsigned int GetVertexArray() const;
+  unsigned int GetVertexBuffer() const;
+  unsigned int GetIndexBuffer() const;
+  size_t GetVertexCount() const;
+  size_t GetIndexCount() const;
+  bool IsSkinned() const;
+};
+} // namespace kuki
@@ -6,5 +6,7 @@ namespace kuki {
 struct KUKI_ENGINE_API MeshFilter final : public IComponent {
   MeshFilter();
   Mesh mesh{};
+  /// @brief Set this after replacing the mesh or changing its bounds, so that the spatial index picks up the new bounds
+  bool dirty{true};
 };
 } // namespace kuki
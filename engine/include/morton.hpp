@@ -0,0 +1,51 @@
+#pragma once
+#include <bounding_box.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <glm/common.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <parallel.hpp>
+#include <utility>
+#include <vector>
+namespace kuki {
+/// @brief Number of bits per axis in a 64-bit Morton code
+constexpr auto MortonBits = 21u;
+/// @brief Insert two zero bits after each of the lower 21 bits
+inline uint64_t ExpandMortonBits(uint64_t value) {
+  value &= 0x1fffff;
+  value = (value | value << 32) & 0x1f00000000ffff;
+  value = (value | value << 16) & 0x1f0000ff0000ff;
+  value = (value | value << 8) & 0x100f00f00f00f00f;
+  value = (value | value << 4) & 0x10c30c30c30c30c3;
+  value = (value | value << 2) & 0x1249249249249249;
+  return value;
+}
+/// @brief Interleave the bits of the given cell coordinates (x is the most significant bit of each triple, matching the octant order)
+inline uint64_t EncodeMorton(uint32_t x, uint32_t y, uint32_t z) {
+  return ExpandMortonBits(x) << 2 | ExpandMortonBits(y) << 1 | ExpandMortonBits(z);
+}
+/// @brief Quantize a point to a 2^21 grid spanning the given bounds, and get its Morton code
+inline uint64_t GetMortonCode(const glm::vec3& point, const BoundingBox& bounds) {
+  constexpr auto cells = static_cast<float>(1u << MortonBits);
+  auto size = glm::max(bounds.max - bounds.min, glm::vec3(1e-6f));
+  auto cell = glm::clamp((point - bounds.min) / size * cells, glm::vec3(0.f), glm::vec3(cells - 1.f));
+  return EncodeMorton(static_cast<uint32_t>(cell.x), static_cast<uint32_t>(cell.y), static_cast<uint32_t>(cell.z));
+}
+/// @brief Sort items by the Morton code of their bounds' centers so that spatially close items are adjacent (e.g., to build a BVH bottom-up)
+/// @param items Items and their bounds
+/// @param bounds Bounds that contain all items
+template <typename T>
+void SortByMortonCode(std::vector<std::pair<T, BoundingBox>>& items, const BoundingBox& bounds) {
+  std::vector<std::pair<uint64_t, size_t>> keys(items.size());
+  ParallelFor(items.size(), [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i)
+      keys[i] = {GetMortonCode((items[i].second.min + items[i].second.max) * .5f, bounds), i};
+  });
+  ParallelSort(keys.begin(), keys.end());
+  std::vector<std::pair<T, BoundingBox>> sorted;
+  sorted.reserve(items.size());
+  for (const auto& [_, index] : keys)
+    sorted.push_back(std::move(items[index]));
+  items = std::move(sorted);
+}
+} // namespace kuki
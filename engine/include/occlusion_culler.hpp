@@ -0,0 +1,59 @@
+#pragma once
+#include <bounding_box.hpp>
+#include <camera.hpp>
+#include <cstddef>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <kuki_engine_export.h>
+#include <vector>
+namespace kuki {
+/// @brief Per-frame statistics of the occlusion culler
+struct KUKI_ENGINE_API OcclusionStats {
+  /// @brief Number of occluders rasterized into the depth buffer
+  size_t occluders{};
+  /// @brief Number of occluder triangles rasterized, after rejecting the back-facing ones and the ones crossing the near plane
+  size_t triangles{};
+  /// @brief Number of bounding boxes tested against the hierarchical depth buffer
+  size_t tested{};
+  /// @brief Number of bounding boxes found to be occluded
+  size_t occluded{};
+};
+/// @brief Rasterizes occluders into a low resolution depth buffer on the CPU and tests bounding boxes against its hierarchical (max) depth
+class KUKI_ENGINE_API OcclusionCuller {
+private:
+  size_t width;
+  size_t height;
+  glm::mat4 viewProjection{1.f};
+  /// @brief Depth mip chain, level 0 is the rasterized depth and each level keeps the farthest depth of 2x2 texels of the previous one
+  std::vector<std::vector<float>> levels;
+  std::vector<size_t> levelWidths;
+  std::vector<size_t> levelHeights;
+  OcclusionStats stats{};
+  void RasterizeTriangle(const glm::vec4&, const glm::vec4&, const glm::vec4&);
+public:
+  static constexpr size_t DefaultWidth = 256;
+  static constexpr size_t DefaultHeight = 128;
+  /// @param width Width of the depth buffer, must be a positive multiple of 4
+  /// @param height Height of the depth buffer
+  OcclusionCuller(size_t = DefaultWidth, size_t = DefaultHeight);
+  /// @brief Clear the depth buffer and the statistics, and start a new frame from the camera's point of view
+  void Begin(const Camera&);
+  /// @brief Rasterize a solid box, given in local space, into the depth buffer
+  /// @param bounds Local bounds of the occluder, the occluder must fill this box for the culling to be conservative
+  /// @param world World transform of the occluder
+  void AddOccluder(const BoundingBox&, const glm::mat4& = glm::mat4(1.f));
+  /// @brief Build the hierarchical depth buffer, call this after adding all occluders and before testing
+  void BuildHiZ();
+  /// @param stats Accumulator for the tested and occluded counts (if given), owned by the caller so that several threads can test at once
+  /// @return true if the world bounds are behind the occluders everywhere on the screen, false otherwise (including the boxes that cross the near plane)
+  bool IsOccluded(const BoundingBox&, OcclusionStats* = nullptr) const;
+  /// @brief Add the tested and occluded counts gathered by the callers of IsOccluded to the statistics of this frame
+  void MergeStats(const OcclusionStats&);
+  /// @brief Get the depth (0 is near, 1 is far) at the given pixel of a mip level, rows start from the bottom of the screen
+  float GetDepth(size_t, size_t, size_t = 0) const;
+  size_t GetWidth() const;
+  size_t GetHeight() const;
+  size_t GetLevelCount() const;
+  const OcclusionStats& GetStats() const;
+};
+} // namespace kuki
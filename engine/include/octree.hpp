@@ -1,13 +1,30 @@
 #pragma once
+#include <algorithm>
+#include <bit>
 #include <camera.hpp>
+#include <cmath>
+#include <cstdint>
 #include <format>
+#include <frustum.hpp>
+#include <functional>
+#include <glm/common.hpp>
 #include <glm/ext/vector_float3.hpp>
+#include <glm/vector_relational.hpp>
 #include <id.hpp>
 #include <kuki_engine_export.h>
+#include <limits>
+#include <memory>
 #include <mesh.hpp>
+#include <morton.hpp>
+#include <occlusion_culler.hpp>
+#include <parallel.hpp>
+#include <queue>
+#include <ray.hpp>
+#include <spatial_hit.hpp>
 #include <sstream>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
+#include <vector>
 namespace kuki {
 enum class Octant : uint8_t {
   LeftBottomBack,
@@ -20,24 +37,54 @@ enum class Octant : uint8_t {
   RightTopFront,
   None
 };
-template <typename T>
+/// @brief Sort key of an item during a bulk build: the Morton code of the deepest node that contains the item, padded to the full code length
+struct OctreeBuildKey {
+  uint64_t code{};
+  size_t index{};
+  uint8_t depth{};
+};
+template <typename T, uint8_t Axes>
 class Octree;
-template <typename T>
+/// @brief A node of an octree, or of a quadtree if only two axes are split
+/// @tparam Axes Bit mask of the axes that are split when subdividing (x = 4, y = 2, z = 1, matching the octant bits)
+template <typename T, uint8_t Axes = 0b111>
 class KUKI_ENGINE_API OctreeNode {
-  friend class Octree<T>;
+  static_assert(Axes != 0 && Axes <= 0b111, "OctreeNode: at least one of the three axes must be split");
+  friend class Octree<T, Axes>;
 private:
+  static constexpr auto ChildCount = 1 << std::popcount(Axes);
+  OctreeNode* parent{};
   OctreeNode* children[8]{};
   bool leaf{true};
   const Octant octant;
   const size_t maxItems;
   const size_t minItems;
-  std::unordered_set<T> items;
-  // TODO: store item bounds for future redistribution operations
+  /// @brief Total number of items inside this node and its children
+  size_t count{};
+  /// @brief Index of the frustum plane that rejected this node during the last traversal
+  uint8_t lastPlane{};
+  std::unordered_map<T, BoundingBox> items;
   bool Insert(const T, const BoundingBox&, std::unordered_map<T, OctreeNode*>&);
+  /// @return true if the given bounding box is fully contained within this node, false otherwise
   bool Intersects(const BoundingBox&);
-  bool Subdivide();
+  /// @return true if the inner box is fully contained within the outer box, false otherwise
+  static bool Contains(const BoundingBox&, const BoundingBox&);
+  /// @brief Get the extent of the children, halved only along the split axes
+  static glm::vec3 GetChildExtent(const glm::vec3&);
+  /// @brief Get the center of the child with the given index (x, y, z bits select the positive halves)
+  static glm::vec3 GetChildCenter(const glm::vec3&, const glm::vec3&, int);
+  /// @brief Create (or recreate) the children, eight for an octree, four for a quadtree
+  void CreateChildren();
+  /// @brief Create the children of a leaf node if it holds too many items, then distribute the items that fit into the children
+  bool Subdivide(std::unordered_map<T, OctreeNode*>&);
+  /// @brief Compute the build key of an item by descending (up to the given number of levels) into the children that would contain it
+  OctreeBuildKey GetBuildKey(const BoundingBox&, size_t, size_t) const;
+  /// @brief Build the subtree from a range of sorted keys, subdividing only where the range holds more than maxItems
+  void Build(const OctreeBuildKey*, const OctreeBuildKey*, size_t, const std::vector<std::pair<T, BoundingBox>>&, std::vector<OctreeNode*>&);
   /// @brief Merge items of children into this node, then remove the children
   void Collapse(std::unordered_map<T, OctreeNode*>&);
+  /// @brief Move the items of this node and its children into the given node
+  void MoveItems(OctreeNode*, std::unordered_map<T, OctreeNode*>&);
   /// @return true if the total number of items contained within this node is not greater than minItems, false otherwise
   bool CanCollapse() const;
   /// @brief Delete all child nodes
@@ -49,11 +96,19 @@ private:
   void ForEach(F);
   template <typename F>
   void ForEachLeaf(F);
+  /// @brief Execute a function on each item in this node and its children
+  template <typename F>
+  void ForEachItem(F) const;
+  /// @brief Cull hierarchically, testing only the planes in the mask that the parent node straddles, and skipping the nodes and items hidden behind the occluders (if a culler is given)
+  template <typename F>
+  void ForEachInFrustum(const Frustum&, uint8_t, F, const OcclusionCuller*, OcclusionStats*);
+  /// @brief Cull the nodes less than the given number of levels below this one like ForEachInFrustum, collecting their items, and gather the nodes that many levels below with their plane masks instead of visiting them
+  void CollectInFrustum(const Frustum&, uint8_t, size_t, std::vector<T>&, std::vector<std::pair<OctreeNode*, uint8_t>>&, const OcclusionCuller*, OcclusionStats*);
   template <typename F>
-  void ForEachInFrustum(const Camera&, F);
+  void ForEachInFrustumReference(const Camera&, F);
   void InsertToStream(std::ostringstream&) const;
 public:
-  OctreeNode(Octant, glm::vec3, glm::vec3, size_t, size_t, size_t, size_t);
+  OctreeNode(Octant, glm::vec3, glm::vec3, size_t, size_t, size_t, size_t, OctreeNode* = nullptr);
   ~OctreeNode();
   const BoundingBox bounds;
   const glm::vec3 center;
@@ -61,11 +116,15 @@ public:
   const size_t depth;
   const size_t maxDepth;
 };
-template <typename T>
+template <typename T, uint8_t Axes = 0b111>
 class KUKI_ENGINE_API Octree {
 private:
-  OctreeNode<T> root;
-  std::unordered_map<T, OctreeNode<T>*> itemToNode;
+  /// @brief Depth of the subtrees CollectInFrustum culls concurrently, 64 of them for both octrees and quadtrees
+  static constexpr size_t ParallelDepth = OctreeNode<T, Axes>::ChildCount == 8 ? 2 : 3;
+  /// @brief Number of items below which CollectInFrustum culls on the calling thread
+  static constexpr size_t MinParallelCount = 4096;
+  std::unique_ptr<OctreeNode<T, Axes>> root;
+  std::unordered_map<T, OctreeNode<T, Axes>*> itemToNode;
 public:
   /// @brief
   /// @param center Center of the octree
@@ -74,7 +133,7 @@ public:
   /// @param minItems Minimum number of items in a node before it can be merged
   /// @param maxItems Maximum number of items in a node before it can be subdivided
   Octree(glm::vec3 = glm::vec3{.0f}, glm::vec3 = glm::vec3{10.0f}, size_t = 4, size_t = 16, size_t = 128);
-  /// @brief Insert an item into the octree
+  /// @brief Insert an item into the octree, or update its bounds if it already exists
   /// @param item Key to store the item
   /// @param bounds Bounding box of the item
   /// @return true if the item was inserted, false otherwise
@@ -82,19 +141,47 @@ public:
   /// @brief Find the item in octree, and remove it
   /// @return true if the item was found and deleted, false otherwise
   bool Delete(const T);
+  /// @brief Replace the contents of the octree with the given items, sorting them by Morton code in parallel and building the nodes top-down by splitting the sorted range
+  /// @details Faster than inserting the items one by one, but not fast enough to rebuild a million items every frame: the nodes and the item lookup are hash maps, and filling them takes far longer than a frame
+  /// @param items Unique items and their bounds, reordered so that the ones that were inserted come first
+  /// @param fit Whether to resize the root to fit all items
+  /// @return Number of items inserted (the rest did not fit into the root)
+  size_t Build(std::vector<std::pair<T, BoundingBox>>&, bool = false);
   void Clear();
   size_t GetCount() const;
+  /// @return A pointer to the bounds the item was inserted with, or nullptr if the item is not in the octree
+  const BoundingBox* GetBounds(const T) const;
   std::string ToString() const;
   template <typename F>
   void ForEach(F);
   template <typename F>
   void ForEachLeaf(F);
+  /// @brief Execute a function on each item whose bounds intersect the camera frustum
+  /// @param culler Occlusion culler with a built hierarchical depth buffer, nodes and items it reports as occluded are skipped
+  /// @param stats Accumulator for the occlusion test counts (if given), see OcclusionCuller::MergeStats
+  template <typename F>
+  void ForEachInFrustum(const Camera&, F, const OcclusionCuller* = nullptr, OcclusionStats* = nullptr);
+  /// @brief Append the items ForEachInFrustum visits to a vector, culling the subtrees concurrently
+  /// @details The order of the items differs from ForEachInFrustum's, but is the same from call to call
+  void CollectInFrustum(const Camera&, std::vector<T>&, const OcclusionCuller* = nullptr, OcclusionStats* = nullptr);
+  /// @brief Same as ForEachInFrustum, but tests all six planes at every node and item (used as a baseline for validation and benchmarks)
   template <typename F>
-  void ForEachInFrustum(const Camera&, F);
+  void ForEachInFrustumReference(const Camera&, F);
+  /// @brief Find the closest item whose bounds are hit by the ray, visiting nodes in the order the ray enters them
+  /// @return true if an item was hit, false otherwise
+  bool Raycast(const Ray&, SpatialHit<T>&, float = std::numeric_limits<float>::max()) const;
+  /// @brief Append all items whose bounds are hit by the ray, sorted by distance
+  void RaycastAll(const Ray&, std::vector<SpatialHit<T>>&, float = std::numeric_limits<float>::max()) const;
+  /// @brief Append all items whose bounds overlap the given box
+  void OverlapAABB(const BoundingBox&, std::vector<T>&) const;
+  /// @brief Append all items whose bounds overlap the sphere with the given center and radius
+  void OverlapSphere(const glm::vec3&, float, std::vector<T>&) const;
+  /// @brief Append (up to) k items closest to the given point, sorted by the distance between the point and the item bounds
+  void KNearest(const glm::vec3&, size_t, std::vector<SpatialHit<T>>&) const;
 };
-template <typename T>
+template <typename T, uint8_t Axes>
 template <typename F>
-void OctreeNode<T>::ForEach(F func) {
+void OctreeNode<T, Axes>::ForEach(F func) {
   func(this);
   if (leaf)
     return;
@@ -104,9 +191,9 @@ void OctreeNode<T>::ForEach(F func) {
     children[i]->ForEach(func);
   }
 }
-template <typename T>
+template <typename T, uint8_t Axes>
 template <typename F>
-void OctreeNode<T>::ForEachLeaf(F func) {
+void OctreeNode<T, Axes>::ForEachLeaf(F func) {
   if (leaf) {
     func(this, static_cast<Octant>(octant));
     return;
@@ -117,130 +204,338 @@ void OctreeNode<T>::ForEachLeaf(F func) {
     children[i]->ForEachLeaf(func);
   }
 }
-template <typename T>
+template <typename T, uint8_t Axes>
 template <typename F>
-void OctreeNode<T>::ForEachInFrustum(const Camera& camera, F func) {
-  if (!camera.IntersectsFrustum(bounds))
-    return;
-  for (const auto& item : items)
+void OctreeNode<T, Axes>::ForEachItem(F func) const {
+  for (const auto& [item, _] : items)
     func(item);
+  if (leaf)
+    return;
   for (auto i = 0; i < 8; ++i) {
     if (!children[i])
       continue;
-    children[i]->ForEachInFrustum(camera, func);
+    children[i]->ForEachItem(func);
   }
 }
-template <typename T>
+template <typename T, uint8_t Axes>
 template <typename F>
-void Octree<T>::ForEach(F func) {
-  root.ForEach(func);
+void OctreeNode<T, Axes>::ForEachInFrustum(const Frustum& frustum, uint8_t planeMask, F func, const OcclusionCuller* culler, OcclusionStats* stats) {
+  if (count == 0)
+    return;
+  if (frustum.Classify(bounds, planeMask, lastPlane) == FrustumTest::Outside)
+    return;
+  if (culler && culler->IsOccluded(bounds, stats))
+    return;
+  if (planeMask == 0 && !culler) {
+    // NOTE: the node is fully inside the frustum, so is everything it contains
+    ForEachItem(func);
+    return;
+  }
+  for (const auto& [item, itemBounds] : items) {
+    auto itemMask = planeMask;
+    auto itemPlane = lastPlane;
+    if (frustum.Classify(itemBounds, itemMask, itemPlane) != FrustumTest::Outside && (!culler || !culler->IsOccluded(itemBounds, stats)))
+      func(item);
+  }
+  if (leaf)
+    return;
+  for (auto i = 0; i < 8; ++i) {
+    if (!children[i])
+      continue;
+    children[i]->ForEachInFrustum(frustum, planeMask, func, culler, stats);
+  }
 }
-template <typename T>
+template <typename T, uint8_t Axes>
+void OctreeNode<T, Axes>::CollectInFrustum(const Frustum& frustum, uint8_t planeMask, size_t levels, std::vector<T>& result, std::vector<std::pair<OctreeNode*, uint8_t>>& subtrees, const OcclusionCuller* culler, OcclusionStats* stats) {
+  if (count == 0)
+    return;
+  if (levels == 0) {
+    subtrees.emplace_back(this, planeMask);
+    return;
+  }
+  if (frustum.Classify(bounds, planeMask, lastPlane) == FrustumTest::Outside)
+    return;
+  if (culler && culler->IsOccluded(bounds, stats))
+    return;
+  for (const auto& [item, itemBounds] : items) {
+    auto itemMask = planeMask;
+    auto itemPlane = lastPlane;
+    if (frustum.Classify(itemBounds, itemMask, itemPlane) != FrustumTest::Outside && (!culler || !culler->IsOccluded(itemBounds, stats)))
+      result.push_back(item);
+  }
+  if (leaf)
+    return;
+  for (auto i = 0; i < 8; ++i) {
+    if (!children[i])
+      continue;
+    children[i]->CollectInFrustum(frustum, planeMask, levels - 1, result, subtrees, culler, stats);
+  }
+}
+template <typename T, uint8_t Axes>
+template <typename F>
+void OctreeNode<T, Axes>::ForEachInFrustumReference(const Camera& camera, F func) {
+  if (count == 0 || !camera.IntersectsFrustum(bounds))
+    return;
+  for (const auto& [item, itemBounds] : items)
+    if (camera.IntersectsFrustum(itemBounds))
+      func(item);
+  if (leaf)
+    return;
+  for (auto i = 0; i < 8; ++i) {
+    if (!children[i])
+      continue;
+    children[i]->ForEachInFrustumReference(camera, func);
+  }
+}
+template <typename T, uint8_t Axes>
 template <typename F>
-void Octree<T>::ForEachLeaf(F func) {
-  root.ForEachLeaf(func);
+void Octree<T, Axes>::ForEach(F func) {
+  root->ForEach(func);
 }
-template <typename T>
+template <typename T, uint8_t Axes>
 template <typename F>
-void Octree<T>::ForEachInFrustum(const Camera& camera, F func) {
-  root.ForEachInFrustum(camera, func);
+void Octree<T, Axes>::ForEachLeaf(F func) {
+  root->ForEachLeaf(func);
 }
-template <typename T>
-OctreeNode<T>::OctreeNode(Octant octant, glm::vec3 center, glm::vec3 extent, size_t depth, size_t maxDepth, size_t minItems, size_t maxItems)
-  : octant(octant), center(center), extent(extent), depth(depth), maxDepth(maxDepth), minItems(minItems), maxItems(maxItems), bounds(center - extent, center + extent) {
+template <typename T, uint8_t Axes>
+template <typename F>
+void Octree<T, Axes>::ForEachInFrustum(const Camera& camera, F func, const OcclusionCuller* culler, OcclusionStats* stats) {
+  root->ForEachInFrustum(camera.frustum, Frustum::AllPlanes, func, culler, stats);
+}
+template <typename T, uint8_t Axes>
+void Octree<T, Axes>::CollectInFrustum(const Camera& camera, std::vector<T>& result, const OcclusionCuller* culler, OcclusionStats* stats) {
+  if (root->count < MinParallelCount) {
+    root->ForEachInFrustum(camera.frustum, Frustum::AllPlanes, [&result](T item) {
+      result.push_back(item);
+    }, culler, stats);
+    return;
+  }
+  // NOTE: the nodes near the root are culled on this thread, each subtree below them is culled by one thread only, so that the nodes' last planes are not shared
+  std::vector<std::pair<OctreeNode<T, Axes>*, uint8_t>> subtrees;
+  root->CollectInFrustum(camera.frustum, Frustum::AllPlanes, ParallelDepth, result, subtrees, culler, stats);
+  std::vector<std::vector<T>> chunkItems(GetParallelThreadCount());
+  std::vector<OcclusionStats> chunkStats(chunkItems.size());
+  auto chunks = ParallelChunks(subtrees.size(), [&](size_t chunk, size_t begin, size_t end) {
+    auto& items = chunkItems[chunk];
+    for (auto i = begin; i < end; ++i)
+      subtrees[i].first->ForEachInFrustum(camera.frustum, subtrees[i].second, [&items](T item) {
+        items.push_back(item);
+      }, culler, stats ? &chunkStats[chunk] : nullptr);
+  }, 1);
+  for (size_t i = 0; i < chunks; ++i) {
+    result.insert(result.end(), chunkItems[i].begin(), chunkItems[i].end());
+    if (stats) {
+      stats->tested += chunkStats[i].tested;
+      stats->occluded += chunkStats[i].occluded;
+    }
+  }
+}
+template <typename T, uint8_t Axes>
+template <typename F>
+void Octree<T, Axes>::ForEachInFrustumReference(const Camera& camera, F func) {
+  root->ForEachInFrustumReference(camera, func);
+}
+template <typename T, uint8_t Axes>
+OctreeNode<T, Axes>::OctreeNode(Octant octant, glm::vec3 center, glm::vec3 extent, size_t depth, size_t maxDepth, size_t minItems, size_t maxItems, OctreeNode* parent)
+  : parent(parent), octant(octant), center(center), extent(extent), depth(depth), maxDepth(maxDepth), minItems(minItems), maxItems(maxItems), bounds(center - extent, center + extent) {
   if (minItems > maxItems)
     throw std::invalid_argument(std::format("Octree: minItems ({}) cannot be greater than maxItems ({}).", minItems, maxItems));
 }
-template <typename T>
-OctreeNode<T>::~OctreeNode() {
+template <typename T, uint8_t Axes>
+OctreeNode<T, Axes>::~OctreeNode() {
   for (auto i = 0; i < 8; ++i) {
     delete children[i];
     children[i] = nullptr;
   }
 }
-template <typename T>
-Octree<T>::Octree(glm::vec3 center, glm::vec3 extent, size_t maxDepth, size_t minItems, size_t maxItems)
-  : root(Octant::None, center, extent, 0, maxDepth, minItems, maxItems) {}
-template <typename T>
-bool Octree<T>::Insert(const T item, const BoundingBox& bounds) {
+template <typename T, uint8_t Axes>
+Octree<T, Axes>::Octree(glm::vec3 center, glm::vec3 extent, size_t maxDepth, size_t minItems, size_t maxItems)
+  : root(std::make_unique<OctreeNode<T, Axes>>(Octant::None, center, extent, 0, maxDepth, minItems, maxItems)) {}
+template <typename T, uint8_t Axes>
+bool Octree<T, Axes>::Insert(const T item, const BoundingBox& bounds) {
   Delete(item);
-  return root.Insert(item, bounds, itemToNode);
+  return root->Insert(item, bounds, itemToNode);
 }
-template <typename T>
-bool OctreeNode<T>::Insert(const T item, const BoundingBox& bounds, std::unordered_map<T, OctreeNode*>& itemToNode) {
+template <typename T, uint8_t Axes>
+bool OctreeNode<T, Axes>::Insert(const T item, const BoundingBox& bounds, std::unordered_map<T, OctreeNode*>& itemToNode) {
   if (!Intersects(bounds))
     return false;
-  items.insert(item);
+  ++count;
+  if (!leaf)
+    for (auto i = 0; i < 8; ++i)
+      if (children[i] && children[i]->Insert(item, bounds, itemToNode))
+        return true;
+  items[item] = bounds;
   itemToNode[item] = this;
-  if (Subdivide())
-    // FIXME: not only insert this item, but also distribute existing items to children
-    for (auto i = 0; i < 8; i++) {
-      if (!children[i])
-        continue;
-      if (children[i]->Insert(item, bounds, itemToNode)) {
-        items.erase(item);
-        break;
-      }
-    }
+  Subdivide(itemToNode);
   return true;
 }
-template <typename T>
-bool OctreeNode<T>::Subdivide() {
+template <typename T, uint8_t Axes>
+bool OctreeNode<T, Axes>::Subdivide(std::unordered_map<T, OctreeNode*>& itemToNode) {
   if (!leaf)
     return true;
   if (items.size() <= maxItems || depth >= maxDepth)
     return false;
-  auto childExtent = extent * .5f;
-  auto childDepth = depth + 1;
-  auto childMinItems = std::max(1u, static_cast<unsigned int>(minItems / 8));
-  auto childMaxItems = std::max(1u, static_cast<unsigned int>(maxItems / 8));
-  for (auto i = 0; i < 8; ++i) {
-    auto x = (i & 4) ? childExtent.x : -childExtent.x;
-    auto y = (i & 2) ? childExtent.y : -childExtent.y;
-    auto z = (i & 1) ? childExtent.z : -childExtent.z;
-    auto offset = glm::vec3(x, y, z);
-    auto childCenter = center + offset;
-    auto childOctant = static_cast<Octant>(i);
-    if (children[i])
-      delete children[i];
-    children[i] = new OctreeNode(childOctant, childCenter, childExtent, childDepth, maxDepth, childMinItems, childMaxItems);
+  CreateChildren();
+  for (auto it = items.begin(); it != items.end();) {
+    auto moved = false;
+    for (auto i = 0; i < 8 && !moved; ++i)
+      moved = children[i] && children[i]->Insert(it->first, it->second, itemToNode);
+    it = moved ? items.erase(it) : std::next(it);
   }
-  leaf = false;
   return true;
 }
-template <typename T>
-void OctreeNode<T>::Collapse(std::unordered_map<T, OctreeNode<T>*>& itemToNode) {
+template <typename T, uint8_t Axes>
+size_t Octree<T, Axes>::Build(std::vector<std::pair<T, BoundingBox>>& items, bool fit) {
+  // NOTE: replacing the root is much cheaper than removing the items one by one
+  itemToNode.clear();
+  auto center = root->center;
+  auto extent = root->extent;
+  if (fit && !items.empty()) {
+    auto bounds = items.front().second;
+    for (const auto& [_, itemBounds] : items) {
+      bounds.min = glm::min(bounds.min, itemBounds.min);
+      bounds.max = glm::max(bounds.max, itemBounds.max);
+    }
+    center = (bounds.min + bounds.max) * .5f;
+    // NOTE: pad the extent by a few ulps so that rounding does not leave the outermost items out
+    extent = (bounds.max - bounds.min) * .5f + (glm::abs(bounds.min) + glm::abs(bounds.max)) * 1e-6f;
+  }
+  root = std::make_unique<OctreeNode<T, Axes>>(Octant::None, center, extent, 0, root->maxDepth, root->minItems, root->maxItems);
+  auto inside = std::partition(items.begin(), items.end(), [this](const std::pair<T, BoundingBox>& item) {
+    return root->Intersects(item.second);
+  });
+  auto count = static_cast<size_t>(std::distance(items.begin(), inside));
+  auto levels = std::min<size_t>(root->maxDepth, MortonBits);
+  std::vector<OctreeBuildKey> keys(count);
+  ParallelFor(count, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i)
+      keys[i] = root->GetBuildKey(items[i].second, levels, i);
+  });
+  // NOTE: for equal codes, shallower items come first, so a node's own items precede the items of its children
+  ParallelSort(keys.begin(), keys.end(), [](const OctreeBuildKey& a, const OctreeBuildKey& b) {
+    return a.code < b.code || (a.code == b.code && a.depth < b.depth);
+  });
+  std::vector<OctreeNode<T, Axes>*> nodes(count);
+  root->Build(keys.data(), keys.data() + count, levels, items, nodes);
+  itemToNode.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+    itemToNode[items[i].first] = nodes[i];
+  return count;
+}
+template <typename T, uint8_t Axes>
+OctreeBuildKey OctreeNode<T, Axes>::GetBuildKey(const BoundingBox& itemBounds, size_t levels, size_t index) const {
+  uint64_t code = 0;
+  size_t level = 0;
+  float nodeCenter[3]{center.x, center.y, center.z};
+  float nodeExtent[3]{extent.x, extent.y, extent.z};
+  // NOTE: child bounds are computed exactly like in CreateChildren, so the item lands where Insert would put it, but one axis at a time since the vector temporaries dominated the build
+  for (; level < levels; ++level) {
+    auto octant = 0;
+    auto contained = true;
+    float childCenter[3];
+    float childExtent[3];
+    for (auto axis = 0; axis < 3; ++axis) {
+      auto bit = 4 >> axis;
+      auto split = (Axes & bit) != 0;
+      childExtent[axis] = split ? nodeExtent[axis] * .5f : nodeExtent[axis];
+      // NOTE: Insert tries the children in order, so pick the lower half of each axis whenever it fits, then verify the single candidate
+      auto upper = split && itemBounds.max[axis] > (nodeCenter[axis] - childExtent[axis]) + childExtent[axis];
+      childCenter[axis] = nodeCenter[axis] + (split ? (upper ? childExtent[axis] : -childExtent[axis]) : 0.f);
+      contained &= childCenter[axis] - childExtent[axis] <= itemBounds.min[axis] && childCenter[axis] + childExtent[axis] >= itemBounds.max[axis];
+      octant |= upper ? bit : 0;
+    }
+    if (!contained)
+      break;
+    code = code << 3 | octant;
+    std::copy_n(childCenter, 3, nodeCenter);
+    std::copy_n(childExtent, 3, nodeExtent);
+  }
+  return {code << 3 * (MortonBits - level), index, static_cast<uint8_t>(level)};
+}
+template <typename T, uint8_t Axes>
+void OctreeNode<T, Axes>::Build(const OctreeBuildKey* first, const OctreeBuildKey* last, size_t levels, const std::vector<std::pair<T, BoundingBox>>& source, std::vector<OctreeNode*>& nodes) {
+  count = static_cast<size_t>(last - first);
+  auto split = last;
+  if (count > maxItems && depth < levels) {
+    split = first;
+    while (split != last && split->depth == depth)
+      ++split;
+  }
+  items.reserve(split - first);
+  for (auto key = first; key != split; ++key) {
+    items.emplace(source[key->index].first, source[key->index].second);
+    nodes[key->index] = this;
+  }
+  if (split == last)
+    return;
+  CreateChildren();
+  const OctreeBuildKey* ranges[9]{split};
+  auto shift = 3 * (MortonBits - depth - 1);
+  for (auto i = 0; i < 8; ++i)
+    ranges[i + 1] = std::partition_point(ranges[i], last, [shift, i](const OctreeBuildKey& key) {
+      return static_cast<int>(key.code >> shift & 7) <= i;
+    });
+  auto buildChildren = [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i)
+      if (children[i])
+        children[i]->Build(ranges[i], ranges[i + 1], levels, source, nodes);
+  };
+  // NOTE: subtrees are disjoint, build the top level ones concurrently
+  if (depth == 0)
+    ParallelFor(8, buildChildren, 1);
+  else
+    buildChildren(0, 8);
+}
+template <typename T, uint8_t Axes>
+void OctreeNode<T, Axes>::Collapse(std::unordered_map<T, OctreeNode<T, Axes>*>& itemToNode) {
   if (!CanCollapse())
     return;
   for (auto i = 0; i < 8; ++i) {
     if (!children[i])
       continue;
-    children[i]->Collapse(itemToNode);
-    for (auto childItem : children[i]->items) {
-      items.insert(childItem);
-      itemToNode[childItem] = this;
-    }
+    children[i]->MoveItems(this, itemToNode);
     delete children[i];
     children[i] = nullptr;
   }
   leaf = true;
 }
-template <typename T>
-bool Octree<T>::Delete(const T item) {
+template <typename T, uint8_t Axes>
+void OctreeNode<T, Axes>::MoveItems(OctreeNode* target, std::unordered_map<T, OctreeNode*>& itemToNode) {
+  for (const auto& [item, itemBounds] : items) {
+    target->items[item] = itemBounds;
+    itemToNode[item] = target;
+  }
+  items.clear();
+  for (auto i = 0; i < 8; ++i)
+    if (children[i])
+      children[i]->MoveItems(target, itemToNode);
+}
+template <typename T, uint8_t Axes>
+bool Octree<T, Axes>::Delete(const T item) {
   auto it = itemToNode.find(item);
   if (it == itemToNode.end())
     return false;
-  it->second->items.erase(item);
-  itemToNode.erase(item);
-  root.Collapse(itemToNode);
+  auto node = it->second;
+  node->items.erase(item);
+  itemToNode.erase(it);
+  // NOTE: only the ancestors of the node are affected; collapse the topmost one that became sparse enough
+  OctreeNode<T, Axes>* collapsible = nullptr;
+  for (auto current = node; current; current = current->parent) {
+    --current->count;
+    if (current->CanCollapse())
+      collapsible = current;
+  }
+  if (collapsible)
+    collapsible->Collapse(itemToNode);
   return true;
 }
-template <typename T>
-void Octree<T>::Clear() {
-  root.Clear(itemToNode);
+template <typename T, uint8_t Axes>
+void Octree<T, Axes>::Clear() {
+  root->Clear(itemToNode);
 }
-template <typename T>
-void OctreeNode<T>::Clear(std::unordered_map<T, OctreeNode*>& itemToNode) {
+template <typename T, uint8_t Axes>
+void OctreeNode<T, Axes>::Clear(std::unordered_map<T, OctreeNode*>& itemToNode) {
   for (auto i = 0; i < 8; ++i) {
     if (!children[i])
       continue;
@@ -248,53 +543,237 @@ void OctreeNode<T>::Clear(std::unordered_map<T, OctreeNode*>& itemToNode) {
     delete children[i];
     children[i] = nullptr;
   }
-  for (auto item : items)
+  for (const auto& [item, _] : items)
     itemToNode.erase(item);
   items.clear();
+  count = 0;
   leaf = true;
 }
-template <typename T>
-bool OctreeNode<T>::Intersects(const BoundingBox& other) {
-  return (bounds.min.x <= other.min.x && bounds.max.x >= other.max.x) && (bounds.min.y <= other.min.y && bounds.max.y >= other.max.y) && (bounds.min.z <= other.min.z && bounds.max.z >= other.max.z);
+template <typename T, uint8_t Axes>
+bool OctreeNode<T, Axes>::Intersects(const BoundingBox& other) {
+  return Contains(bounds, other);
 }
-template <typename T>
-bool OctreeNode<T>::CanCollapse() const {
+template <typename T, uint8_t Axes>
+bool OctreeNode<T, Axes>::Contains(const BoundingBox& outer, const BoundingBox& inner) {
+  return (outer.min.x <= inner.min.x && outer.max.x >= inner.max.x) && (outer.min.y <= inner.min.y && outer.max.y >= inner.max.y) && (outer.min.z <= inner.min.z && outer.max.z >= inner.max.z);
+}
+template <typename T, uint8_t Axes>
+glm::vec3 OctreeNode<T, Axes>::GetChildExtent(const glm::vec3& extent) {
+  auto x = (Axes & 4) ? extent.x * .5f : extent.x;
+  auto y = (Axes & 2) ? extent.y * .5f : extent.y;
+  auto z = (Axes & 1) ? extent.z * .5f : extent.z;
+  return glm::vec3(x, y, z);
+}
+template <typename T, uint8_t Axes>
+glm::vec3 OctreeNode<T, Axes>::GetChildCenter(const glm::vec3& center, const glm::vec3& childExtent, int index) {
+  auto x = (Axes & 4) ? ((index & 4) ? childExtent.x : -childExtent.x) : 0.f;
+  auto y = (Axes & 2) ? ((index & 2) ? childExtent.y : -childExtent.y) : 0.f;
+  auto z = (Axes & 1) ? ((index & 1) ? childExtent.z : -childExtent.z) : 0.f;
+  return center + glm::vec3(x, y, z);
+}
+template <typename T, uint8_t Axes>
+void OctreeNode<T, Axes>::CreateChildren() {
+  auto childExtent = GetChildExtent(extent);
+  auto childDepth = depth + 1;
+  auto childMinItems = std::max(1u, static_cast<unsigned int>(minItems / ChildCount));
+  auto childMaxItems = std::max(1u, static_cast<unsigned int>(maxItems / ChildCount));
+  for (auto i = 0; i < 8; ++i) {
+    // NOTE: children along the axes that are not split are never created
+    if (i & ~Axes)
+      continue;
+    auto childCenter = GetChildCenter(center, childExtent, i);
+    auto childOctant = static_cast<Octant>(i);
+    if (children[i])
+      delete children[i];
+    children[i] = new OctreeNode(childOctant, childCenter, childExtent, childDepth, maxDepth, childMinItems, childMaxItems, this);
+  }
+  leaf = false;
+}
+template <typename T, uint8_t Axes>
+bool OctreeNode<T, Axes>::CanCollapse() const {
   if (leaf)
     return false;
   return GetCount() <= minItems;
 }
-template <typename T>
-size_t Octree<T>::GetCount() const {
-  return root.GetCount();
+template <typename T, uint8_t Axes>
+size_t Octree<T, Axes>::GetCount() const {
+  return root->GetCount();
 }
-template <typename T>
-size_t OctreeNode<T>::GetCount() const {
-  auto total = items.size();
-  for (auto i = 0; i < 8; i++) {
-    if (!children[i])
+template <typename T, uint8_t Axes>
+const BoundingBox* Octree<T, Axes>::GetBounds(const T item) const {
+  auto it = itemToNode.find(item);
+  if (it == itemToNode.end())
+    return nullptr;
+  return &it->second->items.at(item);
+}
+template <typename T, uint8_t Axes>
+size_t OctreeNode<T, Axes>::GetCount() const {
+  return count;
+}
+template <typename T, uint8_t Axes>
+bool Octree<T, Axes>::Raycast(const Ray& ray, SpatialHit<T>& hit, float maxDistance) const {
+  using NodeEntry = std::pair<float, const OctreeNode<T, Axes>*>;
+  std::priority_queue<NodeEntry, std::vector<NodeEntry>, std::greater<NodeEntry>> queue;
+  auto found = false;
+  auto closest = maxDistance;
+  auto distance = 0.f;
+  if (root->count > 0 && ray.Intersects(root->bounds, distance, closest))
+    queue.emplace(distance, root.get());
+  while (!queue.empty()) {
+    auto [nodeDistance, node] = queue.top();
+    queue.pop();
+    // NOTE: nodes are sorted by entry distance, none of the remaining ones can contain a closer hit
+    if (found && nodeDistance > closest)
+      break;
+    for (const auto& [item, bounds] : node->items)
+      if (ray.Intersects(bounds, distance, closest) && (!found || distance < closest)) {
+        hit = {item, distance};
+        closest = distance;
+        found = true;
+      }
+    if (node->leaf)
       continue;
-    total += children[i]->GetCount();
+    for (auto i = 0; i < 8; ++i) {
+      auto child = node->children[i];
+      if (child && child->count > 0 && ray.Intersects(child->bounds, distance, closest))
+        queue.emplace(distance, child);
+    }
   }
-  return total;
+  return found;
 }
-template <typename T>
-std::string Octree<T>::ToString() const {
+template <typename T, uint8_t Axes>
+void Octree<T, Axes>::RaycastAll(const Ray& ray, std::vector<SpatialHit<T>>& hits, float maxDistance) const {
+  auto first = hits.size();
+  auto distance = 0.f;
+  std::vector<const OctreeNode<T, Axes>*> stack{root.get()};
+  while (!stack.empty()) {
+    auto node = stack.back();
+    stack.pop_back();
+    if (node->count == 0 || !ray.Intersects(node->bounds, distance, maxDistance))
+      continue;
+    for (const auto& [item, bounds] : node->items)
+      if (ray.Intersects(bounds, distance, maxDistance))
+        hits.push_back({item, distance});
+    if (node->leaf)
+      continue;
+    for (auto i = 0; i < 8; ++i)
+      if (node->children[i])
+        stack.push_back(node->children[i]);
+  }
+  std::sort(hits.begin() + first, hits.end(), [](const SpatialHit<T>& a, const SpatialHit<T>& b) {
+    return a.distance < b.distance;
+  });
+}
+template <typename T, uint8_t Axes>
+void Octree<T, Axes>::OverlapAABB(const BoundingBox& box, std::vector<T>& result) const {
+  std::vector<const OctreeNode<T, Axes>*> stack{root.get()};
+  while (!stack.empty()) {
+    auto node = stack.back();
+    stack.pop_back();
+    if (node->count == 0 || !box.Intersects(node->bounds))
+      continue;
+    if (glm::all(glm::lessThanEqual(box.min, node->bounds.min)) && glm::all(glm::greaterThanEqual(box.max, node->bounds.max))) {
+      // NOTE: the node is fully inside the query box, so is everything it contains
+      node->ForEachItem([&result](const T item) {
+        result.push_back(item);
+      });
+      continue;
+    }
+    for (const auto& [item, bounds] : node->items)
+      if (box.Intersects(bounds))
+        result.push_back(item);
+    if (node->leaf)
+      continue;
+    for (auto i = 0; i < 8; ++i)
+      if (node->children[i])
+        stack.push_back(node->children[i]);
+  }
+}
+template <typename T, uint8_t Axes>
+void Octree<T, Axes>::OverlapSphere(const glm::vec3& center, float radius, std::vector<T>& result) const {
+  auto radiusSquared = radius * radius;
+  std::vector<const OctreeNode<T, Axes>*> stack{root.get()};
+  while (!stack.empty()) {
+    auto node = stack.back();
+    stack.pop_back();
+    if (node->count == 0 || node->bounds.GetDistanceSquared(center) > radiusSquared)
+      continue;
+    for (const auto& [item, bounds] : node->items)
+      if (bounds.GetDistanceSquared(center) <= radiusSquared)
+        result.push_back(item);
+    if (node->leaf)
+      continue;
+    for (auto i = 0; i < 8; ++i)
+      if (node->children[i])
+        stack.push_back(node->children[i]);
+  }
+}
+template <typename T, uint8_t Axes>
+void Octree<T, Axes>::KNearest(const glm::vec3& point, size_t k, std::vector<SpatialHit<T>>& result) const {
+  if (k == 0)
+    return;
+  using NodeEntry = std::pair<float, const OctreeNode<T, Axes>*>;
+  std::priority_queue<NodeEntry, std::vector<NodeEntry>, std::greater<NodeEntry>> queue;
+  auto farther = [](const SpatialHit<T>& a, const SpatialHit<T>& b) {
+    return a.distance < b.distance;
+  };
+  // NOTE: a max-heap of the best candidates so far (by squared distance), the top is the one to evict
+  std::vector<SpatialHit<T>> best;
+  best.reserve(k + 1);
+  if (root->count > 0)
+    queue.emplace(root->bounds.GetDistanceSquared(point), root.get());
+  while (!queue.empty()) {
+    auto [nodeDistance, node] = queue.top();
+    queue.pop();
+    if (best.size() == k && nodeDistance > best.front().distance)
+      break;
+    for (const auto& [item, bounds] : node->items) {
+      auto distance = bounds.GetDistanceSquared(point);
+      if (best.size() == k) {
+        if (distance >= best.front().distance)
+          continue;
+        std::pop_heap(best.begin(), best.end(), farther);
+        best.pop_back();
+      }
+      best.push_back({item, distance});
+      std::push_heap(best.begin(), best.end(), farther);
+    }
+    if (node->leaf)
+      continue;
+    for (auto i = 0; i < 8; ++i) {
+      auto child = node->children[i];
+      if (child && child->count > 0)
+        queue.emplace(child->bounds.GetDistanceSquared(point), child);
+    }
+  }
+  std::sort_heap(best.begin(), best.end(), farther);
+  for (auto& hit : best) {
+    hit.distance = std::sqrt(hit.distance);
+    result.push_back(hit);
+  }
+}
+template <typename T, uint8_t Axes>
+std::string Octree<T, Axes>::ToString() const {
   std::ostringstream oss;
-  root.InsertToStream(oss);
+  root->InsertToStream(oss);
   return oss.str();
 }
-template <typename T>
-void OctreeNode<T>::InsertToStream(std::ostringstream& oss) const {
+template <typename T, uint8_t Axes>
+void OctreeNode<T, Axes>::InsertToStream(std::ostringstream& oss) const {
   if (depth > 0)
     oss << std::endl;
   for (auto i = 0; i < depth; ++i)
     oss << "  ";
   oss << "(" << center.x << "," << center.y << "," << center.z << "),(" << extent.x << "," << extent.y << "," << extent.z << ")";
-  for (const auto& item : items)
+  for (const auto& [item, _] : items)
     oss << ":" << item.ToString();
   if (leaf)
     return;
   for (const auto& child : children)
-    child->InsertToStream(oss);
+    if (child)
+      child->InsertToStream(oss);
 }
+/// @brief A quadtree on the XZ plane, for mostly flat scenes where splitting the Y axis only adds depth
+template <typename T>
+using Quadtree = Octree<T, 0b101>;
 } // namespace kuki
@@ -0,0 +1,119 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <iterator>
+#include <kuki_engine_export.h>
+#include <mutex>
+#include <thread>
+#include <vector>
+namespace kuki {
+/// @brief Get the number of threads used by the parallel algorithms, including the calling thread (at least 1)
+inline size_t GetParallelThreadCount() {
+  static const auto count = std::max(1u, std::thread::hardware_concurrency());
+  return count;
+}
+/// @brief Threads that live as long as the program and run the jobs of the parallel algorithms from a shared queue
+class KUKI_ENGINE_API WorkerPool {
+private:
+  std::vector<std::thread> workers;
+  std::deque<std::function<void()>> jobs;
+  std::mutex mutex;
+  std::condition_variable condition;
+  bool stopping{};
+  WorkerPool(size_t);
+  void Work();
+public:
+  ~WorkerPool();
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+  /// @brief Get the pool shared by the parallel algorithms, it has one worker less than GetParallelThreadCount since the calling thread takes part in the work
+  static WorkerPool& Get();
+  void Submit(std::function<void()>);
+  /// @brief Run a queued job on the calling thread, if there is one
+  /// @return true if a job was run, false if the queue was empty
+  bool RunPending();
+  size_t GetWorkerCount() const;
+};
+/// @brief Split the range [0, count) into contiguous chunks and process them concurrently on the worker pool, the calling thread processes the last chunk
+/// @param count Number of elements
+/// @param func Function that takes the beginning and the end of a chunk
+/// @param minChunk Minimum number of elements per chunk, small ranges run on the calling thread
+template <typename F>
+void ParallelFor(size_t count, F&& func, size_t minChunk = 1024) {
+  if (count == 0)
+    return;
+  auto chunks = std::min(GetParallelThreadCount(), (count + minChunk - 1) / std::max<size_t>(minChunk, 1));
+  if (chunks <= 1) {
+    func(size_t{0}, count);
+    return;
+  }
+  auto chunkSize = (count + chunks - 1) / chunks;
+  auto& pool = WorkerPool::Get();
+  std::atomic<size_t> pending{0};
+  size_t begin = 0;
+  for (; begin + chunkSize < count; begin += chunkSize) {
+    pending.fetch_add(1, std::memory_order_relaxed);
+    pool.Submit([&func, &pending, begin, end = begin + chunkSize]() {
+      func(begin, end);
+      pending.fetch_sub(1, std::memory_order_release);
+    });
+  }
+  func(begin, count);
+  // NOTE: the waiting thread runs queued jobs too, so a call made from inside a job (e.g., building the children of a node) cannot starve the pool
+  while (pending.load(std::memory_order_acquire) > 0)
+    if (!pool.RunPending())
+      std::this_thread::yield();
+}
+/// @brief Split the range [0, count) into at most one chunk per thread and process them concurrently, so that each chunk can fill its own output and the outputs can be merged in order
+/// @param count Number of elements
+/// @param func Function that takes the index of a chunk, its beginning and its end
+/// @param minChunk Minimum number of elements per chunk
+/// @return Number of chunks, at least 1 even if the range is empty
+template <typename F>
+size_t ParallelChunks(size_t count, F&& func, size_t minChunk = 1024) {
+  auto chunks = std::clamp<size_t>(count / std::max<size_t>(minChunk, 1), 1, GetParallelThreadCount());
+  ParallelFor(chunks, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i)
+      func(i, count * i / chunks, count * (i + 1) / chunks);
+  }, 1);
+  return chunks;
+}
+/// @brief Sort chunks of the range concurrently, then merge them pairwise in parallel
+template <typename It, typename C>
+void ParallelSort(It first, It last, C comp) {
+  auto count = static_cast<size_t>(std::distance(first, last));
+  constexpr size_t minChunk = 1 << 14;
+  auto chunks = std::min(GetParallelThreadCount(), count / minChunk);
+  if (chunks <= 1) {
+    std::sort(first, last, comp);
+    return;
+  }
+  std::vector<size_t> bounds(chunks + 1);
+  for (size_t i = 0; i <= chunks; ++i)
+    bounds[i] = count * i / chunks;
+  ParallelFor(chunks, [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i)
+      std::sort(first + bounds[i], first + bounds[i + 1], comp);
+  }, 1);
+  for (size_t width = 1; width < chunks; width *= 2) {
+    auto merges = (chunks + 2 * width - 1) / (2 * width);
+    ParallelFor(merges, [&](size_t begin, size_t end) {
+      for (auto i = begin; i < end; ++i) {
+        auto low = 2 * width * i;
+        auto middle = std::min(low + width, chunks);
+        auto high = std::min(low + 2 * width, chunks);
+        if (middle < high)
+          std::inplace_merge(first + bounds[low], first + bounds[middle], first + bounds[high], comp);
+      }
+    }, 1);
+  }
+}
+template <typename It>
+void ParallelSort(It first, It last) {
+  ParallelSort(first, last, std::less<>{});
+}
+} // namespace kuki
@@ -15,5 +15,6 @@ struct KUKI_ENGINE_API Plane {
   /// @brief Determines whether the given bounding box is on the positive side of the plane
   bool OnPositiveSide(const BoundingBox&) const;
   float SignedDistance(const glm::vec3&) const;
+  bool operator==(const Plane&) const = default;
 };
 } // namespace kuki
@@ -1,6 +1,9 @@
 #pragma once
 #include <concepts>
+#include <cstddef>
 #include <functional>
+#include <limits>
+#include <list>
 #include <unordered_map>
 #include <vector>
 namespace kuki {
@@ -8,36 +11,132 @@ template <typename T>
 concept IsHashable = requires(const T& t) {
   { std::hash<T>{}(t) } -> std::convertible_to<std::size_t>;
 };
+/// @brief Usage statistics of a pool
+struct PoolStats {
+  /// @brief Memory held by the resources of the pool, in use or idle, in bytes
+  std::size_t bytes{};
+  /// @brief Number of resources handed out and not released yet
+  std::size_t liveCount{};
+  std::size_t idleCount{};
+  /// @brief Number of requests served by an idle resource
+  std::size_t hits{};
+  /// @brief Number of requests that allocated a resource
+  std::size_t misses{};
+  /// @brief Number of idle resources freed to stay within the budget
+  std::size_t evictions{};
+  float GetHitRate() const {
+    auto requests = hits + misses;
+    return requests > 0 ? static_cast<float>(hits) / requests : 0.f;
+  }
+};
+/// @brief Keeps released resources for later requests with the same key, freeing the least recently released ones when the memory of the pool exceeds its budget
 template <IsHashable Key, typename Val>
 class Pool {
+private:
+  struct Entry {
+    Key key;
+    Val val;
+  };
+  /// @brief Idle resources, the most recently released first
+  std::list<Entry> idle;
+  /// @brief Idle resources of each key, the most recently released last
+  std::unordered_map<Key, std::vector<typename std::list<Entry>::iterator>> keyToIdle;
+  std::size_t budget{std::numeric_limits<std::size_t>::max()};
+  PoolStats stats{};
+  /// @brief Free the least recently released resources until a resource of the given size fits in the budget, only idle resources can be freed
+  void Evict(std::size_t size) {
+    while (!idle.empty() && stats.bytes + size > budget) {
+      auto& entry = idle.back();
+      auto it = keyToIdle.find(entry.key);
+      // NOTE: the oldest resource of the pool is also the oldest of its key
+      it->second.erase(it->second.begin());
+      if (it->second.empty())
+        keyToIdle.erase(it);
+      stats.bytes -= GetSize(entry.key);
+      Free(entry.key, entry.val);
+      idle.pop_back();
+      --stats.idleCount;
+      ++stats.evictions;
+    }
+  }
+  void AddIdle(const Key& key, Val&& val) {
+    idle.push_front({key, std::move(val)});
+    keyToIdle[key].push_back(idle.begin());
+    ++stats.idleCount;
+  }
 protected:
-  std::unordered_map<Key, std::vector<Val>> pool;
   virtual Val Allocate(const Key&) = 0;
   virtual void Reallocate(const Key&, Val&) {}
+  /// @brief Delete a resource that is evicted or cleared
+  virtual void Free(const Key&, Val&) {}
+  /// @return Memory held by a resource with the key, in bytes
+  virtual std::size_t GetSize(const Key&) const {
+    return 0;
+  }
 public:
   Pool() = default;
   virtual ~Pool() = default;
   Val Request(const Key& key) {
-    if (auto it = pool.find(key); it != pool.end() && !it->second.empty()) {
-      auto val = std::move(it->second.back());
+    if (auto it = keyToIdle.find(key); it != keyToIdle.end()) {
+      auto entry = it->second.back();
       it->second.pop_back();
+      if (it->second.empty())
+        keyToIdle.erase(it);
+      auto val = std::move(entry->val);
+      idle.erase(entry);
+      --stats.idleCount;
+      ++stats.liveCount;
+      ++stats.hits;
       return val;
     }
+    auto size = GetSize(key);
+    Evict(size);
+    stats.bytes += size;
+    ++stats.liveCount;
+    ++stats.misses;
     return Allocate(key);
   }
   template <std::convertible_to<Val>... Vals>
   void Release(const Key& key, Vals&&... vals) {
-    auto& resources = pool[key];
-    (resources.push_back(std::forward<Vals>(vals)), ...);
+    auto release = [this, &key](Val val) {
+      // NOTE: a resource the pool did not hand out adds to its memory from now on
+      if (stats.liveCount > 0)
+        --stats.liveCount;
+      else
+        stats.bytes += GetSize(key);
+      AddIdle(key, std::move(val));
+    };
+    (release(std::forward<Vals>(vals)), ...);
+    Evict(0);
   }
-  virtual void Clear() {
-    pool.clear();
+  /// @brief Free the idle resources, the ones in use are not affected
+  void Clear() {
+    for (auto& entry : idle) {
+      stats.bytes -= GetSize(entry.key);
+      Free(entry.key, entry.val);
+    }
+    idle.clear();
+    keyToIdle.clear();
+    stats.idleCount = 0;
   }
   void PreAllocate(const Key& key, std::size_t count) {
-    auto& resources = pool[key];
-    resources.reserve(resources.size() + count);
-    for (auto i = 0; i < count; ++i)
-      resources.push_back(Allocate(key));
+    auto size = GetSize(key);
+    for (std::size_t i = 0; i < count; ++i) {
+      Evict(size);
+      stats.bytes += size;
+      AddIdle(key, Allocate(key));
+    }
+  }
+  /// @brief Set the memory the pool may hold before idle resources are freed, resources in use may exceed it
+  void SetBudget(std::size_t value) {
+    budget = value;
+    Evict(0);
+  }
+  std::size_t GetBudget() const {
+    return budget;
+  }
+  const PoolStats& GetStats() const {
+    return stats;
   }
 };
 } // namespace kuki
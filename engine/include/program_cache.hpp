@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <kuki_engine_export.h>
+#include <span>
+#include <string>
+namespace kuki {
+/// @brief Number of programs a program cache loaded, missed and stored
+struct KUKI_ENGINE_API ProgramCacheStats {
+  size_t hits{};
+  /// @brief Number of programs without a binary for their sources and driver
+  size_t misses{};
+  /// @brief Number of binaries the driver did not accept, the programs are then compiled from source
+  size_t rejected{};
+  size_t stored{};
+};
+/// @brief Keeps the binaries of linked programs on disk, so that later launches skip compiling and linking them
+/// @details Each program has one file, named after it, that holds the binary of the program built from the latest sources; a hash of the sources and of the driver's vendor, renderer and version strings tells whether it is stale
+class KUKI_ENGINE_API ProgramCache {
+private:
+  std::filesystem::path directory;
+  /// @brief Vendor, renderer and version strings of the driver, read on first use
+  std::string driver;
+  /// @brief Whether the driver supports any program binary format, checked on first use
+  bool supported{false};
+  bool initialized{false};
+  ProgramCacheStats stats{};
+  /// @brief Read the driver strings and check for binary formats once there is a current context
+  bool Init();
+  uint64_t GetKey(std::span<const std::string>);
+  std::filesystem::path GetPath(const std::string&) const;
+public:
+  /// @brief Identifies the files of the cache and their layout
+  static constexpr uint32_t Magic = 0x4b50524f;
+  /// @param directory Directory of the binaries, created when the first one is stored
+  ProgramCache(const std::filesystem::path&);
+  /// @brief Create a program from the binary stored for its sources (requires a current OpenGL context)
+  /// @param name Name of the program
+  /// @param sources Source text of each stage, in the order they are attached
+  /// @return OpenGL ID of the linked program, 0 if there is no binary for the sources or the driver rejects it
+  unsigned int Load(const std::string&, std::span<const std::string>);
+  /// @brief Store the binary of a linked program, linked with the retrievable hint set (requires a current OpenGL context)
+  /// @param name Name of the program
+  /// @param program OpenGL ID of the program
+  /// @param sources Source text of each stage, in the order they are attached
+  /// @return true if the binary is written
+  bool Store(const std::string&, unsigned int, std::span<const std::string>);
+  const ProgramCacheStats& GetStats() const;
+};
+} // namespace kuki
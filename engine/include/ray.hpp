@@ -0,0 +1,21 @@
+#pragma once
+#include <bounding_box.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <kuki_engine_export.h>
+#include <limits>
+namespace kuki {
+struct KUKI_ENGINE_API Ray {
+  glm::vec3 origin{};
+  /// @brief Unit direction of the ray
+  glm::vec3 direction{.0f, .0f, -1.0f};
+  Ray();
+  Ray(const glm::vec3&, const glm::vec3&);
+  /// @brief Intersect the ray with a bounding box using the slab method
+  /// @param bounds Bounding box to test against
+  /// @param distance Distance along the ray at which it enters the box (0 if the origin is inside the box)
+  /// @param maxDistance Hits beyond this distance are ignored
+  /// @return true if the ray hits the box, false otherwise
+  bool Intersects(const BoundingBox&, float&, float = std::numeric_limits<float>::max()) const;
+  glm::vec3 GetPoint(float) const;
+};
+} // namespace kuki
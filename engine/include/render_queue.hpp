@@ -0,0 +1,81 @@
+#pragma once
+#include <component.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <kuki_engine_export.h>
+#include <material.hpp>
+#include <mesh.hpp>
+#include <vector>
+namespace kuki {
+/// @brief Passes in the order they are drawn, the most significant field of a sort key
+enum class RenderPass : uint8_t {
+  Opaque,
+  /// @brief Drawn after the opaque pass, back to front
+  Transparent
+};
+/// @brief Everything needed to draw an instance, pointing into the components of the entity (valid until the components are added or removed)
+struct KUKI_ENGINE_API RenderItem {
+  const Mesh* mesh{};
+  const Material* material{};
+  const glm::mat4* world{};
+  /// @brief Index of the material in the material table
+  uint32_t materialIndex{};
+  /// @brief Row of the world transform in the transform table
+  uint32_t transformRow{};
+};
+/// @brief A queue of draw requests ordered by 64-bit sort keys, its memory is reused from frame to frame
+class KUKI_ENGINE_API RenderQueue {
+private:
+  struct Entry {
+    uint64_t key;
+    uint32_t index;
+  };
+  std::vector<Entry> entries;
+  /// @brief Scratch buffer of the radix sort
+  std::vector<Entry> buffer;
+  std::vector<RenderItem> items;
+public:
+  // NOTE: key layout from the most to the least significant bits: pass (4), shader (4), material (16), mesh (16), depth (24)
+  static constexpr uint64_t DepthBits = 24;
+  static constexpr uint64_t DepthMask = (uint64_t{1} << DepthBits) - 1;
+  /// @brief Mask of the fields that must match for two items to be drawn in the same instanced batch
+  static constexpr uint64_t BatchMask = ~DepthMask;
+  /// @brief Mask of the pass, shader and material fields, items that match under it can be drawn by a single multi-draw call
+  static constexpr uint64_t MaterialMask = ~((uint64_t{1} << 40) - 1);
+  /// @brief Mask of the pass and shader fields, batches that match under it share the shader state
+  static constexpr uint64_t ShaderMask = uint64_t{0xFF} << 56;
+  /// @brief Pack the fields into a sort key
+  /// @param pass Render pass
+  /// @param shader Shader (material type) of the item
+  /// @param material Index of the texture arrays the material samples, see MaterialTable
+  /// @param mesh Mesh identifier, such as its VAO
+  /// @param depth Distance to the camera over the far plane distance, clamped to [0, 1]
+  static uint64_t MakeKey(RenderPass, MaterialType, uint16_t, uint16_t, float);
+  /// @brief Get a 16-bit mesh identifier, the vertex array in the upper bits keeps the meshes of a shared mesh buffer together
+  static uint16_t GetMeshKey(const Mesh&);
+  /// @brief Remove all items while keeping the allocated memory
+  void Clear();
+  void Reserve(size_t);
+  void Push(uint64_t, const RenderItem&);
+  /// @brief Sort the items by their keys with a least significant digit radix sort, skipping the digits that all keys share
+  void Sort();
+  size_t Size() const;
+  /// @brief Get the key of the i-th item in sorted order
+  uint64_t GetKey(size_t) const;
+  /// @brief Get the i-th item in sorted order
+  const RenderItem& GetItem(size_t) const;
+  /// @brief Execute a function on each run of items whose keys match under the mask, the function takes the beginning and the end of a run
+  template <typename F>
+  void ForEachBatch(F&&, uint64_t = BatchMask) const;
+};
+template <typename F>
+void RenderQueue::ForEachBatch(F&& func, uint64_t mask) const {
+  size_t begin = 0;
+  for (size_t i = 1; i <= entries.size(); ++i)
+    if (i == entries.size() || (entries[i].key & mask) != (entries[begin].key & mask)) {
+      func(begin, i);
+      begin = i;
+    }
+}
+} // namespace kuki
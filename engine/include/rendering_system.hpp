@@ -1,15 +1,32 @@
 #pragma once
+#include <bloom_chain.hpp>
+#include <cstdint>
+#include <draw_job.hpp>
+#include <dynamic_resolution.hpp>
 #include <entity_manager.hpp>
 #include <framebuffer_pool.hpp>
+#include <gl_state_cache.hpp>
 #include <glm/ext/matrix_float4x4.hpp>
+#include <instance_buffer.hpp>
 #include <kuki_engine_export.h>
+#include <light_clusters.hpp>
+#include <material_table.hpp>
+#include <mesh_buffer.hpp>
 #include <octree.hpp>
+#include <pool.hpp>
+#include <primitive.hpp>
+#include <program_cache.hpp>
+#include <render_queue.hpp>
 #include <renderbuffer_pool.hpp>
 #include <shader.hpp>
+#include <skybox.hpp>
+#include <span>
 #include <spdlog/spdlog.h>
 #include <system.hpp>
 #include <texture.hpp>
+#include <texture_cache.hpp>
 #include <texture_pool.hpp>
+#include <transform_table.hpp>
 #include <uniform_buffer_pool.hpp>
 #include <unordered_map>
 namespace kuki {
@@ -23,10 +40,60 @@ enum class GizmoMask : size_t {
   ViewFrustum = static_cast<size_t>(1) << static_cast<uint8_t>(GizmoType::ViewFrustum),
   FrustumCulling = static_cast<size_t>(1) << static_cast<uint8_t>(GizmoType::FrustumCulling),
 };
+/// @brief Statistics of the renderer's resource pools
+struct KUKI_ENGINE_API RenderPoolStats {
+  PoolStats textures;
+  PoolStats renderbuffers;
+  PoolStats framebuffers;
+  PoolStats uniformBuffers;
+};
+/// @brief Per-frame statistics of the scene view
+struct KUKI_ENGINE_API RenderStats {
+  /// @brief Number of instances submitted for drawing
+  size_t drawn{};
+  /// @brief Number of instances rejected by frustum or occlusion culling
+  size_t culled{};
+  /// @brief Number of spatial index nodes and instances rejected by occlusion culling
+  size_t occluded{};
+  /// @brief Number of draw calls issued by the scene pass, a multi-draw call counts as one
+  size_t drawCalls{};
+  /// @brief Number of instances drawn with a level of detail other than the first
+  size_t reducedDetail{};
+  /// @brief CPU time spent building and sorting the render queue, in milliseconds
+  float buildTime{};
+  /// @brief Number of bytes uploaded for the scene pass: changed transform table rows, per-instance indices, the material table and indirect commands
+  size_t uploadBytes{};
+  /// @brief Number of program, vertex array, texture, buffer and vertex format calls the state cache issued and skipped during the scene pass
+  GLStateStats stateCalls{};
+};
 class Application;
 class KUKI_ENGINE_API RenderingSystem final : public System {
+  friend class IShader;
   friend class Shader;
 private:
+  /// @brief Memory the texture and renderbuffer pools may each hold before their least recently released resources are freed
+  static constexpr size_t PoolBudget = size_t{512} << 20;
+  /// @brief Version of the bake passes, change it when their shaders change so that the bake cache is stale
+  static constexpr uint64_t BakeVersion = 2;
+  /// @brief Render targets of a view, requested from the pools and attached once, then kept until the view's size changes
+  struct ViewTargets {
+    TextureParams multiParams;
+    TextureParams singleParams;
+    /// @brief Parameters of the post-processed image, the screen size while the others are at the render scale
+    TextureParams postParams;
+    unsigned int framebufferMulti{0};
+    unsigned int framebufferSingle{0};
+    unsigned int framebufferPost{0};
+    unsigned int renderbufferMulti{0};
+    unsigned int renderbufferSingle{0};
+    unsigned int renderbufferPost{0};
+    unsigned int textureMulti{0};
+    unsigned int textureSingle{0};
+    unsigned int texturePost{0};
+    BloomChain bloom;
+    /// @brief Frame the view was last rendered in, its targets go back to the pools after a frame without it
+    size_t lastFrame{0};
+  };
   std::unordered_map<MaterialType, Shader*> shaders;
   std::unordered_map<ComputeType, ComputeShader*> computes;
   Camera assetCam{};
@@ -37,9 +104,53 @@ private:
   std::unordered_map<ID, unsigned int> assetToTexture;
   Texture brdf{}; // NOTE: generate once and re-use
   size_t fps{};
-  unsigned int materialVBO{0};
-  unsigned int transformVBO{0};
+  RenderStats renderStats{};
+  /// @brief Render targets of each view rendered by RenderSceneToTexture, keyed by its camera
+  std::unordered_map<const Camera*, ViewTargets> viewTargets;
+  /// @brief Number of frames started, see Update
+  size_t frameIndex{0};
+  /// @brief Bloom targets of the asset previews
+  BloomChain previewBloom;
+  DynamicResolution dynamicResolution;
+  /// @brief Binaries of the linked programs, so that the shaders are compiled only on the first launch and after they or the driver change
+  ProgramCache programCache;
+  /// @brief Time the programs created so far took to become ready, logged on shutdown as the startup cost of the shaders
+  float programTime{0.f};
+  /// @brief Baked image based lighting maps, keyed by a hash of the image they are baked from
+  TextureCache bakeCache;
+  /// @brief Whether the driver compiles and links in parallel with the caller (KHR_parallel_shader_compile), the programs are then polled rather than waited for
+  bool parallelCompile{false};
+  /// @brief Skips the redundant binds of the scene pass, the only stretch of the frame in which no other code changes the state
+  GLStateCache stateCache;
+  /// @brief Ring of per-instance transforms, material indices and material tables, advanced once per frame
+  InstanceBuffer instanceBuffer;
+  /// @brief Texture arrays of the material textures and the materials of the frame
+  MaterialTable materialTable;
+  /// @brief Number of material table entries in the bound shader storage buffer range
+  size_t uploadedMaterials{0};
+  /// @brief Offset alignment of shader storage buffer ranges, queried on first use
+  size_t storageAlignment{0};
+  /// @brief World transforms of the drawn entities, each entity keeps its row until it is deleted
+  TransformTable transformTable;
+  std::unordered_map<ID, uint32_t> entityToRow;
+  /// @brief Lights of the scene collected once per frame, the point lights among them are binned into the clusters of the drawing camera
+  std::vector<const Light*> sceneLights;
+  LightClusters lightClusters;
+  /// @brief Shared vertex and index buffers of the meshes, one per vertex format
+  MeshBuffer staticMeshes{false};
+  MeshBuffer skinnedMeshes{true};
+  RenderQueue renderQueue;
+  std::vector<ID> visibleEntities;
+  std::vector<DrawJob> drawJobs;
+  /// @brief Per-batch instance data, reused across batches and frames
+  std::vector<unsigned int> transformRows;
+  std::vector<unsigned int> materialIndices;
+  std::vector<DrawElementsCommand> drawCommands;
+  /// @brief 0, 1, 2, ... rows of the transforms Shader::SetTransform uploads next to their indices, only extended when a longer range is drawn
+  std::vector<unsigned int> identityRows;
   size_t gizmoMask{0};
+  float lodBias{1.f};
+  float lodHysteresis{.1f};
   static bool wireframeMode;
   /// @brief Update framebuffer attachments
   /// @param params Texture parameters
@@ -52,19 +163,71 @@ private:
   bool UpdateAttachments(const TextureParams&, unsigned int, unsigned int, T...);
   void DrawAsset(ID);
   void DrawAssetHierarchy(ID);
-  void DrawEntitiesInstanced(const Camera*, const Mesh*, const std::vector<ID>&);
+  /// @brief Draw a group of render queue items that share the shader and the texture arrays with a multi-draw call per vertex format
+  /// @param camera Camera to draw from
+  /// @param begin Index of the first item of the group
+  /// @param end Index past the last item of the group
+  /// @param bindShader Whether the group uses a different shader than the previous one, so the shader and its per-frame state must be set
+  /// @return true if the shader of the group is bound, false if the group is skipped because its program is not linked
+  bool DrawGroup(const Camera*, size_t, size_t, bool);
+  /// @brief Issue the draw calls of render queue items that share a vertex array, after their instance attributes are bound
+  void DrawMeshes(Shader*, size_t, size_t);
   void DrawFrustumCulling(const Camera*, const Camera*);
   void DrawGizmos(const Camera*, const Camera* = nullptr);
   void DrawScene(const Camera*, const Camera* = nullptr);
+  /// @brief Turn a chunk of the visible entities into draw packets, it only reads shared state (apart from the LOD groups of its entities) so jobs over different chunks can run concurrently
+  void BuildDrawJob(const Camera*, std::span<const ID>, DrawJob&) const;
   void DrawSkybox(const Camera*, const Skybox*);
   void DrawViewFrustum(const Camera*, const Camera*);
-  void ApplyPostProc(unsigned int, unsigned int, const TextureParams&);
+  /// @brief Copy the material table to the instance buffer and bind it as a shader storage buffer if entries were added since the last upload
+  void UploadMaterialTable();
+  /// @brief Copy the lights, clusters and light indices to the instance buffer and bind them as shader storage buffers
+  void UploadLightClusters();
+  size_t GetStorageAlignment();
+  /// @brief Get the transform table row of an entity, allocating one on its first draw
+  uint32_t GetTransformRow(ID, const glm::mat4&);
+  /// @brief Add bloom to an image, then tone map and gamma correct it, upscaling it if the output is larger
+  /// @param textureIn OpenGL ID of the HDR image
+  /// @param paramsIn Parameters of the HDR image
+  /// @param framebufferOut OpenGL ID of the framebuffer whose color attachment receives the result
+  /// @param paramsOut Parameters of the output attachment
+  /// @param bloom Bloom chain to use, it is resized to the image if needed
+  void ApplyPostProc(unsigned int, const TextureParams&, unsigned int, const TextureParams&, BloomChain&);
+  /// @brief Get the render targets of a view, replacing them if their sizes differ
+  /// @param camera Camera of the view
+  /// @param width Width the scene is rendered at
+  /// @param height Height the scene is rendered at
+  /// @param postWidth Width of the post-processed image
+  /// @param postHeight Height of the post-processed image
+  ViewTargets& GetViewTargets(const Camera*, int, int, int, int);
+  /// @brief Return the render targets of a view to the pools
+  void ReleaseViewTargets(ViewTargets&);
+  /// @brief Return the render targets of the views that were not rendered in the previous frame to the pools and forget them, since their cameras may be gone
+  void ReleaseUnusedViewTargets();
   BoundingBox GetAssetBounds(ID);
+  /// @brief Get a program, building it on first use
+  /// @return nullptr until the program is linked
   Shader* GetShader(MaterialType);
+  /// @brief Get a compute program, building it and waiting for it on first use
+  /// @return nullptr if the program failed to build
   ComputeShader* GetCompute(ComputeType);
+  /// @brief Get the parameters of a texture a compute pass bakes
+  /// @param type Type of the baked texture
+  /// @param size Width and height of the baked texture
+  static TextureParams GetBakeParams(TextureType, int);
+  /// @brief Get the key of a baked texture in the bake cache
+  /// @param source Hash of what the texture is baked from, 0 if it depends on nothing but its parameters
+  /// @param params Parameters of the baked texture
+  static uint64_t GetBakeKey(uint64_t, const TextureParams&);
   void UpdateEntityTransforms();
   void UpdateCameraTransforms();
 public:
+  /// @brief Sizes of the maps baked for a skybox
+  static constexpr int CubeMapSize = 1024;
+  static constexpr int IrradianceSize = 32;
+  static constexpr int PrefilterSize = 1024;
+  static constexpr int BRDFSize = 512;
+  static constexpr int SkyboxPreviewSize = 64;
   RenderingSystem(Application&);
   ~RenderingSystem();
   void Start() override;
@@ -72,15 +235,43 @@ public:
   void LateUpdate(float) override;
   void Shutdown() override;
   size_t GetFPS() const;
+  const RenderStats& GetRenderStats() const;
+  RenderPoolStats GetPoolStats() const;
   int RenderSceneToTexture(Camera* = nullptr);
   int RenderAssetToTexture(ID, const int = 64);
-  Texture CreateCubeMapFromEquirect(Texture, const int = 1024);
+  /// @brief Drop what the renderer keeps about an asset's texture, call this before the asset is deleted
+  void ReleaseAsset(ID);
+  Texture CreateCubeMapFromEquirect(Texture, const int = CubeMapSize);
   Texture CreateEquirectFromCubeMap(Texture, const int = 1024);
-  Texture CreateIrradianceMapFromCubeMap(Texture, const int = 32);
-  Texture CreatePrefilterMapFromCubeMap(Texture, const int = 1024);
-  Texture CreateBRDF_LUT(const int = 512);
+  Texture CreateIrradianceMapFromCubeMap(Texture, const int = IrradianceSize);
+  Texture CreatePrefilterMapFromCubeMap(Texture, const int = PrefilterSize);
+  /// @brief Get the BRDF lookup table, baking it on first use unless the bake cache has it
+  Texture CreateBRDF_LUT(const int = BRDFSize);
+  /// @brief Load the maps of a skybox baked from an image before, the BRDF lookup table is not among them and neither is the irradiance map if the skybox has spherical harmonics
+  /// @param hash Hash of the image's pixels, see TextureData::hash
+  /// @param skybox Skybox whose original, irradiance, prefilter and preview maps are set
+  /// @return true if the bake cache has all of the maps
+  bool LoadSkybox(uint64_t, Skybox&);
+  /// @brief Store the maps of a skybox baked from an image in the bake cache
+  /// @param hash Hash of the image's pixels, see TextureData::hash
+  /// @param skybox Skybox whose original, irradiance, prefilter and preview maps are stored
+  void StoreSkybox(uint64_t, const Skybox&);
+  /// @brief Copy a mesh into the shared buffers of its vertex format
+  /// @param vertices Vertices of the mesh
+  /// @param indices Indices of the mesh, sequential ones are generated if empty
+  /// @param skinned Whether the mesh has bone attributes
+  /// @return Mesh that refers to the shared buffers, without bounds
+  Mesh CreateMesh(std::span<const Vertex>, std::span<const unsigned int> = {}, bool = false);
   size_t GetGizmoMask() const;
   void SetGizmoMask(size_t);
+  /// @brief Set the multiplier of the screen sizes used for LOD selection, values below 1 trade quality for frame time
+  void SetLODBias(float);
+  float GetLODBias() const;
+  /// @brief Set the fraction of an LOD threshold the screen size must move past before switching levels
+  void SetLODHysteresis(float);
+  float GetLODHysteresis() const;
+  /// @return Fraction of the screen size the scene is rendered at, see AppConfig::renderScale
+  float GetRenderScale() const;
   static void ToggleWireframeMode();
 };
 #include <rendering_system.inl>
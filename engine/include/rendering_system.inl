@@ -29,12 +29,12 @@ bool RenderingSystem::UpdateAttachments(const TextureParams& params, unsigned in
     // NOTE: for cube maps and mipmapped textures, the caller is responsible for attaching the textures properly
     (bindTexture(textures), ...);
   glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, renderbuffer);
-  // FIXME: currently I'm calling this function multiple times every frame; hence, commenting out the check for performance reasons
-  //auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+  // NOTE: attachments are only updated when a view is resized or a preview is rendered, so the check does not stall every frame
+  auto status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  /*if (status != GL_FRAMEBUFFER_COMPLETE) {
+  if (status != GL_FRAMEBUFFER_COMPLETE) {
     spdlog::error("Framebuffer is incomplete ({0:x}).", status);
     return false;
-  }*/
+  }
   return true;
 }
@@ -1,20 +1,68 @@
 #pragma once
+#include <bounding_box.hpp>
+#include <camera.hpp>
 #include <entity_manager.hpp>
+#include <frustum.hpp>
+#include <glm/ext/vector_float3.hpp>
 #include <id.hpp>
 #include <kuki_engine_export.h>
+#include <limits>
+#include <occlusion_culler.hpp>
 #include <octree.hpp>
+#include <ray.hpp>
+#include <spatial_hit.hpp>
+#include <uniform_grid.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
 namespace kuki {
 class Camera;
+enum class SpatialIndexType : uint8_t {
+  Octree,
+  Quadtree,
+  UniformGrid
+};
+/// @brief Spatial index alternatives, in the order of SpatialIndexType
+using SpatialIndex = std::variant<Octree<ID>, Quadtree<ID>, UniformGrid<ID>>;
 class KUKI_ENGINE_API Scene {
 private:
   const std::string name;
   size_t id{0};
+  /// @brief World bounds of the entities that do not fit into the spatial index
+  std::unordered_map<ID, BoundingBox> outliers;
+  /// @brief Minimum number of changed entities to rebuild the spatial index instead of updating it
+  static constexpr size_t MinRebuildCount = 1024;
+  /// @brief Visible entities of a camera, reused while its frustum stays the same
+  struct VisibilityCache {
+    Frustum frustum{};
+    bool valid{};
+    std::vector<ID> visible;
+    /// @brief Entities whose bounds changed (or that were removed) since the visible set was computed
+    std::unordered_set<ID> dirty;
+  };
+  /// @brief Maximum number of cameras to cache the visible entities of
+  static constexpr size_t MaxVisibilityCaches = 8;
+  std::unordered_map<const Camera*, VisibilityCache> visibilityCaches;
+  /// @brief Remove the entity from the spatial index and the outliers
+  void DeleteSpatial(ID);
+  void MarkVisibilityDirty(ID);
+  void InvalidateVisibility();
+  /// @brief Get the entities inside the camera frustum, culling from scratch only when the frustum changed
+  const std::vector<ID>& GetVisibleEntities(const Camera&);
+  /// @brief Entities whose meshes fill their bounds, rasterized into the occlusion culler's depth buffer
+  std::unordered_set<ID> occluders;
+  OcclusionCuller occlusionCuller{};
+  bool occlusionCulling{};
+  std::vector<ID> unoccluded;
+  /// @brief Rasterize the occluders inside the camera frustum, then get the entities inside the frustum that are not hidden behind them
+  const std::vector<ID>& GetUnoccludedEntities(const Camera&);
 public:
   Scene(const std::string&, unsigned int);
   // TODO: expose helper functions to hide EntityManager and Octree details
   EntityManager entityManager{};
-  Octree<ID> octree{}; // TODO: move this into EntityManager
-  // NOTE: for most scenes, a quadtree would be more appropriate
+  SpatialIndex spatialIndex{}; // TODO: move this into EntityManager
   std::string GetName() const;
   unsigned int GetId() const;
   Camera* GetCamera();
@@ -25,26 +73,61 @@ public:
   void DeleteAllEntities(const std::string&);
   void SortTransforms();
   void UpdateTransforms();
+  /// @brief Re-insert the entities whose Transform or MeshFilter changed since the last call into the spatial index
+  void UpdateSpatialIndex();
+  /// @brief Rebuild the spatial index from all entities, resizing the tree to fit them
+  void RebuildSpatialIndex();
+  /// @brief Switch to another kind of spatial index (a quadtree suits flat scenes), and rebuild it
+  void SetSpatialIndexType(SpatialIndexType);
+  SpatialIndexType GetSpatialIndexType() const;
+  /// @brief Get the number of entities in the spatial index
+  size_t GetSpatialCount() const;
+  /// @return A pointer to the world bounds of the entity in the spatial index or the outliers, or nullptr if it is in neither
+  const BoundingBox* GetSpatialBounds(ID) const;
+  /// @brief Find the closest entity whose world bounds are hit by the ray
+  /// @return true if an entity was hit, false otherwise
+  bool Raycast(const Ray&, SpatialHit<ID>&, float = std::numeric_limits<float>::max()) const;
+  /// @brief Get all entities whose world bounds are hit by the ray, sorted by distance
+  std::vector<SpatialHit<ID>> RaycastAll(const Ray&, float = std::numeric_limits<float>::max()) const;
+  std::vector<ID> OverlapAABB(const BoundingBox&) const;
+  std::vector<ID> OverlapSphere(const glm::vec3&, float) const;
+  /// @brief Get (up to) k entities closest to the given point, sorted by distance
+  std::vector<SpatialHit<ID>> KNearest(const glm::vec3&, size_t) const;
+  /// @return true if the visible entities of the camera are cached for its current frustum, false otherwise
+  bool IsVisibilityCached(const Camera&) const;
+  /// @brief Mark an entity as an occluder, its mesh must fill its bounds (e.g., buildings and walls) since the bounds are rasterized in its place
+  void SetOccluder(ID, bool = true);
+  bool IsOccluder(ID) const;
+  /// @brief Enable or disable occlusion culling, when enabled the visible entities are culled against the occluders every frame instead of being cached
+  void SetOcclusionCulling(bool);
+  bool GetOcclusionCulling() const;
+  /// @brief Get the statistics of the last occlusion culling pass
+  const OcclusionStats& GetOcclusionStats() const;
   template <typename F>
   void ForEachVisibleEntity(const Camera&, F&&);
+  /// @brief Execute a function on each node (or cell) of the spatial index
   template <typename F>
-  void ForEachOctreeNode(F&&);
+  void ForEachSpatialNode(F&&);
+  /// @brief Execute a function on each leaf node (or cell) of the spatial index, along with its octant
   template <typename F>
-  void ForEachOctreeLeafNode(F&&);
+  void ForEachSpatialLeafNode(F&&);
 };
 template <typename F>
 void Scene::ForEachVisibleEntity(const Camera& camera, F&& func) {
-  auto func_ = std::forward(func);
-  octree.ForEachInFrustum(camera, [&](ID id) {
+  auto func_ = std::forward<F>(func);
+  for (const auto id : occlusionCulling ? GetUnoccludedEntities(camera) : GetVisibleEntities(camera))
     func_(id);
-  });
 }
 template <typename F>
-void Scene::ForEachOctreeNode(F&& func) {
-  octree.ForEach(func);
+void Scene::ForEachSpatialNode(F&& func) {
+  std::visit([&](auto& index) {
+    index.ForEach(func);
+  }, spatialIndex);
 }
 template <typename F>
-void Scene::ForEachOctreeLeafNode(F&& func) {
-  octree.ForEachLeaf(func);
+void Scene::ForEachSpatialLeafNode(F&& func) {
+  std::visit([&](auto& index) {
+    index.ForEachLeaf(func);
+  }, spatialIndex);
 }
 } // namespace kuki
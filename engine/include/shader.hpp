@@ -1,48 +1,110 @@
 #pragma once
 #include <bone_data.hpp>
 #include <camera.hpp>
+#include <chrono>
 #include <component.hpp>
+#include <cstdint>
 #include <filesystem>
 #include <glm/ext/matrix_float3x3.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_uint3.hpp>
+#include <instance_buffer.hpp>
 #include <kuki_engine_export.h>
 #include <light.hpp>
+#include <light_clusters.hpp>
 #include <material.hpp>
 #include <mesh.hpp>
+#include <mesh_buffer.hpp>
+#include <skybox.hpp>
 #include <span>
 #include <string>
 #include <unordered_map>
-#include <unordered_set>
+#include <utility>
+#include <vector>
 namespace kuki {
 class RenderingSystem;
+/// @brief Location of a uniform of type T (int for bool and sampler uniforms), resolved once after the program is linked so that setting it does no lookup
+template <typename T>
+struct Uniform {
+  /// @brief -1 if the program does not use the uniform, setting it is then a no-op
+  int location{-1};
+};
+/// @brief Build state of a shader program
+enum class ShaderStatus : uint8_t {
+  /// @brief Not built yet, programs are built on first use
+  Idle,
+  /// @brief Compiling and linking, on the driver's threads if it supports parallel compilation
+  Pending,
+  Ready,
+  Failed
+};
+/// @brief Source file and type of a shader stage
+using ShaderStage = std::pair<std::filesystem::path, int>;
 class KUKI_ENGINE_API IShader {
 private:
   const std::string name;
+  std::vector<ShaderStage> stages;
+  /// @brief Source text of each stage, kept until the program is linked to key its binary in the program cache
+  std::vector<std::string> sources;
+  /// @brief OpenGL IDs of the stages of a pending program
+  std::vector<unsigned int> stageIds;
+  ShaderStatus status{ShaderStatus::Idle};
+  /// @brief When the build started, to report how long the program took to become ready
+  std::chrono::high_resolution_clock::time_point buildStart;
+  /// @brief Check the link status of a pending program, waiting for the driver if it has not finished
+  void Finish();
 protected:
   RenderingSystem& renderer;
   unsigned int id{0};
   std::string Read(const std::filesystem::path&);
   unsigned int Compile(const char*, int);
   void CacheLocations();
+  /// @brief Called once the program is linked, to resolve what depends on its uniforms
+  virtual void OnLink();
   std::unordered_map<std::string, int> uniformToLocation;
-  std::unordered_set<int> cachedLocations;
 public:
-  IShader(const std::string&, RenderingSystem&);
+  /// @param name Name of the program
+  /// @param renderer Renderer that owns the program
+  /// @param stages Source file and type of each stage, read when the program is built
+  IShader(const std::string&, RenderingSystem&, std::vector<ShaderStage>);
   virtual ~IShader();
+  /// @brief Start building the program, from the renderer's program cache if it has a binary for the sources, otherwise from source (requires a current OpenGL context)
+  /// @details If the driver supports parallel compilation, this returns while it compiles and links, so that the programs started together compile at the same time
+  void Build();
+  /// @brief Build the program if it is idle and check whether it is linked, without waiting for a driver that compiles in parallel
+  bool IsReady();
+  /// @brief Build the program if it is idle and wait until it is linked or fails
+  /// @return true if the program is ready
+  bool Wait();
+  ShaderStatus GetStatus() const;
   const std::string& GetName() const;
   unsigned int GetId() const;
   void Use() const;
   void SetUniform(const std::string&, const glm::mat4&);
+  void SetUniform(const std::string&, const glm::vec2&);
   void SetUniform(const std::string&, const glm::vec3&);
   void SetUniform(const std::string&, const glm::vec4&);
   void SetUniform(const std::string&, float);
   void SetUniform(const std::string&, int);
   void SetUniform(const std::string&, unsigned int);
+  void SetUniform(const std::string&, const glm::uvec3&);
+  /// @brief Get the handle of a uniform, call this once after the program is linked rather than per draw
+  template <typename T>
+  Uniform<T> GetUniform(const std::string&) const;
+  template <typename T>
+  void SetUniform(Uniform<T>, const T&);
+  // NOTE: the location must be one of this program's, as returned by GetUniform
   void SetUniform(int, const glm::mat4&);
+  void SetUniform(int, const glm::vec2&);
   void SetUniform(int, const glm::vec3&);
   void SetUniform(int, const glm::vec4&);
   void SetUniform(int, float);
   void SetUniform(int, int);
   void SetUniform(int, unsigned int);
+  void SetUniform(int, const glm::uvec3&);
+  /// @brief Set the elements of an array uniform, the location is that of its first element
+  void SetUniform(int, std::span<const glm::vec3>);
 };
 class KUKI_ENGINE_API ComputeShader : public IShader {
 private:
@@ -51,42 +113,93 @@ public:
   ComputeShader(const std::string&, const std::filesystem::path&, RenderingSystem&, ComputeType = ComputeType::BRDF_LUT);
   ComputeType GetType() const;
 };
+template <typename T>
+Uniform<T> IShader::GetUniform(const std::string& name) const {
+  if (auto it = uniformToLocation.find(name); it != uniformToLocation.end())
+    return {it->second};
+  return {};
+}
+template <typename T>
+void IShader::SetUniform(Uniform<T> uniform, const T& value) {
+  SetUniform(uniform.location, value);
+}
 class KUKI_ENGINE_API Shader : public IShader {
 private:
   MaterialType type;
+  /// @brief Assign the fixed texture unit of each sampler the program uses
+  void SetSamplerUnits();
+protected:
+  void OnLink() override;
 public:
   Shader(const std::string&, const std::filesystem::path&, const std::filesystem::path&, RenderingSystem&, MaterialType = MaterialType::Unlit);
   MaterialType GetType() const;
   virtual void SetCamera(const Camera*);
-  /// @brief Set material textures and enable texture units
+  /// @brief Bind the texture arrays that hold the material's textures and enable texture units
   void SetMaterial(const Material*);
-  /// @brief Set transform attributes for a single instance
-  void SetTransform(const Mesh*, const glm::mat4&, unsigned int);
-  /// @brief Set transform attributes for multiple instances
-  void SetTransform(const Mesh*, std::span<const glm::mat4>, unsigned int);
+  /// @brief Bind a texture to a texture unit, skipping the bind if the renderer's state cache has it bound already
+  void BindTexture(unsigned int, unsigned int, unsigned int);
+  /// @return OpenGL ID of the texture array that holds a copy of the texture, see MaterialTable::GetLayer
+  unsigned int GetTextureArray(unsigned int);
+  /// @brief Set the material table index attribute for a single instance
+  void SetMaterialIndex(const Mesh*, unsigned int, InstanceBuffer&);
+  /// @brief Set the material table index attributes for multiple instances
+  void SetMaterialIndex(const Mesh*, std::span<const unsigned int>, InstanceBuffer&);
+  /// @brief Set the transform of a single instance
+  void SetTransform(const Mesh*, const glm::mat4&, InstanceBuffer&);
+  /// @brief Set the transforms of multiple instances that are not in the transform table, the transforms are written to the instance buffer and bound in place of the table
+  void SetTransform(const Mesh*, std::span<const glm::mat4>, InstanceBuffer&);
+  /// @brief Set the transform index attributes for multiple instances, the indices are rows of the bound transform table
+  void SetTransformIndex(const Mesh*, std::span<const unsigned int>, InstanceBuffer&);
   void SetBoneTransforms(const BoneData);
   virtual void Draw(const Mesh*);
-  void DrawInstanced(const Mesh*, unsigned int);
+  /// @brief Draw instances of a mesh
+  /// @param mesh Mesh to draw
+  /// @param count Number of instances
+  /// @param baseInstance Index of the first instance in the instanced attribute buffers
+  void DrawInstanced(const Mesh*, unsigned int, unsigned int = 0);
+  /// @brief Draw multiple meshes that share a vertex array with a single call, the commands are written to the instance buffer which is then used as the indirect buffer
+  void MultiDrawIndirect(unsigned int, std::span<const DrawElementsCommand>, InstanceBuffer&);
 };
 class KUKI_ENGINE_API LitShader final : public Shader {
+private:
+  struct DirLightUniforms {
+    Uniform<glm::vec3> direction;
+    Uniform<glm::vec3> ambient;
+    Uniform<glm::vec3> diffuse;
+    Uniform<glm::vec3> specular;
+  };
+  Uniform<glm::vec3> viewPos;
+  DirLightUniforms dirLight;
+  Uniform<glm::uvec3> clusterCount;
+  Uniform<glm::vec2> clusterDepth;
+  Uniform<int> hasDirLight;
+  Uniform<int> hasSkybox;
+  Uniform<int> hasIrradianceMap;
+  Uniform<int> hasIrradianceSH;
+  Uniform<std::span<const glm::vec3>> irradianceSH;
+  Uniform<int> hasPrefilterMap;
+  Uniform<int> hasBRDF;
+protected:
+  void OnLink() override;
 public:
+  // NOTE: units 0-6 are used by the material textures
+  static constexpr int IrradianceUnit = 7;
+  static constexpr int PrefilterUnit = 8;
+  static constexpr int BRDFUnit = 9;
   LitShader(const std::string&, const std::filesystem::path&, const std::filesystem::path&, RenderingSystem&);
   void SetCamera(const Camera*) override;
   void SetLighting(const Light*);
+  /// @brief Set the directional light, the point lights are read from the light clusters
   void SetLighting(std::span<const Light*>);
-  /// @brief Set lit material fallback attributes for a single instance
-  void SetMaterialFallback(const Mesh*, const LitFallbackData&, unsigned int);
-  /// @brief Set lit material fallback attributes for multiple instances
-  void SetMaterialFallback(const Mesh*, std::span<const LitFallbackData>, unsigned int);
+  /// @brief Set the layout of the light clusters whose buffers are bound, or disable the point lights if there are no clusters
+  void SetLightClusters(const LightClusters*);
+  /// @brief Bind the image based lighting maps of the skybox, or disable them if there is no skybox
+  void SetSkybox(const Skybox*);
   void Draw(const Mesh*) override;
 };
 class KUKI_ENGINE_API UnlitShader final : public Shader {
 public:
   UnlitShader(const std::string&, const std::filesystem::path&, const std::filesystem::path&, RenderingSystem&);
-  /// @brief Set unlit material fallback attributes for a single instance
-  void SetMaterialFallback(const Mesh*, const UnlitFallbackData&, unsigned int);
-  /// @brief Set unlit material fallback attributes for multiple instances
-  void SetMaterialFallback(const Mesh*, std::span<const UnlitFallbackData>, unsigned int);
   void Draw(const Mesh*) override;
 };
 } // namespace kuki
@@ -2,6 +2,7 @@
 #include <component.hpp>
 #include <glm/ext/vector_uint3.hpp>
 #include <kuki_engine_export.h>
+#include <spherical_harmonics.hpp>
 namespace kuki {
 /// @brief Texture IDs associated with a skybox component
 struct KUKI_ENGINE_API Skybox final : public IComponent {
@@ -11,5 +12,8 @@ struct KUKI_ENGINE_API Skybox final : public IComponent {
   int prefilter{};
   int brdf{};
   int preview{};
+  /// @brief Irradiance of the skybox if hasIrradianceSH is set, used in place of the irradiance map
+  SphericalHarmonics irradianceSH{};
+  bool hasIrradianceSH{false};
 };
 } // namespace kuki
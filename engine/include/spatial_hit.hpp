@@ -0,0 +1,9 @@
+#pragma once
+namespace kuki {
+template <typename T>
+struct SpatialHit {
+  T item{};
+  /// @brief Distance along the ray for raycasts, or distance to the query point for nearest neighbor queries
+  float distance{};
+};
+} // namespace kuki
@@ -0,0 +1,24 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <glm/ext/vector_float3.hpp>
+#include <kuki_engine_export.h>
+namespace kuki {
+/// @brief Diffuse irradiance of an environment as second order (L2) spherical harmonics, 9 coefficients per color channel
+struct KUKI_ENGINE_API SphericalHarmonics {
+  static constexpr size_t CoefficientCount = 9;
+  /// @brief Coefficients of the basis functions (l, m) = (0, 0), (1, -1), (1, 0), (1, 1), (2, -2), (2, -1), (2, 0), (2, 1), (2, 2), convolved with the cosine lobe and divided by pi, so that they evaluate to what the irradiance map stores
+  std::array<glm::vec3, CoefficientCount> coefficients{};
+  /// @brief Get the irradiance divided by pi for a surface normal
+  glm::vec3 Evaluate(const glm::vec3&) const;
+  /// @brief Project an equirectangular image onto the basis, its rows split among threads and its columns processed with SIMD
+  /// @param pixels Linear color of the pixels, row by row
+  /// @param width Width of the image
+  /// @param height Height of the image
+  /// @param channels Number of channels per pixel, at least 3
+  /// @param flip Whether the first row is the top of the sky (EXR) rather than the bottom, as the cube map pass samples the image
+  static SphericalHarmonics Project(const float*, int, int, int, bool = false);
+  /// @brief Project an equirectangular image onto the basis on the calling thread without SIMD, see Project
+  static SphericalHarmonics ProjectScalar(const float*, int, int, int, bool = false);
+};
+} // namespace kuki
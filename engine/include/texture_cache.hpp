@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <kuki_engine_export.h>
+#include <string>
+#include <texture_params.hpp>
+namespace kuki {
+/// @brief Number of textures a texture cache loaded, missed and stored
+struct KUKI_ENGINE_API TextureCacheStats {
+  size_t hits{};
+  size_t misses{};
+  size_t stored{};
+  /// @brief Number of bytes read from and written to the cache files
+  size_t bytes{};
+};
+/// @brief Keeps the contents of generated textures on disk, so that later launches upload them instead of generating them again
+/// @details Each texture has one file, named after it, that holds every level and face; color textures are stored as R11G11B10F and two-channel ones as RG16F, four bytes per texel, which the driver converts on upload
+class KUKI_ENGINE_API TextureCache {
+private:
+  std::filesystem::path directory;
+  TextureCacheStats stats{};
+  std::filesystem::path GetPath(const std::string&) const;
+public:
+  /// @brief Identifies the files of the cache and their layout
+  static constexpr uint32_t Magic = 0x4b544558;
+  /// @param directory Directory of the textures, created when the first one is stored
+  TextureCache(const std::filesystem::path&);
+  /// @brief Upload the texture stored under a name (requires a current OpenGL context)
+  /// @param name Name of the texture
+  /// @param key Hash of what the texture is generated from, a stored texture with another key is stale
+  /// @param texture OpenGL ID of a texture allocated with the parameters
+  /// @param params Parameters of the texture, a stored texture with other parameters is stale
+  /// @return true if the texture is uploaded
+  bool Load(const std::string&, uint64_t, unsigned int, const TextureParams&);
+  /// @brief Store the levels of a texture under a name (requires a current OpenGL context)
+  /// @param name Name of the texture
+  /// @param key Hash of what the texture is generated from
+  /// @param texture OpenGL ID of the texture
+  /// @param params Parameters of the texture
+  /// @return true if the texture is written
+  bool Store(const std::string&, uint64_t, unsigned int, const TextureParams&);
+  const TextureCacheStats& GetStats() const;
+  /// @brief Hash bytes eight at a time, each word mixed as in MurmurHash64A and the result finished with the MurmurHash3 avalanche
+  /// @param data Bytes to hash
+  /// @param size Number of bytes
+  /// @param seed Hash to continue from
+  static uint64_t Hash(const void*, size_t, uint64_t = 0xcbf29ce484222325ull);
+};
+} // namespace kuki
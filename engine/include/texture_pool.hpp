@@ -1,4 +1,5 @@
 #pragma once
+#include <cstddef>
 #include <kuki_engine_export.h>
 #include <pool.hpp>
 #include <texture_params.hpp>
@@ -7,8 +8,9 @@ class KUKI_ENGINE_API TexturePool final : public Pool<TextureParams, unsigned in
 protected:
   unsigned int Allocate(const TextureParams&) override;
   void Reallocate(const TextureParams&, unsigned int&) override;
+  void Free(const TextureParams&, unsigned int&) override;
+  size_t GetSize(const TextureParams&) const override;
 public:
   ~TexturePool() override;
-  void Clear() override;
 };
 } // namespace kuki
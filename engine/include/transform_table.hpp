@@ -0,0 +1,51 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <kuki_engine_export.h>
+#include <vector>
+namespace kuki {
+/// @brief A GPU table of world transforms whose rows stay with their owners from frame to frame, only the rows that changed are uploaded
+/// @details Instances refer to their rows by index, so a static scene uploads no transforms after its first frame
+class KUKI_ENGINE_API TransformTable {
+private:
+  unsigned int id{0};
+  size_t capacity;
+  /// @brief Copy of the rows on the CPU, the source of the uploads
+  std::vector<glm::mat4> rows;
+  std::vector<uint32_t> freeRows;
+  std::vector<uint8_t> dirty;
+  std::vector<uint32_t> dirtyRows;
+  void MarkDirty(uint32_t);
+  /// @brief Create the buffer, or a larger one that takes over the old contents when the rows do not fit
+  void Grow();
+public:
+  /// @brief Binding point of the table's shader storage buffer
+  static constexpr unsigned int BindingPoint = 2;
+  static constexpr size_t DefaultCapacity = 1024;
+  /// @param capacity Initial number of rows of the buffer, it doubles when full
+  TransformTable(size_t = DefaultCapacity);
+  ~TransformTable();
+  TransformTable(const TransformTable&) = delete;
+  TransformTable& operator=(const TransformTable&) = delete;
+  /// @brief Allocate a row, reusing a removed one if possible
+  /// @return Index of the row
+  uint32_t Add(const glm::mat4&);
+  /// @brief Free a row for reuse, its contents are left as they are
+  void Remove(uint32_t);
+  /// @brief Change the transform of a row, it is uploaded by the next Upload call
+  void Set(uint32_t, const glm::mat4&);
+  /// @brief Copy the changed rows to the buffer, one upload per run of adjacent rows (requires a current OpenGL context)
+  /// @return Number of bytes uploaded
+  size_t Upload();
+  /// @brief Bind the buffer to BindingPoint
+  void Bind() const;
+  /// @brief Delete the buffer and remove all rows
+  void Clear();
+  /// @return OpenGL ID of the buffer
+  unsigned int GetId() const;
+  /// @brief Get the number of rows, including the removed ones
+  size_t GetRowCount() const;
+  size_t GetCapacity() const;
+};
+} // namespace kuki
@@ -1,5 +1,6 @@
 #pragma once
 #include <buffer_params.hpp>
+#include <cstddef>
 #include <kuki_engine_export.h>
 #include <pool.hpp>
 namespace kuki {
@@ -7,8 +8,9 @@ class KUKI_ENGINE_API UniformBufferPool final : public Pool<BufferParams, unsign
 protected:
   unsigned int Allocate(const BufferParams&) override;
   void Reallocate(const BufferParams&, unsigned int&) override;
+  void Free(const BufferParams&, unsigned int&) override;
+  size_t GetSize(const BufferParams&) const override;
 public:
   ~UniformBufferPool() override;
-  void Clear() override;
 };
 } // namespace kuki
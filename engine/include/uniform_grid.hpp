@@ -0,0 +1,393 @@
+#pragma once
+#include <algorithm>
+#include <bounding_box.hpp>
+#include <camera.hpp>
+#include <cmath>
+#include <cstdint>
+#include <format>
+#include <frustum.hpp>
+#include <glm/common.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <kuki_engine_export.h>
+#include <limits>
+#include <morton.hpp>
+#include <occlusion_culler.hpp>
+#include <octree.hpp>
+#include <parallel.hpp>
+#include <ray.hpp>
+#include <spatial_hit.hpp>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+namespace kuki {
+/// @brief A cell of a uniform grid, holding the items whose centers fall inside it
+template <typename T>
+struct GridCell {
+  /// @brief Cells are not nested, depth is kept for parity with OctreeNode
+  static constexpr size_t depth = 0;
+  static constexpr size_t maxDepth = 0;
+  glm::vec3 center{};
+  glm::vec3 extent{};
+  BoundingBox bounds;
+  /// @brief Union of the bounds of the items, which may stick out of the cell
+  BoundingBox looseBounds;
+  /// @brief Index of the frustum plane that rejected this cell during the last traversal
+  uint8_t lastPlane{};
+  std::unordered_map<T, BoundingBox> items;
+  void UpdateLooseBounds();
+};
+/// @brief A hashed uniform grid that has no bounds, suited for large flat worlds and frequently moving items
+template <typename T>
+class KUKI_ENGINE_API UniformGrid {
+private:
+  glm::vec3 cellSize;
+  std::unordered_map<uint64_t, GridCell<T>> cells;
+  std::unordered_map<T, uint64_t> itemToCell;
+  /// @brief Largest half extent of the items inserted since the last clear, the distance an item may stick out of its cell
+  glm::vec3 maxItemExtent{};
+  glm::vec3 GetCellCoords(const glm::vec3&) const;
+  uint64_t GetCellKey(const glm::vec3&) const;
+  GridCell<T>& GetCell(uint64_t, const glm::vec3&);
+  /// @brief Cull a cell and the items in it, see ForEachInFrustum
+  template <typename F>
+  static void CullCell(const Camera&, GridCell<T>&, F, const OcclusionCuller*, OcclusionStats*);
+  /// @brief Execute a function on each cell that may contain items overlapping the given box
+  template <typename F>
+  void ForEachCellOverlapping(const BoundingBox&, F) const;
+public:
+  /// @param cellSize Size of the cells (use a large Y size for flat worlds)
+  UniformGrid(glm::vec3 = glm::vec3{16.0f});
+  /// @brief Insert an item into the grid, or update its bounds if it already exists
+  /// @return true (the grid is unbounded, every item fits)
+  bool Insert(const T, const BoundingBox&);
+  /// @return true if the item was found and deleted, false otherwise
+  bool Delete(const T);
+  /// @brief Replace the contents of the grid with the given items, grouping them by cell in parallel
+  /// @return Number of items inserted (always all of them, the second parameter exists for parity with Octree)
+  size_t Build(std::vector<std::pair<T, BoundingBox>>&, bool = false);
+  void Clear();
+  size_t GetCount() const;
+  const BoundingBox* GetBounds(const T) const;
+  glm::vec3 GetCellSize() const;
+  template <typename F>
+  void ForEach(F);
+  /// @brief Execute a function on each non-empty cell, with the same signature as Octree::ForEachLeaf
+  template <typename F>
+  void ForEachLeaf(F);
+  /// @brief Execute a function on each item whose bounds intersect the camera frustum, skipping the cells and items the culler (if any) reports as occluded
+  template <typename F>
+  void ForEachInFrustum(const Camera&, F, const OcclusionCuller* = nullptr, OcclusionStats* = nullptr);
+  /// @brief Append the items ForEachInFrustum visits to a vector, culling chunks of cells concurrently
+  /// @details The order of the items may differ from ForEachInFrustum's
+  void CollectInFrustum(const Camera&, std::vector<T>&, const OcclusionCuller* = nullptr, OcclusionStats* = nullptr);
+  bool Raycast(const Ray&, SpatialHit<T>&, float = std::numeric_limits<float>::max()) const;
+  void RaycastAll(const Ray&, std::vector<SpatialHit<T>>&, float = std::numeric_limits<float>::max()) const;
+  void OverlapAABB(const BoundingBox&, std::vector<T>&) const;
+  void OverlapSphere(const glm::vec3&, float, std::vector<T>&) const;
+  void KNearest(const glm::vec3&, size_t, std::vector<SpatialHit<T>>&) const;
+};
+template <typename T>
+void GridCell<T>::UpdateLooseBounds() {
+  if (items.empty())
+    return;
+  looseBounds = items.begin()->second;
+  for (const auto& [_, itemBounds] : items) {
+    looseBounds.min = glm::min(looseBounds.min, itemBounds.min);
+    looseBounds.max = glm::max(looseBounds.max, itemBounds.max);
+  }
+}
+template <typename T>
+UniformGrid<T>::UniformGrid(glm::vec3 cellSize)
+  : cellSize(cellSize) {
+  if (cellSize.x <= 0.f || cellSize.y <= 0.f || cellSize.z <= 0.f)
+    throw std::invalid_argument(std::format("UniformGrid: cell size ({}, {}, {}) must be positive.", cellSize.x, cellSize.y, cellSize.z));
+}
+template <typename T>
+glm::vec3 UniformGrid<T>::GetCellCoords(const glm::vec3& point) const {
+  // NOTE: coordinates are clamped to the 21 bits per axis a Morton code can hold
+  constexpr auto limit = static_cast<float>(1 << (MortonBits - 1));
+  return glm::clamp(glm::floor(point / cellSize), glm::vec3(-limit), glm::vec3(limit - 1.f));
+}
+template <typename T>
+uint64_t UniformGrid<T>::GetCellKey(const glm::vec3& coords) const {
+  constexpr auto bias = 1 << (MortonBits - 1);
+  return EncodeMorton(static_cast<uint32_t>(static_cast<int32_t>(coords.x) + bias), static_cast<uint32_t>(static_cast<int32_t>(coords.y) + bias), static_cast<uint32_t>(static_cast<int32_t>(coords.z) + bias));
+}
+template <typename T>
+GridCell<T>& UniformGrid<T>::GetCell(uint64_t key, const glm::vec3& coords) {
+  auto [it, inserted] = cells.try_emplace(key);
+  auto& cell = it->second;
+  if (inserted) {
+    cell.extent = cellSize * .5f;
+    cell.center = (coords + .5f) * cellSize;
+    cell.bounds = BoundingBox(coords * cellSize, (coords + 1.f) * cellSize);
+  }
+  return cell;
+}
+template <typename T>
+bool UniformGrid<T>::Insert(const T item, const BoundingBox& bounds) {
+  Delete(item);
+  auto coords = GetCellCoords((bounds.min + bounds.max) * .5f);
+  auto key = GetCellKey(coords);
+  auto& cell = GetCell(key, coords);
+  if (cell.items.empty())
+    cell.looseBounds = bounds;
+  cell.looseBounds.min = glm::min(cell.looseBounds.min, bounds.min);
+  cell.looseBounds.max = glm::max(cell.looseBounds.max, bounds.max);
+  cell.items[item] = bounds;
+  itemToCell[item] = key;
+  maxItemExtent = glm::max(maxItemExtent, (bounds.max - bounds.min) * .5f);
+  return true;
+}
+template <typename T>
+bool UniformGrid<T>::Delete(const T item) {
+  auto it = itemToCell.find(item);
+  if (it == itemToCell.end())
+    return false;
+  auto cellIt = cells.find(it->second);
+  itemToCell.erase(it);
+  auto& cell = cellIt->second;
+  cell.items.erase(item);
+  if (cell.items.empty())
+    cells.erase(cellIt);
+  else
+    cell.UpdateLooseBounds();
+  return true;
+}
+template <typename T>
+size_t UniformGrid<T>::Build(std::vector<std::pair<T, BoundingBox>>& items, bool) {
+  Clear();
+  std::vector<std::pair<uint64_t, size_t>> keys(items.size());
+  ParallelFor(items.size(), [&](size_t begin, size_t end) {
+    for (auto i = begin; i < end; ++i)
+      keys[i] = {GetCellKey(GetCellCoords((items[i].second.min + items[i].second.max) * .5f)), i};
+  });
+  ParallelSort(keys.begin(), keys.end());
+  itemToCell.reserve(items.size());
+  for (size_t first = 0; first < keys.size();) {
+    auto last = first;
+    while (last < keys.size() && keys[last].first == keys[first].first)
+      ++last;
+    const auto& firstBounds = items[keys[first].second].second;
+    auto& cell = GetCell(keys[first].first, GetCellCoords((firstBounds.min + firstBounds.max) * .5f));
+    cell.items.reserve(last - first);
+    for (auto i = first; i < last; ++i) {
+      const auto& [item, bounds] = items[keys[i].second];
+      cell.items.emplace(item, bounds);
+      itemToCell.emplace(item, keys[i].first);
+      maxItemExtent = glm::max(maxItemExtent, (bounds.max - bounds.min) * .5f);
+    }
+    cell.UpdateLooseBounds();
+    first = last;
+  }
+  return items.size();
+}
+template <typename T>
+void UniformGrid<T>::Clear() {
+  cells.clear();
+  itemToCell.clear();
+  maxItemExtent = glm::vec3(0.f);
+}
+template <typename T>
+size_t UniformGrid<T>::GetCount() const {
+  return itemToCell.size();
+}
+template <typename T>
+const BoundingBox* UniformGrid<T>::GetBounds(const T item) const {
+  auto it = itemToCell.find(item);
+  if (it == itemToCell.end())
+    return nullptr;
+  return &cells.at(it->second).items.at(item);
+}
+template <typename T>
+glm::vec3 UniformGrid<T>::GetCellSize() const {
+  return cellSize;
+}
+template <typename T>
+template <typename F>
+void UniformGrid<T>::ForEach(F func) {
+  for (auto& [_, cell] : cells)
+    func(&cell);
+}
+template <typename T>
+template <typename F>
+void UniformGrid<T>::ForEachLeaf(F func) {
+  for (auto& [_, cell] : cells)
+    func(&cell, Octant::None);
+}
+template <typename T>
+template <typename F>
+void UniformGrid<T>::CullCell(const Camera& camera, GridCell<T>& cell, F func, const OcclusionCuller* culler, OcclusionStats* stats) {
+  auto planeMask = Frustum::AllPlanes;
+  if (camera.frustum.Classify(cell.looseBounds, planeMask, cell.lastPlane) == FrustumTest::Outside)
+    return;
+  if (culler && culler->IsOccluded(cell.looseBounds, stats))
+    return;
+  for (const auto& [item, itemBounds] : cell.items) {
+    auto itemMask = planeMask;
+    auto itemPlane = cell.lastPlane;
+    if ((planeMask == 0 || camera.frustum.Classify(itemBounds, itemMask, itemPlane) != FrustumTest::Outside) && (!culler || !culler->IsOccluded(itemBounds, stats)))
+      func(item);
+  }
+}
+template <typename T>
+template <typename F>
+void UniformGrid<T>::ForEachInFrustum(const Camera& camera, F func, const OcclusionCuller* culler, OcclusionStats* stats) {
+  for (auto& [_, cell] : cells)
+    CullCell(camera, cell, func, culler, stats);
+}
+template <typename T>
+void UniformGrid<T>::CollectInFrustum(const Camera& camera, std::vector<T>& result, const OcclusionCuller* culler, OcclusionStats* stats) {
+  // NOTE: the cells are gathered first since the hash map cannot be split into ranges
+  std::vector<GridCell<T>*> cellPointers;
+  cellPointers.reserve(cells.size());
+  for (auto& [_, cell] : cells)
+    cellPointers.push_back(&cell);
+  std::vector<std::vector<T>> chunkItems(GetParallelThreadCount());
+  std::vector<OcclusionStats> chunkStats(chunkItems.size());
+  constexpr size_t minChunk = 64;
+  auto chunks = ParallelChunks(cellPointers.size(), [&](size_t chunk, size_t begin, size_t end) {
+    auto& items = chunkItems[chunk];
+    for (auto i = begin; i < end; ++i)
+      CullCell(camera, *cellPointers[i], [&items](T item) {
+        items.push_back(item);
+      }, culler, stats ? &chunkStats[chunk] : nullptr);
+  }, minChunk);
+  for (size_t i = 0; i < chunks; ++i) {
+    result.insert(result.end(), chunkItems[i].begin(), chunkItems[i].end());
+    if (stats) {
+      stats->tested += chunkStats[i].tested;
+      stats->occluded += chunkStats[i].occluded;
+    }
+  }
+}
+template <typename T>
+template <typename F>
+void UniformGrid<T>::ForEachCellOverlapping(const BoundingBox& box, F func) const {
+  auto min = GetCellCoords(box.min - maxItemExtent);
+  auto max = GetCellCoords(box.max + maxItemExtent);
+  auto range = (max - min) + 1.f;
+  // NOTE: look up the cells in range when there are fewer of them than occupied cells, scan the occupied cells otherwise
+  if (static_cast<double>(range.x) * range.y * range.z > static_cast<double>(cells.size())) {
+    for (const auto& [_, cell] : cells)
+      if (box.Intersects(cell.looseBounds))
+        func(cell);
+    return;
+  }
+  for (auto x = min.x; x <= max.x; ++x)
+    for (auto y = min.y; y <= max.y; ++y)
+      for (auto z = min.z; z <= max.z; ++z) {
+        auto it = cells.find(GetCellKey(glm::vec3(x, y, z)));
+        if (it != cells.end() && box.Intersects(it->second.looseBounds))
+          func(it->second);
+      }
+}
+template <typename T>
+bool UniformGrid<T>::Raycast(const Ray& ray, SpatialHit<T>& hit, float maxDistance) const {
+  // NOTE: cells are visited in the order the ray enters their loose bounds
+  std::vector<std::pair<float, const GridCell<T>*>> candidates;
+  auto distance = 0.f;
+  for (const auto& [_, cell] : cells)
+    if (ray.Intersects(cell.looseBounds, distance, maxDistance))
+      candidates.emplace_back(distance, &cell);
+  std::sort(candidates.begin(), candidates.end(), [](const auto& a, const auto& b) {
+    return a.first < b.first;
+  });
+  auto found = false;
+  auto closest = maxDistance;
+  for (const auto& [cellDistance, cell] : candidates) {
+    if (found && cellDistance > closest)
+      break;
+    for (const auto& [item, bounds] : cell->items)
+      if (ray.Intersects(bounds, distance, closest) && (!found || distance < closest)) {
+        hit = {item, distance};
+        closest = distance;
+        found = true;
+      }
+  }
+  return found;
+}
+template <typename T>
+void UniformGrid<T>::RaycastAll(const Ray& ray, std::vector<SpatialHit<T>>& hits, float maxDistance) const {
+  auto first = hits.size();
+  auto distance = 0.f;
+  for (const auto& [_, cell] : cells) {
+    if (!ray.Intersects(cell.looseBounds, distance, maxDistance))
+      continue;
+    for (const auto& [item, bounds] : cell.items)
+      if (ray.Intersects(bounds, distance, maxDistance))
+        hits.push_back({item, distance});
+  }
+  std::sort(hits.begin() + first, hits.end(), [](const SpatialHit<T>& a, const SpatialHit<T>& b) {
+    return a.distance < b.distance;
+  });
+}
+template <typename T>
+void UniformGrid<T>::OverlapAABB(const BoundingBox& box, std::vector<T>& result) const {
+  ForEachCellOverlapping(box, [&box, &result](const GridCell<T>& cell) {
+    for (const auto& [item, bounds] : cell.items)
+      if (box.Intersects(bounds))
+        result.push_back(item);
+  });
+}
+template <typename T>
+void UniformGrid<T>::OverlapSphere(const glm::vec3& center, float radius, std::vector<T>& result) const {
+  auto radiusSquared = radius * radius;
+  ForEachCellOverlapping(BoundingBox(center - radius, center + radius), [&](const GridCell<T>& cell) {
+    if (cell.looseBounds.GetDistanceSquared(center) > radiusSquared)
+      return;
+    for (const auto& [item, bounds] : cell.items)
+      if (bounds.GetDistanceSquared(center) <= radiusSquared)
+        result.push_back(item);
+  });
+}
+template <typename T>
+void UniformGrid<T>::KNearest(const glm::vec3& point, size_t k, std::vector<SpatialHit<T>>& result) const {
+  if (k == 0 || cells.empty())
+    return;
+  auto farther = [](const SpatialHit<T>& a, const SpatialHit<T>& b) {
+    return a.distance < b.distance;
+  };
+  // NOTE: a max-heap of the best candidates so far (by squared distance), the top is the one to evict
+  std::vector<SpatialHit<T>> best;
+  best.reserve(k + 1);
+  // NOTE: search a growing radius, once k items are within it, no item outside can be closer
+  auto radius = std::max({cellSize.x, cellSize.y, cellSize.z});
+  auto all = k >= GetCount();
+  while (true) {
+    best.clear();
+    auto radiusSquared = all ? std::numeric_limits<float>::max() : radius * radius;
+    auto visit = [&](const GridCell<T>& cell) {
+      if (cell.looseBounds.GetDistanceSquared(point) > radiusSquared)
+        return;
+      for (const auto& [item, bounds] : cell.items) {
+        auto distance = bounds.GetDistanceSquared(point);
+        if (distance > radiusSquared)
+          continue;
+        if (best.size() == k) {
+          if (distance >= best.front().distance)
+            continue;
+          std::pop_heap(best.begin(), best.end(), farther);
+          best.pop_back();
+        }
+        best.push_back({item, distance});
+        std::push_heap(best.begin(), best.end(), farther);
+      }
+    };
+    if (all)
+      for (const auto& [_, cell] : cells)
+        visit(cell);
+    else
+      ForEachCellOverlapping(BoundingBox(point - radius, point + radius), visit);
+    if (all || best.size() == k)
+      break;
+    radius *= 2.f;
+  }
+  std::sort_heap(best.begin(), best.end(), farther);
+  for (auto& hit : best) {
+    hit.distance = std::sqrt(hit.distance);
+    result.push_back(hit);
+  }
+}
+} // namespace kuki
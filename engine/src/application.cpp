@@ -10,7 +10,9 @@
 #include <filesystem>
 #include <glad/glad.h>
 #include <id.hpp>
+#include <occlusion_culler.hpp>
 #include <primitive.hpp>
+#include <ray.hpp>
 #include <rendering_system.hpp>
 #include <scene.hpp>
 #include <spdlog/spdlog.h>
@@ -279,6 +281,8 @@ ID Application::CreateAsset(std::string& name) {
   return assetManager.Create(name);
 }
 void Application::DeleteAsset(ID id) {
+  if (auto renderingSystem = GetSystem<RenderingSystem>())
+    renderingSystem->ReleaseAsset(id);
   assetManager.Delete(id);
 }
 void Application::DeleteEntity(const std::string& name) {
@@ -389,6 +393,96 @@ void Application::UpdateEntityTransforms() {
     return;
   scene->UpdateTransforms();
 }
+void Application::UpdateSpatialIndex() {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return;
+  scene->UpdateSpatialIndex();
+}
+void Application::SetSpatialIndexType(SpatialIndexType type) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return;
+  scene->SetSpatialIndexType(type);
+}
+SpatialIndexType Application::GetSpatialIndexType() {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return SpatialIndexType::Octree;
+  return scene->GetSpatialIndexType();
+}
+void Application::SetOcclusionCulling(bool enabled) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return;
+  scene->SetOcclusionCulling(enabled);
+}
+bool Application::GetOcclusionCulling() {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return false;
+  return scene->GetOcclusionCulling();
+}
+void Application::SetEntityOccluder(ID id, bool occluder) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return;
+  scene->SetOccluder(id, occluder);
+}
+bool Application::IsEntityOccluder(ID id) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return false;
+  return scene->IsOccluder(id);
+}
+OcclusionStats Application::GetOcclusionStats() {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return {};
+  return scene->GetOcclusionStats();
+}
+size_t Application::GetSpatialEntityCount() {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return 0;
+  return scene->GetSpatialCount();
+}
+const BoundingBox* Application::GetEntitySpatialBounds(ID id) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return nullptr;
+  return scene->GetSpatialBounds(id);
+}
+bool Application::RaycastEntities(const Ray& ray, SpatialHit<ID>& hit, float maxDistance) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return false;
+  return scene->Raycast(ray, hit, maxDistance);
+}
+std::vector<SpatialHit<ID>> Application::RaycastAllEntities(const Ray& ray, float maxDistance) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return {};
+  return scene->RaycastAll(ray, maxDistance);
+}
+std::vector<ID> Application::OverlapEntitiesAABB(const BoundingBox& box) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return {};
+  return scene->OverlapAABB(box);
+}
+std::vector<ID> Application::OverlapEntitiesSphere(const glm::vec3& center, float radius) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return {};
+  return scene->OverlapSphere(center, radius);
+}
+std::vector<SpatialHit<ID>> Application::GetNearestEntities(const glm::vec3& point, size_t k) {
+  auto scene = GetActiveScene();
+  if (!scene)
+    return {};
+  return scene->KNearest(point, k);
+}
 bool Application::AddChildEntity(const ID parent, const ID child) {
   auto scene = GetActiveScene();
   if (!scene)
@@ -39,9 +39,11 @@
 #include <rendering_system.hpp>
 #include <skybox.hpp>
 #include <spdlog/spdlog.h>
+#include <spherical_harmonics.hpp>
 #include <stb_image.h>
 #include <string>
 #include <texture.hpp>
+#include <texture_cache.hpp>
 #include <thread>
 #include <tinyexr.h>
 #include <transform.hpp>
@@ -289,6 +291,17 @@ TextureData AssetLoader::LoadTexture(const std::filesystem::path& path, TextureT
     if (!textureData.data)
       spdlog::error("Failed to load texture: '{}'.", pathStr);
   }
+  // NOTE: hashed here, off the main thread, since the maps baked from an image are keyed by its pixels, the type is part of the key as an EXR image is flipped when it is baked
+  auto isHDR = textureData.type == TextureType::HDR || textureData.type == TextureType::EXR;
+  if (isHDR && textureData.data) {
+    const int layout[]{static_cast<int>(textureData.type), textureData.width, textureData.height, textureData.channels};
+    auto pixels = TextureCache::Hash(textureData.data, static_cast<size_t>(textureData.width) * textureData.height * textureData.channels * sizeof(float));
+    textureData.hash = TextureCache::Hash(layout, sizeof(layout), pixels);
+  }
+  if (isHDR && textureData.data && app->GetConfig().irradianceSH) {
+    textureData.irradiance = SphericalHarmonics::Project(static_cast<const float*>(textureData.data), textureData.width, textureData.height, textureData.channels, textureData.type == TextureType::EXR);
+    textureData.hasIrradiance = true;
+  }
   return textureData;
 }
 ID AssetLoader::LoadMesh(const std::string& name, const std::vector<Vertex>& vertices) {
@@ -414,16 +427,31 @@ ID AssetLoader::CreateTextureAsset(const TextureData& textureData) {
   return assetId;
 }
 ID AssetLoader::CreateSkyboxAsset(const TextureData& textureData) {
-  auto texture = CreateTexture(textureData);
   std::string name = textureData.name;
   auto assetId = app->CreateAsset(name);
   auto skybox = app->AddAssetComponent<Skybox>(assetId);
+  skybox->irradianceSH = textureData.irradiance;
+  skybox->hasIrradianceSH = textureData.hasIrradiance;
+  // NOTE: an image that failed to load has no hash, all of them would share a single cache entry
+  auto cacheable = textureData.data && textureData.hash != 0;
+  if (cacheable && LoadSkybox(textureData.hash, *skybox)) {
+    // NOTE: the maps were baked from the same pixels before, so the image itself is not uploaded
+    stbi_image_free(textureData.data);
+    skybox->brdf = CreateBRDF_LUT().id;
+    spdlog::info("Skybox is loaded from the bake cache: {}.", name);
+    return assetId;
+  }
+  auto texture = CreateTexture(textureData);
   auto cubeMap = CreateCubeMapFromEquirect(texture);
   skybox->original = cubeMap.id;
-  skybox->irradiance = CreateIrradianceMapFromCubeMap(cubeMap).id;
+  // NOTE: spherical harmonics replace the irradiance map, which is then neither baked nor cached
+  if (!skybox->hasIrradianceSH)
+    skybox->irradiance = CreateIrradianceMapFromCubeMap(cubeMap).id;
   skybox->prefilter = CreatePrefilterMapFromCubeMap(cubeMap).id;
   skybox->brdf = CreateBRDF_LUT().id;
   skybox->preview = CreateCubeMapPreview(cubeMap).id;
+  if (cacheable)
+    StoreSkybox(textureData.hash, *skybox);
   spdlog::info("Skybox is created: {}.", name);
   return assetId;
 }
@@ -456,7 +484,19 @@ Texture AssetLoader::CreateCubeMapPreview(Texture cubeMap) {
   if (!renderingSystem)
     return Texture{};
   // TODO: read the preview size from a config
-  return renderingSystem->CreateEquirectFromCubeMap(cubeMap, 64);
+  return renderingSystem->CreateEquirectFromCubeMap(cubeMap, RenderingSystem::SkyboxPreviewSize);
+}
+bool AssetLoader::LoadSkybox(uint64_t hash, Skybox& skybox) {
+  auto renderingSystem = app->GetSystem<RenderingSystem>();
+  if (!renderingSystem)
+    return false;
+  return renderingSystem->LoadSkybox(hash, skybox);
+}
+void AssetLoader::StoreSkybox(uint64_t hash, const Skybox& skybox) {
+  auto renderingSystem = app->GetSystem<RenderingSystem>();
+  if (!renderingSystem)
+    return;
+  renderingSystem->StoreSkybox(hash, skybox);
 }
 Material AssetLoader::CreateMaterial(const MaterialData& materialData) {
   Material material{};
@@ -622,61 +662,17 @@ ID AssetLoader::CreateNode(const NodeData& nodeData) {
   return assetId;
 }
 Mesh AssetLoader::CreateMesh(const std::vector<Vertex>& vertices, bool skinned) {
-  Mesh mesh;
-  CreateVertexBuffer(mesh, vertices, skinned);
-  CalculateBounds(mesh, vertices);
-  return mesh;
+  return CreateMesh(vertices, {}, skinned);
 }
 Mesh AssetLoader::CreateMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, bool skinned) {
-  auto mesh = CreateMesh(vertices, skinned);
-  CreateIndexBuffer(mesh, indices);
-  return mesh;
-}
-Mesh AssetLoader::CreateVertexBuffer(Mesh& mesh, const std::vector<Vertex>& vertices, bool skinned) {
-  mesh.vertexCount = vertices.size();
-  GLuint vao, vbo;
-  glCreateVertexArrays(1, &vao);
-  glCreateBuffers(1, &vbo);
-  mesh.vao = vao;
-  auto bindingIndex = 0;
-  glNamedBufferData(vbo, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
-  glVertexArrayVertexBuffer(mesh.vao, bindingIndex, vbo, 0, sizeof(Vertex));
-  auto attribIndex = 0;
-  glVertexArrayAttribFormat(mesh.vao, attribIndex, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
-  glVertexArrayAttribBinding(mesh.vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh.vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribFormat(mesh.vao, attribIndex, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
-  glVertexArrayAttribBinding(mesh.vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh.vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribFormat(mesh.vao, attribIndex, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texture));
-  glVertexArrayAttribBinding(mesh.vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh.vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribFormat(mesh.vao, attribIndex, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, tangent));
-  glVertexArrayAttribBinding(mesh.vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh.vao, attribIndex);
-  if (skinned) {
-    attribIndex++;
-    glVertexArrayAttribFormat(mesh.vao, attribIndex, 4, GL_INT, GL_FALSE, offsetof(Vertex, boneIds));
-    glVertexArrayAttribBinding(mesh.vao, attribIndex, bindingIndex);
-    glEnableVertexArrayAttrib(mesh.vao, attribIndex);
-    attribIndex++;
-    glVertexArrayAttribFormat(mesh.vao, attribIndex, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, boneWeights));
-    glVertexArrayAttribBinding(mesh.vao, attribIndex, bindingIndex);
-    glEnableVertexArrayAttrib(mesh.vao, attribIndex);
-  }
+  // NOTE: meshes are suballocated from the shared buffers of the renderer so that they can be drawn together
+  auto renderingSystem = app->GetSystem<RenderingSystem>();
+  if (!renderingSystem)
+    return Mesh{};
+  auto mesh = renderingSystem->CreateMesh(vertices, indices, skinned);
+  CalculateBounds(mesh, vertices);
   return mesh;
 }
-void AssetLoader::CreateIndexBuffer(Mesh& mesh, const std::vector<unsigned int>& indices) {
-  mesh.indexCount = indices.size();
-  GLuint indexBuffer;
-  glCreateBuffers(1, &indexBuffer);
-  mesh.ebo = indexBuffer;
-  glNamedBufferData(mesh.ebo, indices.size() * sizeof(unsigned int), indices.data(), GL_STATIC_DRAW);
-  glVertexArrayElementBuffer(mesh.vao, mesh.ebo);
-}
 void AssetLoader::CalculateBounds(Mesh& mesh, const std::vector<Vertex>& vertices) {
   mesh.bounds.min = glm::vec3(std::numeric_limits<float>::max());
   mesh.bounds.max = glm::vec3(std::numeric_limits<float>::lowest());
@@ -0,0 +1,91 @@
+#include <algorithm>
+#include <bloom_chain.hpp>
+#include <cstddef>
+#include <format>
+#include <glad/glad.h>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_int2.hpp>
+#include <mesh.hpp>
+#include <shader.hpp>
+#include <stdexcept>
+#include <vector>
+namespace kuki {
+BloomChain::BloomChain(int levelCount)
+  : maxLevelCount(levelCount) {
+  if (levelCount <= 0)
+    throw std::invalid_argument(std::format("Invalid bloom level count: {}.", levelCount));
+}
+BloomChain::~BloomChain() {
+  Clear();
+}
+bool BloomChain::Resize(int width, int height) {
+  glm::ivec2 size(width, height);
+  if (size == imageSize && !levels.empty())
+    return true;
+  Clear();
+  imageSize = size;
+  auto complete = true;
+  for (auto levelSize = size / 2; static_cast<int>(levels.size()) < maxLevelCount && std::min(levelSize.x, levelSize.y) >= MinLevelSize; levelSize /= 2) {
+    Level level{0, 0, levelSize};
+    // NOTE: each level is its own texture rather than a mip level of a shared one, so that upsampling reads one level while writing another without a feedback loop
+    glCreateTextures(GL_TEXTURE_2D, 1, &level.texture);
+    glTextureStorage2D(level.texture, 1, GL_RGBA16F, levelSize.x, levelSize.y);
+    glTextureParameteri(level.texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(level.texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTextureParameteri(level.texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTextureParameteri(level.texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glCreateFramebuffers(1, &level.framebuffer);
+    glNamedFramebufferTexture(level.framebuffer, GL_COLOR_ATTACHMENT0, level.texture, 0);
+    complete &= glCheckNamedFramebufferStatus(level.framebuffer, GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    levels.push_back(level);
+  }
+  return complete && !levels.empty();
+}
+size_t BloomChain::GetLevelCount() const {
+  return levels.size();
+}
+unsigned int BloomChain::GetTexture(size_t level) const {
+  return level < levels.size() ? levels[level].texture : 0;
+}
+unsigned int BloomChain::GetFramebuffer(size_t level) const {
+  return level < levels.size() ? levels[level].framebuffer : 0;
+}
+glm::ivec2 BloomChain::GetSize(size_t level) const {
+  return level < levels.size() ? levels[level].size : glm::ivec2(0);
+}
+void BloomChain::Apply(unsigned int image, Shader& brightShader, Shader& blurShader, const Mesh* frame) {
+  // NOTE: the bright pass is applied while downsampling into the first level, so the only full resolution pass is the composite
+  brightShader.Use();
+  brightShader.SetUniform("model", glm::mat4(1.f));
+  brightShader.SetUniform("image", 0);
+  glActiveTexture(GL_TEXTURE0);
+  for (size_t i = 0; i < levels.size(); ++i) {
+    glBindFramebuffer(GL_FRAMEBUFFER, levels[i].framebuffer);
+    glViewport(0, 0, levels[i].size.x, levels[i].size.y);
+    glBindTexture(GL_TEXTURE_2D, i == 0 ? image : levels[i - 1].texture);
+    brightShader.SetUniform("prefilter", i == 0);
+    brightShader.Draw(frame);
+  }
+  // NOTE: each level is blurred into the next larger one on top of what was downsampled into it, so the first level ends up with the sum of all levels
+  blurShader.Use();
+  blurShader.SetUniform("model", glm::mat4(1.f));
+  blurShader.SetUniform("image", 0);
+  // NOTE: only the colors add up, the alpha of each level is kept at the 1 the bright pass wrote
+  glBlendFuncSeparate(GL_ONE, GL_ONE, GL_ZERO, GL_ONE);
+  for (auto i = levels.size(); i > 1; --i) {
+    glBindFramebuffer(GL_FRAMEBUFFER, levels[i - 2].framebuffer);
+    glViewport(0, 0, levels[i - 2].size.x, levels[i - 2].size.y);
+    glBindTexture(GL_TEXTURE_2D, levels[i - 1].texture);
+    blurShader.Draw(frame);
+  }
+  glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+}
+void BloomChain::Clear() {
+  for (auto& level : levels) {
+    glDeleteFramebuffers(1, &level.framebuffer);
+    glDeleteTextures(1, &level.texture);
+  }
+  levels.clear();
+  imageSize = glm::ivec2(0);
+}
+} // namespace kuki
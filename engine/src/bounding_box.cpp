@@ -1,7 +1,10 @@
 #include <bounding_box.hpp>
+#include <cstddef>
+#include <glm/common.hpp>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <glm/ext/vector_float3.hpp>
 #include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
 #include <limits>
 #include <stdexcept>
 namespace kuki {
@@ -24,4 +27,41 @@ BoundingBox BoundingBox::GetWorldBounds(const glm::mat4& transform) {
   }
   return bounds;
 }
+bool BoundingBox::Intersects(const BoundingBox& other) const {
+  return (min.x <= other.max.x && max.x >= other.min.x) && (min.y <= other.max.y && max.y >= other.min.y) && (min.z <= other.max.z && max.z >= other.min.z);
+}
+float BoundingBox::GetDistanceSquared(const glm::vec3& point) const {
+  auto closest = glm::clamp(point, min, max);
+  auto offset = point - closest;
+  return glm::dot(offset, offset);
+}
+void BoundingBoxBatch::Add(const BoundingBox& bounds) {
+  auto center = (bounds.min + bounds.max) * .5f;
+  auto extent = (bounds.max - bounds.min) * .5f;
+  centerX.push_back(center.x);
+  centerY.push_back(center.y);
+  centerZ.push_back(center.z);
+  extentX.push_back(extent.x);
+  extentY.push_back(extent.y);
+  extentZ.push_back(extent.z);
+}
+void BoundingBoxBatch::Reserve(size_t count) {
+  centerX.reserve(count);
+  centerY.reserve(count);
+  centerZ.reserve(count);
+  extentX.reserve(count);
+  extentY.reserve(count);
+  extentZ.reserve(count);
+}
+void BoundingBoxBatch::Clear() {
+  centerX.clear();
+  centerY.clear();
+  centerZ.clear();
+  extentX.clear();
+  extentY.clear();
+  extentZ.clear();
+}
+size_t BoundingBoxBatch::Size() const {
+  return centerX.size();
+}
 } // namespace kuki
@@ -1,4 +1,5 @@
 #define GLM_ENABLE_EXPERIMENTAL
+#include <algorithm>
 #include <bounding_box.hpp>
 #include <camera.hpp>
 #include <cmath>
@@ -11,6 +12,7 @@
 #include <glm/geometric.hpp>
 #include <glm/gtx/euler_angles.hpp>
 #include <glm/gtx/quaternion.hpp>
+#include <glm/matrix.hpp>
 #include <transform.hpp>
 #include <utility>
 namespace kuki {
@@ -62,7 +64,8 @@ void Camera::UpdateTransform() {
   }
 }
 void Camera::UpdateFrustum() {
-  auto vp = transform.projection * transform.view;
+  // NOTE: planes are extracted from the rows of the view-projection matrix, and GLM matrices are column-major
+  auto vp = glm::transpose(transform.projection * transform.view);
   frustum.left = {vp[3] + vp[0]};
   frustum.right = {vp[3] - vp[0]};
   frustum.bottom = {vp[3] + vp[1]};
@@ -93,4 +96,13 @@ void Camera::Frame(const BoundingBox& bounds, float distanceFactor) {
 bool Camera::IntersectsFrustum(const BoundingBox& bounds) const {
   return frustum.InFrustum(bounds);
 }
+float Camera::GetScreenSize(const BoundingBox& bounds) const {
+  auto radius = glm::length(bounds.max - bounds.min) * .5f;
+  if (type == CameraType::Orthographic)
+    return radius / orthoSize;
+  auto center = (bounds.min + bounds.max) * .5f;
+  // NOTE: the camera may be inside the sphere, the distance is clamped to the near plane to keep the size finite
+  auto distance = std::max(glm::length(center - position), nearPlane);
+  return radius / (distance * std::tan(glm::radians(fov) * .5f));
+}
 } // namespace kuki
@@ -0,0 +1,47 @@
+#include <component.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <draw_job.hpp>
+#include <functional>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <id.hpp>
+#include <material_table.hpp>
+#include <render_queue.hpp>
+namespace kuki {
+void DrawJob::Clear() {
+  packets.clear();
+  materials.clear();
+  hashToMaterial.clear();
+  visible = 0;
+  reduced = 0;
+}
+void DrawJob::Add(ID id, const RenderItem& item, MaterialType type, float depth, const MaterialTable::PreparedMaterial& prepared) {
+  auto [it, inserted] = hashToMaterial.try_emplace(MaterialTable::Hash(prepared), static_cast<uint32_t>(materials.size()));
+  auto material = it->second;
+  // NOTE: a material whose hash collides with another's gets its own slot, the table tells them apart when they are merged
+  if (inserted || !(materials[material] == prepared)) {
+    material = static_cast<uint32_t>(materials.size());
+    materials.push_back(prepared);
+  }
+  packets.push_back({id, item, type, RenderQueue::GetMeshKey(*item.mesh), depth, material});
+}
+void DrawJob::Merge(MaterialTable& table, RenderQueue& queue, const std::function<uint32_t(ID, const glm::mat4&)>& getTransformRow) {
+  // NOTE: adding packs new textures, so it is done once per distinct material of the job rather than per packet
+  resolved.clear();
+  for (const auto& material : materials)
+    resolved.push_back(table.Add(material));
+  for (auto& packet : packets) {
+    const auto& material = resolved[packet.material];
+    packet.item.materialIndex = material.entry;
+    if (packet.item.transformRow == NoTransformRow)
+      packet.item.transformRow = getTransformRow(packet.id, *packet.item.world);
+    queue.Push(RenderQueue::MakeKey(RenderPass::Opaque, packet.type, material.textureSet, packet.mesh, packet.depth), packet.item);
+  }
+}
+size_t DrawJob::GetPacketCount() const {
+  return packets.size();
+}
+size_t DrawJob::GetMaterialCount() const {
+  return materials.size();
+}
+} // namespace kuki
@@ -0,0 +1,42 @@
+#include <algorithm>
+#include <app_config.hpp>
+#include <cmath>
+#include <dynamic_resolution.hpp>
+namespace kuki {
+float DynamicResolution::Update(float frameTime, const AppConfig& config) {
+  auto minScale = std::clamp(config.minRenderScale, ScaleStep, 1.f);
+  auto maxScale = std::clamp(config.maxRenderScale, minScale, 1.f);
+  if (!config.dynamicResolution) {
+    scale = std::clamp(config.renderScale, minScale, maxScale);
+    averageTime = 0.f;
+    settleFrames = 0;
+    return scale;
+  }
+  averageTime = averageTime > 0.f ? averageTime + (frameTime - averageTime) * Smoothing : frameTime;
+  if (settleFrames > 0) {
+    --settleFrames;
+    return scale;
+  }
+  auto target = std::max(config.targetFrameTime, 1e-3f);
+  auto hysteresis = std::clamp(config.resolutionHysteresis, 0.f, 1.f);
+  auto next = scale;
+  if (averageTime > target * (1.f + hysteresis))
+    next = std::min(scale * std::sqrt(target / averageTime), scale - ScaleStep);
+  else if (averageTime < target * (1.f - hysteresis))
+    next = std::max(scale * std::sqrt(target / averageTime), scale + ScaleStep);
+  next = std::clamp(std::round(next / ScaleStep) * ScaleStep, minScale, maxScale);
+  if (next != scale) {
+    // NOTE: the frames before the change say nothing about the new scale
+    scale = next;
+    averageTime = 0.f;
+    settleFrames = SettleFrameCount;
+  }
+  return scale;
+}
+float DynamicResolution::GetScale() const {
+  return scale;
+}
+float DynamicResolution::GetAverageTime() const {
+  return averageTime;
+}
+} // namespace kuki
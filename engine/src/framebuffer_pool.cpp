@@ -6,11 +6,8 @@ namespace kuki {
 FramebufferPool::~FramebufferPool() {
   Clear();
 }
-void FramebufferPool::Clear() {
-  for (const auto& [params, framebuffers] : pool)
-    for (auto id : framebuffers)
-      glDeleteFramebuffers(1, &id);
-  Pool::Clear();
+void FramebufferPool::Free(const TextureParams& params, GLuint& framebuffer) {
+  glDeleteFramebuffers(1, &framebuffer);
 }
 GLuint FramebufferPool::Allocate(const TextureParams& params) {
   GLuint framebuffer;
@@ -1,6 +1,45 @@
 #include <bounding_box.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
 #include <frustum.hpp>
+#include <glm/geometric.hpp>
+#include <vector>
+#if defined(__AVX__) || defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <immintrin.h>
+#define KUKI_FRUSTUM_SIMD
+#endif
 namespace kuki {
+/// @brief Plane equations in structure-of-arrays form, `d` is the signed distance of the origin
+struct PlaneEquations {
+  float nx[6];
+  float ny[6];
+  float nz[6];
+  float d[6];
+};
+static PlaneEquations GetPlaneEquations(const Frustum& frustum) {
+  const Plane* planes[6] = {&frustum.near, &frustum.far, &frustum.right, &frustum.left, &frustum.top, &frustum.bottom};
+  PlaneEquations equations{};
+  for (auto i = 0; i < 6; ++i) {
+    const auto& normal = planes[i]->normal;
+    equations.nx[i] = normal.x;
+    equations.ny[i] = normal.y;
+    equations.nz[i] = normal.z;
+    equations.d[i] = -glm::dot(normal, planes[i]->point);
+  }
+  return equations;
+}
+// NOTE: a box is outside if its positive corner is behind any plane, i.e., dot(n, c) + dot(|n|, e) + d < 0
+static bool InFrustumScalar(const PlaneEquations& eq, const BoundingBoxBatch& boxes, size_t i) {
+  for (auto p = 0; p < 6; ++p) {
+    // NOTE: operations are ordered the same way as the SIMD path so that both produce identical results
+    auto distance = (eq.nx[p] * boxes.centerX[i] + eq.ny[p] * boxes.centerY[i]) + (eq.nz[p] * boxes.centerZ[i] + eq.d[p]);
+    auto radius = (std::abs(eq.nx[p]) * boxes.extentX[i] + std::abs(eq.ny[p]) * boxes.extentY[i]) + std::abs(eq.nz[p]) * boxes.extentZ[i];
+    if (distance + radius < 0.f)
+      return false;
+  }
+  return true;
+}
 bool Frustum::InFrustum(const BoundingBox& bounds) const {
   const Plane planes[6] = {near, far, right, left, top, bottom};
   for (const auto& plane : planes)
@@ -8,4 +47,105 @@ bool Frustum::InFrustum(const BoundingBox& bounds) const {
       return false;
   return true;
 }
+FrustumTest Frustum::Classify(const BoundingBox& bounds, uint8_t& mask, uint8_t& lastPlane) const {
+  const Plane* planes[6] = {&near, &far, &right, &left, &top, &bottom};
+  for (auto i = 0; i < 6; ++i) {
+    // NOTE: start from the plane that rejected this box last time, it is likely to reject it again
+    auto p = (lastPlane + i) % 6;
+    auto bit = static_cast<uint8_t>(1 << p);
+    if ((mask & bit) == 0)
+      continue;
+    const auto& plane = *planes[p];
+    glm::vec3 positiveCorner{};
+    glm::vec3 negativeCorner{};
+    positiveCorner.x = (plane.normal.x >= 0) ? bounds.max.x : bounds.min.x;
+    positiveCorner.y = (plane.normal.y >= 0) ? bounds.max.y : bounds.min.y;
+    positiveCorner.z = (plane.normal.z >= 0) ? bounds.max.z : bounds.min.z;
+    if (plane.SignedDistance(positiveCorner) < 0) {
+      lastPlane = p;
+      return FrustumTest::Outside;
+    }
+    negativeCorner.x = (plane.normal.x >= 0) ? bounds.min.x : bounds.max.x;
+    negativeCorner.y = (plane.normal.y >= 0) ? bounds.min.y : bounds.max.y;
+    negativeCorner.z = (plane.normal.z >= 0) ? bounds.min.z : bounds.max.z;
+    if (plane.SignedDistance(negativeCorner) >= 0)
+      mask &= ~bit;
+  }
+  return mask == 0 ? FrustumTest::Inside : FrustumTest::Intersect;
+}
+void Frustum::InFrustumScalar(const BoundingBoxBatch& boxes, std::vector<uint64_t>& mask) const {
+  auto count = boxes.Size();
+  mask.assign((count + 63) / 64, 0);
+  auto equations = GetPlaneEquations(*this);
+  for (size_t i = 0; i < count; ++i)
+    if (kuki::InFrustumScalar(equations, boxes, i))
+      mask[i / 64] |= uint64_t{1} << (i % 64);
+}
+void Frustum::InFrustum(const BoundingBoxBatch& boxes, std::vector<uint64_t>& mask) const {
+  auto count = boxes.Size();
+  mask.assign((count + 63) / 64, 0);
+  auto equations = GetPlaneEquations(*this);
+  size_t i = 0;
+#if defined(__AVX__)
+  const auto signMask8 = _mm256_set1_ps(-0.f);
+  __m256 nx8[6], ny8[6], nz8[6], ax8[6], ay8[6], az8[6], d8[6];
+  for (auto p = 0; p < 6; ++p) {
+    nx8[p] = _mm256_set1_ps(equations.nx[p]);
+    ny8[p] = _mm256_set1_ps(equations.ny[p]);
+    nz8[p] = _mm256_set1_ps(equations.nz[p]);
+    ax8[p] = _mm256_andnot_ps(signMask8, nx8[p]);
+    ay8[p] = _mm256_andnot_ps(signMask8, ny8[p]);
+    az8[p] = _mm256_andnot_ps(signMask8, nz8[p]);
+    d8[p] = _mm256_set1_ps(equations.d[p]);
+  }
+  for (; i + 8 <= count; i += 8) {
+    auto cx = _mm256_loadu_ps(&boxes.centerX[i]);
+    auto cy = _mm256_loadu_ps(&boxes.centerY[i]);
+    auto cz = _mm256_loadu_ps(&boxes.centerZ[i]);
+    auto ex = _mm256_loadu_ps(&boxes.extentX[i]);
+    auto ey = _mm256_loadu_ps(&boxes.extentY[i]);
+    auto ez = _mm256_loadu_ps(&boxes.extentZ[i]);
+    auto inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+    for (auto p = 0; p < 6; ++p) {
+      auto distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx8[p], cx), _mm256_mul_ps(ny8[p], cy)), _mm256_add_ps(_mm256_mul_ps(nz8[p], cz), d8[p]));
+      auto radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ax8[p], ex), _mm256_mul_ps(ay8[p], ey)), _mm256_mul_ps(az8[p], ez));
+      inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(distance, radius), _mm256_setzero_ps(), _CMP_GE_OQ));
+    }
+    auto bits = static_cast<uint64_t>(_mm256_movemask_ps(inside));
+    mask[i / 64] |= bits << (i % 64);
+  }
+#endif
+#if defined(KUKI_FRUSTUM_SIMD)
+  const auto signMask4 = _mm_set1_ps(-0.f);
+  __m128 nx4[6], ny4[6], nz4[6], ax4[6], ay4[6], az4[6], d4[6];
+  for (auto p = 0; p < 6; ++p) {
+    nx4[p] = _mm_set1_ps(equations.nx[p]);
+    ny4[p] = _mm_set1_ps(equations.ny[p]);
+    nz4[p] = _mm_set1_ps(equations.nz[p]);
+    ax4[p] = _mm_andnot_ps(signMask4, nx4[p]);
+    ay4[p] = _mm_andnot_ps(signMask4, ny4[p]);
+    az4[p] = _mm_andnot_ps(signMask4, nz4[p]);
+    d4[p] = _mm_set1_ps(equations.d[p]);
+  }
+  for (; i + 4 <= count; i += 4) {
+    auto cx = _mm_loadu_ps(&boxes.centerX[i]);
+    auto cy = _mm_loadu_ps(&boxes.centerY[i]);
+    auto cz = _mm_loadu_ps(&boxes.centerZ[i]);
+    auto ex = _mm_loadu_ps(&boxes.extentX[i]);
+    auto ey = _mm_loadu_ps(&boxes.extentY[i]);
+    auto ez = _mm_loadu_ps(&boxes.extentZ[i]);
+    auto inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+    for (auto p = 0; p < 6; ++p) {
+      auto distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx4[p], cx), _mm_mul_ps(ny4[p], cy)), _mm_add_ps(_mm_mul_ps(nz4[p], cz), d4[p]));
+      auto radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax4[p], ex), _mm_mul_ps(ay4[p], ey)), _mm_mul_ps(az4[p], ez));
+      inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+    }
+    auto bits = static_cast<uint64_t>(_mm_movemask_ps(inside));
+    mask[i / 64] |= bits << (i % 64);
+  }
+#endif
+  for (; i < count; ++i)
+    if (kuki::InFrustumScalar(equations, boxes, i))
+      mask[i / 64] |= uint64_t{1} << (i % 64);
+}
 } // namespace kuki
@@ -0,0 +1,108 @@
+#include <cstddef>
+#include <cstdint>
+#include <gl_state_cache.hpp>
+#include <glad/glad.h>
+namespace kuki {
+static uint64_t MakeKey(unsigned int high, unsigned int low) {
+  return static_cast<uint64_t>(high) << 32 | low;
+}
+template <typename T>
+bool GLStateCache::Update(T& cached, const T& value) {
+  if (!active)
+    return true;
+  if (cached == value) {
+    ++stats.skipped;
+    return false;
+  }
+  cached = value;
+  ++stats.issued;
+  return true;
+}
+void GLStateCache::Begin() {
+  End();
+  active = true;
+  stats = {};
+}
+void GLStateCache::End() {
+  // NOTE: the code outside expects no vertex array or buffer to be bound, draws within leave them bound for the next one
+  if (active && vertexArray != 0 && vertexArray != ~0u)
+    glBindVertexArray(0);
+  if (active)
+    for (const auto& [target, buffer] : buffers)
+      if (buffer != 0 && buffer != ~0u)
+        glBindBuffer(target, 0);
+  active = false;
+  // NOTE: ~0 is not the name of any object, so the first call after Begin is issued whatever it binds
+  program = ~0u;
+  vertexArray = ~0u;
+  activeUnit = ~0u;
+  textures.clear();
+  buffers.clear();
+  vertexBuffers.clear();
+  attributes.clear();
+}
+bool GLStateCache::IsActive() const {
+  return active;
+}
+void GLStateCache::UseProgram(unsigned int id) {
+  if (Update(program, id))
+    glUseProgram(id);
+}
+void GLStateCache::BindVertexArray(unsigned int vao) {
+  if (Update(vertexArray, vao))
+    glBindVertexArray(vao);
+}
+void GLStateCache::BindTexture(unsigned int unit, unsigned int target, unsigned int texture) {
+  if (!active) {
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+    return;
+  }
+  auto [it, inserted] = textures.try_emplace(MakeKey(unit, target), ~0u);
+  if (!Update(it->second, texture)) {
+    ++stats.skipped; // NOTE: the active texture call is skipped along with the bind
+    return;
+  }
+  if (Update(activeUnit, unit))
+    glActiveTexture(GL_TEXTURE0 + unit);
+  glBindTexture(target, texture);
+}
+void GLStateCache::BindBuffer(unsigned int target, unsigned int buffer) {
+  if (!active) {
+    glBindBuffer(target, buffer);
+    return;
+  }
+  auto [it, inserted] = buffers.try_emplace(target, ~0u);
+  if (Update(it->second, buffer))
+    glBindBuffer(target, buffer);
+}
+void GLStateCache::BindVertexBuffer(unsigned int vao, unsigned int binding, unsigned int buffer, intptr_t offset, int stride) {
+  VertexBuffer value{buffer, offset, stride};
+  if (!active) {
+    glVertexArrayVertexBuffer(vao, binding, buffer, offset, stride);
+    return;
+  }
+  auto [it, inserted] = vertexBuffers.try_emplace(MakeKey(vao, binding), VertexBuffer{~0u});
+  if (Update(it->second, value))
+    glVertexArrayVertexBuffer(vao, binding, buffer, offset, stride);
+}
+void GLStateCache::SetIntegerAttribute(unsigned int vao, unsigned int attrib, unsigned int binding, int size, unsigned int type, unsigned int divisor) {
+  IntegerAttribute value{binding, size, type, divisor};
+  if (active) {
+    auto [it, inserted] = attributes.try_emplace(MakeKey(vao, attrib), IntegerAttribute{~0u});
+    if (!Update(it->second, value)) {
+      // NOTE: the binding, divisor and enable calls are counted along with the format call
+      stats.skipped += 3;
+      return;
+    }
+    stats.issued += 3;
+  }
+  glVertexArrayAttribIFormat(vao, attrib, size, type, 0);
+  glVertexArrayAttribBinding(vao, attrib, binding);
+  glVertexArrayBindingDivisor(vao, binding, divisor);
+  glEnableVertexArrayAttrib(vao, attrib);
+}
+const GLStateStats& GLStateCache::GetStats() const {
+  return stats;
+}
+} // namespace kuki
@@ -0,0 +1,114 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <format>
+#include <glad/glad.h>
+#include <instance_buffer.hpp>
+#include <spdlog/spdlog.h>
+#include <stdexcept>
+namespace kuki {
+InstanceBuffer::InstanceBuffer(size_t regionSize, size_t regionCount)
+  : regionSize(regionSize), regionCount(regionCount) {
+  if (regionSize == 0 || regionCount == 0)
+    throw std::invalid_argument(std::format("Invalid instance buffer layout: {} regions of {} bytes.", regionCount, regionSize));
+}
+InstanceBuffer::~InstanceBuffer() {
+  Clear();
+}
+bool InstanceBuffer::Allocate() {
+  auto size = static_cast<GLsizeiptr>(regionSize * regionCount);
+  GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+  glCreateBuffers(1, &id);
+  glNamedBufferStorage(id, size, nullptr, flags);
+  mapped = static_cast<std::byte*>(glMapNamedBufferRange(id, 0, size, flags));
+  if (!mapped) {
+    spdlog::error("Failed to map the instance buffer ({} bytes).", size);
+    glDeleteBuffers(1, &id);
+    id = 0;
+    return false;
+  }
+  fences.assign(regionCount, nullptr);
+  return true;
+}
+void InstanceBuffer::WaitRegion(size_t index) {
+  auto fence = static_cast<GLsync>(fences[index]);
+  if (!fence)
+    return;
+  auto result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+  if (result == GL_TIMEOUT_EXPIRED) {
+    ++stats.stalls;
+    constexpr GLuint64 timeout = 1'000'000; // NOTE: 1 ms
+    do
+      result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    while (result == GL_TIMEOUT_EXPIRED);
+  }
+  if (result == GL_WAIT_FAILED)
+    spdlog::error("Failed to wait for the instance buffer region {}.", index);
+  glDeleteSync(fence);
+  fences[index] = nullptr;
+}
+void InstanceBuffer::NextFrame() {
+  if (!retired.empty()) {
+    glDeleteBuffers(static_cast<GLsizei>(retired.size()), retired.data());
+    retired.clear();
+  }
+  if (id > 0)
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  region = (region + 1) % regionCount;
+  head = 0;
+  stats = {};
+  if (id > 0)
+    WaitRegion(region);
+}
+size_t InstanceBuffer::Write(const void* data, size_t size, size_t alignment) {
+  alignment = std::max(alignment, Alignment);
+  auto align = [alignment](size_t value) {
+    return (value + alignment - 1) / alignment * alignment;
+  };
+  // NOTE: the alignment applies to the offset in the buffer, regions may start at any multiple of Alignment
+  auto start = align(region * regionSize + head);
+  if (start + size > (region + 1) * regionSize) {
+    // NOTE: deleting a buffer unbinds it from the context, so the old one is retired instead, OpenGL frees it once the draws that read it are done
+    regionSize = std::max(regionSize * 2, (size + Alignment - 1) / Alignment * Alignment + alignment - Alignment);
+    Retire();
+    ++stats.grows;
+    start = align(region * regionSize);
+  }
+  if (id == 0 && !Allocate())
+    return 0;
+  std::memcpy(mapped + start, data, size);
+  head = start + size - region * regionSize;
+  stats.bytes += size;
+  return start;
+}
+void InstanceBuffer::Retire() {
+  if (id == 0)
+    return;
+  for (auto fence : fences)
+    if (fence)
+      glDeleteSync(static_cast<GLsync>(fence));
+  fences.clear();
+  glUnmapNamedBuffer(id);
+  retired.push_back(id);
+  id = 0;
+  mapped = nullptr;
+}
+void InstanceBuffer::Clear() {
+  Retire();
+  if (!retired.empty())
+    glDeleteBuffers(static_cast<GLsizei>(retired.size()), retired.data());
+  retired.clear();
+}
+unsigned int InstanceBuffer::GetId() const {
+  return id;
+}
+size_t InstanceBuffer::GetRegionSize() const {
+  return regionSize;
+}
+size_t InstanceBuffer::GetRegionCount() const {
+  return regionCount;
+}
+const InstanceBufferStats& InstanceBuffer::GetStats() const {
+  return stats;
+}
+} // namespace kuki
@@ -0,0 +1,136 @@
+#include <algorithm>
+#include <camera.hpp>
+#include <cmath>
+#include <component.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <glm/common.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float2.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/ext/vector_uint2.hpp>
+#include <glm/ext/vector_uint3.hpp>
+#include <glm/geometric.hpp>
+#include <light.hpp>
+#include <light_clusters.hpp>
+#include <limits>
+#include <span>
+namespace kuki {
+LightClusters::LightClusters(unsigned int tilesX, unsigned int tilesY, unsigned int slices)
+  : size(std::max(tilesX, 1u), std::max(tilesY, 1u), std::max(slices, 1u)) {}
+uint32_t LightClusters::GetSlice(float depth) const {
+  auto slice = std::log(std::max(depth, std::numeric_limits<float>::min())) * depthScaleBias.x + depthScaleBias.y;
+  return static_cast<uint32_t>(std::clamp(slice, 0.f, static_cast<float>(size.z - 1)));
+}
+float LightClusters::GetSliceDepth(uint32_t slice) const {
+  return nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(slice) / size.z);
+}
+bool LightClusters::GetTiles(const glm::vec3& min, const glm::vec3& max, glm::uvec2& tileMin, glm::uvec2& tileMax) const {
+  // NOTE: the projection maps boxes to convex shapes whose extremes are projected corners, the box is in front of the near plane so w is positive
+  glm::vec2 ndcMin(std::numeric_limits<float>::max());
+  glm::vec2 ndcMax(std::numeric_limits<float>::lowest());
+  for (auto corner = 0; corner < 8; ++corner) {
+    glm::vec4 point(corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z, 1.f);
+    auto clip = projection * point;
+    auto ndc = glm::vec2(clip) / clip.w;
+    ndcMin = glm::min(ndcMin, ndc);
+    ndcMax = glm::max(ndcMax, ndc);
+  }
+  if (ndcMax.x < -1.f || ndcMax.y < -1.f || ndcMin.x > 1.f || ndcMin.y > 1.f)
+    return false;
+  auto tiles = glm::vec2(size.x, size.y);
+  tileMin = glm::uvec2(glm::clamp((ndcMin * .5f + .5f) * tiles, glm::vec2(0.f), tiles - 1.f));
+  tileMax = glm::uvec2(glm::clamp((ndcMax * .5f + .5f) * tiles, glm::vec2(0.f), tiles - 1.f));
+  return true;
+}
+void LightClusters::Build(const Camera& camera, std::span<const Light* const> sceneLights) {
+  view = camera.transform.view;
+  projection = camera.transform.projection;
+  nearPlane = std::max(camera.nearPlane, std::numeric_limits<float>::min());
+  farPlane = std::max(camera.farPlane, nearPlane * 1.0001f);
+  auto logRatio = std::log(farPlane / nearPlane);
+  depthScaleBias = glm::vec2(size.z / logRatio, -(size.z * std::log(nearPlane)) / logRatio);
+  lights.clear();
+  spans.clear();
+  clusters.assign(static_cast<size_t>(size.x) * size.y * size.z, {});
+  for (const auto* light : sceneLights) {
+    if (!light || light->type != LightType::Point)
+      continue;
+    auto center = glm::vec3(view * glm::vec4(light->vector, 1.f));
+    // NOTE: a light without attenuation reaches the whole frustum, a finite range keeps the projected corners free of infinities
+    auto range = std::min(GetRange(*light), glm::length(center) + farPlane * 1e3f);
+    auto depth = -center.z;
+    if (depth + range < nearPlane || depth - range > farPlane)
+      continue;
+    auto index = static_cast<uint32_t>(lights.size());
+    auto firstSpan = spans.size();
+    auto lastSlice = GetSlice(std::min(depth + range, farPlane));
+    for (auto slice = GetSlice(std::max(depth - range, nearPlane)); slice <= lastSlice; ++slice) {
+      // NOTE: the tiles are found for the part of the light's box inside the slice (widened a little for rounding), which is narrower than the whole box near the camera
+      auto sliceNear = std::max(depth - range, GetSliceDepth(slice) * .999f);
+      auto sliceFar = std::min(depth + range, GetSliceDepth(slice + 1) * 1.001f);
+      glm::vec3 min(center.x - range, center.y - range, -sliceFar);
+      glm::vec3 max(center.x + range, center.y + range, -sliceNear);
+      Span span{index, slice};
+      if (GetTiles(min, max, span.min, span.max))
+        spans.push_back(span);
+    }
+    if (spans.size() == firstSpan)
+      continue;
+    lights.push_back({glm::vec4(light->vector, range), glm::vec4(light->diffuse, 0.f), glm::vec4(light->specular, 0.f), glm::vec4(light->constant, light->linear, light->quadratic, 0.f)});
+  }
+  // NOTE: the first pass counts the lights of each cluster, the second writes their indices after the offsets are known
+  for (const auto& span : spans)
+    for (auto y = span.min.y; y <= span.max.y; ++y)
+      for (auto x = span.min.x; x <= span.max.x; ++x)
+        ++clusters[(static_cast<size_t>(span.slice) * size.y + y) * size.x + x].count;
+  uint32_t offset = 0;
+  for (auto& cluster : clusters) {
+    cluster.offset = offset;
+    offset += cluster.count;
+    cluster.count = 0;
+  }
+  indices.resize(offset);
+  for (const auto& span : spans)
+    for (auto y = span.min.y; y <= span.max.y; ++y)
+      for (auto x = span.min.x; x <= span.max.x; ++x) {
+        auto& cluster = clusters[(static_cast<size_t>(span.slice) * size.y + y) * size.x + x];
+        indices[cluster.offset + cluster.count++] = span.light;
+      }
+}
+float LightClusters::GetRange(const Light& light) {
+  // NOTE: solves constant + linear * d + quadratic * d^2 = intensity / cutoff for the distance d
+  auto intensity = std::max({light.diffuse.r, light.diffuse.g, light.diffuse.b, light.specular.r, light.specular.g, light.specular.b});
+  auto target = intensity / Cutoff - light.constant;
+  if (target <= 0.f)
+    return 0.f;
+  if (light.quadratic > 0.f)
+    return (-light.linear + std::sqrt(light.linear * light.linear + 4.f * light.quadratic * target)) / (2.f * light.quadratic);
+  if (light.linear > 0.f)
+    return target / light.linear;
+  return std::numeric_limits<float>::max();
+}
+size_t LightClusters::GetClusterIndex(const glm::vec3& position) const {
+  auto clip = projection * glm::vec4(position, 1.f);
+  auto ndc = glm::vec2(clip) / clip.w;
+  auto tiles = glm::vec2(size.x, size.y);
+  auto tile = glm::uvec2(glm::clamp((ndc * .5f + .5f) * tiles, glm::vec2(0.f), tiles - 1.f));
+  return (static_cast<size_t>(GetSlice(-position.z)) * size.y + tile.y) * size.x + tile.x;
+}
+glm::uvec3 LightClusters::GetSize() const {
+  return size;
+}
+glm::vec2 LightClusters::GetDepthScaleBias() const {
+  return depthScaleBias;
+}
+const std::vector<LightEntry>& LightClusters::GetLights() const {
+  return lights;
+}
+const std::vector<LightCluster>& LightClusters::GetClusters() const {
+  return clusters;
+}
+const std::vector<uint32_t>& LightClusters::GetIndices() const {
+  return indices;
+}
+} // namespace kuki
@@ -0,0 +1,30 @@
+#include <algorithm>
+#include <component.hpp>
+#include <cstddef>
+#include <cstdint>
+#include <lod_group.hpp>
+#include <utility>
+namespace kuki {
+LODGroup::LODGroup()
+  : IComponent(std::in_place_type<LODGroup>) {}
+uint8_t LODGroup::Select(float screenSize, float bias, float hysteresis) {
+  if (levels.empty())
+    return 0;
+  auto size = screenSize * bias;
+  auto find = [this, size](float scale) {
+    size_t level = 0;
+    while (level + 1 < levels.size() && size < levels[level].screenSize * scale)
+      ++level;
+    return level;
+  };
+  auto last = std::min<size_t>(current, levels.size() - 1);
+  auto level = find(1.f);
+  // NOTE: switching requires the size to cross the threshold by a margin, in either direction
+  if (level < last)
+    level = std::min(find(1.f + hysteresis), last);
+  else if (level > last)
+    level = std::max(find(1.f - hysteresis), last);
+  current = static_cast<uint8_t>(level);
+  return current;
+}
+} // namespace kuki
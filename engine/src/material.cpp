@@ -50,54 +50,29 @@ void Material::SetType(MaterialType type) {
 void LitMaterial::Apply(Shader* shader) const {
   if (type != shader->GetType())
     return;
-  if (data.albedo > 0) {
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, data.albedo);
-    shader->SetUniform("material.albedo", 0);
-  }
-  if (data.normal > 0) {
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, data.normal);
-    shader->SetUniform("material.normal", 1);
-  }
-  if (data.metalness > 0) {
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, data.metalness);
-    shader->SetUniform("material.metalness", 2);
-  }
-  if (data.occlusion > 0) {
-    glActiveTexture(GL_TEXTURE3);
-    glBindTexture(GL_TEXTURE_2D, data.occlusion);
-    shader->SetUniform("material.occlusion", 3);
-  }
-  if (data.roughness > 0) {
-    glActiveTexture(GL_TEXTURE4);
-    glBindTexture(GL_TEXTURE_2D, data.roughness);
-    shader->SetUniform("material.roughness", 4);
-  }
-  if (data.specular > 0) {
-    glActiveTexture(GL_TEXTURE5);
-    glBindTexture(GL_TEXTURE_2D, data.specular);
-    shader->SetUniform("material.specular", 5);
-  }
-  if (data.emissive > 0) {
-    glActiveTexture(GL_TEXTURE6);
-    glBindTexture(GL_TEXTURE_2D, data.emissive);
-    shader->SetUniform("material.emissive", 6);
-  }
+  if (data.albedo > 0)
+    shader->BindTexture(0, GL_TEXTURE_2D_ARRAY, shader->GetTextureArray(data.albedo));
+  if (data.normal > 0)
+    shader->BindTexture(1, GL_TEXTURE_2D_ARRAY, shader->GetTextureArray(data.normal));
+  if (data.metalness > 0)
+    shader->BindTexture(2, GL_TEXTURE_2D_ARRAY, shader->GetTextureArray(data.metalness));
+  if (data.occlusion > 0)
+    shader->BindTexture(3, GL_TEXTURE_2D_ARRAY, shader->GetTextureArray(data.occlusion));
+  if (data.roughness > 0)
+    shader->BindTexture(4, GL_TEXTURE_2D_ARRAY, shader->GetTextureArray(data.roughness));
+  if (data.specular > 0)
+    shader->BindTexture(5, GL_TEXTURE_2D_ARRAY, shader->GetTextureArray(data.specular));
+  if (data.emissive > 0)
+    shader->BindTexture(6, GL_TEXTURE_2D_ARRAY, shader->GetTextureArray(data.emissive));
 }
 void UnlitMaterial::Apply(Shader* shader) const {
   if (type != shader->GetType())
     return;
   if (data.base > 0) {
-    glActiveTexture(GL_TEXTURE0);
-    if (type == MaterialType::Skybox) {
-      glBindTexture(GL_TEXTURE_CUBE_MAP, data.base);
-      shader->SetUniform("skybox", 0);
-    } else {
-      glBindTexture(GL_TEXTURE_2D, data.base);
-      shader->SetUniform("material.base", 0);
-    }
+    if (type == MaterialType::Skybox)
+      shader->BindTexture(0, GL_TEXTURE_CUBE_MAP, data.base);
+    else
+      shader->BindTexture(0, GL_TEXTURE_2D_ARRAY, shader->GetTextureArray(data.base));
   }
 }
 } // namespace kuki
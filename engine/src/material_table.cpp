@@ -0,0 +1,244 @@
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <glad/glad.h>
+#include <iterator>
+#include <material.hpp>
+#include <material_table.hpp>
+#include <spdlog/spdlog.h>
+#include <variant>
+#include <vector>
+namespace kuki {
+/// @brief FNV-1a over the 16-bit words of a trivially copyable value
+/// @param hash Hash to continue from, for values made of several fields
+template <typename T>
+static uint64_t HashWords(const T& value, uint64_t hash = 14695981039346656037ull) {
+  static_assert(sizeof(T) % sizeof(uint16_t) == 0);
+  std::array<uint16_t, sizeof(T) / sizeof(uint16_t)> words;
+  std::memcpy(words.data(), &value, sizeof(T));
+  for (auto word : words) {
+    hash ^= word;
+    hash *= 1099511628211ull;
+  }
+  return hash;
+}
+MaterialTable::MaterialTable(int layerCount)
+  : initialLayerCount(std::max(layerCount, 1)) {}
+MaterialTable::~MaterialTable() {
+  Clear();
+}
+bool MaterialTable::Grow(TextureArray& array) {
+  if (array.capacity >= maxLayerCount)
+    return false;
+  auto capacity = array.capacity > 0 ? std::min(array.capacity * 2, maxLayerCount) : std::min(initialLayerCount, maxLayerCount);
+  const auto& key = array.key;
+  unsigned int id;
+  glCreateTextures(GL_TEXTURE_2D_ARRAY, 1, &id);
+  glTextureStorage3D(id, key.levels, key.internalFormat, key.width, key.height, capacity);
+  glTextureParameteri(id, GL_TEXTURE_WRAP_S, key.wrapS);
+  glTextureParameteri(id, GL_TEXTURE_WRAP_T, key.wrapT);
+  glTextureParameteri(id, GL_TEXTURE_MIN_FILTER, key.minFilter);
+  glTextureParameteri(id, GL_TEXTURE_MAG_FILTER, key.magFilter);
+  glTextureParameteriv(id, GL_TEXTURE_SWIZZLE_RGBA, key.swizzle.data());
+  if (array.id > 0) {
+    // NOTE: the layers are copied on the GPU, draws that still sample the old array keep it alive until they are done
+    for (auto level = 0; level < key.levels; ++level)
+      glCopyImageSubData(array.id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, id, GL_TEXTURE_2D_ARRAY, level, 0, 0, 0, std::max(key.width >> level, 1), std::max(key.height >> level, 1), array.count);
+    glDeleteTextures(1, &array.id);
+  }
+  array.id = id;
+  array.capacity = capacity;
+  return true;
+}
+TextureLayer MaterialTable::GetLayer(unsigned int texture) {
+  if (auto it = textureToLayer.find(texture); it != textureToLayer.end())
+    return it->second;
+  auto& layer = textureToLayer[texture];
+  if (texture == 0 || !glIsTexture(texture))
+    return layer;
+  if (maxLayerCount == 0)
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayerCount);
+  GLint target = 0;
+  glGetTextureParameteriv(texture, GL_TEXTURE_TARGET, &target);
+  if (target != GL_TEXTURE_2D) {
+    spdlog::warn("Texture {} is not a 2D texture, it cannot be packed into a texture array.", texture);
+    return layer;
+  }
+  ArrayKey key{};
+  glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_WIDTH, &key.width);
+  glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_HEIGHT, &key.height);
+  glGetTextureLevelParameteriv(texture, 0, GL_TEXTURE_INTERNAL_FORMAT, &key.internalFormat);
+  // NOTE: textures without immutable storage are packed without their mipmaps
+  glGetTextureParameteriv(texture, GL_TEXTURE_IMMUTABLE_LEVELS, &key.levels);
+  key.levels = std::max(key.levels, 1);
+  glGetTextureParameteriv(texture, GL_TEXTURE_WRAP_S, &key.wrapS);
+  glGetTextureParameteriv(texture, GL_TEXTURE_WRAP_T, &key.wrapT);
+  glGetTextureParameteriv(texture, GL_TEXTURE_MIN_FILTER, &key.minFilter);
+  glGetTextureParameteriv(texture, GL_TEXTURE_MAG_FILTER, &key.magFilter);
+  glGetTextureParameteriv(texture, GL_TEXTURE_SWIZZLE_RGBA, key.swizzle.data());
+  if (key.width <= 0 || key.height <= 0)
+    return layer;
+  auto it = std::find_if(arrays.begin(), arrays.end(), [&key](const TextureArray& array) {
+    return array.key == key && array.count < array.capacity;
+  });
+  if (it == arrays.end())
+    it = std::find_if(arrays.begin(), arrays.end(), [&key, this](const TextureArray& array) {
+      return array.key == key && array.capacity < maxLayerCount;
+    });
+  if (it == arrays.end()) {
+    // NOTE: the index of an array plus one is stored in 16 bits, so that 0 can mean no array
+    if (arrays.size() >= UINT16_MAX) {
+      spdlog::error("Failed to pack texture {}, there are too many texture arrays.", texture);
+      return layer;
+    }
+    arrays.push_back({key, 0, 0, 0});
+    it = std::prev(arrays.end());
+  }
+  if (it->count == it->capacity && !Grow(*it)) {
+    spdlog::error("Failed to pack texture {} into a texture array.", texture);
+    return layer;
+  }
+  for (auto level = 0; level < key.levels; ++level)
+    glCopyImageSubData(texture, GL_TEXTURE_2D, level, 0, 0, 0, it->id, GL_TEXTURE_2D_ARRAY, level, 0, 0, it->count, std::max(key.width >> level, 1), std::max(key.height >> level, 1), 1);
+  layer.array = static_cast<uint16_t>(std::distance(arrays.begin(), it) + 1);
+  layer.layer = it->count++;
+  return layer;
+}
+void MaterialTable::EvictTexture(unsigned int texture) {
+  textureToLayer.erase(texture);
+}
+unsigned int MaterialTable::GetArray(unsigned int texture) {
+  return GetArrayId(GetLayer(texture).array);
+}
+unsigned int MaterialTable::GetArrayId(uint16_t index) const {
+  if (index == 0 || index > arrays.size())
+    return 0;
+  return arrays[index - 1].id;
+}
+size_t MaterialTable::GetArrayCount() const {
+  return arrays.size();
+}
+uint32_t MaterialTable::Add(const MaterialEntry& entry) {
+  auto hash = HashWords(entry);
+  if (auto it = hashToEntry.find(hash); it != hashToEntry.end() && std::memcmp(&entries[it->second], &entry, sizeof(MaterialEntry)) == 0)
+    return it->second;
+  auto index = static_cast<uint32_t>(entries.size());
+  entries.push_back(entry);
+  hashToEntry.try_emplace(hash, index);
+  return index;
+}
+uint16_t MaterialTable::Add(const TextureSet& textureSet) {
+  if (textureSet == TextureSet{})
+    return EmptyTextureSet;
+  auto hash = HashWords(textureSet);
+  if (auto it = hashToTextureSet.find(hash); it != hashToTextureSet.end() && textureSets[it->second - 1] == textureSet)
+    return it->second;
+  // NOTE: the set is a 16-bit field of the render queue's sort keys, a wrapped index would batch materials with another set's arrays
+  if (textureSets.size() >= UINT16_MAX) {
+    spdlog::error("Failed to add a texture set, a frame can have at most {} of them.", UINT16_MAX);
+    return EmptyTextureSet;
+  }
+  textureSets.push_back(textureSet);
+  auto index = static_cast<uint16_t>(textureSets.size());
+  hashToTextureSet.try_emplace(hash, index);
+  return index;
+}
+bool MaterialTable::PreparedMaterial::operator==(const PreparedMaterial& other) const {
+  return std::memcmp(&entry, &other.entry, sizeof(MaterialEntry)) == 0 && textureSet == other.textureSet && pending == other.pending;
+}
+MaterialTable::PreparedMaterial MaterialTable::Prepare(const MaterialEntry& entry, const std::array<int, SlotCount>& textures) const {
+  PreparedMaterial prepared{entry};
+  for (size_t slot = 0; slot < SlotCount; ++slot) {
+    auto bit = 1 << slot;
+    if ((entry.textureMask & bit) == 0)
+      continue;
+    if (textures[slot] <= 0) {
+      prepared.entry.textureMask &= ~bit;
+      continue;
+    }
+    auto it = textureToLayer.find(textures[slot]);
+    if (it == textureToLayer.end()) {
+      prepared.pending[slot] = static_cast<unsigned int>(textures[slot]);
+      continue;
+    }
+    if (it->second.array == 0) {
+      prepared.entry.textureMask &= ~bit;
+      continue;
+    }
+    prepared.textureSet[slot] = it->second.array;
+    prepared.entry.layers[slot] = it->second.layer;
+  }
+  return prepared;
+}
+MaterialTable::PreparedMaterial MaterialTable::Prepare(const LitMaterial& material) const {
+  MaterialEntry entry{};
+  entry.albedo = material.fallback.albedo;
+  entry.specular = material.fallback.specular;
+  entry.emissive = material.fallback.emissive;
+  entry.metalness = material.fallback.metalness;
+  entry.occlusion = material.fallback.occlusion;
+  entry.roughness = material.fallback.roughness;
+  entry.textureMask = material.fallback.textureMask;
+  const auto& data = material.data;
+  return Prepare(entry, {data.albedo, data.normal, data.metalness, data.occlusion, data.roughness, data.specular, data.emissive});
+}
+MaterialTable::PreparedMaterial MaterialTable::Prepare(const UnlitMaterial& material) const {
+  MaterialEntry entry{};
+  entry.albedo = material.fallback.base;
+  entry.textureMask = material.fallback.textureMask;
+  return Prepare(entry, {material.data.base});
+}
+MaterialTable::PreparedMaterial MaterialTable::Prepare(const Material& material) const {
+  return std::visit([this](const auto& current) { return Prepare(current); }, material.current);
+}
+uint64_t MaterialTable::Hash(const PreparedMaterial& prepared) {
+  return HashWords(prepared.pending, HashWords(prepared.textureSet, HashWords(prepared.entry)));
+}
+MaterialIndex MaterialTable::Add(const PreparedMaterial& prepared) {
+  auto entry = prepared.entry;
+  auto textureSet = prepared.textureSet;
+  for (size_t slot = 0; slot < SlotCount; ++slot) {
+    if (prepared.pending[slot] == 0)
+      continue;
+    auto layer = GetLayer(prepared.pending[slot]);
+    if (layer.array == 0) {
+      entry.textureMask &= ~(1 << slot);
+      continue;
+    }
+    textureSet[slot] = layer.array;
+    entry.layers[slot] = layer.layer;
+  }
+  auto set = Add(textureSet);
+  // NOTE: a material whose set could not be added is drawn without its textures
+  if (set == EmptyTextureSet)
+    entry.textureMask = 0;
+  return {Add(entry), set};
+}
+MaterialIndex MaterialTable::Add(const LitMaterial& material) {
+  return Add(Prepare(material));
+}
+MaterialIndex MaterialTable::Add(const UnlitMaterial& material) {
+  return Add(Prepare(material));
+}
+MaterialIndex MaterialTable::Add(const Material& material) {
+  return Add(Prepare(material));
+}
+void MaterialTable::ClearEntries() {
+  entries.clear();
+  hashToEntry.clear();
+  textureSets.clear();
+  hashToTextureSet.clear();
+}
+const std::vector<MaterialEntry>& MaterialTable::GetEntries() const {
+  return entries;
+}
+void MaterialTable::Clear() {
+  for (auto& array : arrays)
+    glDeleteTextures(1, &array.id);
+  arrays.clear();
+  textureToLayer.clear();
+  ClearEntries();
+}
+} // namespace kuki
@@ -0,0 +1,132 @@
+#include <cstddef>
+#include <format>
+#include <glad/glad.h>
+#include <mesh.hpp>
+#include <mesh_buffer.hpp>
+#include <numeric>
+#include <primitive.hpp>
+#include <span>
+#include <stdexcept>
+#include <vector>
+namespace kuki {
+MeshBuffer::MeshBuffer(bool skinned, size_t vertexCapacity, size_t indexCapacity)
+  : skinned(skinned), vertexCapacity(vertexCapacity), indexCapacity(indexCapacity) {
+  if (vertexCapacity == 0 || indexCapacity == 0)
+    throw std::invalid_argument(std::format("Invalid mesh buffer capacity: {} vertices and {} indices.", vertexCapacity, indexCapacity));
+}
+MeshBuffer::~MeshBuffer() {
+  Clear();
+}
+void MeshBuffer::Allocate() {
+  glCreateVertexArrays(1, &vao);
+  glCreateBuffers(1, &vbo);
+  glCreateBuffers(1, &ebo);
+  glNamedBufferStorage(vbo, vertexCapacity * sizeof(Vertex), nullptr, GL_DYNAMIC_STORAGE_BIT);
+  glNamedBufferStorage(ebo, indexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_STORAGE_BIT);
+  auto bindingIndex = 0;
+  glVertexArrayVertexBuffer(vao, bindingIndex, vbo, 0, sizeof(Vertex));
+  glVertexArrayElementBuffer(vao, ebo);
+  auto attribIndex = 0;
+  glVertexArrayAttribFormat(vao, attribIndex, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, position));
+  glVertexArrayAttribBinding(vao, attribIndex, bindingIndex);
+  glEnableVertexArrayAttrib(vao, attribIndex);
+  attribIndex++;
+  glVertexArrayAttribFormat(vao, attribIndex, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, normal));
+  glVertexArrayAttribBinding(vao, attribIndex, bindingIndex);
+  glEnableVertexArrayAttrib(vao, attribIndex);
+  attribIndex++;
+  glVertexArrayAttribFormat(vao, attribIndex, 2, GL_FLOAT, GL_FALSE, offsetof(Vertex, texture));
+  glVertexArrayAttribBinding(vao, attribIndex, bindingIndex);
+  glEnableVertexArrayAttrib(vao, attribIndex);
+  attribIndex++;
+  glVertexArrayAttribFormat(vao, attribIndex, 3, GL_FLOAT, GL_FALSE, offsetof(Vertex, tangent));
+  glVertexArrayAttribBinding(vao, attribIndex, bindingIndex);
+  glEnableVertexArrayAttrib(vao, attribIndex);
+  if (skinned) {
+    attribIndex++;
+    glVertexArrayAttribFormat(vao, attribIndex, 4, GL_INT, GL_FALSE, offsetof(Vertex, boneIds));
+    glVertexArrayAttribBinding(vao, attribIndex, bindingIndex);
+    glEnableVertexArrayAttrib(vao, attribIndex);
+    attribIndex++;
+    glVertexArrayAttribFormat(vao, attribIndex, 4, GL_FLOAT, GL_FALSE, offsetof(Vertex, boneWeights));
+    glVertexArrayAttribBinding(vao, attribIndex, bindingIndex);
+    glEnableVertexArrayAttrib(vao, attribIndex);
+  }
+}
+void MeshBuffer::Reserve(size_t vertices, size_t indices) {
+  // NOTE: the vertex array is kept, so the meshes added so far stay valid
+  if (vertices > vertexCapacity) {
+    while (vertexCapacity < vertices)
+      vertexCapacity *= 2;
+    GLuint buffer;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, vertexCapacity * sizeof(Vertex), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glCopyNamedBufferSubData(vbo, buffer, 0, 0, vertexCount * sizeof(Vertex));
+    glDeleteBuffers(1, &vbo);
+    vbo = buffer;
+    glVertexArrayVertexBuffer(vao, 0, vbo, 0, sizeof(Vertex));
+  }
+  if (indices > indexCapacity) {
+    while (indexCapacity < indices)
+      indexCapacity *= 2;
+    GLuint buffer;
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, indexCapacity * sizeof(unsigned int), nullptr, GL_DYNAMIC_STORAGE_BIT);
+    glCopyNamedBufferSubData(ebo, buffer, 0, 0, indexCount * sizeof(unsigned int));
+    glDeleteBuffers(1, &ebo);
+    ebo = buffer;
+    glVertexArrayElementBuffer(vao, ebo);
+  }
+}
+Mesh MeshBuffer::Add(std::span<const Vertex> vertices, std::span<const unsigned int> indices) {
+  Mesh mesh;
+  if (vertices.empty())
+    return mesh;
+  std::vector<unsigned int> sequential;
+  if (indices.empty()) {
+    sequential.resize(vertices.size());
+    std::iota(sequential.begin(), sequential.end(), 0u);
+    indices = sequential;
+  }
+  if (vao == 0)
+    Allocate();
+  Reserve(vertexCount + vertices.size(), indexCount + indices.size());
+  glNamedBufferSubData(vbo, vertexCount * sizeof(Vertex), vertices.size_bytes(), vertices.data());
+  glNamedBufferSubData(ebo, indexCount * sizeof(unsigned int), indices.size_bytes(), indices.data());
+  mesh.vao = vao;
+  mesh.vertexCount = vertices.size();
+  mesh.indexCount = indices.size();
+  mesh.baseVertex = vertexCount;
+  mesh.firstIndex = indexCount;
+  vertexCount += vertices.size();
+  indexCount += indices.size();
+  return mesh;
+}
+void MeshBuffer::Clear() {
+  if (vao == 0)
+    return;
+  glDeleteVertexArrays(1, &vao);
+  glDeleteBuffers(1, &vbo);
+  glDeleteBuffers(1, &ebo);
+  vao = vbo = ebo = 0;
+  vertexCount = indexCount = 0;
+}
+unsigned int MeshBuffer::GetVertexArray() const {
+  return vao;
+}
+unsigned int MeshBuffer::GetVertexBuffer() const {
+  return vbo;
+}
+unsigned int MeshBuffer::GetIndexBuffer() const {
+  return ebo;
+}
+size_t MeshBuffer::GetVertexCount() const {
+  return vertexCount;
+}
+size_t MeshBuffer::GetIndexCount() const {
+  return indexCount;
+}
+bool MeshBuffer::IsSkinned() const {
+  return skinned;
+}
+} // namespace kuki
@@ -0,0 +1,239 @@
+#include <algorithm>
+#include <bounding_box.hpp>
+#include <camera.hpp>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <glm/ext/matrix_float3x3.hpp>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/matrix.hpp>
+#include <limits>
+#include <occlusion_culler.hpp>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <immintrin.h>
+#define KUKI_OCCLUSION_SIMD
+#endif
+namespace kuki {
+/// @brief Triangles of a box whose corner `i` is at the maximum of the axes set in `i` (x is bit 0), wound counter-clockwise when seen from outside
+static constexpr uint8_t BoxIndices[36] = {
+  0, 4, 6, 0, 6, 2, // -X
+  5, 1, 3, 5, 3, 7, // +X
+  0, 1, 5, 0, 5, 4, // -Y
+  6, 7, 3, 6, 3, 2, // +Y
+  1, 0, 2, 1, 2, 3, // -Z
+  4, 5, 7, 4, 7, 6  // +Z
+};
+static glm::vec3 GetCorner(const BoundingBox& bounds, size_t i) {
+  return {i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z};
+}
+OcclusionCuller::OcclusionCuller(size_t width, size_t height)
+  : width(width), height(height) {
+  if (width == 0 || width % 4 != 0 || height == 0)
+    throw std::invalid_argument(std::format("Depth buffer size {}x{} is invalid, width must be a positive multiple of 4", width, height));
+  levels.emplace_back(width * height, 1.f);
+  levelWidths.push_back(width);
+  levelHeights.push_back(height);
+}
+void OcclusionCuller::Begin(const Camera& camera) {
+  viewProjection = camera.transform.projection * camera.transform.view;
+  levels.resize(1);
+  levelWidths.resize(1);
+  levelHeights.resize(1);
+  std::fill(levels[0].begin(), levels[0].end(), 1.f);
+  stats = {};
+}
+void OcclusionCuller::AddOccluder(const BoundingBox& bounds, const glm::mat4& world) {
+  auto transform = viewProjection * world;
+  glm::vec4 corners[8];
+  for (size_t i = 0; i < 8; ++i)
+    corners[i] = transform * glm::vec4(GetCorner(bounds, i), 1.f);
+  // NOTE: a mirroring transform flips the winding of the triangles
+  auto mirrored = glm::determinant(glm::mat3(world)) < 0.f;
+  for (size_t i = 0; i < 36; i += 3) {
+    const auto& a = corners[BoxIndices[i]];
+    const auto& b = corners[BoxIndices[i + 1]];
+    const auto& c = corners[BoxIndices[i + 2]];
+    if (mirrored)
+      RasterizeTriangle(a, c, b);
+    else
+      RasterizeTriangle(a, b, c);
+  }
+  ++stats.occluders;
+}
+void OcclusionCuller::RasterizeTriangle(const glm::vec4& a, const glm::vec4& b, const glm::vec4& c) {
+  // NOTE: triangles crossing the near plane are skipped instead of clipped, this only loses some occlusion
+  if (a.z < -a.w || b.z < -b.w || c.z < -c.w || a.w <= 0.f || b.w <= 0.f || c.w <= 0.f)
+    return;
+  auto toScreen = [this](const glm::vec4& v) {
+    auto inverse = 1.f / v.w;
+    return glm::vec3((v.x * inverse * .5f + .5f) * width, (v.y * inverse * .5f + .5f) * height, v.z * inverse * .5f + .5f);
+  };
+  auto v0 = toScreen(a);
+  auto v1 = toScreen(b);
+  auto v2 = toScreen(c);
+  auto area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+  if (area <= 0.f)
+    return;
+  // NOTE: pixel centers are at half-integer coordinates
+  auto minX = std::max(0, static_cast<int>(std::ceil(std::min({v0.x, v1.x, v2.x}) - .5f)));
+  auto maxX = std::min(static_cast<int>(width) - 1, static_cast<int>(std::floor(std::max({v0.x, v1.x, v2.x}) - .5f)));
+  auto minY = std::max(0, static_cast<int>(std::ceil(std::min({v0.y, v1.y, v2.y}) - .5f)));
+  auto maxY = std::min(static_cast<int>(height) - 1, static_cast<int>(std::floor(std::max({v0.y, v1.y, v2.y}) - .5f)));
+  if (minX > maxX || minY > maxY)
+    return;
+  ++stats.triangles;
+  // NOTE: edge function i is positive on the inner side of the edge opposite to vertex i, and its value over the area is the barycentric weight of the vertex
+  float stepX[3] = {v1.y - v2.y, v2.y - v0.y, v0.y - v1.y};
+  float stepY[3] = {v2.x - v1.x, v0.x - v2.x, v1.x - v0.x};
+  const glm::vec3* origins[3] = {&v1, &v2, &v0};
+  auto inverseArea = 1.f / area;
+  auto depthStepX = (stepX[0] * v0.z + stepX[1] * v1.z + stepX[2] * v2.z) * inverseArea;
+  auto depthStepY = (stepY[0] * v0.z + stepY[1] * v1.z + stepY[2] * v2.z) * inverseArea;
+  auto startX = minX & ~3;
+  auto& depth = levels[0];
+  for (auto y = minY; y <= maxY; ++y) {
+    auto px = startX + .5f;
+    auto py = y + .5f;
+    float edges[3];
+    for (auto i = 0; i < 3; ++i)
+      edges[i] = stepX[i] * (px - origins[i]->x) + stepY[i] * (py - origins[i]->y);
+    auto z = v0.z + depthStepX * (px - v0.x) + depthStepY * (py - v0.y);
+    auto row = &depth[y * width];
+    auto x = startX;
+#if defined(KUKI_OCCLUSION_SIMD)
+    const auto lanes = _mm_setr_ps(0.f, 1.f, 2.f, 3.f);
+    const auto zero = _mm_setzero_ps();
+    auto e0 = _mm_add_ps(_mm_set1_ps(edges[0]), _mm_mul_ps(lanes, _mm_set1_ps(stepX[0])));
+    auto e1 = _mm_add_ps(_mm_set1_ps(edges[1]), _mm_mul_ps(lanes, _mm_set1_ps(stepX[1])));
+    auto e2 = _mm_add_ps(_mm_set1_ps(edges[2]), _mm_mul_ps(lanes, _mm_set1_ps(stepX[2])));
+    auto z4 = _mm_add_ps(_mm_set1_ps(z), _mm_mul_ps(lanes, _mm_set1_ps(depthStepX)));
+    const auto e0Step = _mm_set1_ps(4.f * stepX[0]);
+    const auto e1Step = _mm_set1_ps(4.f * stepX[1]);
+    const auto e2Step = _mm_set1_ps(4.f * stepX[2]);
+    const auto zStep = _mm_set1_ps(4.f * depthStepX);
+    for (; x <= maxX; x += 4) {
+      auto inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+      if (_mm_movemask_ps(inside) != 0) {
+        auto current = _mm_loadu_ps(row + x);
+        auto nearest = _mm_min_ps(current, z4);
+        _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, current)));
+      }
+      e0 = _mm_add_ps(e0, e0Step);
+      e1 = _mm_add_ps(e1, e1Step);
+      e2 = _mm_add_ps(e2, e2Step);
+      z4 = _mm_add_ps(z4, zStep);
+    }
+#endif
+    for (; x <= maxX; ++x) {
+      auto offset = static_cast<float>(x - startX);
+      if (edges[0] + stepX[0] * offset >= 0.f && edges[1] + stepX[1] * offset >= 0.f && edges[2] + stepX[2] * offset >= 0.f)
+        row[x] = std::min(row[x], z + depthStepX * offset);
+    }
+  }
+}
+void OcclusionCuller::BuildHiZ() {
+  levels.resize(1);
+  levelWidths.resize(1);
+  levelHeights.resize(1);
+  while (levelWidths.back() > 1 || levelHeights.back() > 1) {
+    const auto& source = levels.back();
+    auto sourceWidth = levelWidths.back();
+    auto sourceHeight = levelHeights.back();
+    auto targetWidth = (sourceWidth + 1) / 2;
+    auto targetHeight = (sourceHeight + 1) / 2;
+    std::vector<float> target(targetWidth * targetHeight);
+    for (size_t y = 0; y < targetHeight; ++y) {
+      auto y0 = 2 * y * sourceWidth;
+      auto y1 = std::min(2 * y + 1, sourceHeight - 1) * sourceWidth;
+      for (size_t x = 0; x < targetWidth; ++x) {
+        auto x0 = 2 * x;
+        auto x1 = std::min(2 * x + 1, sourceWidth - 1);
+        target[y * targetWidth + x] = std::max({source[y0 + x0], source[y0 + x1], source[y1 + x0], source[y1 + x1]});
+      }
+    }
+    levels.push_back(std::move(target));
+    levelWidths.push_back(targetWidth);
+    levelHeights.push_back(targetHeight);
+  }
+}
+bool OcclusionCuller::IsOccluded(const BoundingBox& bounds, OcclusionStats* counts) const {
+  if (counts)
+    ++counts->tested;
+  auto minX = std::numeric_limits<float>::max();
+  auto minY = std::numeric_limits<float>::max();
+  auto maxX = std::numeric_limits<float>::lowest();
+  auto maxY = std::numeric_limits<float>::lowest();
+  auto minZ = std::numeric_limits<float>::max();
+  // NOTE: the corners are the transformed minimum corner plus the transformed edges of the box
+  auto origin = viewProjection * glm::vec4(bounds.min, 1.f);
+  auto size = bounds.max - bounds.min;
+  glm::vec4 edges[3] = {viewProjection[0] * size.x, viewProjection[1] * size.y, viewProjection[2] * size.z};
+  for (size_t i = 0; i < 8; ++i) {
+    auto corner = origin;
+    for (auto axis = 0; axis < 3; ++axis)
+      if (i & (size_t{1} << axis))
+        corner += edges[axis];
+    // NOTE: a box crossing the near plane may cover the whole screen, so it is treated as visible
+    if (corner.w <= 0.f || corner.z < -corner.w)
+      return false;
+    auto inverse = 1.f / corner.w;
+    auto x = (corner.x * inverse * .5f + .5f) * width;
+    auto y = (corner.y * inverse * .5f + .5f) * height;
+    minX = std::min(minX, x);
+    minY = std::min(minY, y);
+    maxX = std::max(maxX, x);
+    maxY = std::max(maxY, y);
+    minZ = std::min(minZ, corner.z * inverse * .5f + .5f);
+  }
+  if (maxX < 0.f || maxY < 0.f || minX >= width || minY >= height)
+    return false;
+  // NOTE: occluders cover the pixels whose centers they contain, so the rectangle grows by a pixel to catch the box peeking out next to an occluder's edge
+  auto x0 = static_cast<size_t>(std::clamp(minX - 1.f, 0.f, width - 1.f));
+  auto x1 = static_cast<size_t>(std::clamp(maxX + 1.f, 0.f, width - 1.f));
+  auto y0 = static_cast<size_t>(std::clamp(minY - 1.f, 0.f, height - 1.f));
+  auto y1 = static_cast<size_t>(std::clamp(maxY + 1.f, 0.f, height - 1.f));
+  // NOTE: pick the finest level at which the screen rectangle spans at most 4x4 texels
+  size_t level = 0;
+  while (level + 1 < levels.size() && (x1 - x0 > 3 || y1 - y0 > 3)) {
+    x0 >>= 1;
+    x1 >>= 1;
+    y0 >>= 1;
+    y1 >>= 1;
+    ++level;
+  }
+  const auto& depth = levels[level];
+  auto levelWidth = levelWidths[level];
+  for (auto y = y0; y <= y1; ++y)
+    for (auto x = x0; x <= x1; ++x)
+      if (depth[y * levelWidth + x] >= minZ)
+        return false;
+  if (counts)
+    ++counts->occluded;
+  return true;
+}
+void OcclusionCuller::MergeStats(const OcclusionStats& counts) {
+  stats.tested += counts.tested;
+  stats.occluded += counts.occluded;
+}
+float OcclusionCuller::GetDepth(size_t x, size_t y, size_t level) const {
+  return levels[level][y * levelWidths[level] + x];
+}
+size_t OcclusionCuller::GetWidth() const {
+  return width;
+}
+size_t OcclusionCuller::GetHeight() const {
+  return height;
+}
+size_t OcclusionCuller::GetLevelCount() const {
+  return levels.size();
+}
+const OcclusionStats& OcclusionCuller::GetStats() const {
+  return stats;
+}
+} // namespace kuki
@@ -0,0 +1,64 @@
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <parallel.hpp>
+#include <thread>
+#include <utility>
+namespace kuki {
+WorkerPool::WorkerPool(size_t count) {
+  workers.reserve(count);
+  for (size_t i = 0; i < count; ++i)
+    workers.emplace_back(&WorkerPool::Work, this);
+}
+WorkerPool::~WorkerPool() {
+  {
+    std::lock_guard lock(mutex);
+    stopping = true;
+  }
+  condition.notify_all();
+  for (auto& worker : workers)
+    worker.join();
+}
+WorkerPool& WorkerPool::Get() {
+  static WorkerPool pool(GetParallelThreadCount() - 1);
+  return pool;
+}
+void WorkerPool::Submit(std::function<void()> job) {
+  {
+    std::lock_guard lock(mutex);
+    jobs.push_back(std::move(job));
+  }
+  condition.notify_one();
+}
+bool WorkerPool::RunPending() {
+  std::function<void()> job;
+  {
+    std::lock_guard lock(mutex);
+    if (jobs.empty())
+      return false;
+    job = std::move(jobs.front());
+    jobs.pop_front();
+  }
+  job();
+  return true;
+}
+size_t WorkerPool::GetWorkerCount() const {
+  return workers.size();
+}
+void WorkerPool::Work() {
+  while (true) {
+    std::function<void()> job;
+    {
+      std::unique_lock lock(mutex);
+      condition.wait(lock, [this]() {
+        return stopping || !jobs.empty();
+      });
+      if (jobs.empty())
+        return;
+      job = std::move(jobs.front());
+      jobs.pop_front();
+    }
+    job();
+  }
+}
+} // namespace kuki
@@ -0,0 +1,122 @@
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <glad/glad.h>
+#include <limits>
+#include <program_cache.hpp>
+#include <span>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <system_error>
+#include <vector>
+namespace kuki {
+/// @brief Header of a cache file, followed by the binary
+struct ProgramHeader {
+  uint32_t magic;
+  uint32_t format;
+  uint64_t key;
+  uint64_t size;
+};
+static uint64_t HashBytes(const std::string& text, uint64_t hash) {
+  // NOTE: 64-bit FNV-1a
+  for (auto c : text) {
+    hash ^= static_cast<unsigned char>(c);
+    hash *= 0x100000001b3ull;
+  }
+  return hash;
+}
+ProgramCache::ProgramCache(const std::filesystem::path& directory)
+  : directory(directory) {}
+bool ProgramCache::Init() {
+  if (initialized)
+    return supported;
+  initialized = true;
+  int formatCount = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+  supported = formatCount > 0;
+  if (!supported) {
+    spdlog::info("The driver has no program binary formats, shaders are compiled on every launch.");
+    return false;
+  }
+  for (auto name : {GL_VENDOR, GL_RENDERER, GL_VERSION})
+    if (auto text = glGetString(name))
+      driver.append(reinterpret_cast<const char*>(text)).push_back('\n');
+  return true;
+}
+uint64_t ProgramCache::GetKey(std::span<const std::string> sources) {
+  auto hash = HashBytes(driver, 0xcbf29ce484222325ull);
+  for (const auto& source : sources) {
+    // NOTE: the length separates the stages, so that moving text from one to another changes the key
+    hash = HashBytes(std::to_string(source.size()), hash);
+    hash = HashBytes(source, hash);
+  }
+  return hash;
+}
+std::filesystem::path ProgramCache::GetPath(const std::string& name) const {
+  return directory / (name + ".bin");
+}
+unsigned int ProgramCache::Load(const std::string& name, std::span<const std::string> sources) {
+  if (!Init()) {
+    ++stats.misses;
+    return 0;
+  }
+  auto path = GetPath(name);
+  std::ifstream fs(path, std::ios::binary);
+  ProgramHeader header{};
+  if (!fs || !fs.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != Magic || header.key != GetKey(sources)) {
+    ++stats.misses;
+    return 0;
+  }
+  // NOTE: the size is checked before allocating, so that a corrupt header cannot request more memory than the file holds
+  std::error_code error;
+  auto fileSize = std::filesystem::file_size(path, error);
+  if (error || header.size == 0 || header.size > fileSize - sizeof(header) || header.size > static_cast<uint64_t>(std::numeric_limits<GLsizei>::max())) {
+    spdlog::warn("Program binary has an invalid size: '{}'.", path.string());
+    ++stats.misses;
+    return 0;
+  }
+  std::vector<char> binary(header.size);
+  if (!fs.read(binary.data(), binary.size())) {
+    ++stats.misses;
+    return 0;
+  }
+  auto program = glCreateProgram();
+  glProgramBinary(program, header.format, binary.data(), static_cast<GLsizei>(binary.size()));
+  int success;
+  glGetProgramiv(program, GL_LINK_STATUS, &success);
+  if (!success) {
+    // NOTE: a driver may reject binaries of an older build even if its strings did not change
+    spdlog::warn("Program binary is rejected: {}.", name);
+    glDeleteProgram(program);
+    ++stats.rejected;
+    return 0;
+  }
+  ++stats.hits;
+  return program;
+}
+bool ProgramCache::Store(const std::string& name, unsigned int program, std::span<const std::string> sources) {
+  if (!Init())
+    return false;
+  int size = 0;
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+  if (size <= 0)
+    return false;
+  std::vector<char> binary(size);
+  GLenum format;
+  glGetProgramBinary(program, size, &size, &format, binary.data());
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  std::ofstream fs(GetPath(name), std::ios::binary | std::ios::trunc);
+  ProgramHeader header{Magic, format, GetKey(sources), static_cast<uint64_t>(size)};
+  if (!fs || !fs.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !fs.write(binary.data(), size)) {
+    spdlog::warn("Failed to write program binary: '{}'.", GetPath(name).string());
+    return false;
+  }
+  ++stats.stored;
+  return true;
+}
+const ProgramCacheStats& ProgramCache::GetStats() const {
+  return stats;
+}
+} // namespace kuki
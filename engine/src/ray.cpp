@@ -0,0 +1,37 @@
+#include <bounding_box.hpp>
+#include <cmath>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/geometric.hpp>
+#include <ray.hpp>
+#include <utility>
+namespace kuki {
+Ray::Ray() {}
+Ray::Ray(const glm::vec3& origin, const glm::vec3& direction)
+  : origin(origin), direction(glm::normalize(direction)) {}
+bool Ray::Intersects(const BoundingBox& bounds, float& distance, float maxDistance) const {
+  auto tMin = 0.f;
+  auto tMax = maxDistance;
+  for (auto i = 0; i < 3; ++i) {
+    if (std::abs(direction[i]) < 1e-8f) {
+      // NOTE: the ray is parallel to this slab, it can only hit the box if the origin is between the planes
+      if (origin[i] < bounds.min[i] || origin[i] > bounds.max[i])
+        return false;
+      continue;
+    }
+    auto inverse = 1.f / direction[i];
+    auto t1 = (bounds.min[i] - origin[i]) * inverse;
+    auto t2 = (bounds.max[i] - origin[i]) * inverse;
+    if (t1 > t2)
+      std::swap(t1, t2);
+    tMin = std::max(tMin, t1);
+    tMax = std::min(tMax, t2);
+    if (tMin > tMax)
+      return false;
+  }
+  distance = tMin;
+  return true;
+}
+glm::vec3 Ray::GetPoint(float distance) const {
+  return origin + direction * distance;
+}
+} // namespace kuki
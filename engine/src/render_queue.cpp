@@ -0,0 +1,77 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <mesh.hpp>
+#include <render_queue.hpp>
+#include <vector>
+namespace kuki {
+uint64_t RenderQueue::MakeKey(RenderPass pass, MaterialType shader, uint16_t material, uint16_t mesh, float depth) {
+  depth = std::clamp(depth, 0.f, 1.f);
+  // NOTE: transparent items are blended back to front, so their depth is inverted
+  if (pass == RenderPass::Transparent)
+    depth = 1.f - depth;
+  auto quantized = static_cast<uint64_t>(depth * static_cast<float>(DepthMask));
+  return (static_cast<uint64_t>(pass) & 0xF) << 60 | (static_cast<uint64_t>(shader) & 0xF) << 56 | static_cast<uint64_t>(material) << 40 | static_cast<uint64_t>(mesh) << DepthBits | (quantized & DepthMask);
+}
+uint16_t RenderQueue::GetMeshKey(const Mesh& mesh) {
+  // NOTE: meshes of a mesh buffer share the vertex array, so they are told apart by their range in it
+  auto range = static_cast<uint32_t>(mesh.firstIndex) * 2654435761u ^ static_cast<uint32_t>(mesh.baseVertex);
+  return static_cast<uint16_t>((static_cast<uint32_t>(mesh.vao) & 0xF) << 12 | ((range ^ (range >> 16)) & 0xFFF));
+}
+void RenderQueue::Clear() {
+  entries.clear();
+  items.clear();
+}
+void RenderQueue::Reserve(size_t count) {
+  entries.reserve(count);
+  buffer.reserve(count);
+  items.reserve(count);
+}
+void RenderQueue::Push(uint64_t key, const RenderItem& item) {
+  entries.push_back({key, static_cast<uint32_t>(items.size())});
+  items.push_back(item);
+}
+void RenderQueue::Sort() {
+  constexpr size_t digits = sizeof(uint64_t);
+  auto count = entries.size();
+  if (count < 2)
+    return;
+  // NOTE: digits that all keys share need no pass, e.g. the pass and shader of a scene with a single material type
+  uint64_t varying = 0;
+  for (const auto& entry : entries)
+    varying |= entry.key ^ entries[0].key;
+  size_t sortDigits[digits];
+  size_t sortCount = 0;
+  for (size_t digit = 0; digit < digits; ++digit)
+    if ((varying >> (8 * digit)) & 0xFF)
+      sortDigits[sortCount++] = digit;
+  // NOTE: histograms of the remaining digits are built in a single pass over the keys
+  size_t histograms[digits][256]{};
+  for (const auto& entry : entries)
+    for (size_t i = 0; i < sortCount; ++i)
+      ++histograms[i][(entry.key >> (8 * sortDigits[i])) & 0xFF];
+  buffer.resize(count);
+  for (size_t i = 0; i < sortCount; ++i) {
+    auto digit = sortDigits[i];
+    auto& histogram = histograms[i];
+    size_t offset = 0;
+    for (auto& bucket : histogram) {
+      auto size = bucket;
+      bucket = offset;
+      offset += size;
+    }
+    for (const auto& entry : entries)
+      buffer[histogram[(entry.key >> (8 * digit)) & 0xFF]++] = entry;
+    entries.swap(buffer);
+  }
+}
+size_t RenderQueue::Size() const {
+  return entries.size();
+}
+uint64_t RenderQueue::GetKey(size_t i) const {
+  return entries[i].key;
+}
+const RenderItem& RenderQueue::GetItem(size_t i) const {
+  return items[entries[i].index];
+}
+} // namespace kuki
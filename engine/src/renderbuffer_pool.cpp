@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstddef>
 #include <glad/glad.h>
 #include <pool.hpp>
 #include <renderbuffer_pool.hpp>
@@ -6,11 +8,12 @@ namespace kuki {
 RenderbufferPool::~RenderbufferPool() {
   Clear();
 }
-void RenderbufferPool::Clear() {
-  for (const auto& [params, renderbuffers] : pool)
-    for (auto id : renderbuffers)
-      glDeleteRenderbuffers(1, &id);
-  Pool::Clear();
+void RenderbufferPool::Free(const TextureParams& params, GLuint& renderbuffer) {
+  glDeleteRenderbuffers(1, &renderbuffer);
+}
+size_t RenderbufferPool::GetSize(const TextureParams& params) const {
+  // NOTE: the storage is always 24-bit depth and 8-bit stencil
+  return static_cast<size_t>(params.width) * params.height * std::max(params.samples, 1) * 4;
 }
 GLuint RenderbufferPool::Allocate(const TextureParams& params) {
   GLuint renderbuffer;
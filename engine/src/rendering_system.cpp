@@ -1,11 +1,18 @@
 #define GLM_ENABLE_EXPERIMENTAL
+#include <algorithm>
 #include <application.hpp>
+#include <array>
+#include <bloom_chain.hpp>
 #include <bounding_box.hpp>
 #include <camera.hpp>
+#include <chrono>
 #include <cmath>
 #include <component.hpp>
 #include <cstdint>
 #include <deque>
+#include <dynamic_resolution.hpp>
+#include <format>
+#include <gl_state_cache.hpp>
 #include <glad/glad.h>
 #include <glm/detail/type_vec3.hpp>
 #include <glm/ext/matrix_float4x4.hpp>
@@ -14,33 +21,50 @@
 #include <glm/ext/vector_float4.hpp>
 #include <id.hpp>
 #include <light.hpp>
+#include <lod_group.hpp>
 #include <material.hpp>
+#include <material_table.hpp>
 #include <mesh.hpp>
+#include <mesh_buffer.hpp>
 #include <mesh_filter.hpp>
 #include <mesh_renderer.hpp>
 #include <octree.hpp>
+#include <parallel.hpp>
 #include <pool.hpp>
+#include <primitive.hpp>
+#include <render_queue.hpp>
 #include <rendering_system.hpp>
 #include <shader.hpp>
 #include <skybox.hpp>
+#include <span>
 #include <spdlog/spdlog.h>
+#include <string_view>
 #include <system.hpp>
 #include <texture.hpp>
 #include <texture_params.hpp>
 #include <texture_pool.hpp>
 #include <transform.hpp>
-#include <unordered_map>
+#include <transform_table.hpp>
 #include <variant>
 #include <vector>
 namespace kuki {
 RenderingSystem::RenderingSystem(Application& app)
-  : System(app) {}
+  : System(app), programCache(app.GetConfig().cacheDirectory / "programs"), bakeCache(app.GetConfig().cacheDirectory / "ibl") {
+  texturePool.SetBudget(PoolBudget);
+  renderbufferPool.SetBudget(PoolBudget);
+}
 RenderingSystem::~RenderingSystem() {
   Shutdown();
 }
 void RenderingSystem::Start() {
-  glCreateBuffers(1, &materialVBO);
-  glCreateBuffers(1, &transformVBO);
+  GLint extensionCount = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+  for (auto i = 0; i < extensionCount; ++i) {
+    std::string_view extension(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)));
+    if (extension == "GL_KHR_parallel_shader_compile" || extension == "GL_ARB_parallel_shader_compile")
+      parallelCompile = true;
+  }
+  // NOTE: the programs are built on first use, so the ones a scene never uses are never compiled
   auto brdfCompute = new ComputeShader("BRDF_LUT", "shader/brdf_lut.comp", *this, ComputeType::BRDF_LUT);
   auto cubeMapEquirectCompute = new ComputeShader("CubeMapEquirect", "shader/cubemap_equirect.comp", *this, ComputeType::CubeMapEquirect);
   auto equirectCubeMapCompute = new ComputeShader("EquirectCubeMap", "shader/equirect_cubemap.comp", *this, ComputeType::EquirectCubeMap);
@@ -67,6 +91,11 @@ void RenderingSystem::Start() {
   shaders.insert({unlitShader->GetType(), unlitShader});
 }
 void RenderingSystem::Update(float deltaTime) {
+  ++frameIndex;
+  ReleaseUnusedViewTargets();
+  instanceBuffer.NextFrame();
+  materialTable.ClearEntries();
+  uploadedMaterials = 0;
   static std::deque<float> times;
   static auto accumulatedTime = 0.f;
   times.push_back(deltaTime);
@@ -77,14 +106,29 @@ void RenderingSystem::Update(float deltaTime) {
     times.pop_front();
   }
   fps = times.size();
+  dynamicResolution.Update(deltaTime * 1000.f, app.GetConfig());
 }
 void RenderingSystem::LateUpdate(float deltaTime) {
   UpdateEntityTransforms();
   UpdateCameraTransforms();
 }
 void RenderingSystem::Shutdown() {
-  glDeleteVertexArrays(1, &materialVBO);
-  glDeleteVertexArrays(1, &transformVBO);
+  instanceBuffer.Clear();
+  materialTable.Clear();
+  for (auto& [camera, targets] : viewTargets) {
+    ReleaseViewTargets(targets);
+    targets.bloom.Clear();
+  }
+  viewTargets.clear();
+  previewBloom.Clear();
+  uploadedMaterials = 0;
+  transformTable.Clear();
+  entityToRow.clear();
+  staticMeshes.Clear();
+  skinnedMeshes.Clear();
+  // NOTE: a cold start compiles every program it uses, a warm one loads all of them from the cache
+  if (const auto& stats = programCache.GetStats(); !shaders.empty() && stats.hits + stats.misses > 0)
+    spdlog::info("Shader programs are created in {:.1f} ms ({} loaded from cache, {} compiled).", programTime, stats.hits, stats.misses + stats.rejected);
   for (const auto& [_, compute] : computes)
     delete compute;
   for (const auto& [_, shader] : shaders)
@@ -103,59 +147,54 @@ void RenderingSystem::Shutdown() {
   uniformBufferPool.Clear();
   // FIXME: make sure entities return GPU resources at destruction
 }
+Mesh RenderingSystem::CreateMesh(std::span<const Vertex> vertices, std::span<const unsigned int> indices, bool skinned) {
+  return skinned ? skinnedMeshes.Add(vertices, indices) : staticMeshes.Add(vertices, indices);
+}
 size_t RenderingSystem::GetFPS() const {
   return fps;
 }
+const RenderStats& RenderingSystem::GetRenderStats() const {
+  return renderStats;
+}
+RenderPoolStats RenderingSystem::GetPoolStats() const {
+  return {texturePool.GetStats(), renderbufferPool.GetStats(), framebufferPool.GetStats(), uniformBufferPool.GetStats()};
+}
+float RenderingSystem::GetRenderScale() const {
+  return dynamicResolution.GetScale();
+}
 bool RenderingSystem::wireframeMode = false;
 void RenderingSystem::ToggleWireframeMode() {
   wireframeMode = !wireframeMode;
 }
 Shader* RenderingSystem::GetShader(MaterialType type) {
-  switch (type) {
-  case MaterialType::Lit:
-    return shaders[MaterialType::Lit];
-  case MaterialType::Unlit:
-    return shaders[MaterialType::Unlit];
-  case MaterialType::Skybox:
-    return shaders[MaterialType::Skybox];
-  case MaterialType::Bloom:
-    return shaders[MaterialType::Bloom];
-  case MaterialType::BrightPass:
-    return shaders[MaterialType::BrightPass];
-  case MaterialType::Blur:
-    return shaders[MaterialType::Blur];
-  default:
+  auto it = shaders.find(type);
+  if (it == shaders.end())
     return nullptr;
-  }
+  // NOTE: the first call starts building the program, the draws that use it are skipped until it is linked
+  return it->second->IsReady() ? it->second : nullptr;
 }
 ComputeShader* RenderingSystem::GetCompute(ComputeType type) {
-  switch (type) {
-  case ComputeType::BRDF_LUT:
-    return computes[ComputeType::BRDF_LUT];
-  case ComputeType::CubeMapEquirect:
-    return computes[ComputeType::CubeMapEquirect];
-  case ComputeType::EquirectCubeMap:
-    return computes[ComputeType::EquirectCubeMap];
-  case ComputeType::IrradianceMap:
-    return computes[ComputeType::IrradianceMap];
-  case ComputeType::PrefilterMap:
-    return computes[ComputeType::PrefilterMap];
-  default:
+  auto it = computes.find(type);
+  if (it == computes.end())
     return nullptr;
-  }
+  // NOTE: the bakes need their results right away, so a compute program is waited for on first use
+  return it->second->Wait() ? it->second : nullptr;
 }
 void RenderingSystem::UpdateEntityTransforms() {
   app.UpdateEntityTransforms();
-  // auto scene = app.GetActiveScene();
-  // if (!scene)
-  //   return;
-  // FIXME: do not traverse every Transform every frame
-  // app.ForEachEntity<Transform>([this, &scene](EntityID id, Transform* transform) {
-  //   auto filter = app.GetEntityComponent<MeshFilter>(id);
-  //   if (!filter)
-  //     return;
-  //   scene->octree.Insert(id, filter->mesh.bounds.GetWorldBounds(transform->world));
-  // });
+  // NOTE: the changes are consumed by the spatial index update, so the rows of the changed entities are patched before it
+  app.ForEachChangedEntity<Transform>([this](ID id) {
+    auto it = entityToRow.find(id);
+    if (it == entityToRow.end())
+      return;
+    if (auto transform = app.GetEntityComponent<Transform>(id))
+      transformTable.Set(it->second, transform->world);
+    else {
+      transformTable.Remove(it->second);
+      entityToRow.erase(it);
+    }
+  });
+  app.UpdateSpatialIndex();
 }
 void RenderingSystem::UpdateCameraTransforms() {
   app.ForEachEntity<Camera>([](ID id, Camera* camera) {
@@ -167,128 +206,127 @@ int RenderingSystem::RenderSceneToTexture(Camera* camera) {
   if (!camera)
     return -1;
   auto& config = app.GetConfig();
-  const auto width = config.screenWidth;
-  const auto height = config.screenHeight;
+  // NOTE: the scene is drawn at the render scale and upscaled to the screen size by the post-processing pass
+  const auto scale = dynamicResolution.GetScale();
+  const auto width = std::max(static_cast<int>(std::round(config.screenWidth * scale)), 1);
+  const auto height = std::max(static_cast<int>(std::round(config.screenHeight * scale)), 1);
   // FIXME: the following prevents users from experimenting with different aspect ratios in the editor
-  const auto aspect = static_cast<float>(width) / height;
+  const auto aspect = static_cast<float>(config.screenWidth) / config.screenHeight;
   if (camera->aspectRatio != aspect) {
     camera->aspectRatio = aspect;
     camera->rotationDirty = true;
     camera->uboDirty = true;
   }
-  const TextureParams singleParams{width, height, GL_TEXTURE_2D, GL_RGB32F, 1, 1};
-  const TextureParams multiParams{width, height, GL_TEXTURE_2D_MULTISAMPLE, GL_RGB32F, 4, 1};
-  auto framebufferMulti = framebufferPool.Request(multiParams);
-  auto framebufferSingle = framebufferPool.Request(singleParams);
-  auto renderbufferMulti = renderbufferPool.Request(multiParams);
-  auto renderbufferSingle = renderbufferPool.Request(singleParams);
-  auto textureMulti = texturePool.Request(multiParams);
-  auto textureSingle = texturePool.Request(singleParams);
-  UpdateAttachments(multiParams, framebufferMulti, renderbufferMulti, textureMulti);
-  UpdateAttachments(singleParams, framebufferSingle, renderbufferSingle, textureSingle);
-  glBindFramebuffer(GL_FRAMEBUFFER, framebufferMulti);
+  auto& targets = GetViewTargets(camera, width, height, config.screenWidth, config.screenHeight);
+  glBindFramebuffer(GL_FRAMEBUFFER, targets.framebufferMulti);
   glViewport(0, 0, width, height);
   glClearColor(0.f, 0.f, 0.f, 0.f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
   DrawScene(camera, camera);
   DrawGizmos(camera, camera);
-  glBindFramebuffer(GL_READ_FRAMEBUFFER, framebufferMulti);
-  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebufferSingle);
+  glBindFramebuffer(GL_READ_FRAMEBUFFER, targets.framebufferMulti);
+  glBindFramebuffer(GL_DRAW_FRAMEBUFFER, targets.framebufferSingle);
   glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  auto texturePost = texturePool.Request(singleParams);
-  ApplyPostProc(textureSingle, texturePost, singleParams);
-  framebufferPool.Release(multiParams, framebufferMulti);
-  framebufferPool.Release(singleParams, framebufferSingle);
-  renderbufferPool.Release(multiParams, renderbufferMulti);
-  renderbufferPool.Release(singleParams, renderbufferSingle);
-  texturePool.Release(multiParams, textureMulti);
-  texturePool.Release(singleParams, texturePost);
-  texturePool.Release(singleParams, textureSingle);
-  return texturePost;
-}
-void RenderingSystem::ApplyPostProc(unsigned int textureIn, unsigned int textureOut, const TextureParams& params) {
-  auto bloomShader = GetShader(MaterialType::Bloom);
-  if (!bloomShader) {
-    spdlog::warn("Shader not found: {}.", EnumTraits<MaterialType>().GetNames().at(static_cast<uint8_t>(MaterialType::Bloom)));
+  ApplyPostProc(targets.textureSingle, targets.singleParams, targets.framebufferPost, targets.postParams, targets.bloom);
+  return targets.texturePost;
+}
+RenderingSystem::ViewTargets& RenderingSystem::GetViewTargets(const Camera* camera, int width, int height, int postWidth, int postHeight) {
+  auto& targets = viewTargets[camera];
+  targets.lastFrame = frameIndex;
+  if (targets.framebufferMulti != 0 && targets.singleParams.width == width && targets.singleParams.height == height && targets.postParams.width == postWidth && targets.postParams.height == postHeight)
+    return targets;
+  // NOTE: the old targets go back to the pools, where they are evicted unless a view of their size requests them
+  ReleaseViewTargets(targets);
+  targets.multiParams = {width, height, GL_TEXTURE_2D_MULTISAMPLE, GL_RGB32F, 4, 1};
+  targets.singleParams = {width, height, GL_TEXTURE_2D, GL_RGB32F, 1, 1};
+  targets.postParams = {postWidth, postHeight, GL_TEXTURE_2D, GL_RGB32F, 1, 1};
+  targets.framebufferMulti = framebufferPool.Request(targets.multiParams);
+  targets.framebufferSingle = framebufferPool.Request(targets.singleParams);
+  targets.framebufferPost = framebufferPool.Request(targets.postParams);
+  targets.renderbufferMulti = renderbufferPool.Request(targets.multiParams);
+  targets.renderbufferSingle = renderbufferPool.Request(targets.singleParams);
+  targets.renderbufferPost = renderbufferPool.Request(targets.postParams);
+  targets.textureMulti = texturePool.Request(targets.multiParams);
+  targets.textureSingle = texturePool.Request(targets.singleParams);
+  targets.texturePost = texturePool.Request(targets.postParams);
+  UpdateAttachments(targets.multiParams, targets.framebufferMulti, targets.renderbufferMulti, targets.textureMulti);
+  UpdateAttachments(targets.singleParams, targets.framebufferSingle, targets.renderbufferSingle, targets.textureSingle);
+  UpdateAttachments(targets.postParams, targets.framebufferPost, targets.renderbufferPost, targets.texturePost);
+  return targets;
+}
+void RenderingSystem::ReleaseViewTargets(ViewTargets& targets) {
+  if (targets.framebufferMulti == 0)
     return;
+  framebufferPool.Release(targets.multiParams, targets.framebufferMulti);
+  framebufferPool.Release(targets.singleParams, targets.framebufferSingle);
+  framebufferPool.Release(targets.postParams, targets.framebufferPost);
+  renderbufferPool.Release(targets.multiParams, targets.renderbufferMulti);
+  renderbufferPool.Release(targets.singleParams, targets.renderbufferSingle);
+  renderbufferPool.Release(targets.postParams, targets.renderbufferPost);
+  texturePool.Release(targets.multiParams, targets.textureMulti);
+  texturePool.Release(targets.singleParams, targets.textureSingle);
+  texturePool.Release(targets.postParams, targets.texturePost);
+  targets.framebufferMulti = 0;
+}
+void RenderingSystem::ReleaseUnusedViewTargets() {
+  for (auto it = viewTargets.begin(); it != viewTargets.end();) {
+    if (it->second.lastFrame + 1 >= frameIndex) {
+      ++it;
+      continue;
+    }
+    ReleaseViewTargets(it->second);
+    it->second.bloom.Clear();
+    it = viewTargets.erase(it);
   }
+}
+void RenderingSystem::ApplyPostProc(unsigned int textureIn, const TextureParams& paramsIn, unsigned int framebufferOut, const TextureParams& paramsOut, BloomChain& bloom) {
+  auto bloomShader = GetShader(MaterialType::Bloom);
   auto brightShader = GetShader(MaterialType::BrightPass);
-  if (!brightShader) {
-    spdlog::warn("Shader not found: {}.", EnumTraits<MaterialType>().GetNames().at(static_cast<uint8_t>(MaterialType::BrightPass)));
-    return;
-  }
   auto blurShader = GetShader(MaterialType::Blur);
-  if (!blurShader) {
-    spdlog::warn("Shader not found: {}.", EnumTraits<MaterialType>().GetNames().at(static_cast<uint8_t>(MaterialType::Blur)));
+  // NOTE: when the output cannot be composited, it is cleared rather than left with the contents of a previous use
+  static constexpr float black[]{0.f, 0.f, 0.f, 1.f};
+  if (!bloomShader || !brightShader || !blurShader) {
+    glClearNamedFramebufferfv(framebufferOut, GL_COLOR, 0, black);
     return;
   }
   auto frameId = app.GetAssetId("Frame");
   auto mesh = app.GetAssetComponent<Mesh>(frameId);
   if (!mesh) {
     spdlog::warn("Frame mesh not found.");
+    glClearNamedFramebufferfv(framebufferOut, GL_COLOR, 0, black);
     return;
   }
-  auto framebufferPing = framebufferPool.Request(params);
-  auto framebufferPong = framebufferPool.Request(params);
-  auto renderbufferPing = renderbufferPool.Request(params);
-  auto renderbufferPong = renderbufferPool.Request(params);
-  auto texturePing = texturePool.Request(params);
-  auto texturePong = texturePool.Request(params);
-  auto textureNormal = texturePool.Request(params);
-  UpdateAttachments(params, framebufferPong, renderbufferPong, textureNormal, texturePong);
-  glBindFramebuffer(GL_FRAMEBUFFER, framebufferPong);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, textureIn);
-  brightShader->Use();
-  brightShader->SetUniform("image", 0);
-  glViewport(0, 0, params.width, params.height);
-  glClearColor(0.f, 0.f, 0.f, 0.f);
-  glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-  brightShader->SetUniform("model", glm::mat4(1.f));
-  unsigned int attachments[2] = {GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1};
-  glDrawBuffers(2, attachments);
-  brightShader->Draw(mesh);
-  const auto blurPasses = 8;
-  blurShader->Use();
-  blurShader->SetUniform("model", glm::mat4(1.f));
-  blurShader->SetUniform("image", 0);
-  for (auto i = 0; i < blurPasses; ++i) {
-    auto pingPong = i % 2 == 0;
-    auto framebuffer = pingPong ? framebufferPing : framebufferPong;
-    auto renderbuffer = pingPong ? renderbufferPing : renderbufferPong;
-    auto textureTarget = pingPong ? texturePing : texturePong;
-    auto textureSource = pingPong ? texturePong : texturePing;
-    UpdateAttachments(params, framebuffer, renderbuffer, textureTarget);
-    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
-    glBindTexture(GL_TEXTURE_2D, textureSource);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-    blurShader->SetUniform("horizontal", pingPong);
-    blurShader->Draw(mesh);
+  // NOTE: an image too small for a single level is composited without bloom
+  if (!bloom.Resize(paramsIn.width, paramsIn.height) && bloom.GetLevelCount() > 0) {
+    spdlog::error("Bloom framebuffers are incomplete.");
+    glClearNamedFramebufferfv(framebufferOut, GL_COLOR, 0, black);
+    return;
   }
-  glDrawBuffer(GL_COLOR_ATTACHMENT0);
-  UpdateAttachments(params, framebufferPing, renderbufferPing, textureOut);
-  glBindFramebuffer(GL_FRAMEBUFFER, framebufferPing);
+  bloom.Apply(textureIn, *brightShader, *blurShader, mesh);
+  auto levelCount = bloom.GetLevelCount();
+  glBindFramebuffer(GL_FRAMEBUFFER, framebufferOut);
+  glViewport(0, 0, paramsOut.width, paramsOut.height);
   glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D, textureNormal);
+  glBindTexture(GL_TEXTURE_2D, textureIn);
   glActiveTexture(GL_TEXTURE1);
-  glBindTexture(GL_TEXTURE_2D, texturePong);
+  glBindTexture(GL_TEXTURE_2D, levelCount > 0 ? bloom.GetTexture(0) : textureIn);
+  glClearColor(0.f, 0.f, 0.f, 0.f);
   glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
   bloomShader->Use();
   bloomShader->SetUniform("hdrImage", 0);
   bloomShader->SetUniform("bloomImage", 1);
+  bloomShader->SetUniform("bloomStrength", levelCount > 0 ? 1.f / levelCount : 0.f);
   bloomShader->SetUniform("exposure", 1.f);
   bloomShader->SetUniform("gamma", 2.2f);
   bloomShader->SetUniform("model", glm::mat4(1.f));
   bloomShader->Draw(mesh);
   glBindFramebuffer(GL_FRAMEBUFFER, 0);
-  framebufferPool.Release(params, framebufferPing);
-  framebufferPool.Release(params, framebufferPong);
-  renderbufferPool.Release(params, renderbufferPing);
-  renderbufferPool.Release(params, renderbufferPong);
-  texturePool.Release(params, texturePing);
-  texturePool.Release(params, texturePong);
-  texturePool.Release(params, textureNormal);
+}
+void RenderingSystem::ReleaseAsset(ID assetId) {
+  // NOTE: OpenGL reuses the names of deleted textures, a stale entry would map a new texture to the old one's layer
+  if (auto texture = app.GetAssetComponent<Texture>(assetId))
+    materialTable.EvictTexture(texture->id);
 }
 int RenderingSystem::RenderAssetToTexture(ID assetId, const int textureSize) {
   const auto [texture, skybox] = app.GetAssetComponents<Texture, Skybox>(assetId);
@@ -299,7 +337,8 @@ int RenderingSystem::RenderAssetToTexture(ID assetId, const int textureSize) {
     textureIdPost = texture->id;
   else if (skybox)
     textureIdPost = skybox->preview;
-  else {
+  else if (GetShader(MaterialType::Lit) && GetShader(MaterialType::BrightPass) && GetShader(MaterialType::Blur) && GetShader(MaterialType::Bloom)) {
+    // NOTE: a preview is kept once rendered, so it is not rendered until the programs it uses are linked
     TextureParams textureParams{textureSize, textureSize, GL_TEXTURE_2D, GL_RGBA32F};
     auto textureIdPre = texturePool.Request(textureParams);
     textureIdPost = texturePool.Request(textureParams);
@@ -312,9 +351,10 @@ int RenderingSystem::RenderAssetToTexture(ID assetId, const int textureSize) {
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
     DrawAssetHierarchy(assetId);
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    UpdateAttachments(textureParams, framebuffer, renderbuffer, textureIdPost);
+    ApplyPostProc(textureIdPre, textureParams, framebuffer, textureParams, previewBloom);
     framebufferPool.Release(textureParams, framebuffer);
     renderbufferPool.Release(textureParams, renderbuffer);
-    ApplyPostProc(textureIdPre, textureIdPost, textureParams);
     texturePool.Release(textureParams, textureIdPre);
     assetToTexture[assetId] = textureIdPost;
   }
@@ -323,25 +363,96 @@ int RenderingSystem::RenderAssetToTexture(ID assetId, const int textureSize) {
 void RenderingSystem::DrawScene(const Camera* camera, const Camera* observer) {
   if (!camera)
     return;
-  std::unordered_map<unsigned int, std::vector<ID>> vaoToEntities;
-  std::unordered_map<unsigned int, Mesh> vaoToMesh;
-  // TODO: use ForEachVisibleEntity below
-  app.ForEachEntity<MeshFilter>([this, &vaoToMesh, &vaoToEntities](ID id, MeshFilter* filter) {
-    auto vao = filter->mesh.vao;
-    vaoToMesh[vao] = filter->mesh;
-    vaoToEntities[vao].push_back(id);
+  auto start = std::chrono::high_resolution_clock::now();
+  auto writtenBytes = instanceBuffer.GetStats().bytes;
+  renderQueue.Clear();
+  visibleEntities.clear();
+  app.ForEachVisibleEntity(*camera, [this](ID id) {
+    visibleEntities.push_back(id);
+  });
+  // NOTE: component managers are created on first access, which must not happen inside the jobs
+  if (!visibleEntities.empty())
+    app.GetEntityComponents<MeshFilter, MeshRenderer, Transform, LODGroup>(visibleEntities.front());
+  if (drawJobs.size() < GetParallelThreadCount())
+    drawJobs.resize(GetParallelThreadCount());
+  constexpr size_t minChunk = 512;
+  auto jobCount = ParallelChunks(visibleEntities.size(), [this, &camera](size_t job, size_t begin, size_t end) {
+    BuildDrawJob(camera, std::span<const ID>(visibleEntities).subspan(begin, end - begin), drawJobs[job]);
+  }, minChunk);
+  // NOTE: the merge packs new textures and allocates transform rows, which only the context thread may do
+  size_t visibleCount = 0;
+  size_t reducedCount = 0;
+  auto getTransformRow = [this](ID id, const glm::mat4& world) {
+    return GetTransformRow(id, world);
+  };
+  for (size_t i = 0; i < jobCount; ++i) {
+    auto& job = drawJobs[i];
+    job.Merge(materialTable, renderQueue, getTransformRow);
+    visibleCount += job.visible;
+    reducedCount += job.reduced;
+  }
+  renderQueue.Sort();
+  auto patchedBytes = transformTable.Upload();
+  transformTable.Bind();
+  UploadMaterialTable();
+  auto targetCam = observer ? observer : camera;
+  sceneLights.clear();
+  app.ForEachEntity<Light>([this](ID id, Light* light) {
+    sceneLights.push_back(light);
   });
+  lightClusters.Build(*targetCam, sceneLights);
+  UploadLightClusters();
+  renderStats = {};
+  renderStats.buildTime = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+  renderStats.reducedDetail = reducedCount;
+  renderStats.culled = app.GetSpatialEntityCount() - visibleCount;
+  if (app.GetOcclusionCulling())
+    renderStats.occluded = app.GetOcclusionStats().occluded;
   if (wireframeMode)
     glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-  auto targetCam = observer ? observer : camera;
-  for (const auto& [vao, entities] : vaoToEntities)
-    DrawEntitiesInstanced(targetCam, &vaoToMesh[vao], entities);
+  // NOTE: groups are sorted by shader, so its per-frame state is set once per run of groups that share it
+  auto boundShader = ~uint64_t{0};
+  stateCache.Begin();
+  renderQueue.ForEachBatch([this, &targetCam, &boundShader](size_t begin, size_t end) {
+    auto shader = renderQueue.GetKey(begin) & RenderQueue::ShaderMask;
+    // NOTE: a group whose program is not linked yet is skipped, the next group must then set the state of its shader
+    if (DrawGroup(targetCam, begin, end, shader != boundShader))
+      boundShader = shader;
+  }, RenderQueue::MaterialMask);
+  stateCache.End();
+  renderStats.stateCalls = stateCache.GetStats();
   if (wireframeMode)
     glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+  renderStats.uploadBytes = patchedBytes + instanceBuffer.GetStats().bytes - writtenBytes;
   app.ForFirstEntity<Skybox>([this, &targetCam](ID id, Skybox* skybox) {
     DrawSkybox(targetCam, skybox);
   });
 }
+void RenderingSystem::BuildDrawJob(const Camera* camera, std::span<const ID> ids, DrawJob& job) const {
+  job.Clear();
+  for (const auto id : ids) {
+    auto [filter, renderer, transform, group] = app.GetEntityComponents<MeshFilter, MeshRenderer, Transform, LODGroup>(id);
+    if (!filter)
+      continue;
+    ++job.visible;
+    if (!renderer || !transform)
+      continue;
+    const auto* mesh = &filter->mesh;
+    // NOTE: the levels share the vertex array of their mesh buffer, the mesh key tells them apart so that instances are batched per level
+    auto bounds = group && !group->levels.empty() ? app.GetEntitySpatialBounds(id) : nullptr;
+    if (bounds) {
+      auto level = group->Select(camera->GetScreenSize(*bounds), lodBias, lodHysteresis);
+      mesh = &group->levels[level].mesh;
+      if (level > 0)
+        ++job.reduced;
+    }
+    auto row = entityToRow.find(id);
+    auto distance = glm::length(glm::vec3(transform->world[3]) - camera->position);
+    RenderItem item{mesh, &renderer->material, &transform->world};
+    item.transformRow = row == entityToRow.end() ? DrawJob::NoTransformRow : row->second;
+    job.Add(id, item, renderer->material.GetType(), distance / camera->farPlane, materialTable.Prepare(renderer->material));
+  }
+}
 void RenderingSystem::DrawSkybox(const Camera* camera, const Skybox* skybox) {
   if (!camera || !skybox)
     return;
@@ -350,6 +461,8 @@ void RenderingSystem::DrawSkybox(const Camera* camera, const Skybox* skybox) {
   if (!mesh)
     return;
   auto shader = GetShader(MaterialType::Skybox);
+  if (!shader)
+    return;
   shader->Use();
   shader->SetCamera(camera);
   auto model = glm::scale(glm::mat4(1.f), glm::vec3(2.f));
@@ -359,115 +472,115 @@ void RenderingSystem::DrawSkybox(const Camera* camera, const Skybox* skybox) {
   else {
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_CUBE_MAP, skybox->original);
-    shader->SetUniform("skybox", 0);
     shader->SetUniform("useSkybox", true);
   }
   glDepthFunc(GL_LEQUAL);
   shader->Draw(mesh);
   glDepthFunc(GL_LESS);
 }
-void RenderingSystem::DrawEntitiesInstanced(const Camera* camera, const Mesh* mesh, const std::vector<ID>& entities) {
-  if (!camera || !mesh)
-    return;
-  std::vector<LitFallbackData> litMaterials;
-  std::vector<UnlitFallbackData> unlitMaterials;
-  std::vector<glm::mat4> litTransforms;
-  std::vector<glm::mat4> unlitTransforms;
-  // NOTE: following variables will store the last instance of that material type
-  Material materialLit;
-  Material materialUnlit;
-  // FIXME: a separate draw call shall be invoked per unique material configuration (e.g., different albedo textures)
-  for (auto id : entities) {
-    auto [renderer, transform] = app.GetEntityComponents<MeshRenderer, Transform>(id);
-    if (!renderer || !transform)
-      continue;
-    if (auto litMaterial = std::get_if<LitMaterial>(&renderer->material.current)) {
-      materialLit = renderer->material;
-      litMaterials.push_back(litMaterial->fallback);
-      litTransforms.push_back(transform->world);
-    } else if (auto unlitMaterial = std::get_if<UnlitMaterial>(&renderer->material.current)) {
-      materialUnlit = renderer->material;
-      unlitMaterials.push_back(unlitMaterial->fallback);
-      unlitTransforms.push_back(transform->world);
-    } // else ...
+bool RenderingSystem::DrawGroup(const Camera* camera, size_t begin, size_t end, bool bindShader) {
+  if (!camera || begin >= end)
+    return false;
+  const auto& first = renderQueue.GetItem(begin);
+  // NOTE: items of a group share the shader, hence the material type, and the texture arrays, each reads its own layers from the material table
+  Shader* shader{nullptr};
+  auto lit = std::holds_alternative<LitMaterial>(first.material->current);
+  if (lit) {
+    auto litShader = static_cast<LitShader*>(GetShader(MaterialType::Lit));
+    if (!litShader)
+      return false;
+    shader = litShader;
+    if (bindShader) {
+      Skybox* skybox{nullptr};
+      app.ForFirstEntity<Skybox>([this, &skybox](ID id, Skybox* skyboxComp) {
+        skybox = skyboxComp;
+      });
+      litShader->Use();
+      litShader->SetCamera(camera);
+      litShader->SetLighting(sceneLights);
+      litShader->SetLightClusters(&lightClusters);
+      litShader->SetSkybox(skybox);
+    }
+  } else if (std::holds_alternative<UnlitMaterial>(first.material->current)) {
+    shader = GetShader(MaterialType::Unlit);
+    if (!shader)
+      return false;
+    if (bindShader) {
+      shader->Use();
+      shader->SetCamera(camera);
+    }
+  } else
+    return false;
+  shader->SetMaterial(first.material);
+  // NOTE: meshes of different vertex formats are in different vertex arrays, each needs its own instance bindings and draw call
+  for (auto from = begin; from < end;) {
+    const auto* mesh = renderQueue.GetItem(from).mesh;
+    auto to = from + 1;
+    while (to < end && renderQueue.GetItem(to).mesh->vao == mesh->vao)
+      ++to;
+    transformRows.clear();
+    materialIndices.clear();
+    for (auto i = from; i < to; ++i) {
+      const auto& item = renderQueue.GetItem(i);
+      transformRows.push_back(item.transformRow);
+      materialIndices.push_back(item.materialIndex);
+    }
+    shader->SetMaterialIndex(mesh, materialIndices, instanceBuffer);
+    shader->SetTransformIndex(mesh, transformRows, instanceBuffer);
+    DrawMeshes(shader, from, to);
+    from = to;
   }
-  if (litMaterials.size() > 0) {
-    Skybox* skybox{nullptr};
-    app.ForFirstEntity<Skybox>([this, &skybox](ID id, Skybox* skyboxComp) {
-      skybox = skyboxComp;
-    });
-    auto shader = static_cast<LitShader*>(GetShader(MaterialType::Lit));
-    std::vector<const Light*> lights;
-    app.ForEachEntity<Light>([&](ID id, Light* light) {
-      lights.push_back(light);
-    });
-    shader->Use();
-    shader->SetCamera(camera);
-    shader->SetLighting(lights);
-    if (skybox) {
-      // TODO: let the shader handle which texture units to use
-      // NOTE: units 0-6 are used by other textures such as albedo map
-      if (skybox->irradiance > 0) {
-        glActiveTexture(GL_TEXTURE7);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox->irradiance);
-        shader->SetUniform("irradianceMap", 7);
-      }
-      if (skybox->prefilter > 0) {
-        glActiveTexture(GL_TEXTURE8);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, skybox->prefilter);
-        shader->SetUniform("prefilterMap", 8);
-      }
-      if (skybox->brdf > 0) {
-        glActiveTexture(GL_TEXTURE9);
-        glBindTexture(GL_TEXTURE_2D, skybox->brdf);
-        shader->SetUniform("brdfLUT", 9);
-      }
-      shader->SetUniform("hasSkybox", true);
-      shader->SetUniform("hasIrradianceMap", skybox->irradiance > 0);
-      shader->SetUniform("hasPrefilterMap", skybox->prefilter > 0);
-      shader->SetUniform("hasBRDF", skybox->brdf > 0);
-    } else {
-      shader->SetUniform("hasSkybox", false);
-      shader->SetUniform("hasIrradianceMap", false);
-      shader->SetUniform("hasPrefilterMap", false);
-      shader->SetUniform("hasBRDF", false);
+  return true;
+}
+void RenderingSystem::DrawMeshes(Shader* shader, size_t begin, size_t end) {
+  // NOTE: each run of the same mesh becomes an indirect command whose base instance points at its instance attributes
+  drawCommands.clear();
+  const Mesh* previous{nullptr};
+  for (auto i = begin; i < end; ++i) {
+    const auto* mesh = renderQueue.GetItem(i).mesh;
+    auto baseInstance = static_cast<unsigned int>(i - begin);
+    if (mesh->indexCount == 0) {
+      // NOTE: meshes without indices are not in a mesh buffer, they are drawn one by one
+      shader->DrawInstanced(mesh, 1, baseInstance);
+      ++renderStats.drawCalls;
+      previous = nullptr;
+      continue;
     }
-    shader->SetMaterial(&materialLit);
-    shader->SetMaterialFallback(mesh, litMaterials, materialVBO);
-    shader->SetTransform(mesh, litTransforms, transformVBO);
-    shader->DrawInstanced(mesh, litTransforms.size());
+    if (!previous || mesh->firstIndex != previous->firstIndex || mesh->baseVertex != previous->baseVertex || mesh->indexCount != previous->indexCount)
+      drawCommands.push_back({static_cast<unsigned int>(mesh->indexCount), 0, static_cast<unsigned int>(mesh->firstIndex), mesh->baseVertex, baseInstance});
+    ++drawCommands.back().instanceCount;
+    previous = mesh;
   }
-  if (unlitMaterials.size() > 0) {
-    auto shader = static_cast<UnlitShader*>(GetShader(MaterialType::Unlit));
-    shader->Use();
-    shader->SetCamera(camera);
-    shader->SetMaterial(&materialUnlit);
-    shader->SetMaterialFallback(mesh, unlitMaterials, materialVBO);
-    shader->SetTransform(mesh, unlitTransforms, transformVBO);
-    shader->DrawInstanced(mesh, unlitTransforms.size());
+  if (!drawCommands.empty()) {
+    shader->MultiDrawIndirect(renderQueue.GetItem(begin).mesh->vao, drawCommands, instanceBuffer);
+    ++renderStats.drawCalls;
   }
+  renderStats.drawn += end - begin;
 }
 void RenderingSystem::DrawAssetHierarchy(ID id) {
   static const Light dirLight{};
   auto shader = static_cast<LitShader*>(GetShader(MaterialType::Lit));
+  if (!shader)
+    return;
   auto bounds = GetAssetBounds(id);
   assetCam.Frame(bounds);
   shader->Use();
   shader->SetCamera(&assetCam);
   shader->SetLighting(&dirLight);
-  shader->SetUniform("hasSkybox", false);
+  shader->SetLightClusters(nullptr);
+  shader->SetSkybox(nullptr);
   DrawAsset(id);
 }
 void RenderingSystem::DrawAsset(ID id) {
   auto [transform, mesh, material] = app.GetAssetComponents<Transform, Mesh, Material>(id);
-  if (transform && mesh && material) {
+  auto shader = static_cast<LitShader*>(GetShader(MaterialType::Lit));
+  if (transform && mesh && material && shader) {
     auto model = transform->world;
-    auto shader = static_cast<LitShader*>(GetShader(MaterialType::Lit));
     shader->SetMaterial(material);
-    if (auto litMaterial = std::get_if<LitMaterial>(&material->current))
-      // TODO: support other materials
-      shader->SetMaterialFallback(mesh, litMaterial->fallback, materialVBO);
-    shader->SetTransform(mesh, model, transformVBO);
+    auto index = materialTable.Add(*material).entry;
+    UploadMaterialTable();
+    shader->SetMaterialIndex(mesh, index, instanceBuffer);
+    shader->SetTransform(mesh, model, instanceBuffer);
     shader->Draw(mesh);
   }
   app.ForEachChildAsset(id, [this](ID childId) {
@@ -505,8 +618,8 @@ void RenderingSystem::DrawFrustumCulling(const Camera* camera, const Camera* obs
   glm::vec4 color{};
   color.a = .2f;
   std::vector<glm::mat4> transforms;
-  std::vector<UnlitFallbackData> materials;
-  app.ForEachOctreeLeafNode([&](OctreeNode<ID>* node, Octant octant) {
+  std::vector<unsigned int> materials;
+  app.ForEachSpatialLeafNode([&](const auto* node, Octant octant) {
     auto depth = node->depth;
     auto maxDepth = node->maxDepth;
     auto center = node->center;
@@ -520,15 +633,18 @@ void RenderingSystem::DrawFrustumCulling(const Camera* camera, const Camera* obs
     color.g = intersects ? .5f + ratio : 0.f;
     color.b = maxDepth > 0 ? static_cast<float>(depth) / maxDepth : 1.f;
     transforms.push_back(model);
-    UnlitFallbackData material{};
-    material.base = color;
-    materials.push_back(material);
+    MaterialEntry material{};
+    material.albedo = color;
+    materials.push_back(materialTable.Add(material));
   });
+  UploadMaterialTable();
   auto shader = static_cast<UnlitShader*>(GetShader(MaterialType::Unlit));
+  if (!shader)
+    return;
   shader->Use();
   shader->SetCamera(observer);
-  shader->SetMaterialFallback(mesh, materials, materialVBO);
-  shader->SetTransform(mesh, transforms, transformVBO);
+  shader->SetMaterialIndex(mesh, materials, instanceBuffer);
+  shader->SetTransform(mesh, transforms, instanceBuffer);
   shader->DrawInstanced(mesh, transforms.size());
 }
 void RenderingSystem::DrawViewFrustum(const Camera* camera, const Camera* observer) {
@@ -541,31 +657,89 @@ void RenderingSystem::DrawViewFrustum(const Camera* camera, const Camera* observ
   auto& unlitMaterial = std::get<UnlitMaterial>(material.current);
   unlitMaterial.fallback.base = glm::vec4(.5f, .5f, 0.f, .2f);
   auto shader = static_cast<UnlitShader*>(GetShader(MaterialType::Unlit));
+  if (!shader)
+    return;
   shader->Use();
   shader->SetCamera(observer);
   shader->SetMaterial(&material);
-  shader->SetMaterialFallback(frameMesh, unlitMaterial.fallback, materialVBO);
+  auto index = materialTable.Add(material).entry;
+  UploadMaterialTable();
+  shader->SetMaterialIndex(frameMesh, index, instanceBuffer);
   glDisable(GL_CULL_FACE);
   // near plane (z = -1 in NDC)
   auto nearModel = glm::scale(glm::mat4(1.f), glm::vec3(2.f, 2.f, 1.f));
   nearModel = glm::translate(nearModel, glm::vec3(0.f, 0.f, -1.f));
   nearModel = glm::inverse(camera->transform.projection * camera->transform.view) * nearModel;
-  shader->SetTransform(frameMesh, nearModel, transformVBO);
+  shader->SetTransform(frameMesh, nearModel, instanceBuffer);
   shader->DrawInstanced(frameMesh, 1);
   // far plane (z = 1 in NDC)
   auto farModel = glm::scale(glm::mat4(1.f), glm::vec3(2.f, 2.f, 1.f));
   farModel = glm::translate(farModel, glm::vec3(0.f, 0.f, 1.f));
   farModel = glm::inverse(camera->transform.projection * camera->transform.view) * farModel;
-  shader->SetTransform(frameMesh, farModel, transformVBO);
+  shader->SetTransform(frameMesh, farModel, instanceBuffer);
   shader->DrawInstanced(frameMesh, 1);
   glEnable(GL_CULL_FACE);
 }
+void RenderingSystem::UploadMaterialTable() {
+  const auto& entries = materialTable.GetEntries();
+  if (entries.size() == uploadedMaterials)
+    return;
+  // NOTE: draws issued before a re-upload keep the range that was bound when they were issued
+  auto size = entries.size() * sizeof(MaterialEntry);
+  auto offset = instanceBuffer.Write(entries.data(), size, GetStorageAlignment());
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, MaterialTable::BindingPoint, instanceBuffer.GetId(), offset, size);
+  uploadedMaterials = entries.size();
+}
+void RenderingSystem::UploadLightClusters() {
+  const auto& lights = lightClusters.GetLights();
+  if (lights.empty())
+    return;
+  const auto& clusters = lightClusters.GetClusters();
+  const auto& indices = lightClusters.GetIndices();
+  auto alignment = GetStorageAlignment();
+  auto lightsSize = lights.size() * sizeof(LightEntry);
+  auto lightsOffset = instanceBuffer.Write(lights.data(), lightsSize, alignment);
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LightClusters::LightBindingPoint, instanceBuffer.GetId(), lightsOffset, lightsSize);
+  auto clustersSize = clusters.size() * sizeof(LightCluster);
+  auto clustersOffset = instanceBuffer.Write(clusters.data(), clustersSize, alignment);
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LightClusters::ClusterBindingPoint, instanceBuffer.GetId(), clustersOffset, clustersSize);
+  // NOTE: a light is only kept if it reaches a cluster, so there is at least one index
+  auto indicesSize = indices.size() * sizeof(uint32_t);
+  auto indicesOffset = instanceBuffer.Write(indices.data(), indicesSize, alignment);
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, LightClusters::IndexBindingPoint, instanceBuffer.GetId(), indicesOffset, indicesSize);
+}
+size_t RenderingSystem::GetStorageAlignment() {
+  if (storageAlignment == 0) {
+    GLint alignment = 0;
+    glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    storageAlignment = std::max(alignment, 1);
+  }
+  return storageAlignment;
+}
+uint32_t RenderingSystem::GetTransformRow(ID id, const glm::mat4& world) {
+  auto [it, inserted] = entityToRow.try_emplace(id, 0);
+  if (inserted)
+    it->second = transformTable.Add(world);
+  return it->second;
+}
 size_t RenderingSystem::GetGizmoMask() const {
   return gizmoMask;
 }
 void RenderingSystem::SetGizmoMask(size_t mask) {
   gizmoMask = mask;
 }
+void RenderingSystem::SetLODBias(float bias) {
+  lodBias = std::max(bias, 0.f);
+}
+float RenderingSystem::GetLODBias() const {
+  return lodBias;
+}
+void RenderingSystem::SetLODHysteresis(float hysteresis) {
+  lodHysteresis = std::clamp(hysteresis, 0.f, 1.f);
+}
+float RenderingSystem::GetLODHysteresis() const {
+  return lodHysteresis;
+}
 Texture RenderingSystem::CreateCubeMapFromEquirect(Texture equirect, const int textureSize) {
   constexpr unsigned int workgroupSize = 8;
   Texture texture{};
@@ -573,7 +747,7 @@ Texture RenderingSystem::CreateCubeMapFromEquirect(Texture equirect, const int t
   texture.width = textureSize;
   texture.height = textureSize;
   const auto numGroups = static_cast<unsigned int>(std::ceil(static_cast<float>(textureSize) / workgroupSize));
-  TextureParams params{texture.width, texture.height, GL_TEXTURE_CUBE_MAP, GL_RGBA32F};
+  auto params = GetBakeParams(TextureType::CubeMap, textureSize);
   texture.id = texturePool.Request(params);
   auto shader = GetCompute(ComputeType::EquirectCubeMap);
   if (!shader) {
@@ -598,7 +772,7 @@ Texture RenderingSystem::CreateEquirectFromCubeMap(Texture cubeMap, const int te
   texture.width = textureSize;
   texture.height = textureSize;
   const auto numGroups = static_cast<unsigned int>(std::ceil(static_cast<float>(textureSize) / workgroupSize));
-  TextureParams params{texture.width, texture.height, GL_TEXTURE_2D, GL_RGBA32F};
+  auto params = GetBakeParams(TextureType::Equirect, textureSize);
   texture.id = texturePool.Request(params);
   auto shader = GetCompute(ComputeType::CubeMapEquirect);
   if (!shader) {
@@ -622,7 +796,7 @@ Texture RenderingSystem::CreateIrradianceMapFromCubeMap(Texture cubeMap, const i
   texture.type = TextureType::Irradiance;
   texture.width = textureSize;
   texture.height = textureSize;
-  TextureParams params{textureSize, textureSize, GL_TEXTURE_CUBE_MAP, GL_RGBA32F};
+  auto params = GetBakeParams(TextureType::Irradiance, textureSize);
   texture.id = texturePool.Request(params);
   auto shader = GetCompute(ComputeType::IrradianceMap);
   if (!shader) {
@@ -646,7 +820,7 @@ Texture RenderingSystem::CreatePrefilterMapFromCubeMap(Texture cubeMap, const in
   texture.type = TextureType::Prefilter;
   texture.width = textureSize;
   texture.height = textureSize;
-  TextureParams params{textureSize, textureSize, GL_TEXTURE_CUBE_MAP, GL_RGBA32F, 1, static_cast<int>(mipLevels)};
+  auto params = GetBakeParams(TextureType::Prefilter, textureSize);
   texture.id = texturePool.Request(params);
   auto shader = GetCompute(ComputeType::PrefilterMap);
   if (!shader) {
@@ -680,8 +854,14 @@ Texture RenderingSystem::CreateBRDF_LUT(const int textureSize) {
   texture.type = TextureType::BRDF;
   texture.width = textureSize;
   texture.height = textureSize;
-  TextureParams params{textureSize, textureSize, GL_TEXTURE_2D, GL_RG16F};
+  auto params = GetBakeParams(TextureType::BRDF, textureSize);
   texture.id = texturePool.Request(params);
+  // NOTE: the lookup table depends on nothing but its size, so it is baked once per machine
+  auto key = GetBakeKey(0, params);
+  if (bakeCache.Load("brdf_lut", key, texture.id, params)) {
+    brdf = texture;
+    return brdf;
+  }
   auto shader = GetCompute(ComputeType::BRDF_LUT);
   if (!shader) {
     spdlog::warn("Compute shader not found: {}.", EnumTraits<ComputeType>().GetNames().at(static_cast<uint8_t>(ComputeType::BRDF_LUT)));
@@ -691,7 +871,62 @@ Texture RenderingSystem::CreateBRDF_LUT(const int textureSize) {
   glBindImageTexture(0, texture.id, 0, GL_FALSE, 0, GL_WRITE_ONLY, params.format);
   glDispatchCompute(numGroups, numGroups, 1);
   glMemoryBarrier(GL_SHADER_IMAGE_ACCESS_BARRIER_BIT);
+  bakeCache.Store("brdf_lut", key, texture.id, params);
   brdf = texture;
   return brdf;
 }
+TextureParams RenderingSystem::GetBakeParams(TextureType type, int size) {
+  switch (type) {
+  case TextureType::CubeMap:
+  case TextureType::Irradiance:
+    return {size, size, GL_TEXTURE_CUBE_MAP, GL_RGBA32F};
+  case TextureType::Prefilter:
+    return {size, size, GL_TEXTURE_CUBE_MAP, GL_RGBA32F, 1, static_cast<int>(std::floor(std::log2(size))) + 1};
+  case TextureType::BRDF:
+    return {size, size, GL_TEXTURE_2D, GL_RG16F};
+  default:
+    return {size, size, GL_TEXTURE_2D, GL_RGBA32F};
+  }
+}
+uint64_t RenderingSystem::GetBakeKey(uint64_t source, const TextureParams& params) {
+  const int fields[]{params.width, params.height, params.target, params.format, params.samples, params.mipmaps};
+  return TextureCache::Hash(fields, sizeof(fields), TextureCache::Hash(&source, sizeof(source), BakeVersion));
+}
+/// @brief A map baked for a skybox, in the order LoadSkybox and StoreSkybox visit them
+struct SkyboxMap {
+  TextureType type;
+  int size;
+  const char* name;
+};
+static constexpr std::array<SkyboxMap, 4> SkyboxMaps{{{TextureType::CubeMap, RenderingSystem::CubeMapSize, "cubemap"}, {TextureType::Irradiance, RenderingSystem::IrradianceSize, "irradiance"}, {TextureType::Prefilter, RenderingSystem::PrefilterSize, "prefilter"}, {TextureType::Equirect, RenderingSystem::SkyboxPreviewSize, "preview"}}};
+bool RenderingSystem::LoadSkybox(uint64_t hash, Skybox& skybox) {
+  std::array<unsigned int, SkyboxMaps.size()> textures{};
+  for (size_t i = 0; i < SkyboxMaps.size(); ++i) {
+    if (SkyboxMaps[i].type == TextureType::Irradiance && skybox.hasIrradianceSH)
+      continue;
+    auto params = GetBakeParams(SkyboxMaps[i].type, SkyboxMaps[i].size);
+    textures[i] = texturePool.Request(params);
+    if (bakeCache.Load(std::format("{:016x}_{}", hash, SkyboxMaps[i].name), GetBakeKey(hash, params), textures[i], params))
+      continue;
+    // NOTE: the maps are used together, so a skybox with any of them missing is baked again
+    for (size_t j = 0; j <= i; ++j)
+      if (textures[j] != 0)
+        texturePool.Release(GetBakeParams(SkyboxMaps[j].type, SkyboxMaps[j].size), textures[j]);
+    return false;
+  }
+  skybox.original = textures[0];
+  skybox.irradiance = textures[1];
+  skybox.prefilter = textures[2];
+  skybox.preview = textures[3];
+  return true;
+}
+void RenderingSystem::StoreSkybox(uint64_t hash, const Skybox& skybox) {
+  const std::array<int, SkyboxMaps.size()> textures{skybox.original, skybox.irradiance, skybox.prefilter, skybox.preview};
+  for (size_t i = 0; i < SkyboxMaps.size(); ++i) {
+    if (textures[i] == 0)
+      continue;
+    auto params = GetBakeParams(SkyboxMaps[i].type, SkyboxMaps[i].size);
+    bakeCache.Store(std::format("{:016x}_{}", hash, SkyboxMaps[i].name), GetBakeKey(hash, params), textures[i], params);
+  }
+}
 } // namespace kuki
@@ -1,9 +1,24 @@
+#include <algorithm>
+#include <bounding_box.hpp>
 #include <camera.hpp>
+#include <cmath>
 #include <entity_manager.hpp>
+#include <frustum.hpp>
+#include <glm/ext/vector_float3.hpp>
 #include <id.hpp>
+#include <mesh_filter.hpp>
+#include <occlusion_culler.hpp>
+#include <octree.hpp>
+#include <ray.hpp>
 #include <scene.hpp>
 #include <string>
 #include <transform.hpp>
+#include <uniform_grid.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <variant>
+#include <vector>
 namespace kuki {
 Scene::Scene(const std::string& name, unsigned int id)
   : name(name), id(id) {}
@@ -22,22 +37,27 @@ ID Scene::CreateEntity(std::string& name) {
 }
 void Scene::DeleteEntity(ID id) {
   entityManager.Delete(id);
-  octree.Delete(id);
+  DeleteSpatial(id);
 }
 void Scene::DeleteEntity(const std::string& name) {
   auto id = entityManager.GetId(name);
   if (!id.IsValid())
     return;
   entityManager.Delete(id);
-  octree.Delete(id);
+  DeleteSpatial(id);
 }
 void Scene::DeleteAllEntities() {
   entityManager.DeleteAll();
-  octree.Clear();
+  std::visit([](auto& index) {
+    index.Clear();
+  }, spatialIndex);
+  outliers.clear();
+  visibilityCaches.clear();
+  occluders.clear();
 }
 void Scene::DeleteAllEntities(const std::string& prefix) {
+  // NOTE: deleted entities lose their components, UpdateSpatialIndex removes them from the spatial index
   entityManager.DeleteAll(prefix);
-  octree.Clear();
 }
 void Scene::SortTransforms() {
   entityManager.SortComponents<Transform>();
@@ -45,4 +65,246 @@ void Scene::SortTransforms() {
 void Scene::UpdateTransforms() {
   entityManager.UpdateComponents<Transform>();
 }
+void Scene::UpdateSpatialIndex() {
+  // NOTE: meshes replaced in place are only flagged, collect them along with the added and removed filters
+  entityManager.UpdateComponents<MeshFilter>();
+  std::unordered_set<ID> changed;
+  auto collect = [&changed](ID id) {
+    changed.insert(id);
+  };
+  entityManager.ForEachChanged<Transform>(collect);
+  entityManager.ForEachChanged<MeshFilter>(collect);
+  entityManager.ClearChanged<Transform>();
+  entityManager.ClearChanged<MeshFilter>();
+  // NOTE: when a large share of the entities changed (e.g., after loading or spawning), a bulk build is much cheaper than individual inserts
+  if (changed.size() >= MinRebuildCount && changed.size() * 2 >= GetSpatialCount()) {
+    RebuildSpatialIndex();
+    return;
+  }
+  for (const auto id : changed) {
+    MarkVisibilityDirty(id);
+    auto [transform, filter] = entityManager.GetComponents<Transform, MeshFilter>(id);
+    if (!transform || !filter) {
+      DeleteSpatial(id);
+      continue;
+    }
+    auto bounds = filter->mesh.bounds.GetWorldBounds(transform->world);
+    auto inserted = std::visit([id, &bounds](auto& index) {
+      return index.Insert(id, bounds);
+    }, spatialIndex);
+    if (inserted)
+      outliers.erase(id);
+    else
+      outliers[id] = bounds;
+  }
+}
+void Scene::DeleteSpatial(ID id) {
+  std::visit([id](auto& index) {
+    index.Delete(id);
+  }, spatialIndex);
+  outliers.erase(id);
+  occluders.erase(id);
+  MarkVisibilityDirty(id);
+}
+const BoundingBox* Scene::GetSpatialBounds(ID id) const {
+  auto bounds = std::visit([id](const auto& index) {
+    return index.GetBounds(id);
+  }, spatialIndex);
+  if (bounds)
+    return bounds;
+  auto it = outliers.find(id);
+  return it == outliers.end() ? nullptr : &it->second;
+}
+void Scene::MarkVisibilityDirty(ID id) {
+  for (auto& [_, cache] : visibilityCaches)
+    if (cache.valid)
+      cache.dirty.insert(id);
+}
+void Scene::InvalidateVisibility() {
+  for (auto& [_, cache] : visibilityCaches)
+    cache.valid = false;
+}
+bool Scene::IsVisibilityCached(const Camera& camera) const {
+  auto it = visibilityCaches.find(&camera);
+  return it != visibilityCaches.end() && it->second.valid && it->second.frustum == camera.frustum;
+}
+const std::vector<ID>& Scene::GetVisibleEntities(const Camera& camera) {
+  if (visibilityCaches.size() >= MaxVisibilityCaches && !visibilityCaches.contains(&camera))
+    visibilityCaches.clear();
+  auto& cache = visibilityCaches[&camera];
+  // NOTE: when most entities changed, culling from scratch is cheaper than testing them one by one
+  if (cache.valid && cache.frustum == camera.frustum && cache.dirty.size() * 4 <= GetSpatialCount()) {
+    if (cache.dirty.empty())
+      return cache.visible;
+    std::erase_if(cache.visible, [&cache](ID id) {
+      return cache.dirty.contains(id);
+    });
+    for (const auto id : cache.dirty) {
+      auto bounds = GetSpatialBounds(id);
+      if (bounds && camera.IntersectsFrustum(*bounds))
+        cache.visible.push_back(id);
+    }
+    cache.dirty.clear();
+    return cache.visible;
+  }
+  cache.visible.clear();
+  cache.dirty.clear();
+  std::visit([&](auto& index) {
+    index.CollectInFrustum(camera, cache.visible);
+  }, spatialIndex);
+  for (const auto& [id, bounds] : outliers)
+    if (camera.IntersectsFrustum(bounds))
+      cache.visible.push_back(id);
+  cache.frustum = camera.frustum;
+  cache.valid = true;
+  return cache.visible;
+}
+const std::vector<ID>& Scene::GetUnoccludedEntities(const Camera& camera) {
+  occlusionCuller.Begin(camera);
+  for (const auto id : occluders) {
+    auto bounds = GetSpatialBounds(id);
+    if (!bounds || !camera.IntersectsFrustum(*bounds))
+      continue;
+    auto [transform, filter] = entityManager.GetComponents<Transform, MeshFilter>(id);
+    if (transform && filter)
+      occlusionCuller.AddOccluder(filter->mesh.bounds, transform->world);
+  }
+  occlusionCuller.BuildHiZ();
+  unoccluded.clear();
+  OcclusionStats counts{};
+  std::visit([&](auto& index) {
+    index.CollectInFrustum(camera, unoccluded, &occlusionCuller, &counts);
+  }, spatialIndex);
+  for (const auto& [id, bounds] : outliers)
+    if (camera.IntersectsFrustum(bounds) && !occlusionCuller.IsOccluded(bounds, &counts))
+      unoccluded.push_back(id);
+  occlusionCuller.MergeStats(counts);
+  return unoccluded;
+}
+void Scene::SetOccluder(ID id, bool occluder) {
+  if (occluder)
+    occluders.insert(id);
+  else
+    occluders.erase(id);
+}
+bool Scene::IsOccluder(ID id) const {
+  return occluders.contains(id);
+}
+void Scene::SetOcclusionCulling(bool enabled) {
+  occlusionCulling = enabled;
+}
+bool Scene::GetOcclusionCulling() const {
+  return occlusionCulling;
+}
+const OcclusionStats& Scene::GetOcclusionStats() const {
+  return occlusionCuller.GetStats();
+}
+void Scene::RebuildSpatialIndex() {
+  std::vector<std::pair<ID, BoundingBox>> items;
+  items.reserve(entityManager.GetCount());
+  entityManager.ForEach<Transform, MeshFilter>([&items](ID id, Transform* transform, MeshFilter* filter) {
+    items.emplace_back(id, filter->mesh.bounds.GetWorldBounds(transform->world));
+  });
+  entityManager.UpdateComponents<MeshFilter>();
+  entityManager.ClearChanged<Transform>();
+  entityManager.ClearChanged<MeshFilter>();
+  auto count = std::visit([&items](auto& index) {
+    return index.Build(items, true);
+  }, spatialIndex);
+  InvalidateVisibility();
+  outliers.clear();
+  for (auto i = count; i < items.size(); ++i)
+    outliers.emplace(items[i].first, items[i].second);
+}
+void Scene::SetSpatialIndexType(SpatialIndexType type) {
+  if (type == GetSpatialIndexType())
+    return;
+  switch (type) {
+  case SpatialIndexType::Octree:
+    spatialIndex.emplace<Octree<ID>>();
+    break;
+  case SpatialIndexType::Quadtree:
+    spatialIndex.emplace<Quadtree<ID>>();
+    break;
+  case SpatialIndexType::UniformGrid:
+    spatialIndex.emplace<UniformGrid<ID>>();
+    break;
+  }
+  RebuildSpatialIndex();
+}
+SpatialIndexType Scene::GetSpatialIndexType() const {
+  return static_cast<SpatialIndexType>(spatialIndex.index());
+}
+size_t Scene::GetSpatialCount() const {
+  return std::visit([](const auto& index) {
+    return index.GetCount();
+  }, spatialIndex) + outliers.size();
+}
+bool Scene::Raycast(const Ray& ray, SpatialHit<ID>& hit, float maxDistance) const {
+  auto found = std::visit([&](const auto& index) {
+    return index.Raycast(ray, hit, maxDistance);
+  }, spatialIndex);
+  auto distance = 0.f;
+  for (const auto& [id, bounds] : outliers)
+    if (ray.Intersects(bounds, distance, found ? hit.distance : maxDistance) && (!found || distance < hit.distance)) {
+      hit = {id, distance};
+      found = true;
+    }
+  return found;
+}
+std::vector<SpatialHit<ID>> Scene::RaycastAll(const Ray& ray, float maxDistance) const {
+  std::vector<SpatialHit<ID>> hits;
+  auto distance = 0.f;
+  for (const auto& [id, bounds] : outliers)
+    if (ray.Intersects(bounds, distance, maxDistance))
+      hits.push_back({id, distance});
+  // NOTE: spatial index hits are sorted, merge them with the outliers
+  auto middle = hits.size();
+  std::sort(hits.begin(), hits.end(), [](const SpatialHit<ID>& a, const SpatialHit<ID>& b) {
+    return a.distance < b.distance;
+  });
+  std::visit([&](const auto& index) {
+    index.RaycastAll(ray, hits, maxDistance);
+  }, spatialIndex);
+  std::inplace_merge(hits.begin(), hits.begin() + middle, hits.end(), [](const SpatialHit<ID>& a, const SpatialHit<ID>& b) {
+    return a.distance < b.distance;
+  });
+  return hits;
+}
+std::vector<ID> Scene::OverlapAABB(const BoundingBox& box) const {
+  std::vector<ID> result;
+  std::visit([&](const auto& index) {
+    index.OverlapAABB(box, result);
+  }, spatialIndex);
+  for (const auto& [id, bounds] : outliers)
+    if (box.Intersects(bounds))
+      result.push_back(id);
+  return result;
+}
+std::vector<ID> Scene::OverlapSphere(const glm::vec3& center, float radius) const {
+  std::vector<ID> result;
+  std::visit([&](const auto& index) {
+    index.OverlapSphere(center, radius, result);
+  }, spatialIndex);
+  for (const auto& [id, bounds] : outliers)
+    if (bounds.GetDistanceSquared(center) <= radius * radius)
+      result.push_back(id);
+  return result;
+}
+std::vector<SpatialHit<ID>> Scene::KNearest(const glm::vec3& point, size_t k) const {
+  std::vector<SpatialHit<ID>> result;
+  std::visit([&](const auto& index) {
+    index.KNearest(point, k, result);
+  }, spatialIndex);
+  if (outliers.empty())
+    return result;
+  for (const auto& [id, bounds] : outliers)
+    result.push_back({id, std::sqrt(bounds.GetDistanceSquared(point))});
+  auto count = std::min(k, result.size());
+  std::partial_sort(result.begin(), result.begin() + count, result.end(), [](const SpatialHit<ID>& a, const SpatialHit<ID>& b) {
+    return a.distance < b.distance;
+  });
+  result.resize(count);
+  return result;
+}
 } // namespace kuki
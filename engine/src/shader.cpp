@@ -1,6 +1,8 @@
+#include <array>
 #include <bone_data.hpp>
 #include <buffer_params.hpp>
 #include <camera.hpp>
+#include <chrono>
 #include <component.hpp>
 #include <cstddef>
 #include <filesystem>
@@ -10,21 +12,106 @@
 #include <glm/ext/vector_float3.hpp>
 #include <glm/ext/vector_float4.hpp>
 #include <glm/gtc/type_ptr.hpp>
+#include <instance_buffer.hpp>
 #include <light.hpp>
 #include <material.hpp>
+#include <material_table.hpp>
 #include <mesh.hpp>
+#include <mesh_buffer.hpp>
+#include <numeric>
+#include <program_cache.hpp>
 #include <rendering_system.hpp>
 #include <shader.hpp>
 #include <span>
 #include <spdlog/spdlog.h>
 #include <sstream>
 #include <string>
+#include <transform_table.hpp>
+#include <utility>
+#include <vector>
 namespace kuki {
-IShader::IShader(const std::string& name, RenderingSystem& renderer)
-  : name(name), renderer(renderer) {}
+// NOTE: from KHR_parallel_shader_compile, which the loader does not define
+static constexpr GLenum CompletionStatus = 0x91B1;
+IShader::IShader(const std::string& name, RenderingSystem& renderer, std::vector<ShaderStage> stages)
+  : name(name), stages(std::move(stages)), renderer(renderer) {}
 IShader::~IShader() {
+  for (auto stageId : stageIds)
+    glDeleteShader(stageId);
   glDeleteProgram(id);
 }
+void IShader::Build() {
+  if (status != ShaderStatus::Idle)
+    return;
+  buildStart = std::chrono::high_resolution_clock::now();
+  for (const auto& [path, type] : stages)
+    sources.push_back(Read(path));
+  id = renderer.programCache.Load(name, sources);
+  if (id) {
+    status = ShaderStatus::Pending;
+    Finish();
+    return;
+  }
+  // NOTE: the compile status is not checked here, since querying it would wait for a driver that compiles in parallel
+  for (auto i = 0; i < stages.size(); ++i)
+    stageIds.push_back(Compile(sources[i].c_str(), stages[i].second));
+  id = glCreateProgram();
+  for (auto stageId : stageIds)
+    glAttachShader(id, stageId);
+  glProgramParameteri(id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(id);
+  status = ShaderStatus::Pending;
+}
+void IShader::Finish() {
+  int success;
+  glGetProgramiv(id, GL_LINK_STATUS, &success);
+  if (!success) {
+    for (auto stageId : stageIds) {
+      int compiled;
+      glGetShaderiv(stageId, GL_COMPILE_STATUS, &compiled);
+      if (!compiled)
+        spdlog::error("Failed to compile shader: {}.", name);
+    }
+    spdlog::error("Failed to link shader: {}.", name);
+    status = ShaderStatus::Failed;
+  } else {
+    auto cached = stageIds.empty();
+    if (!cached)
+      renderer.programCache.Store(name, id, sources);
+    // NOTE: the time includes what the caller did while the driver compiled in parallel, it is the wait a program adds on first use
+    auto time = std::chrono::duration<float, std::milli>(std::chrono::high_resolution_clock::now() - buildStart).count();
+    spdlog::info("Shader program is created: {} ({:.1f} ms, {}).", name, time, cached ? "loaded from cache" : "compiled");
+    renderer.programTime += time;
+    CacheLocations();
+    OnLink();
+    status = ShaderStatus::Ready;
+  }
+  for (auto stageId : stageIds)
+    glDeleteShader(stageId);
+  stageIds.clear();
+  sources.clear();
+}
+bool IShader::IsReady() {
+  Build();
+  if (status == ShaderStatus::Pending) {
+    // NOTE: without parallel compilation the link is already done, the query merely returns its result
+    int complete = GL_TRUE;
+    if (renderer.parallelCompile)
+      glGetProgramiv(id, CompletionStatus, &complete);
+    if (complete)
+      Finish();
+  }
+  return status == ShaderStatus::Ready;
+}
+bool IShader::Wait() {
+  Build();
+  if (status == ShaderStatus::Pending)
+    Finish();
+  return status == ShaderStatus::Ready;
+}
+ShaderStatus IShader::GetStatus() const {
+  return status;
+}
+void IShader::OnLink() {}
 unsigned int IShader::GetId() const {
   return id;
 }
@@ -50,10 +137,6 @@ unsigned int IShader::Compile(const char* text, int type) {
   auto id = glCreateShader(type);
   glShaderSource(id, 1, &text, nullptr);
   glCompileShader(id);
-  int success;
-  glGetShaderiv(id, GL_COMPILE_STATUS, &success);
-  if (!success)
-    spdlog::error("Failed to compile shader: {}.", name);
   return id;
 }
 void IShader::CacheLocations() {
@@ -66,19 +149,21 @@ void IShader::CacheLocations() {
   for (auto i = 0; i < params; ++i) {
     glGetActiveUniform(id, i, bufSize, &length, &size, &type, name);
     auto loc = glGetUniformLocation(id, name);
-    if (loc >= 0) {
+    if (loc >= 0)
       uniformToLocation[name] = loc;
-      cachedLocations.insert(loc);
-    }
   }
 }
 void IShader::Use() const {
-  glUseProgram(id);
+  renderer.stateCache.UseProgram(id);
 }
 void IShader::SetUniform(const std::string& name, const glm::mat4& value) {
   if (auto it = uniformToLocation.find(name); it != uniformToLocation.end())
     glUniformMatrix4fv(it->second, 1, GL_FALSE, glm::value_ptr(value));
 }
+void IShader::SetUniform(const std::string& name, const glm::vec2& value) {
+  if (auto it = uniformToLocation.find(name); it != uniformToLocation.end())
+    glUniform2fv(it->second, 1, glm::value_ptr(value));
+}
 void IShader::SetUniform(const std::string& name, const glm::vec3& value) {
   if (auto it = uniformToLocation.find(name); it != uniformToLocation.end())
     glUniform3fv(it->second, 1, glm::value_ptr(value));
@@ -99,76 +184,71 @@ void IShader::SetUniform(const std::string& name, unsigned int value) {
   if (auto it = uniformToLocation.find(name); it != uniformToLocation.end())
     glUniform1ui(it->second, value);
 }
+void IShader::SetUniform(const std::string& name, const glm::uvec3& value) {
+  if (auto it = uniformToLocation.find(name); it != uniformToLocation.end())
+    glUniform3uiv(it->second, 1, glm::value_ptr(value));
+}
 void IShader::SetUniform(int loc, const glm::mat4& value) {
-  if (cachedLocations.find(loc) == cachedLocations.end())
+  if (loc < 0)
     return;
   glUniformMatrix4fv(loc, 1, GL_FALSE, glm::value_ptr(value));
 }
+void IShader::SetUniform(int loc, const glm::vec2& value) {
+  if (loc < 0)
+    return;
+  glUniform2fv(loc, 1, glm::value_ptr(value));
+}
 void IShader::SetUniform(int loc, const glm::vec3& value) {
-  if (cachedLocations.find(loc) == cachedLocations.end())
+  if (loc < 0)
     return;
   glUniform3fv(loc, 1, glm::value_ptr(value));
 }
 void IShader::SetUniform(int loc, const glm::vec4& value) {
-  if (cachedLocations.find(loc) == cachedLocations.end())
+  if (loc < 0)
     return;
   glUniform4fv(loc, 1, glm::value_ptr(value));
 }
 void IShader::SetUniform(int loc, float value) {
-  if (cachedLocations.find(loc) == cachedLocations.end())
+  if (loc < 0)
     return;
   glUniform1f(loc, value);
 }
 void IShader::SetUniform(int loc, int value) {
-  if (cachedLocations.find(loc) == cachedLocations.end())
+  if (loc < 0)
     return;
   glUniform1i(loc, value);
 }
 void IShader::SetUniform(int loc, unsigned int value) {
-  if (cachedLocations.find(loc) == cachedLocations.end())
+  if (loc < 0)
     return;
   glUniform1ui(loc, value);
 }
-ComputeShader::ComputeShader(const std::string& name, const std::filesystem::path& comp, RenderingSystem& renderer, ComputeType type)
-  : IShader(name, renderer), type(type) {
-  auto compText = Read(comp);
-  auto compId = Compile(compText.c_str(), GL_COMPUTE_SHADER);
-  id = glCreateProgram();
-  glAttachShader(id, compId);
-  glLinkProgram(id);
-  glDeleteShader(compId);
-  int success;
-  glGetProgramiv(id, GL_LINK_STATUS, &success);
-  if (!success)
-    spdlog::error("Failed to link shader: {}.", name);
-  else {
-    spdlog::info("Shader program is created: {}.", name);
-    CacheLocations();
-  }
+void IShader::SetUniform(int loc, const glm::uvec3& value) {
+  if (loc < 0)
+    return;
+  glUniform3uiv(loc, 1, glm::value_ptr(value));
+}
+void IShader::SetUniform(int loc, std::span<const glm::vec3> values) {
+  if (loc < 0)
+    return;
+  glUniform3fv(loc, static_cast<GLsizei>(values.size()), glm::value_ptr(values.front()));
 }
+ComputeShader::ComputeShader(const std::string& name, const std::filesystem::path& comp, RenderingSystem& renderer, ComputeType type)
+  : IShader(name, renderer, {{comp, GL_COMPUTE_SHADER}}), type(type) {}
 ComputeType ComputeShader::GetType() const {
   return type;
 }
 Shader::Shader(const std::string& name, const std::filesystem::path& vert, const std::filesystem::path& frag, RenderingSystem& renderer, MaterialType type)
-  : IShader(name, renderer), type(type) {
-  auto vertText = Read(vert);
-  auto fragText = Read(frag);
-  auto vertId = Compile(vertText.c_str(), GL_VERTEX_SHADER);
-  auto fragId = Compile(fragText.c_str(), GL_FRAGMENT_SHADER);
-  id = glCreateProgram();
-  glAttachShader(id, vertId);
-  glAttachShader(id, fragId);
-  glLinkProgram(id);
-  glDeleteShader(vertId);
-  glDeleteShader(fragId);
-  int success;
-  glGetProgramiv(id, GL_LINK_STATUS, &success);
-  if (!success)
-    spdlog::error("Failed to link shader: {}.", name);
-  else {
-    spdlog::info("Shader program is created: {}.", name);
-    CacheLocations();
-  }
+  : IShader(name, renderer, {{vert, GL_VERTEX_SHADER}, {frag, GL_FRAGMENT_SHADER}}), type(type) {}
+void Shader::OnLink() {
+  SetSamplerUnits();
+}
+void Shader::SetSamplerUnits() {
+  // NOTE: each sampler has a fixed unit, so it is set once here and the materials only bind their textures
+  static const std::array<std::pair<const char*, int>, 12> samplerUnits{{{"material.albedo", 0}, {"material.normal", 1}, {"material.metalness", 2}, {"material.occlusion", 3}, {"material.roughness", 4}, {"material.specular", 5}, {"material.emissive", 6}, {"material.base", 0}, {"skybox", 0}, {"irradianceMap", LitShader::IrradianceUnit}, {"prefilterMap", LitShader::PrefilterUnit}, {"brdfLUT", LitShader::BRDFUnit}}};
+  for (const auto& [name, unit] : samplerUnits)
+    if (auto it = uniformToLocation.find(name); it != uniformToLocation.end())
+      glProgramUniform1i(id, it->second, unit);
 }
 MaterialType Shader::GetType() const {
   return type;
@@ -187,50 +267,101 @@ void Shader::SetCamera(const Camera* camera) {
 void Shader::SetMaterial(const Material* material) {
   material->Apply(this);
 }
-void Shader::SetTransform(const Mesh* mesh, const glm::mat4& transform, unsigned int buffer) {
+void Shader::BindTexture(unsigned int unit, unsigned int target, unsigned int texture) {
+  renderer.stateCache.BindTexture(unit, target, texture);
+}
+unsigned int Shader::GetTextureArray(unsigned int texture) {
+  return renderer.materialTable.GetArray(texture);
+}
+void Shader::SetMaterialIndex(const Mesh* mesh, unsigned int index, InstanceBuffer& buffer) {
+  std::span<const unsigned int> indices(&index, 1);
+  SetMaterialIndex(mesh, indices, buffer);
+}
+void Shader::SetMaterialIndex(const Mesh* mesh, std::span<const unsigned int> indices, InstanceBuffer& buffer) {
+  auto bindingIndex = 2;
+  auto attribIndex = 8;
+  auto offset = buffer.Write(indices);
+  renderer.stateCache.BindVertexBuffer(mesh->vao, bindingIndex, buffer.GetId(), offset, sizeof(unsigned int));
+  renderer.stateCache.SetIntegerAttribute(mesh->vao, attribIndex, bindingIndex, 1, GL_UNSIGNED_INT, 1);
+}
+void Shader::SetTransform(const Mesh* mesh, const glm::mat4& transform, InstanceBuffer& buffer) {
   std::span<const glm::mat4> transforms(&transform, 1);
   SetTransform(mesh, transforms, buffer);
 }
-void Shader::SetTransform(const Mesh* mesh, std::span<const glm::mat4> transforms, unsigned int buffer) {
-  auto bindingIndex = 1;
-  glNamedBufferData(buffer, transforms.size() * sizeof(glm::mat4), transforms.data(), GL_DYNAMIC_DRAW);
-  glVertexArrayVertexBuffer(mesh->vao, bindingIndex, buffer, 0, sizeof(glm::mat4));
-  glVertexArrayBindingDivisor(mesh->vao, bindingIndex, 1);
-  auto attribIndex = 4;
-  for (auto i = 0; i < 4; ++i) {
-    glVertexArrayAttribFormat(mesh->vao, attribIndex, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * i);
-    glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-    glEnableVertexArrayAttrib(mesh->vao, attribIndex);
-    attribIndex++;
+void Shader::SetTransform(const Mesh* mesh, std::span<const glm::mat4> transforms, InstanceBuffer& buffer) {
+  auto& rows = renderer.identityRows;
+  if (rows.size() < transforms.size()) {
+    auto first = static_cast<unsigned int>(rows.size());
+    rows.resize(transforms.size());
+    std::iota(rows.begin() + first, rows.end(), first);
   }
+  SetTransformIndex(mesh, std::span<const unsigned int>(rows.data(), transforms.size()), buffer);
+  auto offset = buffer.Write(transforms, renderer.GetStorageAlignment());
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, TransformTable::BindingPoint, buffer.GetId(), offset, transforms.size_bytes());
+}
+void Shader::SetTransformIndex(const Mesh* mesh, std::span<const unsigned int> indices, InstanceBuffer& buffer) {
+  auto bindingIndex = 1;
+  auto attribIndex = 9;
+  auto offset = buffer.Write(indices);
+  renderer.stateCache.BindVertexBuffer(mesh->vao, bindingIndex, buffer.GetId(), offset, sizeof(unsigned int));
+  renderer.stateCache.SetIntegerAttribute(mesh->vao, attribIndex, bindingIndex, 1, GL_UNSIGNED_INT, 1);
 }
 void Shader::SetBoneTransforms(const BoneData boneData) {
 }
 void Shader::Draw(const Mesh* mesh) {
   if (!mesh)
     return;
-  glBindVertexArray(mesh->vao);
+  renderer.stateCache.BindVertexArray(mesh->vao);
   if (mesh->indexCount > 0)
-    glDrawElements(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0);
+    glDrawElementsBaseVertex(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, reinterpret_cast<void*>(mesh->firstIndex * sizeof(unsigned int)), mesh->baseVertex);
   else
     glDrawArrays(GL_TRIANGLES, 0, mesh->vertexCount);
-  glBindVertexArray(0);
+  if (!renderer.stateCache.IsActive())
+    glBindVertexArray(0);
 }
-void Shader::DrawInstanced(const Mesh* mesh, unsigned int count) {
+void Shader::DrawInstanced(const Mesh* mesh, unsigned int count, unsigned int baseInstance) {
   if (!mesh || count == 0)
     return;
-  glBindVertexArray(mesh->vao);
+  renderer.stateCache.BindVertexArray(mesh->vao);
   if (mesh->indexCount > 0)
-    glDrawElementsInstanced(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, 0, count);
+    glDrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, mesh->indexCount, GL_UNSIGNED_INT, reinterpret_cast<void*>(mesh->firstIndex * sizeof(unsigned int)), count, mesh->baseVertex, baseInstance);
   else
-    glDrawArraysInstanced(GL_TRIANGLES, 0, mesh->vertexCount, count);
+    glDrawArraysInstancedBaseInstance(GL_TRIANGLES, 0, mesh->vertexCount, count, baseInstance);
+  if (!renderer.stateCache.IsActive())
+    glBindVertexArray(0);
+}
+void Shader::MultiDrawIndirect(unsigned int vao, std::span<const DrawElementsCommand> commands, InstanceBuffer& buffer) {
+  if (vao == 0 || commands.empty())
+    return;
+  auto offset = buffer.Write(commands);
+  renderer.stateCache.BindVertexArray(vao);
+  renderer.stateCache.BindBuffer(GL_DRAW_INDIRECT_BUFFER, buffer.GetId());
+  glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<void*>(offset), commands.size(), sizeof(DrawElementsCommand));
+  // NOTE: while the state cache is active the next draw likely binds the same ones, it unbinds them when it ends
+  if (renderer.stateCache.IsActive())
+    return;
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
   glBindVertexArray(0);
 }
 LitShader::LitShader(const std::string& name, const std::filesystem::path& vert, const std::filesystem::path& frag, RenderingSystem& renderer)
   : Shader(name, vert, frag, renderer, MaterialType::Lit) {}
+void LitShader::OnLink() {
+  Shader::OnLink();
+  viewPos = GetUniform<glm::vec3>("viewPos");
+  dirLight = {GetUniform<glm::vec3>("dirLight.direction"), GetUniform<glm::vec3>("dirLight.ambient"), GetUniform<glm::vec3>("dirLight.diffuse"), GetUniform<glm::vec3>("dirLight.specular")};
+  clusterCount = GetUniform<glm::uvec3>("clusterCount");
+  clusterDepth = GetUniform<glm::vec2>("clusterDepth");
+  hasDirLight = GetUniform<int>("hasDirLight");
+  hasSkybox = GetUniform<int>("hasSkybox");
+  hasIrradianceMap = GetUniform<int>("hasIrradianceMap");
+  hasIrradianceSH = GetUniform<int>("hasIrradianceSH");
+  irradianceSH = GetUniform<std::span<const glm::vec3>>("irradianceSH[0]");
+  hasPrefilterMap = GetUniform<int>("hasPrefilterMap");
+  hasBRDF = GetUniform<int>("hasBRDF");
+}
 void LitShader::SetCamera(const Camera* camera) {
   Shader::SetCamera(camera);
-  SetUniform("viewPos", camera->position);
+  SetUniform(viewPos, camera->position);
 }
 void LitShader::SetLighting(const Light* light) {
   std::span<const Light*> lights(&light, 1);
@@ -238,89 +369,52 @@ void LitShader::SetLighting(const Light* light) {
 }
 void LitShader::SetLighting(std::span<const Light*> lights) {
   auto dirExists = false;
-  unsigned int pointIndex = 0;
   for (const auto& light : lights)
     if (light->type == LightType::Directional) {
-      SetUniform("dirLight.direction", light->vector);
-      SetUniform("dirLight.ambient", light->ambient);
-      SetUniform("dirLight.diffuse", light->diffuse);
-      SetUniform("dirLight.specular", light->specular);
+      SetUniform(dirLight.direction, light->vector);
+      SetUniform(dirLight.ambient, light->ambient);
+      SetUniform(dirLight.diffuse, light->diffuse);
+      SetUniform(dirLight.specular, light->specular);
       dirExists = true;
-    } else if (light->type == LightType::Point) {
-      auto offset = pointIndex * 7;
-      SetUniform(uniformToLocation["pointLights[0].position"] + offset, light->vector);
-      SetUniform(uniformToLocation["pointLights[0].ambient"] + offset, light->ambient);
-      SetUniform(uniformToLocation["pointLights[0].diffuse"] + offset, light->diffuse);
-      SetUniform(uniformToLocation["pointLights[0].specular"] + offset, light->specular);
-      SetUniform(uniformToLocation["pointLights[0].constant"] + offset, light->constant);
-      SetUniform(uniformToLocation["pointLights[0].linear"] + offset, light->linear);
-      SetUniform(uniformToLocation["pointLights[0].quadratic"] + offset, light->quadratic);
-      pointIndex++;
     }
-  SetUniform("pointCount", pointIndex);
-  SetUniform("hasDirLight", dirExists);
-}
-void LitShader::SetMaterialFallback(const Mesh* mesh, const LitFallbackData& material, unsigned int buffer) {
-  std::span<const LitFallbackData> materials(&material, 1);
-  SetMaterialFallback(mesh, materials, buffer);
+  SetUniform(hasDirLight, static_cast<int>(dirExists));
 }
-void LitShader::SetMaterialFallback(const Mesh* mesh, std::span<const LitFallbackData> materials, unsigned int buffer) {
-  auto bindingIndex = 2;
-  auto attribIndex = 8;
-  glNamedBufferData(buffer, materials.size() * sizeof(LitFallbackData), materials.data(), GL_DYNAMIC_DRAW);
-  glVertexArrayVertexBuffer(mesh->vao, bindingIndex, buffer, 0, sizeof(LitFallbackData));
-  glVertexArrayBindingDivisor(mesh->vao, bindingIndex, 1);
-  glVertexArrayAttribFormat(mesh->vao, attribIndex, 4, GL_FLOAT, GL_FALSE, offsetof(LitFallbackData, albedo));
-  glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh->vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribFormat(mesh->vao, attribIndex, 4, GL_FLOAT, GL_FALSE, offsetof(LitFallbackData, specular));
-  glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh->vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribFormat(mesh->vao, attribIndex, 4, GL_FLOAT, GL_FALSE, offsetof(LitFallbackData, emissive));
-  glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh->vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribFormat(mesh->vao, attribIndex, 1, GL_FLOAT, GL_FALSE, offsetof(LitFallbackData, metalness));
-  glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh->vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribFormat(mesh->vao, attribIndex, 1, GL_FLOAT, GL_FALSE, offsetof(LitFallbackData, occlusion));
-  glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh->vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribFormat(mesh->vao, attribIndex, 1, GL_FLOAT, GL_FALSE, offsetof(LitFallbackData, roughness));
-  glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh->vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribIFormat(mesh->vao, attribIndex, 1, GL_INT, offsetof(LitFallbackData, textureMask));
-  glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh->vao, attribIndex);
+void LitShader::SetLightClusters(const LightClusters* clusters) {
+  if (!clusters || clusters->GetLights().empty()) {
+    SetUniform(clusterCount, glm::uvec3(0));
+    return;
+  }
+  SetUniform(clusterCount, clusters->GetSize());
+  SetUniform(clusterDepth, clusters->GetDepthScaleBias());
+}
+void LitShader::SetSkybox(const Skybox* skybox) {
+  if (!skybox) {
+    SetUniform(hasSkybox, 0);
+    SetUniform(hasIrradianceMap, 0);
+    SetUniform(hasIrradianceSH, 0);
+    SetUniform(hasPrefilterMap, 0);
+    SetUniform(hasBRDF, 0);
+    return;
+  }
+  if (skybox->irradiance > 0)
+    BindTexture(IrradianceUnit, GL_TEXTURE_CUBE_MAP, skybox->irradiance);
+  if (skybox->prefilter > 0)
+    BindTexture(PrefilterUnit, GL_TEXTURE_CUBE_MAP, skybox->prefilter);
+  if (skybox->brdf > 0)
+    BindTexture(BRDFUnit, GL_TEXTURE_2D, skybox->brdf);
+  SetUniform(hasSkybox, 1);
+  SetUniform(hasIrradianceMap, static_cast<int>(skybox->irradiance > 0));
+  SetUniform(hasIrradianceSH, static_cast<int>(skybox->hasIrradianceSH));
+  if (skybox->hasIrradianceSH)
+    SetUniform(irradianceSH, std::span<const glm::vec3>(skybox->irradianceSH.coefficients));
+  SetUniform(hasPrefilterMap, static_cast<int>(skybox->prefilter > 0));
+  SetUniform(hasBRDF, static_cast<int>(skybox->brdf > 0));
 }
 void LitShader::Draw(const Mesh* mesh) {
   DrawInstanced(mesh, 1);
 }
 UnlitShader::UnlitShader(const std::string& name, const std::filesystem::path& vert, const std::filesystem::path& frag, RenderingSystem& renderer)
   : Shader(name, vert, frag, renderer, MaterialType::Unlit) {}
-void UnlitShader::SetMaterialFallback(const Mesh* mesh, const UnlitFallbackData& material, unsigned int buffer) {
-  std::span<const UnlitFallbackData> materials(&material, 1);
-  SetMaterialFallback(mesh, materials, buffer);
-}
-void UnlitShader::SetMaterialFallback(const Mesh* mesh, std::span<const UnlitFallbackData> materials, unsigned int buffer) {
-  auto bindingIndex = 2;
-  auto attribIndex = 8;
-  glNamedBufferData(buffer, materials.size() * sizeof(UnlitFallbackData), materials.data(), GL_DYNAMIC_DRAW);
-  glVertexArrayVertexBuffer(mesh->vao, bindingIndex, buffer, 0, sizeof(UnlitFallbackData));
-  glVertexArrayBindingDivisor(mesh->vao, bindingIndex, 1);
-  glVertexArrayAttribFormat(mesh->vao, attribIndex, 4, GL_FLOAT, GL_FALSE, offsetof(UnlitFallbackData, base));
-  glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh->vao, attribIndex);
-  attribIndex++;
-  glVertexArrayAttribIFormat(mesh->vao, attribIndex, 1, GL_INT, offsetof(UnlitFallbackData, textureMask));
-  glVertexArrayAttribBinding(mesh->vao, attribIndex, bindingIndex);
-  glEnableVertexArrayAttrib(mesh->vao, attribIndex);
-}
 void UnlitShader::Draw(const Mesh* mesh) {
   DrawInstanced(mesh, 1);
 }
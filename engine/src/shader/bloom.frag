@@ -1,6 +1,7 @@
 #version 460 core
 in vec2 texCoord;
 out vec4 color;
+uniform float bloomStrength;
 uniform float exposure;
 uniform float gamma;
 uniform sampler2D bloomImage;
@@ -8,8 +9,9 @@ uniform sampler2D hdrImage;
 void main() {
         vec4 sceneColor = texture(hdrImage, texCoord);
         vec4 bloomColor = texture(bloomImage, texCoord);
-        sceneColor += bloomColor;
-        vec4 toneMapped = vec4(vec3(1.0) - exp(-sceneColor.rgb * exposure), sceneColor.a);
-        vec4 gammaCorrected = pow(toneMapped, vec4(1.0 / gamma));
-        color = gammaCorrected;
+        sceneColor.rgb += bloomColor.rgb * bloomStrength;
+        vec3 toneMapped = vec3(1.0) - exp(-sceneColor.rgb * exposure);
+        vec3 gammaCorrected = pow(toneMapped, vec3(1.0 / gamma));
+        // the output is opaque, so that blending does not scale the composite by its alpha
+        color = vec4(gammaCorrected, 1.0);
 }
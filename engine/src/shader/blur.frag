@@ -1,21 +1,12 @@
 #version 460 core
-const float weight[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);
 in vec2 texCoord;
 out vec4 color;
-uniform bool horizontal;
 uniform sampler2D image;
 void main() {
-        vec2 tex_offset = 1.0 / textureSize(image, 0);
-        vec3 result = texture(image, texCoord).rgb * weight[0];
-        if (horizontal)
-                for (int i = 1; i < 5; ++i) {
-                        result += texture(image, texCoord + vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
-                        result += texture(image, texCoord - vec2(tex_offset.x * i, 0.0)).rgb * weight[i];
-                }
-        else
-                for (int i = 1; i < 5; ++i) {
-                        result += texture(image, texCoord + vec2(0.0, tex_offset.y * i)).rgb * weight[i];
-                        result += texture(image, texCoord - vec2(0.0, tex_offset.y * i)).rgb * weight[i];
-                }
-        color = vec4(result, 1.0);
+        // 3x3 tent filter over the smaller level, added to the larger one by blending
+        vec2 texel = 1.0 / textureSize(image, 0);
+        vec3 result = texture(image, texCoord).rgb * 4.0;
+        result += (texture(image, texCoord + vec2(texel.x, 0.0)).rgb + texture(image, texCoord - vec2(texel.x, 0.0)).rgb + texture(image, texCoord + vec2(0.0, texel.y)).rgb + texture(image, texCoord - vec2(0.0, texel.y)).rgb) * 2.0;
+        result += texture(image, texCoord + texel).rgb + texture(image, texCoord - texel).rgb + texture(image, texCoord + vec2(texel.x, -texel.y)).rgb + texture(image, texCoord + vec2(-texel.x, texel.y)).rgb;
+        color = vec4(result / 16.0, 1.0);
 }
@@ -1,13 +1,41 @@
 #version 460 core
 in vec2 texCoord;
-layout(location = 0) out vec4 color;
-layout(location = 1) out vec4 brightColor;
+out vec4 color;
+uniform bool prefilter;
 uniform sampler2D image;
+const vec3 luma = vec3(0.2126, 0.7152, 0.0722);
+vec3 Sample(vec2 offset) {
+        vec3 sampleColor = texture(image, texCoord + offset).rgb;
+        // only the parts brighter than 1 bloom, this is done while downsampling the image into the first level
+        if (prefilter && dot(sampleColor, luma) <= 1.0)
+                return vec3(0.0);
+        return sampleColor;
+}
 void main() {
-        color = texture(image, texCoord);
-        float brightness = dot(color.rgb, vec3(0.2126, 0.7152, 0.0722));
-        if (brightness > 1.0)
-                brightColor = vec4(color.rgb, 1.0);
-        else
-                brightColor = vec4(0.0, 0.0, 0.0, 1.0);
+        // 13 bilinear taps around the center of the four source texels that make up this texel, averaged in five overlapping boxes
+        vec2 texel = 1.0 / textureSize(image, 0);
+        vec3 a = Sample(texel * vec2(-2.0, 2.0));
+        vec3 b = Sample(texel * vec2(0.0, 2.0));
+        vec3 c = Sample(texel * vec2(2.0, 2.0));
+        vec3 d = Sample(texel * vec2(-2.0, 0.0));
+        vec3 e = Sample(vec2(0.0));
+        vec3 f = Sample(texel * vec2(2.0, 0.0));
+        vec3 g = Sample(texel * vec2(-2.0, -2.0));
+        vec3 h = Sample(texel * vec2(0.0, -2.0));
+        vec3 i = Sample(texel * vec2(2.0, -2.0));
+        vec3 j = Sample(texel * vec2(-1.0, 1.0));
+        vec3 k = Sample(texel * vec2(1.0, 1.0));
+        vec3 l = Sample(texel * vec2(-1.0, -1.0));
+        vec3 m = Sample(texel * vec2(1.0, -1.0));
+        vec3 boxes[5] = vec3[]((j + k + l + m) * 0.25, (a + b + d + e) * 0.25, (b + c + e + f) * 0.25, (d + e + g + h) * 0.25, (e + f + h + i) * 0.25);
+        float weights[5] = float[](0.5, 0.125, 0.125, 0.125, 0.125);
+        vec3 result = vec3(0.0);
+        float weightSum = 0.0;
+        for (int n = 0; n < 5; ++n) {
+                // weighting the boxes by their inverse brightness on the first level keeps single very bright pixels from flickering
+                float weight = prefilter ? weights[n] / (1.0 + dot(boxes[n], luma)) : weights[n];
+                result += boxes[n] * weight;
+                weightSum += weight;
+        }
+        color = vec4(result / weightSum, 1.0);
 }
@@ -2,27 +2,31 @@
 const float EPSILON = 1.0e-6;
 const float MAX_REFLECTION_LOD = 4.0;
 const float PI = 3.14159265359;
-const uint MAX_POINT_LIGHTS = 8;
-flat in int textureMask;
-in float metalness;
-in float occlusion;
-in float roughness;
+flat in uint materialIndex;
 in vec2 texCoord;
 in vec3 normal;
 in vec3 position;
 in vec3 tangent;
-in vec4 albedo;
-in vec4 emissive;
-in vec4 specular;
 out vec4 color;
 struct Material {
-        sampler2D albedo;
-        sampler2D normal;
-        sampler2D metalness;
-        sampler2D occlusion;
-        sampler2D roughness;
-        sampler2D specular;
-        sampler2D emissive;
+        sampler2DArray albedo;
+        sampler2DArray normal;
+        sampler2DArray metalness;
+        sampler2DArray occlusion;
+        sampler2DArray roughness;
+        sampler2DArray specular;
+        sampler2DArray emissive;
+};
+/// @brief An entry of the material table, the layers are in the order of the texture mask bits
+struct MaterialEntry {
+        vec4 albedo;
+        vec4 specular;
+        vec4 emissive;
+        float metalness;
+        float occlusion;
+        float roughness;
+        int textureMask;
+        int layers[8];
 };
 struct DirLight {
         vec3 direction;
@@ -30,40 +34,66 @@ struct DirLight {
         vec3 diffuse;
         vec3 specular;
 };
+/// @brief A point light of the light buffer, its range is in position.w and its constant, linear and quadratic terms in attenuation
 struct PointLight {
-        vec3 position;
-        vec3 ambient;
-        vec3 diffuse;
-        vec3 specular;
-        float constant;
-        float linear;
-        float quadratic;
+        vec4 position;
+        vec4 diffuse;
+        vec4 specular;
+        vec4 attenuation;
+};
+layout(std140, binding = 0) uniform i_cameraTransform {
+        mat4 view;
+        mat4 projection;
+};
+layout(std430, binding = 1) readonly buffer i_materialTable {
+        MaterialEntry materials[];
+};
+layout(std430, binding = 3) readonly buffer i_lights {
+        PointLight pointLights[];
+};
+/// @brief Offset and count of each cluster's lights in the index list
+layout(std430, binding = 4) readonly buffer i_lightClusters {
+        uvec2 clusters[];
+};
+layout(std430, binding = 5) readonly buffer i_lightIndices {
+        uint lightIndices[];
 };
 uniform DirLight dirLight;
 uniform Material material;
-uniform PointLight pointLights[MAX_POINT_LIGHTS];
+/// @brief Number of tiles across, down and depth slices, 0 if there are no point lights
+uniform uvec3 clusterCount;
+/// @brief Scale and bias that map the logarithm of the view depth to a slice
+uniform vec2 clusterDepth;
 uniform bool hasBRDF;
 uniform bool hasDirLight;
 uniform bool hasIrradianceMap;
+uniform bool hasIrradianceSH;
 uniform bool hasPrefilterMap;
 uniform bool hasSkybox;
 uniform sampler2D brdfLUT;
 uniform samplerCube irradianceMap;
+/// @brief L2 spherical harmonics of the irradiance divided by pi, in the order of SphericalHarmonics::coefficients
+uniform vec3 irradianceSH[9];
 uniform samplerCube prefilterMap;
-uniform uint pointCount;
 uniform vec3 viewPos;
 float DistributionGGX(vec3, vec3, float);
 float GeometrySchlickGGX(float, float);
 float GeometrySmith(vec3, vec3, vec3, float);
 vec2 FallbackBRDF(float, float);
 vec3 DirLightContribution(DirLight, vec3, vec3, vec3, float, float, vec3);
+/// @brief Evaluate the irradiance spherical harmonics for a normal, it must match SphericalHarmonics::Evaluate
+vec3 EvaluateIrradianceSH(vec3);
 /// @brief A gradient sky to use as fallback in the absence of a cubemap
 vec3 FallbackSky(vec3);
 vec3 FresnelSchlick(float, vec3);
 vec3 FresnelSchlickRoughness(float, vec3, float);
-vec3 GetNormalFromTexture();
+vec3 GetNormalFromTexture(int);
+/// @brief Get the light cluster that contains a world position, it must match LightClusters::GetClusterIndex
+uint GetCluster(vec3);
 vec3 PointLightContribution(PointLight, vec3, vec3, vec3, float, float, vec3, vec3);
 void main() {
+        MaterialEntry entry = materials[materialIndex];
+        int textureMask = entry.textureMask;
         bool useAlbedoTexture = (textureMask & 0x1) != 0;
         bool useNormalTexture = (textureMask & 0x2) != 0;
         bool useMetalnessTexture = (textureMask & 0x4) != 0;
@@ -71,13 +101,13 @@ void main() {
         bool useRoughnessTexture = (textureMask & 0x10) != 0;
         bool useSpecularTexture = (textureMask & 0x20) != 0;
         bool useEmissiveTexture = (textureMask & 0x40) != 0;
-        vec3 N = (useNormalTexture) ? GetNormalFromTexture() : normal;
-        vec4 A = (useAlbedoTexture) ? texture(material.albedo, texCoord) : albedo;
-        vec4 S = (useSpecularTexture) ? texture(material.specular, texCoord) : specular;
-        vec4 E = (useEmissiveTexture) ? texture(material.emissive, texCoord) : emissive;
-        float O = (useOcclusionTexture) ? texture(material.occlusion, texCoord).r : occlusion;
-        float R = (useRoughnessTexture) ? texture(material.roughness, texCoord).g : roughness;
-        float M = (useMetalnessTexture) ? texture(material.metalness, texCoord).b : metalness;
+        vec3 N = (useNormalTexture) ? GetNormalFromTexture(entry.layers[1]) : normal;
+        vec4 A = (useAlbedoTexture) ? texture(material.albedo, vec3(texCoord, entry.layers[0])) : entry.albedo;
+        vec4 S = (useSpecularTexture) ? texture(material.specular, vec3(texCoord, entry.layers[5])) : entry.specular;
+        vec4 E = (useEmissiveTexture) ? texture(material.emissive, vec3(texCoord, entry.layers[6])) : entry.emissive;
+        float O = (useOcclusionTexture) ? texture(material.occlusion, vec3(texCoord, entry.layers[3])).r : entry.occlusion;
+        float R = (useRoughnessTexture) ? texture(material.roughness, vec3(texCoord, entry.layers[4])).g : entry.roughness;
+        float M = (useMetalnessTexture) ? texture(material.metalness, vec3(texCoord, entry.layers[2])).b : entry.metalness;
         vec3 V = normalize(viewPos - position);
         vec3 reflectDir = reflect(-V, N);
         vec3 F0 = vec3(0.04);
@@ -89,7 +119,7 @@ void main() {
                 vec3 kS = F;
                 vec3 kD = 1.0 - kS;
                 kD *= 1.0 - vec3(M);
-                vec3 irradiance = hasIrradianceMap ? texture(irradianceMap, N).rgb : FallbackSky(N);
+                vec3 irradiance = hasIrradianceSH ? EvaluateIrradianceSH(N) : hasIrradianceMap ? texture(irradianceMap, N).rgb : FallbackSky(N);
                 vec3 diffuse = irradiance * A.rgb;
                 vec3 prefilteredColor = hasPrefilterMap ? textureLod(prefilterMap, reflectDir, R * MAX_REFLECTION_LOD).rgb : FallbackSky(reflectDir);
                 vec2 brdf = hasBRDF ? texture(brdfLUT, vec2(max(dot(N, V), 0.0), R)).rg : FallbackBRDF(max(dot(N, V), 0.0), R);
@@ -100,8 +130,11 @@ void main() {
                 ambient = dirLight.ambient * A.rgb * O;
         } else
                 ambient = vec3(0.03) * A.rgb * O;
-        for (int i = 0; i < min(pointCount, MAX_POINT_LIGHTS); ++i)
-                Lo += PointLightContribution(pointLights[i], F0, A.rgb, N, M, R, V, position);
+        if (clusterCount.x > 0) {
+                uvec2 cluster = clusters[GetCluster(position)];
+                for (uint i = 0; i < cluster.y; ++i)
+                        Lo += PointLightContribution(pointLights[lightIndices[cluster.x + i]], F0, A.rgb, N, M, R, V, position);
+        }
         color = vec4(ambient + Lo, A.a);
 }
 vec3 DirLightContribution(DirLight light, vec3 F0, vec3 A, vec3 N, float M, float R, vec3 V) {
@@ -130,6 +163,19 @@ float DistributionGGX(vec3 N, vec3 H, float R) {
         denom = PI * denom * denom;
         return nom / denom;
 }
+vec3 EvaluateIrradianceSH(vec3 n) {
+        vec3 irradiance = irradianceSH[0] * 0.282095;
+        irradiance += irradianceSH[1] * (0.488603 * n.y);
+        irradiance += irradianceSH[2] * (0.488603 * n.z);
+        irradiance += irradianceSH[3] * (0.488603 * n.x);
+        irradiance += irradianceSH[4] * (1.092548 * n.x * n.y);
+        irradiance += irradianceSH[5] * (1.092548 * n.y * n.z);
+        irradiance += irradianceSH[6] * (0.315392 * (3.0 * n.z * n.z - 1.0));
+        irradiance += irradianceSH[7] * (1.092548 * n.x * n.z);
+        irradiance += irradianceSH[8] * (0.546274 * (n.x * n.x - n.y * n.y));
+        // NOTE: the truncated series can ring below zero opposite very bright spots
+        return max(irradiance, vec3(0.0));
+}
 vec2 FallbackBRDF(float NdotV, float roughness) {
         return vec2(NdotV, 1.0 - roughness);
 }
@@ -160,8 +206,16 @@ float GeometrySmith(vec3 N, vec3 V, vec3 L, float R) {
         float ggx1 = GeometrySchlickGGX(NdotL, R);
         return ggx1 * ggx2;
 }
-vec3 GetNormalFromTexture() {
-        vec3 tangentNormal = texture(material.normal, texCoord).xyz * 2.0 - 1.0;
+uint GetCluster(vec3 position) {
+        vec4 viewPosition = view * vec4(position, 1.0);
+        vec4 clip = projection * viewPosition;
+        vec2 tiles = vec2(clusterCount.xy);
+        uvec2 tile = uvec2(clamp((clip.xy / clip.w * 0.5 + 0.5) * tiles, vec2(0.0), tiles - 1.0));
+        uint slice = uint(clamp(log(max(-viewPosition.z, EPSILON)) * clusterDepth.x + clusterDepth.y, 0.0, float(clusterCount.z - 1)));
+        return (slice * clusterCount.y + tile.y) * clusterCount.x + tile.x;
+}
+vec3 GetNormalFromTexture(int layer) {
+        vec3 tangentNormal = texture(material.normal, vec3(texCoord, layer)).xyz * 2.0 - 1.0;
         vec3 N = normalize(normal);
         vec3 T = normalize(tangent);
         vec3 B = normalize(cross(N, T));
@@ -169,7 +223,7 @@ vec3 GetNormalFromTexture() {
         return normalize(TBN * tangentNormal);
 }
 vec3 PointLightContribution(PointLight light, vec3 F0, vec3 A, vec3 N, float M, float R, vec3 V, vec3 position) {
-        vec3 L = normalize(light.position - position);
+        vec3 L = normalize(light.position.xyz - position);
         vec3 H = normalize(V + L);
         float NdotL = max(dot(N, L), 0.0);
         float NDF = DistributionGGX(N, H, R);
@@ -180,9 +234,9 @@ vec3 PointLightContribution(PointLight light, vec3 F0, vec3 A, vec3 N, float M,
         vec3 kS = F;
         vec3 kD = vec3(1.0) - kS;
         kD *= 1.0 - vec3(M);
-        float distance = length(light.position - position);
-        float attenuation = 1.0 / (light.constant + light.linear * distance + light.quadratic * distance * distance);
-        vec3 diffuse = (A / PI) * light.diffuse * attenuation;
+        float distance = length(light.position.xyz - position);
+        float attenuation = 1.0 / (light.attenuation.x + light.attenuation.y * distance + light.attenuation.z * distance * distance);
+        vec3 diffuse = (A / PI) * light.diffuse.rgb * attenuation;
         vec3 specular = numerator / denominator;
-        return (kD * diffuse + specular * light.specular) * NdotL;
+        return (kD * diffuse + specular * light.specular.rgb) * NdotL;
 }
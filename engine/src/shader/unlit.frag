@@ -1,13 +1,26 @@
 #version 460 core
-flat in int textureMask;
+flat in uint materialIndex;
 in vec2 texCoord;
-in vec4 baseColor;
 out vec4 color;
 struct Material {
-        sampler2D base;
+        sampler2DArray base;
+};
+struct MaterialEntry {
+        vec4 albedo;
+        vec4 specular;
+        vec4 emissive;
+        float metalness;
+        float occlusion;
+        float roughness;
+        int textureMask;
+        int layers[8];
+};
+layout(std430, binding = 1) readonly buffer i_materialTable {
+        MaterialEntry materials[];
 };
 uniform Material material;
 void main() {
-        bool useBaseTexture = (textureMask & 0x1) != 0;
-        color = useBaseTexture ? vec4(texture(material.base, texCoord).rgb, 1.0) : baseColor;
+        MaterialEntry entry = materials[materialIndex];
+        bool useBaseTexture = (entry.textureMask & 0x1) != 0;
+        color = useBaseTexture ? vec4(texture(material.base, vec3(texCoord, entry.layers[0])).rgb, 1.0) : entry.albedo;
 }
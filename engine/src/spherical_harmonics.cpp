@@ -0,0 +1,196 @@
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <glm/ext/vector_float3.hpp>
+#include <numbers>
+#include <parallel.hpp>
+#include <spherical_harmonics.hpp>
+#include <vector>
+#if defined(__AVX__) || defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <immintrin.h>
+#define KUKI_SH_SIMD
+#endif
+namespace kuki {
+/// @brief Sums of each basis function times each channel over a range of pixels, channel by channel
+using SHSums = std::array<double, SphericalHarmonics::CoefficientCount * 3>;
+/// @brief Cosine lobe factor of each coefficient's band divided by pi
+static constexpr float BandFactors[SphericalHarmonics::CoefficientCount]{1.f, 2.f / 3.f, 2.f / 3.f, 2.f / 3.f, .25f, .25f, .25f, .25f, .25f};
+/// @brief Constants of the basis functions, see EvaluateBasis
+static constexpr float C0 = .282095f;
+static constexpr float C1 = .488603f;
+static constexpr float C2 = 1.092548f;
+static constexpr float C3 = .315392f;
+static constexpr float C4 = .546274f;
+static void EvaluateBasis(float x, float y, float z, float* basis) {
+  basis[0] = C0;
+  basis[1] = C1 * y;
+  basis[2] = C1 * z;
+  basis[3] = C1 * x;
+  basis[4] = C2 * x * y;
+  basis[5] = C2 * y * z;
+  basis[6] = C3 * (3.f * z * z - 1.f);
+  basis[7] = C2 * x * z;
+  basis[8] = C4 * (x * x - y * y);
+}
+/// @brief Direction of an image row, its sine is the y of its directions and its cosine scales their x and z
+static void GetRowDirection(int row, int height, bool flip, float& y, float& cosLatitude) {
+  auto v = (row + .5f) / height;
+  auto latitude = (flip ? .5f - v : v - .5f) * std::numbers::pi_v<float>;
+  y = std::sin(latitude);
+  cosLatitude = std::cos(latitude);
+}
+/// @brief Accumulate the pixels [begin, end) of a row whose directions are (cosLatitude * cosLongitude, y, cosLatitude * sinLongitude)
+static void AccumulateScalar(const float* red, const float* green, const float* blue, const float* cosLongitude, const float* sinLongitude, float y, float cosLatitude, size_t begin, size_t end, float* sums) {
+  float basis[SphericalHarmonics::CoefficientCount];
+  for (auto i = begin; i < end; ++i) {
+    EvaluateBasis(cosLatitude * cosLongitude[i], y, cosLatitude * sinLongitude[i], basis);
+    for (size_t k = 0; k < SphericalHarmonics::CoefficientCount; ++k) {
+      sums[k] += basis[k] * red[i];
+      sums[SphericalHarmonics::CoefficientCount + k] += basis[k] * green[i];
+      sums[2 * SphericalHarmonics::CoefficientCount + k] += basis[k] * blue[i];
+    }
+  }
+}
+/// @brief Project the rows [begin, end) of an image, each row is weighted by the solid angle of its pixels
+template <bool Simd>
+static void ProjectRows(const float* pixels, int width, int height, int channels, bool flip, const std::vector<float>& cosLongitude, const std::vector<float>& sinLongitude, int begin, int end, SHSums& result) {
+  constexpr auto count = SphericalHarmonics::CoefficientCount;
+  // NOTE: the channels are split into rows of their own, so that the SIMD loop loads a channel of consecutive pixels at once
+  std::vector<float> red(width), green(width), blue(width);
+  auto pixelAngle = 2.f * std::numbers::pi_v<float> / width * std::numbers::pi_v<float> / height;
+  for (auto row = begin; row < end; ++row) {
+    const auto* rowPixels = pixels + static_cast<size_t>(row) * width * channels;
+    for (auto i = 0; i < width; ++i) {
+      red[i] = rowPixels[i * channels];
+      green[i] = rowPixels[i * channels + 1];
+      blue[i] = rowPixels[i * channels + 2];
+    }
+    float y, cosLatitude;
+    GetRowDirection(row, height, flip, y, cosLatitude);
+    float sums[count * 3]{};
+    size_t i = 0;
+#if defined(__AVX__)
+    if constexpr (Simd) {
+      __m256 sums8[count * 3];
+      for (auto& sum : sums8)
+        sum = _mm256_setzero_ps();
+      const auto y8 = _mm256_set1_ps(y);
+      const auto cosLatitude8 = _mm256_set1_ps(cosLatitude);
+      for (; i + 8 <= static_cast<size_t>(width); i += 8) {
+        auto x = _mm256_mul_ps(cosLatitude8, _mm256_loadu_ps(&cosLongitude[i]));
+        auto z = _mm256_mul_ps(cosLatitude8, _mm256_loadu_ps(&sinLongitude[i]));
+        __m256 basis[count];
+        basis[0] = _mm256_set1_ps(C0);
+        basis[1] = _mm256_mul_ps(_mm256_set1_ps(C1), y8);
+        basis[2] = _mm256_mul_ps(_mm256_set1_ps(C1), z);
+        basis[3] = _mm256_mul_ps(_mm256_set1_ps(C1), x);
+        basis[4] = _mm256_mul_ps(_mm256_set1_ps(C2), _mm256_mul_ps(x, y8));
+        basis[5] = _mm256_mul_ps(_mm256_set1_ps(C2), _mm256_mul_ps(y8, z));
+        basis[6] = _mm256_mul_ps(_mm256_set1_ps(C3), _mm256_sub_ps(_mm256_mul_ps(_mm256_set1_ps(3.f), _mm256_mul_ps(z, z)), _mm256_set1_ps(1.f)));
+        basis[7] = _mm256_mul_ps(_mm256_set1_ps(C2), _mm256_mul_ps(x, z));
+        basis[8] = _mm256_mul_ps(_mm256_set1_ps(C4), _mm256_sub_ps(_mm256_mul_ps(x, x), _mm256_mul_ps(y8, y8)));
+        const __m256 color[3]{_mm256_loadu_ps(&red[i]), _mm256_loadu_ps(&green[i]), _mm256_loadu_ps(&blue[i])};
+        for (auto c = 0; c < 3; ++c)
+          for (size_t k = 0; k < count; ++k)
+            sums8[c * count + k] = _mm256_add_ps(sums8[c * count + k], _mm256_mul_ps(basis[k], color[c]));
+      }
+      for (size_t k = 0; k < count * 3; ++k) {
+        alignas(32) float lanes[8];
+        _mm256_store_ps(lanes, sums8[k]);
+        for (auto lane : lanes)
+          sums[k] += lane;
+      }
+    }
+#endif
+#if defined(KUKI_SH_SIMD)
+    if constexpr (Simd) {
+      __m128 sums4[count * 3];
+      for (auto& sum : sums4)
+        sum = _mm_setzero_ps();
+      const auto y4 = _mm_set1_ps(y);
+      const auto cosLatitude4 = _mm_set1_ps(cosLatitude);
+      for (; i + 4 <= static_cast<size_t>(width); i += 4) {
+        auto x = _mm_mul_ps(cosLatitude4, _mm_loadu_ps(&cosLongitude[i]));
+        auto z = _mm_mul_ps(cosLatitude4, _mm_loadu_ps(&sinLongitude[i]));
+        __m128 basis[count];
+        basis[0] = _mm_set1_ps(C0);
+        basis[1] = _mm_mul_ps(_mm_set1_ps(C1), y4);
+        basis[2] = _mm_mul_ps(_mm_set1_ps(C1), z);
+        basis[3] = _mm_mul_ps(_mm_set1_ps(C1), x);
+        basis[4] = _mm_mul_ps(_mm_set1_ps(C2), _mm_mul_ps(x, y4));
+        basis[5] = _mm_mul_ps(_mm_set1_ps(C2), _mm_mul_ps(y4, z));
+        basis[6] = _mm_mul_ps(_mm_set1_ps(C3), _mm_sub_ps(_mm_mul_ps(_mm_set1_ps(3.f), _mm_mul_ps(z, z)), _mm_set1_ps(1.f)));
+        basis[7] = _mm_mul_ps(_mm_set1_ps(C2), _mm_mul_ps(x, z));
+        basis[8] = _mm_mul_ps(_mm_set1_ps(C4), _mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(y4, y4)));
+        const __m128 color[3]{_mm_loadu_ps(&red[i]), _mm_loadu_ps(&green[i]), _mm_loadu_ps(&blue[i])};
+        for (auto c = 0; c < 3; ++c)
+          for (size_t k = 0; k < count; ++k)
+            sums4[c * count + k] = _mm_add_ps(sums4[c * count + k], _mm_mul_ps(basis[k], color[c]));
+      }
+      for (size_t k = 0; k < count * 3; ++k) {
+        alignas(16) float lanes[4];
+        _mm_store_ps(lanes, sums4[k]);
+        for (auto lane : lanes)
+          sums[k] += lane;
+      }
+    }
+#endif
+    AccumulateScalar(red.data(), green.data(), blue.data(), cosLongitude.data(), sinLongitude.data(), y, cosLatitude, i, width, sums);
+    // NOTE: the pixels of a row share their solid angle, so it is applied once per row, in double precision since tall images sum many rows
+    auto weight = static_cast<double>(pixelAngle * cosLatitude);
+    for (size_t k = 0; k < count * 3; ++k)
+      result[k] += sums[k] * weight;
+  }
+}
+/// @brief Get the cosine and sine of the longitude of each column
+static void GetColumnDirections(int width, std::vector<float>& cosLongitude, std::vector<float>& sinLongitude) {
+  cosLongitude.resize(width);
+  sinLongitude.resize(width);
+  for (auto i = 0; i < width; ++i) {
+    auto longitude = ((i + .5f) / width - .5f) * 2.f * std::numbers::pi_v<float>;
+    cosLongitude[i] = std::cos(longitude);
+    sinLongitude[i] = std::sin(longitude);
+  }
+}
+static SphericalHarmonics GetCoefficients(const SHSums& sums) {
+  SphericalHarmonics sh;
+  for (size_t k = 0; k < SphericalHarmonics::CoefficientCount; ++k)
+    for (auto c = 0; c < 3; ++c)
+      sh.coefficients[k][c] = static_cast<float>(sums[c * SphericalHarmonics::CoefficientCount + k]) * BandFactors[k];
+  return sh;
+}
+glm::vec3 SphericalHarmonics::Evaluate(const glm::vec3& normal) const {
+  float basis[CoefficientCount];
+  EvaluateBasis(normal.x, normal.y, normal.z, basis);
+  glm::vec3 result(0.f);
+  for (size_t k = 0; k < CoefficientCount; ++k)
+    result += coefficients[k] * basis[k];
+  return result;
+}
+SphericalHarmonics SphericalHarmonics::Project(const float* pixels, int width, int height, int channels, bool flip) {
+  if (!pixels || width <= 0 || height <= 0 || channels < 3)
+    return {};
+  std::vector<float> cosLongitude, sinLongitude;
+  GetColumnDirections(width, cosLongitude, sinLongitude);
+  // NOTE: each chunk of rows sums into its own slot and the slots are added in order, so the result does not depend on the timing of the threads
+  std::vector<SHSums> chunkSums(GetParallelThreadCount(), SHSums{});
+  constexpr size_t minChunk = 16;
+  auto chunkCount = ParallelChunks(height, [&](size_t chunk, size_t begin, size_t end) {
+    ProjectRows<true>(pixels, width, height, channels, flip, cosLongitude, sinLongitude, static_cast<int>(begin), static_cast<int>(end), chunkSums[chunk]);
+  }, minChunk);
+  SHSums sums{};
+  for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+    for (size_t k = 0; k < sums.size(); ++k)
+      sums[k] += chunkSums[chunk][k];
+  return GetCoefficients(sums);
+}
+SphericalHarmonics SphericalHarmonics::ProjectScalar(const float* pixels, int width, int height, int channels, bool flip) {
+  if (!pixels || width <= 0 || height <= 0 || channels < 3)
+    return {};
+  std::vector<float> cosLongitude, sinLongitude;
+  GetColumnDirections(width, cosLongitude, sinLongitude);
+  SHSums sums{};
+  ProjectRows<false>(pixels, width, height, channels, flip, cosLongitude, sinLongitude, 0, height, sums);
+  return GetCoefficients(sums);
+}
+} // namespace kuki
@@ -0,0 +1,133 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <glad/glad.h>
+#include <spdlog/spdlog.h>
+#include <string>
+#include <system_error>
+#include <texture_cache.hpp>
+#include <texture_params.hpp>
+#include <utility>
+#include <vector>
+namespace kuki {
+/// @brief Header of a cache file, followed by the levels from the largest, each with all its faces
+struct TextureHeader {
+  uint32_t magic;
+  uint32_t format;
+  uint32_t type;
+  int32_t width;
+  int32_t height;
+  int32_t target;
+  int32_t internalFormat;
+  int32_t levels;
+  uint64_t key;
+};
+/// @brief Get the format and type the texels of a texture are stored as, both four bytes per texel
+static std::pair<GLenum, GLenum> GetPacking(const TextureParams& params) {
+  if (params.format == GL_RG16F || params.format == GL_RG32F)
+    return {GL_RG, GL_HALF_FLOAT};
+  return {GL_RGB, GL_UNSIGNED_INT_10F_11F_11F_REV};
+}
+static size_t GetLevelSize(const TextureParams& params, int level) {
+  auto faces = params.target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+  return static_cast<size_t>(std::max(params.width >> level, 1)) * std::max(params.height >> level, 1) * faces * 4;
+}
+TextureCache::TextureCache(const std::filesystem::path& directory)
+  : directory(directory) {}
+std::filesystem::path TextureCache::GetPath(const std::string& name) const {
+  return directory / (name + ".tex");
+}
+bool TextureCache::Load(const std::string& name, uint64_t key, unsigned int texture, const TextureParams& params) {
+  auto [format, type] = GetPacking(params);
+  std::ifstream fs(GetPath(name), std::ios::binary);
+  TextureHeader header{};
+  if (!fs || !fs.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+    ++stats.misses;
+    return false;
+  }
+  if (header.magic != Magic || header.key != key || header.format != format || header.type != type || header.width != params.width || header.height != params.height || header.target != params.target || header.internalFormat != params.format || header.levels != params.mipmaps) {
+    ++stats.misses;
+    return false;
+  }
+  // NOTE: all levels are read before any is uploaded, so that a truncated file leaves the texture untouched
+  std::vector<char> data;
+  for (auto level = 0; level < params.mipmaps; ++level)
+    data.resize(data.size() + GetLevelSize(params, level));
+  if (!fs.read(data.data(), data.size())) {
+    spdlog::warn("Cached texture is truncated: '{}'.", GetPath(name).string());
+    ++stats.misses;
+    return false;
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  size_t offset = 0;
+  for (auto level = 0; level < params.mipmaps; ++level) {
+    auto width = std::max(params.width >> level, 1);
+    auto height = std::max(params.height >> level, 1);
+    if (params.target == GL_TEXTURE_CUBE_MAP)
+      glTextureSubImage3D(texture, level, 0, 0, 0, width, height, 6, format, type, data.data() + offset);
+    else
+      glTextureSubImage2D(texture, level, 0, 0, width, height, format, type, data.data() + offset);
+    offset += GetLevelSize(params, level);
+  }
+  ++stats.hits;
+  stats.bytes += sizeof(header) + data.size();
+  return true;
+}
+bool TextureCache::Store(const std::string& name, uint64_t key, unsigned int texture, const TextureParams& params) {
+  auto [format, type] = GetPacking(params);
+  std::vector<char> data;
+  // NOTE: generated textures are usually written by image stores, which the read must see
+  glMemoryBarrier(GL_TEXTURE_UPDATE_BARRIER_BIT);
+  glPixelStorei(GL_PACK_ALIGNMENT, 4);
+  for (auto level = 0; level < params.mipmaps; ++level) {
+    auto offset = data.size();
+    auto size = GetLevelSize(params, level);
+    data.resize(offset + size);
+    glGetTextureImage(texture, level, format, type, static_cast<GLsizei>(size), data.data() + offset);
+  }
+  std::error_code error;
+  std::filesystem::create_directories(directory, error);
+  std::ofstream fs(GetPath(name), std::ios::binary | std::ios::trunc);
+  TextureHeader header{Magic, format, type, params.width, params.height, params.target, params.format, params.mipmaps, key};
+  if (!fs || !fs.write(reinterpret_cast<const char*>(&header), sizeof(header)) || !fs.write(data.data(), data.size())) {
+    spdlog::warn("Failed to write cached texture: '{}'.", GetPath(name).string());
+    return false;
+  }
+  ++stats.stored;
+  stats.bytes += sizeof(header) + data.size();
+  return true;
+}
+const TextureCacheStats& TextureCache::GetStats() const {
+  return stats;
+}
+uint64_t TextureCache::Hash(const void* data, size_t size, uint64_t seed) {
+  constexpr uint64_t multiplier = 0xc6a4a7935bd1e995ull;
+  auto bytes = static_cast<const unsigned char*>(data);
+  auto hash = seed ^ (size * multiplier);
+  size_t i = 0;
+  // NOTE: a multiply only carries bits upward, so each word is folded onto itself before it is combined, otherwise its high bits would never reach the low ones
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, bytes + i, sizeof(word));
+    word *= multiplier;
+    word ^= word >> 47;
+    word *= multiplier;
+    hash ^= word;
+    hash *= multiplier;
+  }
+  for (; i < size; ++i) {
+    hash ^= bytes[i];
+    hash *= multiplier;
+  }
+  // NOTE: the final avalanche makes every input bit affect every bit of the hash
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccdull;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53ull;
+  hash ^= hash >> 33;
+  return hash;
+}
+} // namespace kuki
@@ -1,3 +1,5 @@
+#include <algorithm>
+#include <cstddef>
 #include <glad/glad.h>
 #include <pool.hpp>
 #include <texture_params.hpp>
@@ -11,11 +13,38 @@ bool TextureParams::operator==(const TextureParams& other) const {
 TexturePool::~TexturePool() {
   Clear();
 }
-void TexturePool::Clear() {
-  for (const auto& [params, textures] : pool)
-    for (auto id : textures)
-      glDeleteTextures(1, &id);
-  Pool::Clear();
+void TexturePool::Free(const TextureParams& params, GLuint& texture) {
+  glDeleteTextures(1, &texture);
+}
+static size_t GetTexelSize(int format) {
+  switch (format) {
+  case GL_RGBA32F:
+    return 16;
+  case GL_RGB32F:
+    return 12;
+  case GL_RGBA16F:
+    return 8;
+  case GL_RGB16F:
+    return 6;
+  case GL_RG16F:
+  case GL_R32F:
+    return 4;
+  case GL_RGB8:
+    return 3;
+  case GL_RG8:
+    return 2;
+  case GL_R8:
+    return 1;
+  default:
+    return 4;
+  }
+}
+size_t TexturePool::GetSize(const TextureParams& params) const {
+  size_t size = 0;
+  for (auto level = 0; level < std::max(params.mipmaps, 1); ++level)
+    size += static_cast<size_t>(std::max(params.width >> level, 1)) * std::max(params.height >> level, 1);
+  auto faces = params.target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+  return size * faces * std::max(params.samples, 1) * GetTexelSize(params.format);
 }
 GLuint TexturePool::Allocate(const TextureParams& params) {
   GLuint texture;
@@ -24,7 +53,7 @@ GLuint TexturePool::Allocate(const TextureParams& params) {
   return texture;
 }
 void TexturePool::Reallocate(const TextureParams& params, GLuint& texture) {
-  // FIXME: this creates immutable storage — resizing is not possible
+  // NOTE: immutable storage cannot be resized, textures of another size are other entries of the pool and the unused ones are evicted
   if (texture == 0)
     return;
   glBindTexture(params.target, texture);
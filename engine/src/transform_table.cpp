@@ -0,0 +1,107 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <format>
+#include <glad/glad.h>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <stdexcept>
+#include <transform_table.hpp>
+#include <vector>
+namespace kuki {
+TransformTable::TransformTable(size_t capacity)
+  : capacity(capacity) {
+  if (capacity == 0)
+    throw std::invalid_argument(std::format("Invalid transform table capacity: {}.", capacity));
+}
+TransformTable::~TransformTable() {
+  Clear();
+}
+void TransformTable::MarkDirty(uint32_t row) {
+  if (dirty[row])
+    return;
+  dirty[row] = 1;
+  dirtyRows.push_back(row);
+}
+void TransformTable::Grow() {
+  auto oldCapacity = capacity;
+  while (capacity < rows.size())
+    capacity *= 2;
+  if (id > 0 && capacity == oldCapacity)
+    return;
+  unsigned int buffer;
+  glCreateBuffers(1, &buffer);
+  glNamedBufferStorage(buffer, capacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_STORAGE_BIT);
+  if (id > 0) {
+    // NOTE: the rows that did not change since the last upload are copied on the GPU, the rest are uploaded afterwards
+    glCopyNamedBufferSubData(id, buffer, 0, 0, oldCapacity * sizeof(glm::mat4));
+    glDeleteBuffers(1, &id);
+  }
+  id = buffer;
+}
+uint32_t TransformTable::Add(const glm::mat4& transform) {
+  uint32_t row;
+  if (!freeRows.empty()) {
+    row = freeRows.back();
+    freeRows.pop_back();
+    rows[row] = transform;
+  } else {
+    row = static_cast<uint32_t>(rows.size());
+    rows.push_back(transform);
+    dirty.push_back(0);
+  }
+  MarkDirty(row);
+  return row;
+}
+void TransformTable::Remove(uint32_t row) {
+  if (row < rows.size())
+    freeRows.push_back(row);
+}
+void TransformTable::Set(uint32_t row, const glm::mat4& transform) {
+  if (row >= rows.size())
+    return;
+  rows[row] = transform;
+  MarkDirty(row);
+}
+size_t TransformTable::Upload() {
+  if (rows.empty() || (id > 0 && dirtyRows.empty()))
+    return 0;
+  Grow();
+  std::sort(dirtyRows.begin(), dirtyRows.end());
+  size_t bytes = 0;
+  for (size_t i = 0; i < dirtyRows.size();) {
+    auto first = dirtyRows[i];
+    auto last = first;
+    while (++i < dirtyRows.size() && dirtyRows[i] == last + 1)
+      last = dirtyRows[i];
+    auto size = (last - first + 1) * sizeof(glm::mat4);
+    glNamedBufferSubData(id, first * sizeof(glm::mat4), size, &rows[first]);
+    bytes += size;
+  }
+  for (auto row : dirtyRows)
+    dirty[row] = 0;
+  dirtyRows.clear();
+  return bytes;
+}
+void TransformTable::Bind() const {
+  if (id > 0)
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, BindingPoint, id);
+}
+void TransformTable::Clear() {
+  if (id > 0)
+    glDeleteBuffers(1, &id);
+  id = 0;
+  rows.clear();
+  freeRows.clear();
+  dirty.clear();
+  dirtyRows.clear();
+}
+unsigned int TransformTable::GetId() const {
+  return id;
+}
+size_t TransformTable::GetRowCount() const {
+  return rows.size();
+}
+size_t TransformTable::GetCapacity() const {
+  return capacity;
+}
+} // namespace kuki
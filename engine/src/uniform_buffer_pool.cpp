@@ -1,4 +1,5 @@
 #include <buffer_params.hpp>
+#include <cstddef>
 #include <glad/glad.h>
 #include <pool.hpp>
 #include <uniform_buffer_pool.hpp>
@@ -11,11 +12,11 @@ bool BufferParams::operator==(const BufferParams& other) const {
 UniformBufferPool::~UniformBufferPool() {
   Clear();
 }
-void UniformBufferPool::Clear() {
-  for (const auto& [params, buffers] : pool)
-    for (auto id : buffers)
-      glDeleteBuffers(1, &id);
-  Pool::Clear();
+void UniformBufferPool::Free(const BufferParams& params, GLuint& ubo) {
+  glDeleteBuffers(1, &ubo);
+}
+size_t UniformBufferPool::GetSize(const BufferParams& params) const {
+  return params.size;
 }
 GLuint UniformBufferPool::Allocate(const BufferParams& params) {
   GLuint ubo;
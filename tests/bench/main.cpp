@@ -0,0 +1,811 @@
+#include <algorithm>
+#include <app_config.hpp>
+#include <application.hpp>
+#include <array>
+#include <bloom_chain.hpp>
+#include <bounding_box.hpp>
+#include <camera.hpp>
+#include <chrono>
+#include <component.hpp>
+#include <cstdint>
+#include <draw_job.hpp>
+#include <filesystem>
+#include <format>
+#include <glad/glad.h>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <gtest/gtest.h>
+#include <id.hpp>
+#include <iostream>
+#include <light_clusters.hpp>
+#include <limits>
+#include <material.hpp>
+#include <material_table.hpp>
+#include <mesh.hpp>
+#include <mesh_filter.hpp>
+#include <occlusion_culler.hpp>
+#include <octree.hpp>
+#include <parallel.hpp>
+#include <primitive.hpp>
+#include <program_cache.hpp>
+#include <random>
+#include <ray.hpp>
+#include <render_queue.hpp>
+#include <rendering_system.hpp>
+#include <scene.hpp>
+#include <shader.hpp>
+#include <skybox.hpp>
+#include <spatial_hit.hpp>
+#include <spherical_harmonics.hpp>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <test_helpers.hpp>
+#include <texture_cache.hpp>
+#include <texture_params.hpp>
+#include <transform.hpp>
+#include <uniform_grid.hpp>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+using namespace kuki;
+TEST(FrustumTest, BatchBenchmark) {
+  auto camera = CreateTestCamera();
+  auto boxes = CreateRandomBoxes(100000, 100.f);
+  std::vector<BoundingBox> singles;
+  singles.reserve(boxes.Size());
+  for (size_t i = 0; i < boxes.Size(); ++i) {
+    glm::vec3 center(boxes.centerX[i], boxes.centerY[i], boxes.centerZ[i]);
+    glm::vec3 extent(boxes.extentX[i], boxes.extentY[i], boxes.extentZ[i]);
+    singles.emplace_back(center - extent, center + extent);
+  }
+  std::vector<uint64_t> mask;
+  constexpr auto iterations = 20;
+  auto start = std::chrono::high_resolution_clock::now();
+  size_t visibleSingle = 0;
+  for (auto i = 0; i < iterations; ++i)
+    for (const auto& bounds : singles)
+      visibleSingle += camera.frustum.InFrustum(bounds);
+  auto single = std::chrono::high_resolution_clock::now() - start;
+  start = std::chrono::high_resolution_clock::now();
+  for (auto i = 0; i < iterations; ++i)
+    camera.frustum.InFrustumScalar(boxes, mask);
+  auto scalar = std::chrono::high_resolution_clock::now() - start;
+  start = std::chrono::high_resolution_clock::now();
+  for (auto i = 0; i < iterations; ++i)
+    camera.frustum.InFrustum(boxes, mask);
+  auto simd = std::chrono::high_resolution_clock::now() - start;
+  using ms = std::chrono::duration<double, std::milli>;
+  std::cout << "[ BENCH    ] 100k boxes per pass, single: " << ms(single).count() / iterations << " ms, scalar batch: " << ms(scalar).count() / iterations << " ms, SIMD batch: " << ms(simd).count() / iterations << " ms" << std::endl;
+  EXPECT_GT(visibleSingle, 0);
+}
+TEST(OctreeTest, CoherentCullingBenchmark) {
+  Octree<ID> octree(glm::vec3(0.f), glm::vec3(128.f), 6, 16, 64);
+  for (const auto& [id, bounds] : CreateRandomItems(100000, 120.f))
+    octree.Insert(id, bounds);
+  Camera camera;
+  camera.farPlane = 150.f;
+  constexpr size_t frameCount = 240;
+  size_t visibleCoherent = 0;
+  size_t visibleReference = 0;
+  using ms = std::chrono::duration<double, std::milli>;
+  ms coherent{};
+  ms reference{};
+  for (size_t frame = 0; frame < frameCount; ++frame) {
+    FlyThrough(camera, frame, frameCount, 60.f);
+    auto start = std::chrono::high_resolution_clock::now();
+    octree.ForEachInFrustumReference(camera, [&visibleReference](ID) {
+      ++visibleReference;
+    });
+    reference += std::chrono::high_resolution_clock::now() - start;
+    start = std::chrono::high_resolution_clock::now();
+    octree.ForEachInFrustum(camera, [&visibleCoherent](ID) {
+      ++visibleCoherent;
+    });
+    coherent += std::chrono::high_resolution_clock::now() - start;
+  }
+  std::cout << "[ BENCH    ] 100k items fly-through, per frame, all planes: " << reference.count() / frameCount << " ms, plane masks: " << coherent.count() / frameCount << " ms" << std::endl;
+  EXPECT_EQ(visibleCoherent, visibleReference);
+}
+TEST(OctreeTest, SpatialQueryBenchmark) {
+  Octree<ID> octree(glm::vec3(0.f), glm::vec3(128.f), 6, 16, 64);
+  auto items = CreateRandomItems(100000, 120.f);
+  for (const auto& [id, bounds] : items)
+    octree.Insert(id, bounds);
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> position(-100.f, 100.f);
+  constexpr auto queries = 1000;
+  std::vector<Ray> rays;
+  std::vector<glm::vec3> points;
+  for (auto i = 0; i < queries; ++i) {
+    points.emplace_back(position(rng), position(rng), position(rng));
+    rays.emplace_back(points.back(), glm::vec3(position(rng), position(rng), position(rng)));
+  }
+  using us = std::chrono::duration<double, std::micro>;
+  auto measure = [](auto&& func) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto i = 0; i < queries; ++i)
+      func(i);
+    return us(std::chrono::high_resolution_clock::now() - start).count() / queries;
+  };
+  size_t results = 0;
+  auto bruteForce = measure([&](int i) {
+    auto distance = 0.f;
+    auto closest = std::numeric_limits<float>::max();
+    for (const auto& [id, bounds] : items)
+      if (rays[i].Intersects(bounds, distance, closest))
+        closest = distance;
+    results += closest < std::numeric_limits<float>::max();
+  });
+  auto raycast = measure([&](int i) {
+    SpatialHit<ID> hit;
+    results += octree.Raycast(rays[i], hit);
+  });
+  auto raycastAll = measure([&](int i) {
+    std::vector<SpatialHit<ID>> hits;
+    octree.RaycastAll(rays[i], hits);
+    results += hits.size();
+  });
+  auto overlapBox = measure([&](int i) {
+    std::vector<ID> overlaps;
+    octree.OverlapAABB(BoundingBox(points[i] - glm::vec3(5.f), points[i] + glm::vec3(5.f)), overlaps);
+    results += overlaps.size();
+  });
+  auto overlapSphere = measure([&](int i) {
+    std::vector<ID> overlaps;
+    octree.OverlapSphere(points[i], 5.f, overlaps);
+    results += overlaps.size();
+  });
+  auto nearest = measure([&](int i) {
+    std::vector<SpatialHit<ID>> hits;
+    octree.KNearest(points[i], 16, hits);
+    results += hits.size();
+  });
+  std::cout << "[ BENCH    ] 100k items, per query, brute force raycast: " << bruteForce << " us, raycast: " << raycast << " us, raycast all: " << raycastAll << " us, overlap AABB: " << overlapBox << " us, overlap sphere: " << overlapSphere << " us, 16 nearest: " << nearest << " us" << std::endl;
+  EXPECT_GT(results, 0);
+}
+TEST(OctreeTest, BulkBuildBenchmark) {
+  Octree<ID> octree(glm::vec3(0.f), glm::vec3(128.f), 6, 16, 64);
+  auto items = CreateRandomItems(1000000, 120.f);
+  using ms = std::chrono::duration<double, std::milli>;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (const auto& [id, bounds] : items)
+    octree.Insert(id, bounds);
+  ms incremental = std::chrono::high_resolution_clock::now() - start;
+  ms bulk{};
+  constexpr auto builds = 4;
+  for (auto i = 0; i < builds; ++i) {
+    start = std::chrono::high_resolution_clock::now();
+    octree.Build(items, true);
+    bulk += std::chrono::high_resolution_clock::now() - start;
+  }
+  constexpr auto frameBudget = 1000. / 60.;
+  auto build = bulk.count() / builds;
+  std::cout << "[ BENCH    ] 1M items, incremental insert: " << incremental.count() << " ms, bulk build: " << build << " ms (" << GetParallelThreadCount() << " threads), " << build / frameBudget << "x the " << frameBudget << " ms frame budget" << std::endl;
+  EXPECT_EQ(octree.GetCount(), items.size());
+}
+template <typename Index>
+static std::string BenchmarkSpatialIndex(Index index, std::vector<std::pair<ID, BoundingBox>> items, glm::vec3 range, float cameraHeight) {
+  using ms = std::chrono::duration<double, std::milli>;
+  auto start = std::chrono::high_resolution_clock::now();
+  index.Build(items, true);
+  ms build = std::chrono::high_resolution_clock::now() - start;
+  Camera camera;
+  camera.farPlane = 150.f;
+  constexpr size_t frameCount = 120;
+  size_t visible = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (size_t frame = 0; frame < frameCount; ++frame) {
+    FlyThrough(camera, frame, frameCount, range.x * .5f);
+    camera.position.y += cameraHeight;
+    camera.Update();
+    index.ForEachInFrustum(camera, [&visible](ID) {
+      ++visible;
+    });
+  }
+  ms cull = std::chrono::high_resolution_clock::now() - start;
+  std::mt19937 rng(5);
+  std::uniform_real_distribution<float> unit(-1.f, 1.f);
+  constexpr size_t queryCount = 500;
+  size_t results = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < queryCount; ++i) {
+    SpatialHit<ID> hit;
+    auto origin = glm::vec3(unit(rng), unit(rng), unit(rng)) * range;
+    results += index.Raycast(Ray(origin, glm::vec3(unit(rng), unit(rng) * .1f, unit(rng))), hit);
+  }
+  ms raycast = std::chrono::high_resolution_clock::now() - start;
+  start = std::chrono::high_resolution_clock::now();
+  for (size_t i = 0; i < queryCount; ++i) {
+    std::vector<SpatialHit<ID>> hits;
+    index.KNearest(glm::vec3(unit(rng), unit(rng), unit(rng)) * range, 16, hits);
+    results += hits.size();
+  }
+  ms nearest = std::chrono::high_resolution_clock::now() - start;
+  EXPECT_GT(visible, 0);
+  EXPECT_GT(results, 0);
+  std::ostringstream oss;
+  oss << "build " << build.count() << " ms, cull " << cull.count() / frameCount << " ms, raycast " << raycast.count() * 1000. / queryCount << " us, 16 nearest " << nearest.count() * 1000. / queryCount << " us";
+  return oss.str();
+}
+TEST(SpatialIndexTest, ShapeBenchmark) {
+  struct Shape {
+    std::string name;
+    glm::vec3 range;
+    float cameraHeight;
+  };
+  std::vector<Shape> shapes{{"volume 240^3", glm::vec3(120.f), 0.f}, {"flat 2000x2000x8", glm::vec3(1000.f, 4.f, 1000.f), 10.f}};
+  for (const auto& shape : shapes) {
+    auto items = CreateRandomItems(100000, shape.range);
+    std::cout << "[ BENCH    ] 100k items, " << shape.name << ", octree: " << BenchmarkSpatialIndex(Octree<ID>(glm::vec3(0.f), glm::vec3(10.f), 6, 16, 64), items, shape.range, shape.cameraHeight) << std::endl;
+    std::cout << "[ BENCH    ] 100k items, " << shape.name << ", quadtree: " << BenchmarkSpatialIndex(Quadtree<ID>(glm::vec3(0.f), glm::vec3(10.f), 6, 16, 64), items, shape.range, shape.cameraHeight) << std::endl;
+    std::cout << "[ BENCH    ] 100k items, " << shape.name << ", uniform grid: " << BenchmarkSpatialIndex(UniformGrid<ID>(glm::vec3(16.f)), items, shape.range, shape.cameraHeight) << std::endl;
+  }
+}
+TEST(SceneTest, VisibilityCacheBenchmark) {
+  Scene scene("Test", 0);
+  auto camera = CreateTestCamera();
+  for (auto i = 0; i < 20000; ++i) {
+    std::string name = "Cube";
+    auto id = scene.CreateEntity(name);
+    auto transform = scene.entityManager.AddComponent<Transform>(id);
+    auto filter = scene.entityManager.AddComponent<MeshFilter>(id);
+    transform->position = glm::vec3(i % 200 - 100.f, 0.f, i / 200 - 90.f) * 2.f;
+    filter->mesh.bounds = BoundingBox(glm::vec3(-.5f), glm::vec3(.5f));
+  }
+  scene.UpdateTransforms();
+  scene.UpdateSpatialIndex();
+  using us = std::chrono::duration<double, std::micro>;
+  constexpr auto frameCount = 100;
+  size_t visible = 0;
+  auto measure = [&](auto&& update) {
+    auto start = std::chrono::high_resolution_clock::now();
+    for (auto frame = 0; frame < frameCount; ++frame) {
+      update(frame);
+      scene.ForEachVisibleEntity(camera, [&visible](ID) {
+        ++visible;
+      });
+    }
+    return us(std::chrono::high_resolution_clock::now() - start).count() / frameCount;
+  };
+  auto moving = measure([&camera](int frame) {
+    camera.position.x = (frame % 2) ? 1.f : 0.f;
+    camera.Update();
+  });
+  auto idle = measure([&camera](int) {
+    camera.Update();
+  });
+  std::cout << "[ BENCH    ] 20k entities, per frame visibility, moving camera: " << moving << " us, idle camera: " << idle << " us" << std::endl;
+  EXPECT_GT(visible, 0);
+}
+template <typename Index>
+static std::string BenchmarkOcclusion(Index index, const std::vector<std::pair<ID, BoundingBox>>& items, const Camera& camera, const OcclusionCuller& culler) {
+  auto copy = items;
+  index.Build(copy, true);
+  using us = std::chrono::duration<double, std::micro>;
+  constexpr auto frameCount = 20;
+  size_t frustumVisible = 0;
+  size_t occlusionVisible = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (auto frame = 0; frame < frameCount; ++frame)
+    index.ForEachInFrustum(camera, [&frustumVisible](ID) {
+      ++frustumVisible;
+    });
+  auto frustumTime = us(std::chrono::high_resolution_clock::now() - start).count() / frameCount;
+  OcclusionStats counts{};
+  start = std::chrono::high_resolution_clock::now();
+  for (auto frame = 0; frame < frameCount; ++frame)
+    index.ForEachInFrustum(camera, [&occlusionVisible](ID) {
+      ++occlusionVisible;
+    }, &culler, &counts);
+  auto occlusionTime = us(std::chrono::high_resolution_clock::now() - start).count() / frameCount;
+  EXPECT_LT(occlusionVisible, frustumVisible);
+  std::ostringstream stream;
+  stream << "frustum only: " << frustumTime << " us (" << frustumVisible / frameCount << " visible), frustum + occlusion: " << occlusionTime << " us (" << occlusionVisible / frameCount << " visible, " << counts.tested / frameCount << " boxes tested)";
+  return stream.str();
+}
+TEST(OcclusionCullerTest, CityBenchmark) {
+  auto buildings = CreateCity(24, 20.f, 10.f);
+  auto items = CreateRandomItems(100000, glm::vec3(360.f, 1.f, 360.f));
+  for (auto& [_, bounds] : items) {
+    bounds.min.y += 1.f;
+    bounds.max.y += 1.f;
+  }
+  auto camera = CreateStreetCamera();
+  camera.position.z = 365.f;
+  camera.farPlane = 800.f;
+  camera.Update();
+  OcclusionCuller culler;
+  using us = std::chrono::duration<double, std::micro>;
+  constexpr auto frameCount = 20;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (auto frame = 0; frame < frameCount; ++frame) {
+    culler.Begin(camera);
+    for (const auto& building : buildings)
+      if (camera.IntersectsFrustum(building))
+        culler.AddOccluder(building);
+    culler.BuildHiZ();
+  }
+  auto rasterTime = us(std::chrono::high_resolution_clock::now() - start).count() / frameCount;
+  std::cout << "[ BENCH    ] 576 buildings, " << culler.GetWidth() << "x" << culler.GetHeight() << " depth buffer, rasterize + HiZ: " << rasterTime << " us (" << culler.GetStats().triangles << " triangles)" << std::endl;
+  std::cout << "[ BENCH    ] 100k items, octree, " << BenchmarkOcclusion(Octree<ID>(), items, camera, culler) << std::endl;
+  std::cout << "[ BENCH    ] 100k items, uniform grid, " << BenchmarkOcclusion(UniformGrid<ID>(), items, camera, culler) << std::endl;
+}
+TEST(LightClustersTest, BuildBenchmark) {
+  auto camera = CreateTestCamera();
+  auto lights = CreateTestLights(4096, 100.f, 29);
+  std::vector<const Light*> pointers;
+  for (const auto& light : lights)
+    pointers.push_back(&light);
+  constexpr auto iterations = 20;
+  LightClusters clusters;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (auto iteration = 0; iteration < iterations; ++iteration)
+    clusters.Build(camera, pointers);
+  auto elapsed = std::chrono::high_resolution_clock::now() - start;
+  size_t busiest = 0;
+  for (const auto& cluster : clusters.GetClusters())
+    busiest = std::max<size_t>(busiest, cluster.count);
+  using ms = std::chrono::duration<double, std::milli>;
+  auto clusterCount = clusters.GetClusters().size();
+  std::cout << "[ BENCH    ] 4096 point lights, " << clusterCount << " clusters, build: " << ms(elapsed).count() / iterations << " ms, " << clusters.GetLights().size() << " lights in the frustum, " << static_cast<double>(clusters.GetIndices().size()) / clusterCount << " per cluster on average, " << busiest << " at most" << std::endl;
+  EXPECT_LT(busiest, clusters.GetLights().size());
+}
+TEST(RenderQueueTest, DrawListBenchmark) {
+  constexpr size_t count = 20000;
+  constexpr size_t meshCount = 50;
+  constexpr auto iterations = 20;
+  std::vector<Mesh> meshes(meshCount);
+  for (size_t i = 0; i < meshCount; ++i)
+    meshes[i].vao = static_cast<unsigned int>(i + 1);
+  std::mt19937 rng(3);
+  std::uniform_int_distribution<size_t> meshDist(0, meshCount - 1);
+  std::uniform_real_distribution<float> depthDist(0.f, 1.f);
+  std::vector<size_t> meshOf(count);
+  std::vector<float> depthOf(count);
+  std::vector<glm::mat4> worlds(count);
+  std::vector<LitMaterial> litMaterialsOf(count);
+  for (size_t i = 0; i < count; ++i) {
+    meshOf[i] = meshDist(rng);
+    depthOf[i] = depthDist(rng);
+  }
+  // NOTE: the previous approach, hash maps rebuilt every frame, four vectors allocated per batch and the material copied per instance
+  size_t drawnMaps = 0;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (auto iteration = 0; iteration < iterations; ++iteration) {
+    std::unordered_map<unsigned int, std::vector<size_t>> vaoToEntities;
+    std::unordered_map<unsigned int, Mesh> vaoToMesh;
+    for (size_t i = 0; i < count; ++i) {
+      const auto& mesh = meshes[meshOf[i]];
+      vaoToMesh[mesh.vao] = mesh;
+      vaoToEntities[mesh.vao].push_back(i);
+    }
+    for (const auto& [vao, entities] : vaoToEntities) {
+      std::vector<LitFallbackData> litMaterials;
+      std::vector<UnlitFallbackData> unlitMaterials;
+      std::vector<glm::mat4> litTransforms;
+      std::vector<glm::mat4> unlitTransforms;
+      LitMaterial materialLit;
+      for (auto i : entities) {
+        materialLit = litMaterialsOf[i];
+        litMaterials.push_back(materialLit.fallback);
+        litTransforms.push_back(worlds[i]);
+      }
+      drawnMaps += litTransforms.size() + unlitTransforms.size() + unlitMaterials.size() + (vaoToMesh[vao].vao > 0 ? 0 : 1);
+    }
+  }
+  auto maps = std::chrono::high_resolution_clock::now() - start;
+  RenderQueue queue;
+  std::vector<LitFallbackData> materials;
+  std::vector<glm::mat4> transforms;
+  size_t drawnQueue = 0;
+  start = std::chrono::high_resolution_clock::now();
+  for (auto iteration = 0; iteration < iterations; ++iteration) {
+    queue.Clear();
+    for (size_t i = 0; i < count; ++i) {
+      const auto& mesh = meshes[meshOf[i]];
+      queue.Push(RenderQueue::MakeKey(RenderPass::Opaque, MaterialType::Lit, 0, static_cast<uint16_t>(mesh.vao), depthOf[i]), {&mesh, nullptr, &worlds[i]});
+    }
+    queue.Sort();
+    queue.ForEachBatch([&](size_t begin, size_t end) {
+      materials.clear();
+      transforms.clear();
+      for (auto i = begin; i < end; ++i) {
+        const auto& item = queue.GetItem(i);
+        materials.push_back(litMaterialsOf[item.world - worlds.data()].fallback);
+        transforms.push_back(*item.world);
+      }
+      drawnQueue += transforms.size();
+    });
+  }
+  auto sorted = std::chrono::high_resolution_clock::now() - start;
+  using ms = std::chrono::duration<double, std::milli>;
+  std::cout << "[ BENCH    ] 20k items in 50 meshes per frame, hash maps: " << ms(maps).count() / iterations << " ms, sorted queue: " << ms(sorted).count() / iterations << " ms" << std::endl;
+  EXPECT_EQ(drawnMaps, drawnQueue);
+}
+TEST(RenderQueueTest, ParallelDrawListBenchmark) {
+  constexpr size_t count = 100000;
+  constexpr size_t meshCount = 50;
+  constexpr size_t materialCount = 64;
+  constexpr auto iterations = 10;
+  std::vector<Mesh> meshes(meshCount);
+  for (size_t i = 0; i < meshCount; ++i)
+    meshes[i].vao = static_cast<unsigned int>(i + 1);
+  std::vector<LitMaterial> materials(materialCount);
+  for (size_t i = 0; i < materialCount; ++i)
+    materials[i].fallback.albedo = glm::vec4(static_cast<float>(i) / materialCount, 0.f, 0.f, 1.f);
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<size_t> meshDist(0, meshCount - 1);
+  std::uniform_int_distribution<size_t> materialDist(0, materialCount - 1);
+  std::uniform_real_distribution<float> positionDist(-100.f, 100.f);
+  // NOTE: entities own copies of their materials, as the mesh renderers do
+  std::vector<size_t> meshOf(count);
+  std::vector<LitMaterial> materialOf(count);
+  std::vector<glm::mat4> worlds(count);
+  for (size_t i = 0; i < count; ++i) {
+    meshOf[i] = meshDist(rng);
+    materialOf[i] = materials[materialDist(rng)];
+    worlds[i] = glm::translate(glm::mat4(1.f), glm::vec3(positionDist(rng), positionDist(rng), positionDist(rng)));
+  }
+  auto makeItem = [&](size_t i, uint16_t& mesh, float& depth) {
+    mesh = RenderQueue::GetMeshKey(meshes[meshOf[i]]);
+    depth = glm::length(glm::vec3(worlds[i][3])) / 200.f;
+    return RenderItem{&meshes[meshOf[i]], nullptr, &worlds[i]};
+  };
+  MaterialTable sequentialTable;
+  RenderQueue sequential;
+  auto start = std::chrono::high_resolution_clock::now();
+  for (auto iteration = 0; iteration < iterations; ++iteration) {
+    sequentialTable.ClearEntries();
+    sequential.Clear();
+    for (size_t i = 0; i < count; ++i) {
+      uint16_t mesh;
+      float depth;
+      auto item = makeItem(i, mesh, depth);
+      auto material = sequentialTable.Add(materialOf[i]);
+      item.materialIndex = material.entry;
+      sequential.Push(RenderQueue::MakeKey(RenderPass::Opaque, MaterialType::Lit, material.textureSet, mesh, depth), item);
+    }
+    sequential.Sort();
+  }
+  auto sequentialTime = std::chrono::high_resolution_clock::now() - start;
+  std::vector<DrawJob> jobs(GetParallelThreadCount());
+  MaterialTable parallelTable;
+  RenderQueue parallel;
+  auto getTransformRow = [](ID id, const glm::mat4& world) {
+    return 0u;
+  };
+  start = std::chrono::high_resolution_clock::now();
+  for (auto iteration = 0; iteration < iterations; ++iteration) {
+    parallelTable.ClearEntries();
+    parallel.Clear();
+    auto jobCount = ParallelChunks(count, [&](size_t chunk, size_t begin, size_t end) {
+      auto& job = jobs[chunk];
+      job.Clear();
+      for (auto i = begin; i < end; ++i) {
+        uint16_t mesh;
+        float depth;
+        auto item = makeItem(i, mesh, depth);
+        job.Add(ID::Invalid(), item, MaterialType::Lit, depth, parallelTable.Prepare(materialOf[i]));
+      }
+    }, 512);
+    for (size_t i = 0; i < jobCount; ++i)
+      jobs[i].Merge(parallelTable, parallel, getTransformRow);
+    parallel.Sort();
+  }
+  auto parallelTime = std::chrono::high_resolution_clock::now() - start;
+  using ms = std::chrono::duration<double, std::milli>;
+  std::cout << "[ BENCH    ] 100k items in 64 materials per frame, sequential: " << ms(sequentialTime).count() / iterations << " ms, " << GetParallelThreadCount() << " threads: " << ms(parallelTime).count() / iterations << " ms" << std::endl;
+  ASSERT_EQ(parallel.Size(), sequential.Size());
+  EXPECT_EQ(parallelTable.GetEntries().size(), materialCount);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_EQ(parallel.GetKey(i), sequential.GetKey(i));
+    ASSERT_EQ(parallel.GetItem(i).world, sequential.GetItem(i).world);
+    ASSERT_EQ(parallel.GetItem(i).materialIndex, sequential.GetItem(i).materialIndex);
+  }
+}
+TEST(SphericalHarmonicsTest, ProjectBenchmark) {
+  constexpr auto width = 2051;
+  constexpr auto height = 1027;
+  constexpr auto channels = 4;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> dist(0.f, 8.f);
+  std::vector<float> pixels(static_cast<size_t>(width) * height * channels);
+  for (auto& value : pixels)
+    value = dist(rng);
+  constexpr auto iterations = 5;
+  SphericalHarmonics reference;
+  SphericalHarmonics projected;
+  auto scalarStart = std::chrono::high_resolution_clock::now();
+  for (auto i = 0; i < iterations; ++i)
+    reference = SphericalHarmonics::ProjectScalar(pixels.data(), width, height, channels);
+  auto scalar = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - scalarStart).count() / iterations;
+  auto projectStart = std::chrono::high_resolution_clock::now();
+  for (auto i = 0; i < iterations; ++i)
+    projected = SphericalHarmonics::Project(pixels.data(), width, height, channels);
+  auto project = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - projectStart).count() / iterations;
+  std::cout << "[ BENCH    ] " << width << "x" << height << " equirect to L2 SH, scalar: " << scalar << " ms, SIMD on " << GetParallelThreadCount() << " threads: " << project << " ms" << std::endl;
+  EXPECT_NEAR(projected.coefficients[0].r, reference.coefficients[0].r, 1e-3f);
+}
+TEST(ShaderTest, UniformHandleBenchmark) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  constexpr auto batches = 20000;
+  AppConfig config;
+  config.cacheDirectory = std::filesystem::temp_directory_path() / "kuki_shader_benchmark";
+  Application app(config);
+  RenderingSystem renderer(app);
+  LitShader shader("LightingBenchmark", WriteTestShader("lighting.vert", LightingTestVertSource), WriteTestShader("lighting.frag", LightingTestFragSource), renderer);
+  ASSERT_TRUE(shader.Wait());
+  shader.Use();
+  // a batch sets the camera, the directional light, the cluster layout and the skybox of the scene
+  auto camera = CreateTestCamera();
+  auto pointLights = CreateTestLights(64, 20.f, 3);
+  Light sun;
+  sun.vector = glm::vec3(0.f, -1.f, 0.f);
+  std::vector<const Light*> lights{&sun};
+  for (const auto& light : pointLights)
+    lights.push_back(&light);
+  LightClusters clusters;
+  clusters.Build(camera, lights);
+  Skybox skybox;
+  skybox.hasIrradianceSH = true;
+  for (size_t i = 0; i < skybox.irradianceSH.coefficients.size(); ++i)
+    skybox.irradianceSH.coefficients[i] = glm::vec3(.1f * i);
+  // NOTE: the previous approach, every call looks the name up in the program's map of locations
+  auto start = std::chrono::high_resolution_clock::now();
+  for (auto batch = 0; batch < batches; ++batch) {
+    shader.SetUniform("viewPos", camera.position);
+    shader.SetUniform("dirLight.direction", sun.vector);
+    shader.SetUniform("dirLight.ambient", sun.ambient);
+    shader.SetUniform("dirLight.diffuse", sun.diffuse);
+    shader.SetUniform("dirLight.specular", sun.specular);
+    shader.SetUniform("hasDirLight", 1);
+    shader.SetUniform("clusterCount", clusters.GetSize());
+    shader.SetUniform("clusterDepth", clusters.GetDepthScaleBias());
+    shader.SetUniform("hasSkybox", 1);
+    shader.SetUniform("hasIrradianceMap", 0);
+    shader.SetUniform("hasIrradianceSH", 1);
+    // NOTE: arrays have no setter by name, their location is queried from the driver
+    glUniform3fv(glGetUniformLocation(shader.GetId(), "irradianceSH"), 9, glm::value_ptr(skybox.irradianceSH.coefficients[0]));
+    shader.SetUniform("hasPrefilterMap", 0);
+    shader.SetUniform("hasBRDF", 0);
+  }
+  glFinish();
+  auto byName = std::chrono::high_resolution_clock::now() - start;
+  constexpr auto uniformCount = 14;
+  start = std::chrono::high_resolution_clock::now();
+  for (auto batch = 0; batch < batches; ++batch) {
+    shader.SetCamera(&camera);
+    shader.SetLighting(lights);
+    shader.SetLightClusters(&clusters);
+    shader.SetSkybox(&skybox);
+  }
+  glFinish();
+  auto byHandle = std::chrono::high_resolution_clock::now() - start;
+  using us = std::chrono::duration<double, std::micro>;
+  std::cout << "[ BENCH    ] lighting uniforms of a batch (" << uniformCount << " uniforms and the 9 irradiance coefficients), by name: " << us(byName).count() / batches << " us, by handle: " << us(byHandle).count() / batches << " us" << std::endl;
+  auto program = shader.GetId();
+  glm::vec3 read(0.f);
+  glGetUniformfv(program, glGetUniformLocation(program, "irradianceSH[8]"), glm::value_ptr(read));
+  EXPECT_EQ(read, skybox.irradianceSH.coefficients[8]);
+  glm::uvec3 clusterCount(0);
+  glGetUniformuiv(program, glGetUniformLocation(program, "clusterCount"), glm::value_ptr(clusterCount));
+  EXPECT_EQ(clusterCount, clusters.GetSize());
+  glUseProgram(0);
+}
+TEST(ProgramCacheTest, ColdWarmBenchmark) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  int formatCount = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+  if (formatCount == 0)
+    GTEST_SKIP() << "No program binary formats";
+  auto directory = std::filesystem::temp_directory_path() / "kuki_program_cache_benchmark";
+  std::filesystem::remove_all(directory);
+  std::array<std::string, 2> sources{"#version 450 core\nlayout(location = 0) in vec3 position;\nuniform mat4 model;\nvoid main() { gl_Position = model * vec4(position, 1.0); }\n", "#version 450 core\nuniform vec4 tint;\nout vec4 color;\nvoid main() { color = tint * 0.5; }\n"};
+  ProgramCache cache(directory);
+  // cold start: compile and link from source, then store the binary
+  auto coldStart = std::chrono::high_resolution_clock::now();
+  auto vertText = sources[0].c_str();
+  auto fragText = sources[1].c_str();
+  auto vert = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vert, 1, &vertText, nullptr);
+  glCompileShader(vert);
+  auto frag = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(frag, 1, &fragText, nullptr);
+  glCompileShader(frag);
+  auto program = glCreateProgram();
+  glAttachShader(program, vert);
+  glAttachShader(program, frag);
+  glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(program);
+  glDeleteShader(vert);
+  glDeleteShader(frag);
+  ASSERT_TRUE(cache.Store("Test", program, sources));
+  auto cold = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - coldStart).count();
+  // warm start: a new cache, as on the next launch, loads the binary
+  ProgramCache warmCache(directory);
+  auto warmStart = std::chrono::high_resolution_clock::now();
+  auto loaded = warmCache.Load("Test", sources);
+  auto warm = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - warmStart).count();
+  EXPECT_NE(loaded, 0);
+  std::cout << "[ BENCH    ] 1 program, cold (compile, link, store): " << cold << " ms, warm (load binary): " << warm << " ms" << std::endl;
+  glDeleteProgram(program);
+  glDeleteProgram(loaded);
+  std::filesystem::remove_all(directory);
+}
+TEST(ShaderTest, ParallelCompileBenchmark) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  auto supported = false;
+  GLint extensionCount = 0;
+  glGetIntegerv(GL_NUM_EXTENSIONS, &extensionCount);
+  for (auto i = 0; i < extensionCount; ++i) {
+    std::string_view extension(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)));
+    supported = supported || extension == "GL_KHR_parallel_shader_compile" || extension == "GL_ARB_parallel_shader_compile";
+  }
+  if (!supported)
+    GTEST_SKIP() << "No parallel shader compilation";
+  constexpr GLenum completionStatus = 0x91B1;
+  constexpr auto programCount = 8;
+  // each program differs, so the driver cannot reuse an earlier compile
+  auto createPrograms = [&](int seed) {
+    std::vector<unsigned int> programs;
+    for (auto i = 0; i < programCount; ++i) {
+      auto fragSource = std::format("#version 450 core\nout vec4 color;\nvoid main() {{\n  vec4 sum = vec4(0.0);\n  for (int i = 0; i < {}; ++i)\n    sum += sin(gl_FragCoord * float(i)) * cos(gl_FragCoord.yxwz);\n  color = sum;\n}}\n", 32 + seed * programCount + i);
+      programs.push_back(CreateTestProgram("#version 450 core\nvoid main() { gl_Position = vec4(0.0); }\n", fragSource.c_str()));
+    }
+    return programs;
+  };
+  auto sequentialStart = std::chrono::high_resolution_clock::now();
+  auto sequentialPrograms = createPrograms(0);
+  for (auto program : sequentialPrograms) {
+    int linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    EXPECT_TRUE(linked);
+  }
+  auto sequential = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - sequentialStart).count();
+  // the compiles are issued together and polled, as the renderer does for the programs of the first frame
+  auto parallelStart = std::chrono::high_resolution_clock::now();
+  auto parallelPrograms = createPrograms(1);
+  size_t polls = 0;
+  for (auto pending = true; pending; ++polls) {
+    pending = false;
+    for (auto program : parallelPrograms) {
+      int complete;
+      glGetProgramiv(program, completionStatus, &complete);
+      pending = pending || !complete;
+    }
+  }
+  for (auto program : parallelPrograms) {
+    int linked;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    EXPECT_TRUE(linked);
+  }
+  auto parallel = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - parallelStart).count();
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  std::cout << "[ BENCH    ] " << programCount << " programs, waited one by one: " << sequential << " ms, issued together and polled: " << parallel << " ms (" << polls << " polls)" << std::endl;
+  for (auto program : sequentialPrograms)
+    glDeleteProgram(program);
+  for (auto program : parallelPrograms)
+    glDeleteProgram(program);
+}
+TEST(TextureCacheTest, StoreLoadBenchmark) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  auto directory = std::filesystem::temp_directory_path() / "kuki_texture_cache_benchmark";
+  std::filesystem::remove_all(directory);
+  constexpr auto size = 256;
+  TextureParams params{size, size, GL_TEXTURE_CUBE_MAP, GL_RGBA32F, 1, 9};
+  auto createTexture = [&]() {
+    unsigned int texture;
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &texture);
+    glTextureStorage2D(texture, params.mipmaps, params.format, params.width, params.height);
+    return texture;
+  };
+  auto source = createTexture();
+  for (auto level = 0; level < params.mipmaps; ++level) {
+    auto levelSize = size >> level;
+    std::vector<glm::vec4> texels(levelSize * levelSize * 6, glm::vec4(2.f, .5f, 8.f, 1.f));
+    glTextureSubImage3D(source, level, 0, 0, 0, levelSize, levelSize, 6, GL_RGBA, GL_FLOAT, texels.data());
+  }
+  TextureCache cache(directory);
+  auto key = TextureCache::Hash("environment", 11);
+  auto storeStart = std::chrono::high_resolution_clock::now();
+  ASSERT_TRUE(cache.Store("environment_cubemap", key, source, params));
+  auto store = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - storeStart).count();
+  auto fileSize = std::filesystem::file_size(directory / "environment_cubemap.tex");
+  auto loaded = createTexture();
+  TextureCache warmCache(directory);
+  auto loadStart = std::chrono::high_resolution_clock::now();
+  ASSERT_TRUE(warmCache.Load("environment_cubemap", key, loaded, params));
+  glFinish();
+  auto load = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count();
+  std::cout << "[ BENCH    ] " << size << "^2 cube map with " << params.mipmaps << " levels, " << fileSize / 1024 << " KiB, store: " << store << " ms, load and upload: " << load << " ms" << std::endl;
+  unsigned int textures[]{source, loaded};
+  glDeleteTextures(2, textures);
+  std::filesystem::remove_all(directory);
+}
+TEST(BloomChainTest, GpuBenchmark) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  constexpr auto width = 3840;
+  constexpr auto height = 2160;
+  constexpr auto iterations = 4;
+  constexpr auto gaussianPasses = 8;
+  AppConfig config;
+  config.cacheDirectory = std::filesystem::temp_directory_path() / "kuki_bloom_benchmark";
+  Application app(config);
+  RenderingSystem renderer(app);
+  std::filesystem::path shaderDirectory(KUKI_SHADER_DIR);
+  Shader brightShader("BrightPass", shaderDirectory / "standard_m.vert", shaderDirectory / "bright_pass.frag", renderer, MaterialType::BrightPass);
+  Shader blurShader("Blur", shaderDirectory / "standard_m.vert", shaderDirectory / "blur.frag", renderer, MaterialType::Blur);
+  // NOTE: the previous approach, a separable 9-tap Gaussian ping-ponged over the full resolution image
+  Shader gaussianShader("Gaussian", shaderDirectory / "standard_m.vert", WriteTestShader("gaussian.frag", "#version 450 core\nconst float weight[5] = float[](0.227027, 0.1945946, 0.1216216, 0.054054, 0.016216);\nin vec2 texCoord;\nout vec4 color;\nuniform bool horizontal;\nuniform sampler2D image;\nvoid main() {\n  vec2 offset = (horizontal ? vec2(1.0, 0.0) : vec2(0.0, 1.0)) / textureSize(image, 0);\n  vec3 result = texture(image, texCoord).rgb * weight[0];\n  for (int i = 1; i < 5; ++i)\n    result += (texture(image, texCoord + offset * i).rgb + texture(image, texCoord - offset * i).rgb) * weight[i];\n  color = vec4(result, 1.0);\n}\n"), renderer, MaterialType::Blur);
+  if (!brightShader.Wait() || !blurShader.Wait() || !gaussianShader.Wait())
+    GTEST_SKIP() << "The bloom shaders do not build on this context";
+  auto frame = renderer.CreateMesh(Primitive::Frame());
+  // the image has the format of the scene's resolved target, bright enough everywhere that the bright pass keeps it
+  unsigned int textures[3];
+  glCreateTextures(GL_TEXTURE_2D, 3, textures);
+  unsigned int framebuffers[2];
+  glCreateFramebuffers(2, framebuffers);
+  for (auto texture : textures) {
+    glTextureStorage2D(texture, 1, GL_RGB32F, width, height);
+    glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  }
+  const float bright[]{4.f, 2.f, 1.f};
+  glClearTexImage(textures[0], 0, GL_RGB, GL_FLOAT, bright);
+  for (auto i = 0; i < 2; ++i)
+    glNamedFramebufferTexture(framebuffers[i], GL_COLOR_ATTACHMENT0, textures[i + 1], 0);
+  BloomChain bloom;
+  ASSERT_TRUE(bloom.Resize(width, height));
+  unsigned int query;
+  glCreateQueries(GL_TIME_ELAPSED, 1, &query);
+  auto timeGpu = [&](auto&& passes) {
+    // the first run is not timed, it includes the driver's setup of the programs and targets
+    passes();
+    double total = 0.;
+    for (auto i = 0; i < iterations; ++i) {
+      glBeginQuery(GL_TIME_ELAPSED, query);
+      passes();
+      glEndQuery(GL_TIME_ELAPSED);
+      GLuint64 elapsed = 0;
+      glGetQueryObjectui64v(query, GL_QUERY_RESULT, &elapsed);
+      total += elapsed;
+    }
+    return total / iterations / 1e6;
+  };
+  auto chain = timeGpu([&]() {
+    bloom.Apply(textures[0], brightShader, blurShader, &frame);
+  });
+  auto gaussian = timeGpu([&]() {
+    gaussianShader.Use();
+    gaussianShader.SetUniform("model", glm::mat4(1.f));
+    gaussianShader.SetUniform("image", 0);
+    glViewport(0, 0, width, height);
+    glActiveTexture(GL_TEXTURE0);
+    for (auto i = 0; i < gaussianPasses; ++i) {
+      glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[i % 2]);
+      glBindTexture(GL_TEXTURE_2D, textures[i == 0 ? 0 : 2 - i % 2]);
+      gaussianShader.SetUniform("horizontal", i % 2 == 0);
+      gaussianShader.Draw(&frame);
+    }
+  });
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  std::cout << "[ BENCH    ] " << width << "x" << height << " bloom on the GPU, " << gaussianPasses << " full resolution Gaussian passes: " << gaussian << " ms, " << bloom.GetLevelCount() << " level chain: " << chain << " ms" << std::endl;
+  glDeleteQueries(1, &query);
+  glDeleteFramebuffers(2, framebuffers);
+  glDeleteTextures(3, textures);
+}
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,153 @@
+#pragma once
+#include <bounding_box.hpp>
+#include <camera.hpp>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <glm/ext/scalar_constants.hpp>
+#include <glm/ext/vector_float3.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/trigonometric.hpp>
+#include <id.hpp>
+#include <light.hpp>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+namespace kuki {
+/// @brief Scatter boxes of random sizes in a cube around the origin
+inline BoundingBoxBatch CreateRandomBoxes(size_t count, float range, unsigned int seed = 42) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> position(-range, range);
+  std::uniform_real_distribution<float> size(.1f, 2.f);
+  BoundingBoxBatch boxes;
+  boxes.Reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    glm::vec3 min(position(rng), position(rng), position(rng));
+    boxes.Add(BoundingBox(min, min + glm::vec3(size(rng), size(rng), size(rng))));
+  }
+  return boxes;
+}
+/// @brief Create a camera on the +z axis looking at the origin
+inline Camera CreateTestCamera() {
+  Camera camera;
+  camera.position = glm::vec3(0.f, 0.f, 50.f);
+  camera.aspectRatio = 16.f / 9.f;
+  camera.farPlane = 200.f;
+  camera.Update();
+  return camera;
+}
+/// @brief Scatter items of random sizes in a box around the origin
+inline std::vector<std::pair<ID, BoundingBox>> CreateRandomItems(size_t count, glm::vec3 range, unsigned int seed = 7) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> unit(-1.f, 1.f);
+  std::uniform_real_distribution<float> size(.1f, 2.f);
+  std::vector<std::pair<ID, BoundingBox>> items;
+  items.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    auto min = glm::vec3(unit(rng), unit(rng), unit(rng)) * range;
+    items.emplace_back(ID::Generate(), BoundingBox(min, min + glm::vec3(size(rng), size(rng), size(rng))));
+  }
+  return items;
+}
+inline std::vector<std::pair<ID, BoundingBox>> CreateRandomItems(size_t count, float range, unsigned int seed = 7) {
+  return CreateRandomItems(count, glm::vec3(range), seed);
+}
+/// @brief Move the camera along a circle around the origin, looking towards the direction of motion
+inline void FlyThrough(Camera& camera, size_t frame, size_t frameCount, float radius) {
+  auto angle = 2.f * glm::pi<float>() * frame / frameCount;
+  camera.position = glm::vec3(radius * std::cos(angle), 10.f * std::sin(3.f * angle), radius * std::sin(angle));
+  camera.rotation = glm::angleAxis(-angle, glm::vec3(0.f, 1.f, 0.f));
+  camera.Update();
+}
+/// @brief Create a grid of city blocks with one building per block, centered at the origin
+inline std::vector<BoundingBox> CreateCity(size_t blocks, float blockSize, float streetWidth, unsigned int seed = 11) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> height(10.f, 40.f);
+  std::vector<BoundingBox> buildings;
+  auto pitch = blockSize + streetWidth;
+  auto offset = -.5f * pitch * blocks;
+  for (size_t x = 0; x < blocks; ++x)
+    for (size_t z = 0; z < blocks; ++z) {
+      auto min = glm::vec3(offset + x * pitch, 0.f, offset + z * pitch);
+      buildings.emplace_back(min, min + glm::vec3(blockSize, height(rng), blockSize));
+    }
+  return buildings;
+}
+/// @brief Place the camera at street level at the southern edge of the city, looking north with a slight turn
+inline Camera CreateStreetCamera() {
+  Camera camera;
+  camera.position = glm::vec3(-5.f, 2.f, 185.f);
+  camera.rotation = glm::angleAxis(glm::radians(15.f), glm::vec3(0.f, 1.f, 0.f));
+  camera.aspectRatio = 16.f / 9.f;
+  camera.farPlane = 400.f;
+  camera.Update();
+  return camera;
+}
+/// @brief Scatter point lights with random colors and attenuations in a box around the origin
+inline std::vector<Light> CreateTestLights(size_t count, float extent, unsigned int seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<float> positionDist(-extent, extent);
+  std::uniform_real_distribution<float> colorDist(.1f, 1.f);
+  std::uniform_real_distribution<float> quadraticDist(.5f, 8.f);
+  std::vector<Light> lights(count);
+  for (auto& light : lights) {
+    light.type = LightType::Point;
+    light.vector = glm::vec3(positionDist(rng), positionDist(rng), positionDist(rng));
+    light.diffuse = glm::vec3(colorDist(rng), colorDist(rng), colorDist(rng));
+    light.specular = light.diffuse;
+    light.linear = .1f;
+    light.quadratic = quadraticDist(rng);
+  }
+  return lights;
+}
+/// @brief Create a hidden window with an OpenGL 4.5 context once
+/// @return false if there is no display or driver, run the tests under xvfb-run with LIBGL_ALWAYS_SOFTWARE=1 to use Mesa's software renderer on a headless machine
+inline bool HasTestContext() {
+  static const auto created = []() {
+    if (!glfwInit())
+      return false;
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 5);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    auto window = glfwCreateWindow(64, 64, "KukiTests", nullptr, nullptr);
+    if (!window) {
+      glfwTerminate();
+      return false;
+    }
+    glfwMakeContextCurrent(window);
+    return gladLoadGLLoader((GLADloadproc)glfwGetProcAddress) != 0;
+  }();
+  return created;
+}
+/// @brief Compile and link a program from vertex and fragment shader sources
+inline unsigned int CreateTestProgram(const char* vertSource, const char* fragSource) {
+  auto vert = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vert, 1, &vertSource, nullptr);
+  glCompileShader(vert);
+  auto frag = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(frag, 1, &fragSource, nullptr);
+  glCompileShader(frag);
+  auto program = glCreateProgram();
+  glAttachShader(program, vert);
+  glAttachShader(program, frag);
+  glLinkProgram(program);
+  glDeleteShader(vert);
+  glDeleteShader(frag);
+  return program;
+}
+/// @brief Vertex stage of a program with the uniforms LitShader resolves when it is linked, those of lit.frag without its textures and storage buffers
+inline constexpr const char* LightingTestVertSource = "#version 450 core\nvoid main() { gl_Position = vec4(0.0); }\n";
+/// @brief Fragment stage of the lighting test program, every uniform contributes to the output so that none is optimized away
+inline constexpr const char* LightingTestFragSource = "#version 450 core\nstruct DirLight { vec3 direction; vec3 ambient; vec3 diffuse; vec3 specular; };\nuniform DirLight dirLight;\nuniform uvec3 clusterCount;\nuniform vec2 clusterDepth;\nuniform bool hasDirLight;\nuniform bool hasSkybox;\nuniform bool hasIrradianceMap;\nuniform bool hasIrradianceSH;\nuniform bool hasPrefilterMap;\nuniform bool hasBRDF;\nuniform vec3 irradianceSH[9];\nuniform vec3 viewPos;\nout vec4 color;\nvoid main() {\n  vec3 sum = hasDirLight ? dirLight.direction + dirLight.ambient + dirLight.diffuse + dirLight.specular : viewPos;\n  sum += vec3(clusterCount) * clusterDepth.x + clusterDepth.y;\n  if (hasIrradianceSH)\n    for (int i = 0; i < 9; ++i)\n      sum += irradianceSH[i];\n  color = vec4(sum, float(hasSkybox) + float(hasIrradianceMap) + float(hasPrefilterMap) + float(hasBRDF));\n}\n";
+/// @brief Write a shader stage into a temporary directory, for the shader classes that read their stages from files
+inline std::filesystem::path WriteTestShader(const std::string& name, const char* source) {
+  auto path = std::filesystem::temp_directory_path() / "kuki_test_shaders" / name;
+  std::filesystem::create_directories(path.parent_path());
+  std::ofstream(path) << source;
+  return path;
+}
+} // namespace kuki
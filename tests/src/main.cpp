@@ -1,10 +1,71 @@
+#include <algorithm>
+#include <app_config.hpp>
+#include <application.hpp>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <bloom_chain.hpp>
+#include <bounding_box.hpp>
+#include <camera.hpp>
+#include <cmath>
+#include <cstdint>
+#include <draw_job.hpp>
+#include <dynamic_resolution.hpp>
+#include <filesystem>
+#include <frustum.hpp>
+#include <fstream>
+#include <gl_state_cache.hpp>
+#include <glad/glad.h>
+#include <glm/ext/matrix_float4x4.hpp>
+#include <glm/ext/matrix_transform.hpp>
+#include <glm/ext/vector_float2.hpp>
 #include <glm/ext/vector_float3.hpp>
+#include <glm/ext/vector_float4.hpp>
+#include <glm/ext/vector_int2.hpp>
+#include <glm/geometric.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/trigonometric.hpp>
 #include <gtest/gtest.h>
 #include <id.hpp>
+#include <instance_buffer.hpp>
+#include <light.hpp>
+#include <light_clusters.hpp>
+#include <lod_group.hpp>
+#include <material_table.hpp>
+#include <memory>
 #include <mesh.hpp>
+#include <mesh_buffer.hpp>
+#include <mesh_filter.hpp>
+#include <morton.hpp>
+#include <occlusion_culler.hpp>
 #include <octree.hpp>
+#include <parallel.hpp>
+#include <pool.hpp>
+#include <primitive.hpp>
+#include <program_cache.hpp>
+#include <random>
+#include <ray.hpp>
+#include <render_queue.hpp>
+#include <rendering_system.hpp>
+#include <scene.hpp>
+#include <shader.hpp>
+#include <skybox.hpp>
+#include <span>
+#include <spherical_harmonics.hpp>
+#include <stdexcept>
 #include <string>
+#include <test_helpers.hpp>
+#include <texture_cache.hpp>
+#include <texture_params.hpp>
+#include <thread>
+#include <transform.hpp>
+#include <transform_table.hpp>
 #include <trie.hpp>
+#include <uniform_grid.hpp>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
 using namespace kuki;
 TEST(TrieTest, TestInsertDelete) {
   Trie<SuffixNode> trie;
@@ -53,6 +114,1612 @@ TEST(OctreeTest, OctreeInsert) {
   result = octree.Insert(ID::Generate(), BoundingBox(glm::vec3(3.9f), glm::vec3(5.4f)));
   EXPECT_EQ(result, true);
 }
+TEST(FrustumTest, BatchMatchesScalar) {
+  auto camera = CreateTestCamera();
+  // NOTE: an odd count exercises the SIMD tail
+  auto boxes = CreateRandomBoxes(1027, 100.f);
+  std::vector<uint64_t> simdMask;
+  std::vector<uint64_t> scalarMask;
+  camera.frustum.InFrustum(boxes, simdMask);
+  camera.frustum.InFrustumScalar(boxes, scalarMask);
+  ASSERT_EQ(simdMask.size(), (boxes.Size() + 63) / 64);
+  EXPECT_EQ(simdMask, scalarMask);
+  size_t visible = 0;
+  for (auto word : simdMask)
+    visible += std::popcount(word);
+  EXPECT_GT(visible, 0);
+  EXPECT_LT(visible, boxes.Size());
+}
+TEST(FrustumTest, BatchMatchesSingle) {
+  auto camera = CreateTestCamera();
+  BoundingBoxBatch boxes;
+  boxes.Add(BoundingBox(glm::vec3(-1.f), glm::vec3(1.f)));
+  boxes.Add(BoundingBox(glm::vec3(-1.f, -1.f, 60.f), glm::vec3(1.f, 1.f, 62.f)));
+  boxes.Add(BoundingBox(glm::vec3(-1.f, -1.f, -160.f), glm::vec3(1.f, 1.f, -140.f)));
+  boxes.Add(BoundingBox(glm::vec3(500.f), glm::vec3(501.f)));
+  boxes.Add(BoundingBox(glm::vec3(-500.f), glm::vec3(500.f)));
+  std::vector<uint64_t> mask;
+  camera.frustum.InFrustum(boxes, mask);
+  EXPECT_EQ(mask[0], 0b10101);
+}
+TEST(OctreeTest, OctreeSubdivideAndCollapse) {
+  Octree<ID> octree(glm::vec3(.0f), glm::vec3(10.f), 3, 2, 4);
+  std::vector<ID> ids;
+  for (auto i = 0; i < 64; ++i) {
+    auto id = ID::Generate();
+    auto min = glm::vec3(-9.f + (i % 4) * 4.5f, -9.f + (i / 4 % 4) * 4.5f, -9.f + (i / 16) * 4.5f);
+    EXPECT_TRUE(octree.Insert(id, BoundingBox(min, min + glm::vec3(.5f))));
+    ids.push_back(id);
+  }
+  EXPECT_EQ(octree.GetCount(), 64);
+  size_t leafCount = 0;
+  octree.ForEachLeaf([&leafCount](OctreeNode<ID>*, Octant) {
+    ++leafCount;
+  });
+  EXPECT_GT(leafCount, 1);
+  // re-inserting an item updates its bounds instead of duplicating it
+  EXPECT_TRUE(octree.Insert(ids[0], BoundingBox(glm::vec3(1.f), glm::vec3(2.f))));
+  EXPECT_EQ(octree.GetCount(), 64);
+  EXPECT_EQ(octree.GetBounds(ids[0])->min, glm::vec3(1.f));
+  for (auto i = 0; i < 63; ++i)
+    EXPECT_TRUE(octree.Delete(ids[i]));
+  EXPECT_FALSE(octree.Delete(ids[0]));
+  EXPECT_EQ(octree.GetCount(), 1);
+  leafCount = 0;
+  octree.ForEachLeaf([&leafCount](OctreeNode<ID>*, Octant) {
+    ++leafCount;
+  });
+  EXPECT_EQ(leafCount, 1);
+  EXPECT_NE(octree.GetBounds(ids[63]), nullptr);
+}
+TEST(SceneTest, SpatialIndexCulling) {
+  Scene scene("Test", 0);
+  auto camera = CreateTestCamera();
+  auto createEntity = [&scene](glm::vec3 position) {
+    std::string name = "Cube";
+    auto id = scene.CreateEntity(name);
+    auto transform = scene.entityManager.AddComponent<Transform>(id);
+    auto filter = scene.entityManager.AddComponent<MeshFilter>(id);
+    transform->position = position;
+    filter->mesh.bounds = BoundingBox(glm::vec3(-.5f), glm::vec3(.5f));
+    return id;
+  };
+  auto visible = createEntity(glm::vec3(0.f));
+  auto behind = createEntity(glm::vec3(0.f, 0.f, 80.f));
+  auto outlier = createEntity(glm::vec3(0.f, 0.f, -50.f));
+  scene.UpdateTransforms();
+  scene.UpdateSpatialIndex();
+  EXPECT_EQ(scene.GetSpatialCount(), 3);
+  auto collectVisible = [&scene, &camera]() {
+    std::unordered_set<ID> ids;
+    scene.ForEachVisibleEntity(camera, [&ids](ID id) {
+      ids.insert(id);
+    });
+    return ids;
+  };
+  auto ids = collectVisible();
+  EXPECT_EQ(ids.size(), 2);
+  EXPECT_TRUE(ids.contains(visible));
+  EXPECT_TRUE(ids.contains(outlier));
+  // only the moved entity is re-inserted
+  scene.entityManager.GetComponent<Transform>(behind)->position = glm::vec3(2.f, 0.f, 0.f);
+  scene.entityManager.GetComponent<Transform>(behind)->dirty = true;
+  scene.UpdateTransforms();
+  scene.UpdateSpatialIndex();
+  EXPECT_EQ(collectVisible().size(), 3);
+  // swapping the mesh in place updates the bounds of the entity
+  Mesh large;
+  large.bounds = BoundingBox(glm::vec3(-4.f), glm::vec3(4.f));
+  auto filter = scene.entityManager.GetComponent<MeshFilter>(behind);
+  filter->mesh = large;
+  filter->dirty = true;
+  scene.UpdateSpatialIndex();
+  ASSERT_NE(scene.GetSpatialBounds(behind), nullptr);
+  EXPECT_EQ(scene.GetSpatialBounds(behind)->max, glm::vec3(6.f, 4.f, 4.f));
+  auto overlaps = scene.OverlapAABB(BoundingBox(glm::vec3(5.f, -1.f, -1.f), glm::vec3(5.5f, 1.f, 1.f)));
+  EXPECT_EQ(overlaps, std::vector<ID>{behind});
+  scene.entityManager.RemoveComponent<MeshFilter>(visible);
+  scene.UpdateSpatialIndex();
+  EXPECT_EQ(scene.GetSpatialCount(), 2);
+  EXPECT_FALSE(collectVisible().contains(visible));
+}
+TEST(OctreeTest, CoherentCullingMatchesReference) {
+  Octree<ID> octree(glm::vec3(0.f), glm::vec3(128.f), 6, 16, 64);
+  for (const auto& [id, bounds] : CreateRandomItems(20000, 120.f))
+    octree.Insert(id, bounds);
+  Camera camera;
+  camera.farPlane = 150.f;
+  constexpr size_t frameCount = 64;
+  for (size_t frame = 0; frame < frameCount; ++frame) {
+    FlyThrough(camera, frame, frameCount, 60.f);
+    std::unordered_set<ID> coherent;
+    std::unordered_set<ID> reference;
+    octree.ForEachInFrustum(camera, [&coherent](ID id) {
+      coherent.insert(id);
+    });
+    octree.ForEachInFrustumReference(camera, [&reference](ID id) {
+      reference.insert(id);
+    });
+    ASSERT_EQ(coherent, reference) << "frame " << frame;
+  }
+}
+TEST(RayTest, SlabIntersection) {
+  BoundingBox box(glm::vec3(-1.f), glm::vec3(1.f));
+  auto distance = 0.f;
+  EXPECT_TRUE(Ray(glm::vec3(0.f, 0.f, 5.f), glm::vec3(0.f, 0.f, -1.f)).Intersects(box, distance));
+  EXPECT_FLOAT_EQ(distance, 4.f);
+  EXPECT_FALSE(Ray(glm::vec3(0.f, 0.f, 5.f), glm::vec3(0.f, 0.f, 1.f)).Intersects(box, distance));
+  EXPECT_FALSE(Ray(glm::vec3(0.f, 0.f, 5.f), glm::vec3(0.f, 0.f, -1.f)).Intersects(box, distance, 3.f));
+  EXPECT_FALSE(Ray(glm::vec3(2.f, 0.f, 5.f), glm::vec3(0.f, 0.f, -1.f)).Intersects(box, distance));
+  EXPECT_TRUE(Ray(glm::vec3(0.f), glm::vec3(1.f, 1.f, 0.f)).Intersects(box, distance));
+  EXPECT_FLOAT_EQ(distance, 0.f);
+}
+template <typename Index>
+static void ExpectQueriesMatchBruteForce(Index& index, const std::vector<std::pair<ID, BoundingBox>>& items, glm::vec3 range) {
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<float> unit(-1.f, 1.f);
+  auto randomPoint = [&rng, &unit, &range]() {
+    return glm::vec3(unit(rng), unit(rng), unit(rng)) * range;
+  };
+  Camera camera;
+  camera.farPlane = 150.f;
+  for (size_t frame = 0; frame < 8; ++frame) {
+    FlyThrough(camera, frame, 8, 60.f);
+    std::unordered_set<ID> expected;
+    for (const auto& [id, bounds] : items)
+      if (camera.IntersectsFrustum(bounds))
+        expected.insert(id);
+    std::unordered_set<ID> actual;
+    index.ForEachInFrustum(camera, [&actual](ID id) {
+      actual.insert(id);
+    });
+    ASSERT_EQ(actual, expected);
+    std::vector<ID> collected;
+    index.CollectInFrustum(camera, collected);
+    ASSERT_EQ(collected.size(), expected.size());
+    ASSERT_EQ(std::unordered_set<ID>(collected.begin(), collected.end()), expected);
+  }
+  for (auto query = 0; query < 32; ++query) {
+    auto point = randomPoint();
+    Ray ray(point, randomPoint());
+    std::vector<SpatialHit<ID>> expectedHits;
+    auto distance = 0.f;
+    for (const auto& [id, bounds] : items)
+      if (ray.Intersects(bounds, distance))
+        expectedHits.push_back({id, distance});
+    std::sort(expectedHits.begin(), expectedHits.end(), [](const auto& a, const auto& b) {
+      return a.distance < b.distance;
+    });
+    std::vector<SpatialHit<ID>> hits;
+    index.RaycastAll(ray, hits);
+    ASSERT_EQ(hits.size(), expectedHits.size());
+    SpatialHit<ID> closest;
+    ASSERT_EQ(index.Raycast(ray, closest), !expectedHits.empty());
+    if (!expectedHits.empty())
+      EXPECT_FLOAT_EQ(closest.distance, expectedHits.front().distance);
+    BoundingBox box(point - glm::vec3(15.f), point + glm::vec3(15.f));
+    std::vector<ID> overlaps;
+    index.OverlapAABB(box, overlaps);
+    auto expectedOverlaps = std::count_if(items.begin(), items.end(), [&box](const auto& item) {
+      return box.Intersects(item.second);
+    });
+    EXPECT_EQ(overlaps.size(), expectedOverlaps);
+    overlaps.clear();
+    index.OverlapSphere(point, 15.f, overlaps);
+    expectedOverlaps = std::count_if(items.begin(), items.end(), [&point](const auto& item) {
+      return item.second.GetDistanceSquared(point) <= 15.f * 15.f;
+    });
+    EXPECT_EQ(overlaps.size(), expectedOverlaps);
+    std::vector<float> distances;
+    for (const auto& [id, bounds] : items)
+      distances.push_back(std::sqrt(bounds.GetDistanceSquared(point)));
+    std::sort(distances.begin(), distances.end());
+    std::vector<SpatialHit<ID>> nearest;
+    index.KNearest(point, 10, nearest);
+    ASSERT_EQ(nearest.size(), 10);
+    for (auto i = 0; i < 10; ++i)
+      EXPECT_FLOAT_EQ(nearest[i].distance, distances[i]);
+  }
+}
+TEST(OctreeTest, SpatialQueriesMatchBruteForce) {
+  Octree<ID> octree(glm::vec3(0.f), glm::vec3(128.f), 6, 16, 64);
+  auto items = CreateRandomItems(20000, 120.f);
+  for (const auto& [id, bounds] : items)
+    octree.Insert(id, bounds);
+  ExpectQueriesMatchBruteForce(octree, items, glm::vec3(100.f));
+}
+TEST(QuadtreeTest, SpatialQueriesMatchBruteForce) {
+  Quadtree<ID> quadtree(glm::vec3(0.f), glm::vec3(256.f, 8.f, 256.f), 6, 16, 64);
+  auto items = CreateRandomItems(20000, glm::vec3(240.f, 4.f, 240.f));
+  for (const auto& [id, bounds] : items)
+    quadtree.Insert(id, bounds);
+  EXPECT_EQ(quadtree.GetCount(), items.size());
+  ExpectQueriesMatchBruteForce(quadtree, items, glm::vec3(200.f, 4.f, 200.f));
+  Quadtree<ID> built(glm::vec3(0.f), glm::vec3(256.f, 8.f, 256.f), 6, 16, 64);
+  auto buildItems = items;
+  ASSERT_EQ(built.Build(buildItems), items.size());
+  ExpectQueriesMatchBruteForce(built, items, glm::vec3(200.f, 4.f, 200.f));
+  // quadtree nodes are only split along X and Z
+  built.ForEach([](OctreeNode<ID, 0b101>* node) {
+    EXPECT_FLOAT_EQ(node->extent.y, 8.f);
+  });
+}
+TEST(UniformGridTest, SpatialQueriesMatchBruteForce) {
+  UniformGrid<ID> grid(glm::vec3(8.f));
+  auto items = CreateRandomItems(20000, 120.f);
+  for (const auto& [id, bounds] : items)
+    grid.Insert(id, bounds);
+  ExpectQueriesMatchBruteForce(grid, items, glm::vec3(100.f));
+  for (size_t i = 0; i < items.size(); i += 2)
+    grid.Delete(items[i].first);
+  EXPECT_EQ(grid.GetCount(), items.size() / 2);
+  auto buildItems = items;
+  ASSERT_EQ(grid.Build(buildItems), items.size());
+  ExpectQueriesMatchBruteForce(grid, items, glm::vec3(100.f));
+}
+TEST(MortonTest, EncodeMatchesOctantOrder) {
+  EXPECT_EQ(EncodeMorton(1, 0, 0), 4);
+  EXPECT_EQ(EncodeMorton(0, 1, 0), 2);
+  EXPECT_EQ(EncodeMorton(0, 0, 1), 1);
+  EXPECT_EQ(EncodeMorton(0x1fffff, 0, 0), 0x4924924924924924);
+  EXPECT_EQ(EncodeMorton(0x1fffff, 0x1fffff, 0x1fffff), 0x7fffffffffffffff);
+  EXPECT_EQ(EncodeMorton(0b10, 0b11, 0b01), 0b110011);
+}
+TEST(ParallelTest, SortMatchesSequential) {
+  std::mt19937 rng(11);
+  std::vector<uint32_t> values(1000003);
+  for (auto& value : values)
+    value = rng();
+  auto expected = values;
+  std::sort(expected.begin(), expected.end());
+  ParallelSort(values.begin(), values.end());
+  EXPECT_EQ(values, expected);
+}
+TEST(ParallelTest, ChunksCoverRangeInOrder) {
+  for (size_t count : {size_t{0}, size_t{100}, size_t{100003}}) {
+    std::vector<std::pair<size_t, size_t>> bounds(GetParallelThreadCount());
+    auto chunks = ParallelChunks(count, [&](size_t chunk, size_t begin, size_t end) {
+      bounds[chunk] = {begin, end};
+    }, 1000);
+    ASSERT_GE(chunks, 1u);
+    ASSERT_LE(chunks, GetParallelThreadCount());
+    EXPECT_EQ(bounds.front().first, 0u);
+    EXPECT_EQ(bounds[chunks - 1].second, count);
+    for (size_t i = 1; i < chunks; ++i)
+      EXPECT_EQ(bounds[i].first, bounds[i - 1].second);
+  }
+}
+TEST(ParallelTest, NestedCallsShareWorkers) {
+  auto& pool = WorkerPool::Get();
+  EXPECT_EQ(pool.GetWorkerCount(), GetParallelThreadCount() - 1);
+  // NOTE: a call from inside a job waits by running queued jobs, so nesting cannot deadlock even with a single worker
+  std::atomic<size_t> sum{0};
+  for (auto frame = 0; frame < 100; ++frame)
+    ParallelFor(16, [&sum](size_t begin, size_t end) {
+      for (auto i = begin; i < end; ++i)
+        ParallelFor(100, [&sum](size_t innerBegin, size_t innerEnd) {
+          sum += innerEnd - innerBegin;
+        }, 10);
+    }, 1);
+  EXPECT_EQ(sum, 100 * 16 * 100);
+  EXPECT_EQ(&WorkerPool::Get(), &pool);
+  std::atomic<int> done{0};
+  for (auto i = 0; i < 32; ++i)
+    pool.Submit([&done]() {
+      ++done;
+    });
+  while (done < 32)
+    if (!pool.RunPending())
+      std::this_thread::yield();
+  EXPECT_FALSE(pool.RunPending());
+}
+TEST(OctreeTest, BulkBuildMatchesIncremental) {
+  Octree<ID> incremental(glm::vec3(0.f), glm::vec3(128.f), 6, 16, 64);
+  Octree<ID> bulk(glm::vec3(0.f), glm::vec3(128.f), 6, 16, 64);
+  auto items = CreateRandomItems(50000, 120.f);
+  for (const auto& [id, bounds] : items)
+    incremental.Insert(id, bounds);
+  auto outside = CreateRandomItems(100, 10.f, 13);
+  for (auto& [_, bounds] : outside) {
+    bounds.min += 200.f;
+    bounds.max += 200.f;
+  }
+  auto buildItems = items;
+  buildItems.insert(buildItems.end(), outside.begin(), outside.end());
+  ASSERT_EQ(bulk.Build(buildItems), items.size());
+  EXPECT_EQ(bulk.GetCount(), incremental.GetCount());
+  for (auto i = items.size(); i < buildItems.size(); ++i)
+    EXPECT_EQ(bulk.GetBounds(buildItems[i].first), nullptr);
+  for (const auto& [id, bounds] : items)
+    ASSERT_NE(bulk.GetBounds(id), nullptr);
+  Camera camera;
+  camera.farPlane = 150.f;
+  for (size_t frame = 0; frame < 16; ++frame) {
+    FlyThrough(camera, frame, 16, 60.f);
+    std::unordered_set<ID> expected;
+    incremental.ForEachInFrustum(camera, [&expected](ID id) {
+      expected.insert(id);
+    });
+    std::unordered_set<ID> actual;
+    bulk.ForEachInFrustum(camera, [&actual](ID id) {
+      actual.insert(id);
+    });
+    ASSERT_EQ(actual, expected);
+  }
+  // the built tree keeps supporting incremental updates
+  for (size_t i = 0; i < items.size(); i += 2)
+    bulk.Delete(items[i].first);
+  EXPECT_EQ(bulk.GetCount(), items.size() / 2);
+  // fitting the root takes in everything
+  EXPECT_EQ(bulk.Build(buildItems, true), buildItems.size());
+  EXPECT_EQ(bulk.GetCount(), buildItems.size());
+}
+TEST(SceneTest, SpatialIndexBulkRebuild) {
+  Scene scene("Test", 0);
+  for (auto i = 0; i < 2000; ++i) {
+    std::string name = "Cube";
+    auto id = scene.CreateEntity(name);
+    auto transform = scene.entityManager.AddComponent<Transform>(id);
+    auto filter = scene.entityManager.AddComponent<MeshFilter>(id);
+    transform->position = glm::vec3(i % 50, 0.f, i / 50) * 4.f;
+    filter->mesh.bounds = BoundingBox(glm::vec3(-.5f), glm::vec3(.5f));
+  }
+  scene.UpdateTransforms();
+  scene.UpdateSpatialIndex();
+  // most entities lie outside the default octree bounds, the rebuild resizes it to fit them all
+  EXPECT_EQ(scene.GetSpatialCount(), 2000);
+  EXPECT_EQ(std::get<Octree<ID>>(scene.spatialIndex).GetCount(), 2000);
+  EXPECT_EQ(scene.OverlapAABB(BoundingBox(glm::vec3(-1.f), glm::vec3(197.f, 1.f, 157.f))).size(), 2000);
+}
+TEST(SceneTest, SpatialIndexTypes) {
+  Scene scene("Test", 0);
+  auto camera = CreateTestCamera();
+  for (auto i = 0; i < 400; ++i) {
+    std::string name = "Cube";
+    auto id = scene.CreateEntity(name);
+    auto transform = scene.entityManager.AddComponent<Transform>(id);
+    auto filter = scene.entityManager.AddComponent<MeshFilter>(id);
+    transform->position = glm::vec3(i % 20 - 10.f, 0.f, i / 20 - 10.f) * 3.f;
+    filter->mesh.bounds = BoundingBox(glm::vec3(-.5f), glm::vec3(.5f));
+  }
+  scene.UpdateTransforms();
+  scene.UpdateSpatialIndex();
+  auto collectVisible = [&scene, &camera]() {
+    std::unordered_set<ID> ids;
+    scene.ForEachVisibleEntity(camera, [&ids](ID id) {
+      ids.insert(id);
+    });
+    return ids;
+  };
+  auto expected = collectVisible();
+  EXPECT_FALSE(expected.empty());
+  for (auto type : {SpatialIndexType::Quadtree, SpatialIndexType::UniformGrid, SpatialIndexType::Octree}) {
+    scene.SetSpatialIndexType(type);
+    EXPECT_EQ(scene.GetSpatialIndexType(), type);
+    EXPECT_EQ(scene.GetSpatialCount(), 400);
+    EXPECT_EQ(collectVisible(), expected);
+    EXPECT_EQ(scene.KNearest(glm::vec3(0.f), 1).size(), 1);
+  }
+}
+TEST(SceneTest, VisibilityCache) {
+  Scene scene("Test", 0);
+  auto camera = CreateTestCamera();
+  std::vector<ID> ids;
+  for (auto i = 0; i < 2000; ++i) {
+    std::string name = "Cube";
+    auto id = scene.CreateEntity(name);
+    auto transform = scene.entityManager.AddComponent<Transform>(id);
+    auto filter = scene.entityManager.AddComponent<MeshFilter>(id);
+    transform->position = glm::vec3(i % 50 - 25.f, 0.f, i / 50 - 20.f) * 4.f;
+    filter->mesh.bounds = BoundingBox(glm::vec3(-.5f), glm::vec3(.5f));
+    ids.push_back(id);
+  }
+  scene.UpdateTransforms();
+  scene.UpdateSpatialIndex();
+  auto collectVisible = [&scene, &camera]() {
+    std::unordered_set<ID> visible;
+    scene.ForEachVisibleEntity(camera, [&visible](ID id) {
+      visible.insert(id);
+    });
+    return visible;
+  };
+  auto bruteForce = [&scene, &camera, &ids]() {
+    std::unordered_set<ID> visible;
+    for (const auto id : ids) {
+      auto [transform, filter] = scene.entityManager.GetComponents<Transform, MeshFilter>(id);
+      if (transform && filter && camera.IntersectsFrustum(filter->mesh.bounds.GetWorldBounds(transform->world)))
+        visible.insert(id);
+    }
+    return visible;
+  };
+  EXPECT_FALSE(scene.IsVisibilityCached(camera));
+  auto visible = collectVisible();
+  EXPECT_EQ(visible, bruteForce());
+  EXPECT_TRUE(scene.IsVisibilityCached(camera));
+  EXPECT_EQ(collectVisible(), visible);
+  // moving a few entities keeps the cache, only they are tested again
+  auto hidden = *visible.begin();
+  auto shown = std::find_if(ids.begin(), ids.end(), [&visible](ID id) {
+    return !visible.contains(id);
+  });
+  ASSERT_NE(shown, ids.end());
+  auto hiddenTransform = scene.entityManager.GetComponent<Transform>(hidden);
+  hiddenTransform->position = glm::vec3(0.f, 0.f, 500.f);
+  hiddenTransform->dirty = true;
+  auto shownTransform = scene.entityManager.GetComponent<Transform>(*shown);
+  shownTransform->position = glm::vec3(0.f);
+  shownTransform->dirty = true;
+  scene.UpdateTransforms();
+  scene.UpdateSpatialIndex();
+  EXPECT_TRUE(scene.IsVisibilityCached(camera));
+  visible = collectVisible();
+  EXPECT_FALSE(visible.contains(hidden));
+  EXPECT_TRUE(visible.contains(*shown));
+  EXPECT_EQ(visible, bruteForce());
+  scene.DeleteEntity(*shown);
+  EXPECT_FALSE(collectVisible().contains(*shown));
+  ids.erase(shown);
+  // moving the camera culls from scratch
+  camera.position.x += 20.f;
+  camera.Update();
+  EXPECT_FALSE(scene.IsVisibilityCached(camera));
+  EXPECT_EQ(collectVisible(), bruteForce());
+  EXPECT_TRUE(scene.IsVisibilityCached(camera));
+}
+TEST(OcclusionCullerTest, WallHidesBoxesBehindIt) {
+  auto camera = CreateTestCamera();
+  OcclusionCuller culler;
+  culler.Begin(camera);
+  culler.AddOccluder(BoundingBox(glm::vec3(-10.f, -10.f, -1.f), glm::vec3(10.f, 10.f, 1.f)));
+  culler.BuildHiZ();
+  EXPECT_EQ(culler.GetStats().occluders, 1);
+  // NOTE: only the front face of the wall faces the camera
+  EXPECT_EQ(culler.GetStats().triangles, 2);
+  auto frontDepth = camera.transform.projection * camera.transform.view * glm::vec4(0.f, 0.f, 1.f, 1.f);
+  auto centerDepth = culler.GetDepth(culler.GetWidth() / 2, culler.GetHeight() / 2);
+  EXPECT_NEAR(centerDepth, frontDepth.z / frontDepth.w * .5f + .5f, 1e-4f);
+  EXPECT_FLOAT_EQ(culler.GetDepth(0, 0), 1.f);
+  auto top = culler.GetLevelCount() - 1;
+  EXPECT_FLOAT_EQ(culler.GetDepth(0, 0, top), 1.f);
+  OcclusionStats counts{};
+  EXPECT_TRUE(culler.IsOccluded(BoundingBox(glm::vec3(-1.f, -1.f, -21.f), glm::vec3(1.f, 1.f, -19.f)), &counts));
+  EXPECT_TRUE(culler.IsOccluded(BoundingBox(glm::vec3(-8.f, -8.f, -3.f), glm::vec3(8.f, 8.f, -2.f)), &counts));
+  // in front of the wall, sticking out of it, beside it, and crossing the near plane
+  EXPECT_FALSE(culler.IsOccluded(BoundingBox(glm::vec3(-1.f, -1.f, 9.f), glm::vec3(1.f, 1.f, 11.f)), &counts));
+  EXPECT_FALSE(culler.IsOccluded(BoundingBox(glm::vec3(-1.f, 8.f, -21.f), glm::vec3(1.f, 20.f, -19.f)), &counts));
+  EXPECT_FALSE(culler.IsOccluded(BoundingBox(glm::vec3(25.f, -1.f, -21.f), glm::vec3(27.f, 1.f, -19.f)), &counts));
+  EXPECT_FALSE(culler.IsOccluded(BoundingBox(glm::vec3(-1.f, -1.f, 40.f), glm::vec3(1.f, 1.f, 60.f)), &counts));
+  EXPECT_EQ(counts.tested, 6);
+  EXPECT_EQ(counts.occluded, 2);
+  EXPECT_EQ(culler.GetStats().tested, 0);
+  culler.MergeStats(counts);
+  EXPECT_EQ(culler.GetStats().tested, 6);
+  EXPECT_EQ(culler.GetStats().occluded, 2);
+  EXPECT_THROW(OcclusionCuller(250, 128), std::invalid_argument);
+}
+TEST(OcclusionCullerTest, CityCullingIsConservative) {
+  auto buildings = CreateCity(12, 20.f, 10.f);
+  auto items = CreateRandomItems(5000, glm::vec3(180.f, 1.f, 180.f));
+  // NOTE: lift the items onto the ground, there is no ground occluder to hide what is below the buildings
+  for (auto& [_, bounds] : items) {
+    bounds.min.y += 1.f;
+    bounds.max.y += 1.f;
+  }
+  auto camera = CreateStreetCamera();
+  OcclusionCuller culler;
+  culler.Begin(camera);
+  for (const auto& building : buildings)
+    if (camera.IntersectsFrustum(building))
+      culler.AddOccluder(building);
+  culler.BuildHiZ();
+  // NOTE: an occluded box must be hidden from every sample point, that is, the ray towards the point hits a building first
+  auto isHidden = [&buildings, &camera](const glm::vec3& point) {
+    auto distance = glm::length(point - camera.position);
+    Ray ray(camera.position, point - camera.position);
+    auto hit = 0.f;
+    return std::any_of(buildings.begin(), buildings.end(), [&](const BoundingBox& building) {
+      return ray.Intersects(building, hit, distance);
+    });
+  };
+  size_t inFrustum = 0;
+  size_t occluded = 0;
+  for (const auto& [_, bounds] : items) {
+    if (!camera.IntersectsFrustum(bounds))
+      continue;
+    ++inFrustum;
+    if (!culler.IsOccluded(bounds))
+      continue;
+    ++occluded;
+    auto center = (bounds.min + bounds.max) * .5f;
+    EXPECT_TRUE(isHidden(center));
+    for (auto i = 0; i < 8; ++i) {
+      auto corner = glm::vec3(i & 1 ? bounds.max.x : bounds.min.x, i & 2 ? bounds.max.y : bounds.min.y, i & 4 ? bounds.max.z : bounds.min.z);
+      EXPECT_TRUE(isHidden(corner));
+    }
+  }
+  EXPECT_GT(occluded, inFrustum / 2);
+  EXPECT_LT(occluded, inFrustum);
+  // the concurrent traversal skips the same items and counts the same tests as the serial one
+  auto expectSameAsSerial = [&items, &camera, &culler](auto& index) {
+    auto copy = items;
+    index.Build(copy, true);
+    std::unordered_set<ID> serial;
+    OcclusionStats serialCounts{};
+    index.ForEachInFrustum(camera, [&serial](ID id) {
+      serial.insert(id);
+    }, &culler, &serialCounts);
+    std::vector<ID> collected;
+    OcclusionStats counts{};
+    index.CollectInFrustum(camera, collected, &culler, &counts);
+    EXPECT_EQ(collected.size(), serial.size());
+    EXPECT_EQ(std::unordered_set<ID>(collected.begin(), collected.end()), serial);
+    EXPECT_EQ(counts.tested, serialCounts.tested);
+    EXPECT_EQ(counts.occluded, serialCounts.occluded);
+  };
+  Octree<ID> octree(glm::vec3(0.f), glm::vec3(200.f), 6, 16, 64);
+  expectSameAsSerial(octree);
+  UniformGrid<ID> grid(glm::vec3(16.f));
+  expectSameAsSerial(grid);
+}
+TEST(SceneTest, OcclusionCulling) {
+  Scene scene("Test", 0);
+  auto camera = CreateTestCamera();
+  auto createCube = [&scene](const glm::vec3& position, const BoundingBox& bounds) {
+    std::string name = "Cube";
+    auto id = scene.CreateEntity(name);
+    auto transform = scene.entityManager.AddComponent<Transform>(id);
+    auto filter = scene.entityManager.AddComponent<MeshFilter>(id);
+    transform->position = position;
+    filter->mesh.bounds = bounds;
+    return id;
+  };
+  auto wall = createCube(glm::vec3(0.f), BoundingBox(glm::vec3(-20.f, -10.f, -1.f), glm::vec3(20.f, 10.f, 1.f)));
+  std::unordered_set<ID> behind;
+  for (auto i = 0; i < 8; ++i)
+    behind.insert(createCube(glm::vec3(i * 4.f - 14.f, 0.f, -20.f), BoundingBox(glm::vec3(-.5f), glm::vec3(.5f))));
+  auto front = createCube(glm::vec3(0.f, 0.f, 10.f), BoundingBox(glm::vec3(-.5f), glm::vec3(.5f)));
+  auto beside = createCube(glm::vec3(30.f, 0.f, 0.f), BoundingBox(glm::vec3(-.5f), glm::vec3(.5f)));
+  scene.UpdateTransforms();
+  scene.UpdateSpatialIndex();
+  auto collectVisible = [&scene, &camera]() {
+    std::unordered_set<ID> visible;
+    scene.ForEachVisibleEntity(camera, [&visible](ID id) {
+      visible.insert(id);
+    });
+    return visible;
+  };
+  EXPECT_EQ(collectVisible().size(), 11);
+  scene.SetOcclusionCulling(true);
+  // NOTE: without occluders, nothing is occluded
+  EXPECT_EQ(collectVisible().size(), 11);
+  scene.SetOccluder(wall);
+  EXPECT_TRUE(scene.IsOccluder(wall));
+  auto visible = collectVisible();
+  EXPECT_EQ(visible, (std::unordered_set<ID>{wall, front, beside}));
+  EXPECT_EQ(scene.GetOcclusionStats().occluders, 1);
+  EXPECT_GE(scene.GetOcclusionStats().occluded, 1);
+  scene.SetOcclusionCulling(false);
+  EXPECT_EQ(collectVisible().size(), 11);
+  scene.SetOcclusionCulling(true);
+  scene.DeleteEntity(wall);
+  EXPECT_FALSE(scene.IsOccluder(wall));
+  EXPECT_EQ(collectVisible().size(), 10);
+}
+static LODGroup CreateLODGroup() {
+  LODGroup group;
+  for (auto screenSize : {.5f, .25f, .1f}) {
+    LODLevel level;
+    level.mesh.vao = static_cast<int>(group.levels.size()) + 1;
+    level.screenSize = screenSize;
+    group.levels.push_back(level);
+  }
+  return group;
+}
+TEST(LODTest, SelectWithHysteresis) {
+  auto group = CreateLODGroup();
+  EXPECT_EQ(group.Select(1.f), 0);
+  EXPECT_EQ(group.Select(.3f), 1);
+  EXPECT_EQ(group.Select(.01f), 2);
+  // NOTE: the screen size must cross a threshold by 10% before the level changes
+  EXPECT_EQ(group.Select(.26f), 2);
+  EXPECT_EQ(group.Select(.28f), 1);
+  EXPECT_EQ(group.Select(.24f), 1);
+  EXPECT_EQ(group.Select(.22f), 2);
+  // jumping over several levels at once
+  EXPECT_EQ(group.Select(.8f), 0);
+  EXPECT_EQ(group.Select(.2f), 2);
+  EXPECT_EQ(group.Select(.3f, 1.f, 0.f), 1);
+  EXPECT_EQ(group.Select(.3f, .4f, 0.f), 2);
+  EXPECT_EQ(group.Select(.3f, 3.f, 0.f), 0);
+  LODGroup empty;
+  EXPECT_EQ(empty.Select(1.f), 0);
+}
+TEST(LODTest, ScreenSizeSelectsLevelsByDistance) {
+  Camera camera;
+  camera.Update();
+  auto bounds = BoundingBox(glm::vec3(-1.f), glm::vec3(1.f));
+  auto near = camera.GetScreenSize(BoundingBox(bounds.min - glm::vec3(0.f, 0.f, 10.f), bounds.max - glm::vec3(0.f, 0.f, 10.f)));
+  auto far = camera.GetScreenSize(BoundingBox(bounds.min - glm::vec3(0.f, 0.f, 20.f), bounds.max - glm::vec3(0.f, 0.f, 20.f)));
+  EXPECT_NEAR(near, std::sqrt(3.f) / (10.f * std::tan(glm::radians(camera.fov) * .5f)), 1e-5f);
+  EXPECT_NEAR(far * 2.f, near, 1e-5f);
+  camera.type = CameraType::Orthographic;
+  camera.Update();
+  EXPECT_NEAR(camera.GetScreenSize(bounds), std::sqrt(3.f) / camera.orthoSize, 1e-5f);
+  // a row of entities moving away from the camera switches to coarser levels, never back
+  camera.type = CameraType::Perspective;
+  camera.Update();
+  Scene scene("Test", 0);
+  std::vector<ID> ids;
+  for (auto i = 0; i < 100; ++i) {
+    std::string name = "Cube";
+    auto id = scene.CreateEntity(name);
+    auto transform = scene.entityManager.AddComponent<Transform>(id);
+    auto filter = scene.entityManager.AddComponent<MeshFilter>(id);
+    auto group = scene.entityManager.AddComponent<LODGroup>(id);
+    transform->position = glm::vec3(0.f, 0.f, -2.f - i);
+    filter->mesh.bounds = bounds;
+    *group = CreateLODGroup();
+    ids.push_back(id);
+  }
+  scene.UpdateTransforms();
+  scene.UpdateSpatialIndex();
+  std::unordered_map<int, size_t> batches;
+  uint8_t previous = 0;
+  for (const auto id : ids) {
+    auto bounds = scene.GetSpatialBounds(id);
+    ASSERT_NE(bounds, nullptr);
+    auto group = scene.entityManager.GetComponent<LODGroup>(id);
+    auto level = group->Select(camera.GetScreenSize(*bounds));
+    EXPECT_GE(level, previous);
+    previous = level;
+    ++batches[group->levels[level].mesh.vao];
+  }
+  EXPECT_EQ(batches.size(), 3);
+  EXPECT_EQ(previous, 2);
+}
+TEST(LightClustersTest, ClustersHoldEveryLightInRange) {
+  auto camera = CreateTestCamera();
+  auto lights = CreateTestLights(2000, 100.f, 17);
+  Light sun;
+  std::vector<const Light*> pointers{&sun};
+  for (const auto& light : lights)
+    pointers.push_back(&light);
+  LightClusters clusters;
+  clusters.Build(camera, pointers);
+  const auto& entries = clusters.GetLights();
+  const auto& indices = clusters.GetIndices();
+  ASSERT_FALSE(entries.empty());
+  EXPECT_LT(entries.size(), lights.size());
+  // NOTE: sample points inside the frustum, each must find every light that reaches it in its cluster
+  std::mt19937 rng(23);
+  std::uniform_real_distribution<float> ndcDist(-.999f, .999f);
+  std::uniform_real_distribution<float> depthDist(0.f, 1.f);
+  auto inverse = glm::inverse(camera.transform.projection);
+  size_t reached = 0;
+  for (auto sample = 0; sample < 20000; ++sample) {
+    auto depth = camera.nearPlane * std::pow(camera.farPlane / camera.nearPlane, depthDist(rng));
+    auto ray = inverse * glm::vec4(ndcDist(rng), ndcDist(rng), 1.f, 1.f);
+    auto direction = glm::vec3(ray) / ray.w;
+    auto viewPosition = direction * (depth / -direction.z);
+    auto worldPosition = glm::vec3(glm::inverse(camera.transform.view) * glm::vec4(viewPosition, 1.f));
+    const auto& cluster = clusters.GetClusters()[clusters.GetClusterIndex(viewPosition)];
+    std::unordered_set<uint32_t> listed(indices.begin() + cluster.offset, indices.begin() + cluster.offset + cluster.count);
+    for (uint32_t i = 0; i < entries.size(); ++i)
+      if (glm::length(glm::vec3(entries[i].position) - worldPosition) < entries[i].position.w) {
+        ++reached;
+        ASSERT_TRUE(listed.contains(i)) << "light " << i << " missing at sample " << sample;
+      }
+  }
+  EXPECT_GT(reached, 0u);
+  Light weak;
+  weak.type = LightType::Point;
+  weak.diffuse = glm::vec3(1.f);
+  weak.specular = glm::vec3(0.f);
+  weak.constant = 1.f;
+  weak.linear = 0.f;
+  weak.quadratic = 1.f;
+  EXPECT_NEAR(LightClusters::GetRange(weak), std::sqrt(255.f), 1e-3f);
+}
+TEST(RenderQueueTest, SortMatchesStdSort) {
+  std::mt19937_64 rng(7);
+  std::vector<glm::mat4> worlds(10000);
+  RenderQueue queue;
+  std::vector<std::pair<uint64_t, size_t>> expected;
+  for (size_t i = 0; i < worlds.size(); ++i) {
+    // NOTE: keys share their upper bits often, like the keys of a real scene
+    auto key = rng() & 0x0FF0'0000'00FF'FFFF;
+    queue.Push(key, {nullptr, nullptr, &worlds[i]});
+    expected.emplace_back(key, i);
+  }
+  queue.Sort();
+  std::stable_sort(expected.begin(), expected.end(), [](const auto& a, const auto& b) {
+    return a.first < b.first;
+  });
+  ASSERT_EQ(queue.Size(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    EXPECT_EQ(queue.GetKey(i), expected[i].first);
+    EXPECT_EQ(queue.GetItem(i).world, &worlds[expected[i].second]);
+  }
+  // the queue keeps its order after it is cleared and refilled
+  queue.Clear();
+  EXPECT_EQ(queue.Size(), 0);
+  queue.Push(2, {});
+  queue.Push(1, {});
+  queue.Sort();
+  EXPECT_EQ(queue.GetKey(0), 1);
+}
+TEST(RenderQueueTest, KeyOrderAndBatches) {
+  auto near = RenderQueue::MakeKey(RenderPass::Opaque, MaterialType::Lit, 1, 2, .1f);
+  auto far = RenderQueue::MakeKey(RenderPass::Opaque, MaterialType::Lit, 1, 2, .9f);
+  auto otherMesh = RenderQueue::MakeKey(RenderPass::Opaque, MaterialType::Lit, 1, 3, 0.f);
+  auto otherMaterial = RenderQueue::MakeKey(RenderPass::Opaque, MaterialType::Lit, 2, 0, 0.f);
+  auto unlit = RenderQueue::MakeKey(RenderPass::Opaque, MaterialType::Unlit, 0, 0, 0.f);
+  auto transparentNear = RenderQueue::MakeKey(RenderPass::Transparent, MaterialType::Lit, 0, 0, .1f);
+  auto transparentFar = RenderQueue::MakeKey(RenderPass::Transparent, MaterialType::Lit, 0, 0, .9f);
+  EXPECT_LT(near, far);
+  EXPECT_LT(far, otherMesh);
+  EXPECT_LT(otherMesh, otherMaterial);
+  EXPECT_NE(otherMaterial & RenderQueue::ShaderMask, unlit & RenderQueue::ShaderMask);
+  EXPECT_LT(unlit, transparentFar);
+  EXPECT_LT(transparentFar, transparentNear);
+  EXPECT_EQ(near & RenderQueue::BatchMask, far & RenderQueue::BatchMask);
+  RenderQueue queue;
+  for (auto key : {transparentNear, otherMesh, far, unlit, near, transparentFar, otherMaterial})
+    queue.Push(key, {});
+  queue.Sort();
+  std::vector<size_t> sizes;
+  queue.ForEachBatch([&sizes](size_t begin, size_t end) {
+    sizes.push_back(end - begin);
+  });
+  EXPECT_EQ(sizes, (std::vector<size_t>{2, 1, 1, 1, 2}));
+  size_t shaders = 0;
+  queue.ForEachBatch([&shaders](size_t begin, size_t end) {
+    ++shaders;
+  }, RenderQueue::ShaderMask);
+  EXPECT_EQ(shaders, 3);
+}
+TEST(RenderQueueTest, ParallelDrawListMatchesSequential) {
+  constexpr size_t count = 20000;
+  constexpr size_t meshCount = 50;
+  constexpr size_t materialCount = 64;
+  std::vector<Mesh> meshes(meshCount);
+  for (size_t i = 0; i < meshCount; ++i)
+    meshes[i].vao = static_cast<unsigned int>(i + 1);
+  std::vector<LitMaterial> materials(materialCount);
+  for (size_t i = 0; i < materialCount; ++i)
+    materials[i].fallback.albedo = glm::vec4(static_cast<float>(i) / materialCount, 0.f, 0.f, 1.f);
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<size_t> meshDist(0, meshCount - 1);
+  std::uniform_int_distribution<size_t> materialDist(0, materialCount - 1);
+  std::uniform_real_distribution<float> positionDist(-100.f, 100.f);
+  // NOTE: entities own copies of their materials, as the mesh renderers do
+  std::vector<size_t> meshOf(count);
+  std::vector<LitMaterial> materialOf(count);
+  std::vector<glm::mat4> worlds(count);
+  for (size_t i = 0; i < count; ++i) {
+    meshOf[i] = meshDist(rng);
+    materialOf[i] = materials[materialDist(rng)];
+    worlds[i] = glm::translate(glm::mat4(1.f), glm::vec3(positionDist(rng), positionDist(rng), positionDist(rng)));
+  }
+  auto makeItem = [&](size_t i, uint16_t& mesh, float& depth) {
+    mesh = RenderQueue::GetMeshKey(meshes[meshOf[i]]);
+    depth = glm::length(glm::vec3(worlds[i][3])) / 200.f;
+    return RenderItem{&meshes[meshOf[i]], nullptr, &worlds[i]};
+  };
+  MaterialTable sequentialTable;
+  RenderQueue sequential;
+  for (size_t i = 0; i < count; ++i) {
+    uint16_t mesh;
+    float depth;
+    auto item = makeItem(i, mesh, depth);
+    auto material = sequentialTable.Add(materialOf[i]);
+    item.materialIndex = material.entry;
+    sequential.Push(RenderQueue::MakeKey(RenderPass::Opaque, MaterialType::Lit, material.textureSet, mesh, depth), item);
+  }
+  sequential.Sort();
+  std::vector<DrawJob> jobs(GetParallelThreadCount());
+  MaterialTable parallelTable;
+  RenderQueue parallel;
+  auto jobCount = ParallelChunks(count, [&](size_t chunk, size_t begin, size_t end) {
+    auto& job = jobs[chunk];
+    job.Clear();
+    for (auto i = begin; i < end; ++i) {
+      uint16_t mesh;
+      float depth;
+      auto item = makeItem(i, mesh, depth);
+      item.transformRow = DrawJob::NoTransformRow;
+      job.Add(ID::Invalid(), item, MaterialType::Lit, depth, parallelTable.Prepare(materialOf[i]));
+    }
+  }, 512);
+  size_t packetCount = 0;
+  for (size_t i = 0; i < jobCount; ++i) {
+    // equal materials share a slot of the job
+    EXPECT_LE(jobs[i].GetMaterialCount(), materialCount);
+    packetCount += jobs[i].GetPacketCount();
+    jobs[i].Merge(parallelTable, parallel, [&worlds](ID id, const glm::mat4& world) {
+      return static_cast<uint32_t>(&world - worlds.data());
+    });
+  }
+  EXPECT_EQ(packetCount, count);
+  parallel.Sort();
+  ASSERT_EQ(parallel.Size(), sequential.Size());
+  EXPECT_EQ(parallelTable.GetEntries().size(), materialCount);
+  for (size_t i = 0; i < count; ++i) {
+    ASSERT_EQ(parallel.GetKey(i), sequential.GetKey(i));
+    ASSERT_EQ(parallel.GetItem(i).world, sequential.GetItem(i).world);
+    ASSERT_EQ(parallel.GetItem(i).materialIndex, sequential.GetItem(i).materialIndex);
+    ASSERT_EQ(parallel.GetItem(i).transformRow, parallel.GetItem(i).world - worlds.data());
+  }
+}
+TEST(DynamicResolutionTest, ScaleFollowsFrameTime) {
+  AppConfig config;
+  DynamicResolution resolution;
+  // the fixed scale is used while dynamic resolution is off
+  config.renderScale = .75f;
+  EXPECT_FLOAT_EQ(resolution.Update(40.f, config), .75f);
+  config.renderScale = 1.f;
+  config.dynamicResolution = true;
+  config.targetFrameTime = 10.f;
+  // frames four times slower than the target halve the scale, one step at a time with a pause after each
+  auto scale = 1.f;
+  auto changes = 0;
+  for (auto frame = 0; frame < 2000; ++frame) {
+    // NOTE: the frame time of a GPU-bound frame grows with the pixel count
+    auto next = resolution.Update(40.f * scale * scale, config);
+    if (next != scale) {
+      EXPECT_LT(next, scale);
+      EXPECT_FLOAT_EQ(std::fmod(next, DynamicResolution::ScaleStep), 0.f);
+      ++changes;
+    }
+    scale = next;
+  }
+  EXPECT_NEAR(scale, .5f, DynamicResolution::ScaleStep);
+  EXPECT_GE(scale, config.minRenderScale);
+  EXPECT_LE(changes, 3);
+  // within the hysteresis band the scale stays put
+  for (auto frame = 0; frame < 500; ++frame)
+    EXPECT_FLOAT_EQ(resolution.Update(10.f * (1.f + config.resolutionHysteresis * (frame % 2 ? .5f : -.5f)), config), scale);
+  // a fast frame time raises the scale back up to the maximum
+  for (auto frame = 0; frame < 2000; ++frame)
+    scale = resolution.Update(2.f, config);
+  EXPECT_FLOAT_EQ(scale, config.maxRenderScale);
+  // a slow frame time stops at the minimum
+  for (auto frame = 0; frame < 2000; ++frame)
+    scale = resolution.Update(1000.f, config);
+  EXPECT_FLOAT_EQ(scale, config.minRenderScale);
+}
+TEST(PoolTest, EvictsLeastRecentlyReleasedOverBudget) {
+  // NOTE: each resource of key k holds k bytes, the freed ones are recorded
+  class CountingPool final : public Pool<int, int> {
+  protected:
+    int Allocate(const int& key) override {
+      return ++allocated * 100 + key;
+    }
+    void Free(const int& key, int& val) override {
+      freed.push_back(val);
+    }
+    size_t GetSize(const int& key) const override {
+      return key;
+    }
+  public:
+    int allocated{0};
+    std::vector<int> freed;
+  };
+  CountingPool pool;
+  pool.SetBudget(100);
+  auto a = pool.Request(40);
+  auto b = pool.Request(30);
+  auto c = pool.Request(20);
+  EXPECT_EQ(pool.GetStats().bytes, 90);
+  EXPECT_EQ(pool.GetStats().liveCount, 3);
+  EXPECT_EQ(pool.GetStats().misses, 3);
+  pool.Release(40, a);
+  pool.Release(30, b);
+  pool.Release(20, c);
+  EXPECT_EQ(pool.GetStats().idleCount, 3);
+  EXPECT_EQ(pool.GetStats().liveCount, 0);
+  // a request with the same key reuses the idle resource
+  EXPECT_EQ(pool.Request(30), b);
+  EXPECT_EQ(pool.GetStats().hits, 1);
+  EXPECT_FLOAT_EQ(pool.GetStats().GetHitRate(), .25f);
+  // a new resource that does not fit evicts the least recently released ones first
+  auto d = pool.Request(50);
+  EXPECT_EQ(pool.freed, std::vector<int>{a});
+  EXPECT_EQ(pool.GetStats().bytes, 100);
+  EXPECT_EQ(pool.GetStats().evictions, 1);
+  EXPECT_EQ(pool.Request(20), c);
+  // resources in use are never freed, the pool may exceed its budget for them
+  auto e = pool.Request(60);
+  EXPECT_EQ(pool.freed.size(), 1);
+  EXPECT_EQ(pool.GetStats().bytes, 160);
+  EXPECT_EQ(pool.GetStats().liveCount, 4);
+  pool.Release(60, e);
+  EXPECT_EQ(pool.freed, (std::vector<int>{a, e}));
+  // lowering the budget frees the idle resources that no longer fit
+  pool.Release(50, d);
+  pool.SetBudget(60);
+  EXPECT_EQ(pool.freed, (std::vector<int>{a, e, d}));
+  EXPECT_EQ(pool.GetStats().bytes, 50);
+  pool.Clear();
+  EXPECT_EQ(pool.GetStats().idleCount, 0);
+  EXPECT_EQ(pool.GetStats().bytes, 50);
+}
+TEST(SphericalHarmonicsTest, ProjectsIrradiance) {
+  constexpr auto width = 256;
+  constexpr auto height = 128;
+  constexpr auto channels = 3;
+  // a uniform environment has the same irradiance for every normal, which the irradiance map stores divided by pi
+  std::vector<float> uniform(width * height * channels, 2.f);
+  auto sh = SphericalHarmonics::Project(uniform.data(), width, height, channels);
+  for (const auto& normal : {glm::vec3(0.f, 1.f, 0.f), glm::vec3(1.f, 0.f, 0.f), glm::normalize(glm::vec3(-1.f, -2.f, 3.f))}) {
+    auto irradiance = sh.Evaluate(normal);
+    for (auto c = 0; c < 3; ++c)
+      EXPECT_NEAR(irradiance[c], 2.f, 1e-3f);
+  }
+  // a white upper hemisphere, the second half of the rows as the cube map pass samples them, gives (1 + cos) / 2, which the first two bands represent exactly
+  std::vector<float> sky(width * height * channels, 0.f);
+  std::fill(sky.begin() + width * height / 2 * channels, sky.end(), 1.f);
+  sh = SphericalHarmonics::Project(sky.data(), width, height, channels);
+  EXPECT_NEAR(sh.Evaluate(glm::vec3(0.f, 1.f, 0.f)).g, 1.f, .01f);
+  EXPECT_NEAR(sh.Evaluate(glm::vec3(0.f, -1.f, 0.f)).g, 0.f, .01f);
+  EXPECT_NEAR(sh.Evaluate(glm::vec3(0.f, 0.f, 1.f)).g, .5f, .01f);
+  EXPECT_NEAR(sh.Evaluate(glm::normalize(glm::vec3(1.f, 1.f, 0.f))).g, (1.f + std::sqrt(.5f)) / 2.f, .01f);
+  // flipped images, such as EXR, have the sky in the first rows
+  auto flipped = SphericalHarmonics::Project(sky.data(), width, height, channels, true);
+  EXPECT_NEAR(flipped.Evaluate(glm::vec3(0.f, -1.f, 0.f)).g, 1.f, .01f);
+  // a bright spot is seen by the normals that face it, the columns start at the -x side of the sky
+  std::vector<float> spot(width * height * 4, 0.f);
+  for (auto row = height / 2 - 4; row < height / 2 + 4; ++row)
+    for (auto column = width / 2 - 4; column < width / 2 + 4; ++column)
+      spot[(row * width + column) * 4] = 100.f;
+  sh = SphericalHarmonics::Project(spot.data(), width, height, 4);
+  EXPECT_GT(sh.Evaluate(glm::vec3(1.f, 0.f, 0.f)).r, 5.f * sh.Evaluate(glm::vec3(-1.f, 0.f, 0.f)).r + .01f);
+  EXPECT_NEAR(sh.Evaluate(glm::vec3(1.f, 0.f, 0.f)).g, 0.f, 1e-6f);
+  EXPECT_EQ(SphericalHarmonics::Project(nullptr, width, height, channels).coefficients[0], glm::vec3(0.f));
+}
+TEST(SphericalHarmonicsTest, ProjectMatchesScalar) {
+  // odd sizes leave columns for the tails of the SIMD loops
+  constexpr auto width = 515;
+  constexpr auto height = 259;
+  constexpr auto channels = 4;
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<float> dist(0.f, 8.f);
+  std::vector<float> pixels(static_cast<size_t>(width) * height * channels);
+  for (auto& value : pixels)
+    value = dist(rng);
+  auto reference = SphericalHarmonics::ProjectScalar(pixels.data(), width, height, channels);
+  auto projected = SphericalHarmonics::Project(pixels.data(), width, height, channels);
+  for (size_t k = 0; k < SphericalHarmonics::CoefficientCount; ++k)
+    for (auto c = 0; c < 3; ++c)
+      EXPECT_NEAR(projected.coefficients[k][c], reference.coefficients[k][c], 1e-3f + std::abs(reference.coefficients[k][c]) * 1e-4f) << "coefficient " << k << ", channel " << c;
+  // the result does not depend on the timing of the threads
+  auto again = SphericalHarmonics::Project(pixels.data(), width, height, channels);
+  EXPECT_EQ(again.coefficients, projected.coefficients);
+}
+template <typename T>
+std::vector<T> ReadBuffer(unsigned int buffer, size_t offset, size_t count) {
+  std::vector<T> data(count);
+  glGetNamedBufferSubData(buffer, offset, count * sizeof(T), data.data());
+  return data;
+}
+TEST(InstanceBufferTest, RingReusesRegionsAfterFences) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  constexpr size_t regionSize = 1024;
+  InstanceBuffer buffer(regionSize, 3);
+  std::vector<glm::mat4> transforms(4, glm::mat4(2.f));
+  std::vector<float> values{1.f, 2.f, 3.f};
+  // each frame writes to its own region, offsets are aligned
+  for (size_t frame = 0; frame < 3; ++frame) {
+    auto valueOffset = buffer.Write(std::span<const float>(values));
+    auto transformOffset = buffer.Write(std::span<const glm::mat4>(transforms));
+    EXPECT_EQ(valueOffset, frame * regionSize);
+    EXPECT_EQ(transformOffset, frame * regionSize + InstanceBuffer::Alignment);
+    EXPECT_EQ(ReadBuffer<float>(buffer.GetId(), valueOffset, values.size()), values);
+    EXPECT_EQ(ReadBuffer<glm::mat4>(buffer.GetId(), transformOffset, transforms.size()), transforms);
+    EXPECT_EQ(buffer.GetStats().bytes, values.size() * sizeof(float) + transforms.size() * sizeof(glm::mat4));
+    buffer.NextFrame();
+  }
+  // the first region is reused once the GPU is done with it
+  glFinish();
+  EXPECT_EQ(buffer.Write(std::span<const float>(values)), 0);
+  EXPECT_EQ(buffer.GetStats().stalls, 0);
+  // a frame that does not fit in a region grows the buffer
+  std::vector<glm::mat4> many(32, glm::mat4(3.f));
+  auto offset = buffer.Write(std::span<const glm::mat4>(many));
+  EXPECT_EQ(buffer.GetStats().grows, 1);
+  EXPECT_GE(buffer.GetRegionSize(), many.size() * sizeof(glm::mat4));
+  EXPECT_EQ(ReadBuffer<glm::mat4>(buffer.GetId(), offset, many.size()), many);
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  buffer.Clear();
+  EXPECT_EQ(buffer.GetId(), 0);
+}
+TEST(MeshBufferTest, MultiDrawIndirect) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  // the small capacity makes the second mesh grow the buffers
+  MeshBuffer meshes(false, 4, 4);
+  std::vector<Vertex> triangle(3);
+  triangle[0].position = glm::vec3(-.2f, -.2f, 0.f);
+  triangle[1].position = glm::vec3(.2f, -.2f, 0.f);
+  triangle[2].position = glm::vec3(0.f, .2f, 0.f);
+  std::vector<Vertex> quad(4);
+  quad[0].position = glm::vec3(-.2f, -.2f, 0.f);
+  quad[1].position = glm::vec3(.2f, -.2f, 0.f);
+  quad[2].position = glm::vec3(.2f, .2f, 0.f);
+  quad[3].position = glm::vec3(-.2f, .2f, 0.f);
+  std::vector<unsigned int> quadIndices{0, 1, 2, 2, 3, 0};
+  auto triangleMesh = meshes.Add(triangle);
+  auto quadMesh = meshes.Add(quad, quadIndices);
+  EXPECT_EQ(triangleMesh.vao, quadMesh.vao);
+  EXPECT_EQ(triangleMesh.indexCount, 3);
+  EXPECT_EQ(quadMesh.baseVertex, 3);
+  EXPECT_EQ(quadMesh.firstIndex, 3);
+  EXPECT_EQ(meshes.GetVertexCount(), 7);
+  EXPECT_EQ(meshes.GetIndexCount(), 9);
+  EXPECT_EQ(ReadBuffer<unsigned int>(meshes.GetIndexBuffer(), 0, 9), (std::vector<unsigned int>{0, 1, 2, 0, 1, 2, 2, 3, 0}));
+  // one triangle and two quads drawn by a single call, their transforms are read at the base instance of each command
+  constexpr auto size = 16;
+  unsigned int framebuffer, texture;
+  glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+  glTextureStorage2D(texture, 1, GL_RGBA8, size, size);
+  glCreateFramebuffers(1, &framebuffer);
+  glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, texture, 0);
+  ASSERT_EQ(glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER), GL_FRAMEBUFFER_COMPLETE);
+  auto program = CreateTestProgram("#version 450 core\nlayout(location = 0) in vec3 position;\nlayout(location = 4) in mat4 model;\nvoid main() { gl_Position = model * vec4(position, 1.0); }\n", "#version 450 core\nout vec4 color;\nvoid main() { color = vec4(1.0); }\n");
+  InstanceBuffer instances;
+  std::vector<glm::mat4> transforms{glm::translate(glm::mat4(1.f), glm::vec3(-.5f, -.5f, 0.f)), glm::translate(glm::mat4(1.f), glm::vec3(.5f, .5f, 0.f)), glm::translate(glm::mat4(1.f), glm::vec3(.5f, -.5f, 0.f))};
+  auto offset = instances.Write(std::span<const glm::mat4>(transforms));
+  auto vao = meshes.GetVertexArray();
+  glVertexArrayVertexBuffer(vao, 1, instances.GetId(), offset, sizeof(glm::mat4));
+  glVertexArrayBindingDivisor(vao, 1, 1);
+  for (auto i = 0; i < 4; ++i) {
+    glVertexArrayAttribFormat(vao, 4 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4) * i);
+    glVertexArrayAttribBinding(vao, 4 + i, 1);
+    glEnableVertexArrayAttrib(vao, 4 + i);
+  }
+  std::vector<DrawElementsCommand> commands{{3, 1, static_cast<unsigned int>(triangleMesh.firstIndex), triangleMesh.baseVertex, 0}, {6, 2, static_cast<unsigned int>(quadMesh.firstIndex), quadMesh.baseVertex, 1}};
+  auto commandOffset = instances.Write(std::span<const DrawElementsCommand>(commands));
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(0, 0, size, size);
+  glClearColor(0.f, 0.f, 0.f, 0.f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glUseProgram(program);
+  glBindVertexArray(vao);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, instances.GetId());
+  glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, reinterpret_cast<void*>(commandOffset), commands.size(), sizeof(DrawElementsCommand));
+  std::vector<uint8_t> pixels(size * size * 4);
+  glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  auto covered = [&pixels](float x, float y) {
+    auto column = static_cast<int>((x + 1.f) * .5f * size);
+    auto row = static_cast<int>((y + 1.f) * .5f * size);
+    return pixels[(row * size + column) * 4] > 0;
+  };
+  EXPECT_TRUE(covered(-.5f, -.5f));
+  EXPECT_TRUE(covered(.5f, .5f));
+  EXPECT_TRUE(covered(.5f, -.5f));
+  EXPECT_FALSE(covered(-.5f, .5f));
+  EXPECT_FALSE(covered(0.f, 0.f));
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+  glBindVertexArray(0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteProgram(program);
+  glDeleteFramebuffers(1, &framebuffer);
+  glDeleteTextures(1, &texture);
+}
+TEST(MaterialTableTest, TexturesShareArraysAndDrawCall) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  auto createTexture = [](int size, uint32_t color) {
+    unsigned int texture;
+    glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+    glTextureStorage2D(texture, 1, GL_RGBA8, size, size);
+    std::vector<uint32_t> texels(size * size, color);
+    glTextureSubImage2D(texture, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    return texture;
+  };
+  // NOTE: colors are RGBA bytes read as little-endian words
+  constexpr uint32_t red = 0xFF0000FF;
+  constexpr uint32_t green = 0xFF00FF00;
+  auto redTexture = createTexture(4, red);
+  auto greenTexture = createTexture(4, green);
+  auto largeTexture = createTexture(8, 0xFFFF0000);
+  // a single layer at first, so the second texture of the same size grows the array
+  MaterialTable table(1);
+  LitMaterial redMaterial;
+  redMaterial.data.albedo = redTexture;
+  redMaterial.fallback.textureMask = 0x1;
+  auto greenMaterial = redMaterial;
+  greenMaterial.data.albedo = greenTexture;
+  auto largeMaterial = redMaterial;
+  largeMaterial.data.albedo = largeTexture;
+  auto untexturedMaterial = redMaterial;
+  untexturedMaterial.fallback.textureMask = 0;
+  untexturedMaterial.fallback.albedo = glm::vec4(0.f, 0.f, 1.f, 1.f);
+  auto redIndex = table.Add(redMaterial);
+  auto greenIndex = table.Add(greenMaterial);
+  auto largeIndex = table.Add(largeMaterial);
+  auto untexturedIndex = table.Add(untexturedMaterial);
+  EXPECT_EQ(table.Add(redMaterial).entry, redIndex.entry);
+  EXPECT_NE(greenIndex.entry, redIndex.entry);
+  EXPECT_EQ(greenIndex.textureSet, redIndex.textureSet);
+  EXPECT_NE(largeIndex.textureSet, redIndex.textureSet);
+  EXPECT_NE(untexturedIndex.textureSet, redIndex.textureSet);
+  EXPECT_EQ(table.GetArrayCount(), 2);
+  EXPECT_EQ(table.GetArray(redTexture), table.GetArray(greenTexture));
+  EXPECT_NE(table.GetArray(redTexture), table.GetArray(largeTexture));
+  // the large texture is the first layer of its own array, so its material shares the entry of the red one
+  const auto& entries = table.GetEntries();
+  EXPECT_EQ(largeIndex.entry, redIndex.entry);
+  ASSERT_EQ(entries.size(), 3);
+  EXPECT_EQ(entries[redIndex.entry].layers[0], 0);
+  EXPECT_EQ(entries[greenIndex.entry].layers[0], 1);
+  EXPECT_EQ(entries[greenIndex.entry].textureMask, 0x1);
+  // the layer copied before the growth survives it
+  std::vector<uint32_t> texels(2 * 4 * 4);
+  glGetTextureSubImage(table.GetArray(redTexture), 0, 0, 0, 0, 4, 4, 2, GL_RGBA, GL_UNSIGNED_BYTE, texels.size() * sizeof(uint32_t), texels.data());
+  EXPECT_EQ(texels.front(), red);
+  EXPECT_EQ(texels.back(), green);
+  // two textured instances and an untextured one drawn by a single call, each reads its material from the table
+  constexpr auto size = 16;
+  unsigned int framebuffer, target, vao;
+  glCreateTextures(GL_TEXTURE_2D, 1, &target);
+  glTextureStorage2D(target, 1, GL_RGBA8, size, size);
+  glCreateFramebuffers(1, &framebuffer);
+  glNamedFramebufferTexture(framebuffer, GL_COLOR_ATTACHMENT0, target, 0);
+  ASSERT_EQ(glCheckNamedFramebufferStatus(framebuffer, GL_FRAMEBUFFER), GL_FRAMEBUFFER_COMPLETE);
+  auto program = CreateTestProgram("#version 450 core\nlayout(location = 8) in uint material;\nflat out uint materialIndex;\nout vec2 texCoord;\nvoid main() {\n  texCoord = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n  materialIndex = material;\n  gl_Position = vec4(texCoord * 0.8 - 0.9 + vec2(gl_InstanceID % 2, gl_InstanceID / 2), 0.0, 1.0);\n}\n", "#version 450 core\nstruct MaterialEntry { vec4 albedo; vec4 specular; vec4 emissive; float metalness; float occlusion; float roughness; int textureMask; int layers[8]; };\nlayout(std430, binding = 1) readonly buffer i_materialTable { MaterialEntry materials[]; };\nuniform sampler2DArray albedo;\nflat in uint materialIndex;\nin vec2 texCoord;\nout vec4 color;\nvoid main() {\n  MaterialEntry entry = materials[materialIndex];\n  color = (entry.textureMask & 0x1) != 0 ? texture(albedo, vec3(texCoord, entry.layers[0])) : entry.albedo;\n}\n");
+  InstanceBuffer instances;
+  GLint alignment = 1;
+  glGetIntegerv(GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment);
+  auto tableOffset = instances.Write(entries.data(), entries.size() * sizeof(MaterialEntry), alignment);
+  EXPECT_EQ(tableOffset % alignment, 0);
+  glBindBufferRange(GL_SHADER_STORAGE_BUFFER, MaterialTable::BindingPoint, instances.GetId(), tableOffset, entries.size() * sizeof(MaterialEntry));
+  std::vector<unsigned int> indices{redIndex.entry, greenIndex.entry, untexturedIndex.entry};
+  auto indexOffset = instances.Write(std::span<const unsigned int>(indices));
+  glCreateVertexArrays(1, &vao);
+  glVertexArrayVertexBuffer(vao, 2, instances.GetId(), indexOffset, sizeof(unsigned int));
+  glVertexArrayBindingDivisor(vao, 2, 1);
+  glVertexArrayAttribIFormat(vao, 8, 1, GL_UNSIGNED_INT, 0);
+  glVertexArrayAttribBinding(vao, 8, 2);
+  glEnableVertexArrayAttrib(vao, 8);
+  glBindTextureUnit(0, table.GetArray(redTexture));
+  glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+  glViewport(0, 0, size, size);
+  glClearColor(0.f, 0.f, 0.f, 0.f);
+  glClear(GL_COLOR_BUFFER_BIT);
+  glUseProgram(program);
+  glBindVertexArray(vao);
+  glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, indices.size());
+  std::vector<uint32_t> pixels(size * size);
+  glReadPixels(0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  auto pixel = [&pixels](float x, float y) {
+    auto column = static_cast<int>((x + 1.f) * .5f * size);
+    auto row = static_cast<int>((y + 1.f) * .5f * size);
+    return pixels[row * size + column];
+  };
+  EXPECT_EQ(pixel(-.5f, -.5f), red);
+  EXPECT_EQ(pixel(.5f, -.5f), green);
+  EXPECT_EQ(pixel(-.5f, .5f), 0xFFFF0000);
+  EXPECT_EQ(pixel(.5f, .5f), 0);
+  EXPECT_EQ(untexturedIndex.textureSet, MaterialTable::EmptyTextureSet);
+  // a texture created after one is deleted may get its name, once evicted it is packed by its own size
+  table.EvictTexture(largeTexture);
+  glDeleteTextures(1, &largeTexture);
+  auto reusedTexture = createTexture(4, red);
+  auto reusedLayer = table.GetLayer(reusedTexture);
+  EXPECT_EQ(table.GetArrayId(reusedLayer.array), table.GetArray(redTexture));
+  EXPECT_EQ(reusedLayer.layer, 2);
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  glBindVertexArray(0);
+  glBindFramebuffer(GL_FRAMEBUFFER, 0);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteProgram(program);
+  glDeleteFramebuffers(1, &framebuffer);
+  unsigned int textures[] = {target, redTexture, greenTexture, reusedTexture};
+  glDeleteTextures(4, textures);
+  table.Clear();
+  EXPECT_EQ(table.GetArrayCount(), 0);
+}
+TEST(TransformTableTest, UploadsOnlyChangedRows) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  constexpr auto rowSize = sizeof(glm::mat4);
+  TransformTable table(2);
+  std::vector<glm::mat4> transforms{glm::mat4(1.f), glm::mat4(2.f), glm::mat4(3.f)};
+  std::vector<uint32_t> rows;
+  for (const auto& transform : transforms)
+    rows.push_back(table.Add(transform));
+  EXPECT_EQ(rows, (std::vector<uint32_t>{0, 1, 2}));
+  // the first upload creates a buffer large enough for all rows
+  EXPECT_EQ(table.Upload(), 3 * rowSize);
+  EXPECT_EQ(table.GetCapacity(), 4);
+  EXPECT_EQ(ReadBuffer<glm::mat4>(table.GetId(), 0, 3), transforms);
+  // nothing changed, nothing is uploaded
+  EXPECT_EQ(table.Upload(), 0);
+  // only the changed row is patched
+  transforms[1] = glm::mat4(4.f);
+  table.Set(rows[1], transforms[1]);
+  table.Set(rows[1], transforms[1]);
+  EXPECT_EQ(table.Upload(), rowSize);
+  EXPECT_EQ(ReadBuffer<glm::mat4>(table.GetId(), 0, 3), transforms);
+  // a removed row is reused by the next addition
+  table.Remove(rows[0]);
+  transforms[0] = glm::mat4(5.f);
+  EXPECT_EQ(table.Add(transforms[0]), rows[0]);
+  // growing keeps the rows uploaded before, only the new ones are uploaded
+  transforms.push_back(glm::mat4(6.f));
+  transforms.push_back(glm::mat4(7.f));
+  table.Add(transforms[3]);
+  table.Add(transforms[4]);
+  EXPECT_EQ(table.Upload(), 3 * rowSize);
+  EXPECT_EQ(table.GetCapacity(), 8);
+  EXPECT_EQ(ReadBuffer<glm::mat4>(table.GetId(), 0, 5), transforms);
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  table.Clear();
+  EXPECT_EQ(table.GetId(), 0);
+}
+TEST(GLStateCacheTest, SkipsRedundantCalls) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  unsigned int textures[2];
+  glCreateTextures(GL_TEXTURE_2D, 2, textures);
+  unsigned int vao;
+  glCreateVertexArrays(1, &vao);
+  unsigned int buffer;
+  glCreateBuffers(1, &buffer);
+  glNamedBufferData(buffer, 64, nullptr, GL_STATIC_DRAW);
+  GLStateCache cache;
+  // outside Begin and End every call is issued and nothing is counted
+  cache.BindTexture(3, GL_TEXTURE_2D, textures[0]);
+  cache.BindTexture(3, GL_TEXTURE_2D, textures[0]);
+  EXPECT_EQ(cache.GetStats().issued + cache.GetStats().skipped, 0);
+  cache.Begin();
+  // the first bind is issued whatever the state was, the repeated one is skipped along with its active texture call
+  cache.BindTexture(3, GL_TEXTURE_2D, textures[0]);
+  cache.BindTexture(3, GL_TEXTURE_2D, textures[0]);
+  EXPECT_EQ(cache.GetStats().issued, 2);
+  EXPECT_EQ(cache.GetStats().skipped, 2);
+  // another texture on the same unit needs no active texture call
+  cache.BindTexture(3, GL_TEXTURE_2D, textures[1]);
+  EXPECT_EQ(cache.GetStats().issued, 3);
+  EXPECT_EQ(cache.GetStats().skipped, 3);
+  int bound;
+  glGetIntegeri_v(GL_TEXTURE_BINDING_2D, 3, &bound);
+  EXPECT_EQ(bound, textures[1]);
+  // the instance attribute format is specified once, the buffer offset changes per batch
+  cache = {};
+  cache.Begin();
+  for (auto batch = 0; batch < 4; ++batch) {
+    cache.BindVertexArray(vao);
+    cache.BindVertexBuffer(vao, 2, buffer, batch * 16, sizeof(unsigned int));
+    cache.SetIntegerAttribute(vao, 8, 2, 1, GL_UNSIGNED_INT, 1);
+  }
+  EXPECT_EQ(cache.GetStats().issued, 1 + 4 + 4);
+  EXPECT_EQ(cache.GetStats().skipped, 3 + 4 * 3);
+  int enabled, divisor, binding;
+  glGetVertexArrayIndexediv(vao, 8, GL_VERTEX_ATTRIB_ARRAY_ENABLED, &enabled);
+  glGetVertexArrayIndexediv(vao, 8, GL_VERTEX_ATTRIB_ARRAY_DIVISOR, &divisor);
+  glGetVertexArrayIndexediv(vao, 8, GL_VERTEX_ATTRIB_ARRAY_BUFFER_BINDING, &binding);
+  EXPECT_EQ(enabled, GL_TRUE);
+  EXPECT_EQ(divisor, 1);
+  EXPECT_EQ(binding, buffer);
+  // ending leaves no vertex array bound, and the state is forgotten
+  cache.End();
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &bound);
+  EXPECT_EQ(bound, 0);
+  cache.Begin();
+  cache.BindVertexArray(vao);
+  EXPECT_EQ(cache.GetStats().issued, 1);
+  cache.End();
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  glDeleteBuffers(1, &buffer);
+  glDeleteVertexArrays(1, &vao);
+  glDeleteTextures(2, textures);
+}
+TEST(BloomChainTest, LevelsHalveAndAreKept) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  BloomChain bloom;
+  ASSERT_TRUE(bloom.Resize(1920, 1080));
+  ASSERT_EQ(bloom.GetLevelCount(), BloomChain::DefaultLevelCount);
+  for (size_t i = 0; i < bloom.GetLevelCount(); ++i) {
+    EXPECT_EQ(bloom.GetSize(i), glm::ivec2(960 >> i, 540 >> i));
+    int format;
+    glGetTextureLevelParameteriv(bloom.GetTexture(i), 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+    EXPECT_EQ(format, GL_RGBA16F);
+  }
+  // the same size keeps the levels, the attachments are set up once
+  auto texture = bloom.GetTexture(0);
+  auto framebuffer = bloom.GetFramebuffer(0);
+  ASSERT_TRUE(bloom.Resize(1920, 1080));
+  EXPECT_EQ(bloom.GetTexture(0), texture);
+  EXPECT_EQ(bloom.GetFramebuffer(0), framebuffer);
+  // small images get fewer levels, none below the minimum size
+  ASSERT_TRUE(bloom.Resize(64, 40));
+  EXPECT_EQ(bloom.GetLevelCount(), 3);
+  EXPECT_EQ(bloom.GetSize(2), glm::ivec2(8, 5));
+  EXPECT_FALSE(bloom.Resize(6, 6));
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  bloom.Clear();
+  EXPECT_EQ(bloom.GetLevelCount(), 0);
+}
+TEST(ShaderTest, UniformHandlesMatchLocations) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  AppConfig config;
+  config.cacheDirectory = std::filesystem::temp_directory_path() / "kuki_shader_test";
+  Application app(config);
+  RenderingSystem renderer(app);
+  LitShader shader("LightingTest", WriteTestShader("lighting.vert", LightingTestVertSource), WriteTestShader("lighting.frag", LightingTestFragSource), renderer);
+  ASSERT_TRUE(shader.Wait());
+  shader.Use();
+  auto program = shader.GetId();
+  for (const auto* name : {"viewPos", "dirLight.direction", "dirLight.specular", "irradianceSH[0]"})
+    EXPECT_EQ(shader.GetUniform<glm::vec3>(name).location, glGetUniformLocation(program, name)) << name;
+  auto readVector = [program](int location) {
+    glm::vec3 value(0.f);
+    glGetUniformfv(program, location, glm::value_ptr(value));
+    return value;
+  };
+  auto readInt = [program](const char* name) {
+    int value = -1;
+    glGetUniformiv(program, glGetUniformLocation(program, name), &value);
+    return value;
+  };
+  // a uniform the program does not use has no location, setting it is a no-op
+  auto unused = shader.GetUniform<glm::vec3>("unused");
+  EXPECT_EQ(unused.location, -1);
+  shader.SetUniform(unused, glm::vec3(1.f));
+  // values set by handle and by name land in the same uniform
+  auto clusterDepth = shader.GetUniform<glm::vec2>("clusterDepth");
+  EXPECT_EQ(clusterDepth.location, glGetUniformLocation(program, "clusterDepth"));
+  glm::vec2 depth(0.f);
+  shader.SetUniform(clusterDepth, glm::vec2(1.f, 2.f));
+  glGetUniformfv(program, clusterDepth.location, glm::value_ptr(depth));
+  EXPECT_EQ(depth, glm::vec2(1.f, 2.f));
+  shader.SetUniform("clusterDepth", glm::vec2(3.f, 4.f));
+  glGetUniformfv(program, clusterDepth.location, glm::value_ptr(depth));
+  EXPECT_EQ(depth, glm::vec2(3.f, 4.f));
+  // the lit shader sets the uniforms whose handles it resolved when the program was linked
+  Light light;
+  light.vector = glm::vec3(0.f, -1.f, 0.f);
+  light.ambient = glm::vec3(.1f, .2f, .3f);
+  shader.SetLighting(&light);
+  EXPECT_EQ(readVector(glGetUniformLocation(program, "dirLight.direction")), light.vector);
+  EXPECT_EQ(readVector(glGetUniformLocation(program, "dirLight.ambient")), light.ambient);
+  EXPECT_EQ(readInt("hasDirLight"), 1);
+  auto camera = CreateTestCamera();
+  auto pointLights = CreateTestLights(16, 20.f, 3);
+  std::vector<const Light*> lights;
+  for (const auto& pointLight : pointLights)
+    lights.push_back(&pointLight);
+  LightClusters clusters;
+  clusters.Build(camera, lights);
+  shader.SetLightClusters(&clusters);
+  glm::uvec3 clusterCount(0);
+  glGetUniformuiv(program, glGetUniformLocation(program, "clusterCount"), glm::value_ptr(clusterCount));
+  EXPECT_EQ(clusterCount, clusters.GetSize());
+  glGetUniformfv(program, clusterDepth.location, glm::value_ptr(depth));
+  EXPECT_EQ(depth, clusters.GetDepthScaleBias());
+  shader.SetLightClusters(nullptr);
+  glGetUniformuiv(program, glGetUniformLocation(program, "clusterCount"), glm::value_ptr(clusterCount));
+  EXPECT_EQ(clusterCount, glm::uvec3(0));
+  Skybox skybox;
+  skybox.hasIrradianceSH = true;
+  for (size_t i = 0; i < skybox.irradianceSH.coefficients.size(); ++i)
+    skybox.irradianceSH.coefficients[i] = glm::vec3(static_cast<float>(i));
+  shader.SetSkybox(&skybox);
+  EXPECT_EQ(readInt("hasSkybox"), 1);
+  EXPECT_EQ(readInt("hasIrradianceSH"), 1);
+  EXPECT_EQ(readInt("hasIrradianceMap"), 0);
+  EXPECT_EQ(readVector(glGetUniformLocation(program, "irradianceSH[8]")), skybox.irradianceSH.coefficients[8]);
+  shader.SetSkybox(nullptr);
+  EXPECT_EQ(readInt("hasSkybox"), 0);
+  EXPECT_EQ(readInt("hasIrradianceSH"), 0);
+  std::array<glm::vec3, 9> coefficients;
+  for (size_t i = 0; i < coefficients.size(); ++i)
+    coefficients[i] = glm::vec3(static_cast<float>(i));
+  shader.SetUniform(shader.GetUniform<std::span<const glm::vec3>>("irradianceSH[0]"), std::span<const glm::vec3>(coefficients));
+  EXPECT_EQ(readVector(glGetUniformLocation(program, "irradianceSH[8]")), coefficients[8]);
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  glUseProgram(0);
+}
+TEST(RenderingSystemTest, ReleasesTargetsOfRemovedViews) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  AppConfig config("Test", "", 64, 32);
+  config.cacheDirectory = std::filesystem::temp_directory_path() / "kuki_rendering_test";
+  Application app(config);
+  RenderingSystem renderer(app);
+  Camera kept;
+  auto removed = std::make_unique<Camera>();
+  renderer.Update(.016f);
+  EXPECT_NE(renderer.RenderSceneToTexture(&kept), 0);
+  EXPECT_NE(renderer.RenderSceneToTexture(removed.get()), 0);
+  // each view holds a multisampled, a resolved and a post-processed target
+  EXPECT_EQ(renderer.GetPoolStats().textures.liveCount, 6);
+  EXPECT_EQ(renderer.GetPoolStats().framebuffers.liveCount, 6);
+  removed.reset();
+  for (auto frame = 0; frame < 2; ++frame) {
+    renderer.Update(.016f);
+    renderer.RenderSceneToTexture(&kept);
+  }
+  EXPECT_EQ(renderer.GetPoolStats().textures.liveCount, 3);
+  EXPECT_EQ(renderer.GetPoolStats().renderbuffers.liveCount, 3);
+  EXPECT_EQ(renderer.GetPoolStats().framebuffers.liveCount, 3);
+  // the released targets are reused by a view of the same size
+  auto textureMisses = renderer.GetPoolStats().textures.misses;
+  Camera added;
+  renderer.RenderSceneToTexture(&added);
+  EXPECT_EQ(renderer.GetPoolStats().textures.misses, textureMisses);
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+}
+TEST(ProgramCacheTest, StoresAndLoadsBinaries) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  int formatCount = 0;
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+  if (formatCount == 0)
+    GTEST_SKIP() << "No program binary formats";
+  auto directory = std::filesystem::temp_directory_path() / "kuki_program_cache_test";
+  std::filesystem::remove_all(directory);
+  std::array<std::string, 2> sources{"#version 450 core\nlayout(location = 0) in vec3 position;\nuniform mat4 model;\nvoid main() { gl_Position = model * vec4(position, 1.0); }\n", "#version 450 core\nuniform vec4 tint;\nout vec4 color;\nvoid main() { color = tint * 0.5; }\n"};
+  ProgramCache cache(directory);
+  EXPECT_EQ(cache.Load("Test", sources), 0);
+  EXPECT_EQ(cache.GetStats().misses, 1);
+  // cold start: compile and link from source, then store the binary
+  auto vertText = sources[0].c_str();
+  auto fragText = sources[1].c_str();
+  auto vert = glCreateShader(GL_VERTEX_SHADER);
+  glShaderSource(vert, 1, &vertText, nullptr);
+  glCompileShader(vert);
+  auto frag = glCreateShader(GL_FRAGMENT_SHADER);
+  glShaderSource(frag, 1, &fragText, nullptr);
+  glCompileShader(frag);
+  auto program = glCreateProgram();
+  glAttachShader(program, vert);
+  glAttachShader(program, frag);
+  glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+  glLinkProgram(program);
+  glDeleteShader(vert);
+  glDeleteShader(frag);
+  ASSERT_TRUE(cache.Store("Test", program, sources));
+  EXPECT_EQ(cache.GetStats().stored, 1);
+  // warm start: a new cache, as on the next launch, loads the binary
+  ProgramCache warmCache(directory);
+  auto loaded = warmCache.Load("Test", sources);
+  ASSERT_NE(loaded, 0);
+  EXPECT_EQ(warmCache.GetStats().hits, 1);
+  EXPECT_GE(glGetUniformLocation(loaded, "tint"), 0);
+  EXPECT_GE(glGetUniformLocation(loaded, "model"), 0);
+  // a change to the sources makes the binary stale
+  auto changed = sources;
+  changed[1] += "\n";
+  EXPECT_EQ(warmCache.Load("Test", changed), 0);
+  EXPECT_EQ(warmCache.GetStats().misses, 1);
+  // a corrupt binary is rejected by the driver or fails to read, both fall back to compiling
+  {
+    std::fstream fs(directory / "Test.bin", std::ios::binary | std::ios::in | std::ios::out);
+    fs.seekp(64);
+    std::string garbage(256, '\x5a');
+    fs.write(garbage.data(), garbage.size());
+  }
+  EXPECT_EQ(warmCache.Load("Test", sources), 0);
+  EXPECT_EQ(warmCache.GetStats().hits, 1);
+  // a header whose size is beyond the end of the file or too large for OpenGL is a miss, nothing that large is allocated
+  for (auto size : {uint64_t{1} << 40, uint64_t{1} << 33}) {
+    ASSERT_TRUE(cache.Store("Test", program, sources));
+    std::fstream fs(directory / "Test.bin", std::ios::binary | std::ios::in | std::ios::out);
+    // NOTE: the size follows the magic, the format and the key
+    fs.seekp(16);
+    fs.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    fs.close();
+    auto misses = warmCache.GetStats().misses;
+    EXPECT_EQ(warmCache.Load("Test", sources), 0);
+    EXPECT_EQ(warmCache.GetStats().misses, misses + 1);
+  }
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  glDeleteProgram(program);
+  glDeleteProgram(loaded);
+  std::filesystem::remove_all(directory);
+}
+TEST(TextureCacheTest, HashSpreadsBits) {
+  // the same high bit flipped in two words must not cancel out
+  const uint64_t zeros[]{0, 0};
+  const uint64_t highBits[]{uint64_t{1} << 63, uint64_t{1} << 63};
+  EXPECT_NE(TextureCache::Hash(zeros, sizeof(zeros)), TextureCache::Hash(highBits, sizeof(highBits)));
+  // flipping any input bit flips about half of the bits of the hash
+  std::array<uint64_t, 8> words{};
+  for (size_t i = 0; i < words.size(); ++i)
+    words[i] = i * 0x9e3779b97f4a7c15ull;
+  auto hash = TextureCache::Hash(words.data(), sizeof(words));
+  auto flipped = 0;
+  for (auto bit = 0; bit < 64 * words.size(); ++bit) {
+    auto changed = words;
+    changed[bit / 64] ^= uint64_t{1} << (bit % 64);
+    auto changedBits = std::popcount(hash ^ TextureCache::Hash(changed.data(), sizeof(changed)));
+    EXPECT_GT(changedBits, 8) << "bit " << bit;
+    flipped += changedBits;
+  }
+  EXPECT_NEAR(flipped / (64. * words.size()), 32., 2.);
+}
+TEST(TextureCacheTest, StoresAndLoadsCompactLevels) {
+  if (!HasTestContext())
+    GTEST_SKIP() << "No OpenGL 4.5 context";
+  auto directory = std::filesystem::temp_directory_path() / "kuki_texture_cache_test";
+  std::filesystem::remove_all(directory);
+  constexpr auto size = 256;
+  TextureParams params{size, size, GL_TEXTURE_CUBE_MAP, GL_RGBA32F, 1, 9};
+  auto createTexture = [&]() {
+    unsigned int texture;
+    glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &texture);
+    glTextureStorage2D(texture, params.mipmaps, params.format, params.width, params.height);
+    return texture;
+  };
+  // each level and face has its own HDR color, so that a mixed up layout is caught
+  auto getColor = [](int level, int face) {
+    return glm::vec4(.25f * (level + 1), 2.f + face, 64.f / (face + 1), 1.f);
+  };
+  auto source = createTexture();
+  for (auto level = 0; level < params.mipmaps; ++level) {
+    auto levelSize = size >> level;
+    for (auto face = 0; face < 6; ++face) {
+      std::vector<glm::vec4> texels(levelSize * levelSize, getColor(level, face));
+      glTextureSubImage3D(source, level, 0, 0, face, levelSize, levelSize, 1, GL_RGBA, GL_FLOAT, texels.data());
+    }
+  }
+  TextureCache cache(directory);
+  auto key = TextureCache::Hash("environment", 11);
+  ASSERT_TRUE(cache.Store("environment_cubemap", key, source, params));
+  // four bytes per texel instead of the sixteen of the texture
+  auto fileSize = std::filesystem::file_size(directory / "environment_cubemap.tex");
+  EXPECT_LT(fileSize, size_t{size} * size * 6 * 4 * 4 / 3 + 1024);
+  auto loaded = createTexture();
+  TextureCache warmCache(directory);
+  ASSERT_TRUE(warmCache.Load("environment_cubemap", key, loaded, params));
+  for (auto level = 0; level < params.mipmaps; level += 4) {
+    auto levelSize = size >> level;
+    std::vector<glm::vec4> texels(levelSize * levelSize * 6);
+    glGetTextureImage(loaded, level, GL_RGBA, GL_FLOAT, static_cast<GLsizei>(texels.size() * sizeof(glm::vec4)), texels.data());
+    for (auto face = 0; face < 6; ++face) {
+      auto expected = getColor(level, face);
+      auto texel = texels[face * levelSize * levelSize];
+      for (auto c = 0; c < 3; ++c)
+        EXPECT_NEAR(texel[c], expected[c], expected[c] / 32.f) << "level " << level << ", face " << face;
+    }
+  }
+  // another key or other parameters make the stored texture stale
+  EXPECT_FALSE(warmCache.Load("environment_cubemap", key + 1, loaded, params));
+  auto otherParams = params;
+  otherParams.mipmaps = 1;
+  EXPECT_FALSE(warmCache.Load("environment_cubemap", key, loaded, otherParams));
+  EXPECT_FALSE(warmCache.Load("missing", key, loaded, params));
+  EXPECT_EQ(warmCache.GetStats().hits, 1);
+  EXPECT_EQ(warmCache.GetStats().misses, 3);
+  // two-channel textures keep half floats
+  TextureParams lutParams{32, 32, GL_TEXTURE_2D, GL_RG16F};
+  unsigned int lut, lutLoaded;
+  glCreateTextures(GL_TEXTURE_2D, 1, &lut);
+  glTextureStorage2D(lut, 1, GL_RG16F, 32, 32);
+  glCreateTextures(GL_TEXTURE_2D, 1, &lutLoaded);
+  glTextureStorage2D(lutLoaded, 1, GL_RG16F, 32, 32);
+  std::vector<glm::vec2> lutTexels(32 * 32);
+  for (size_t i = 0; i < lutTexels.size(); ++i)
+    lutTexels[i] = glm::vec2(i / 1024.f, 1.f - i / 1024.f);
+  glTextureSubImage2D(lut, 0, 0, 0, 32, 32, GL_RG, GL_FLOAT, lutTexels.data());
+  ASSERT_TRUE(cache.Store("lut", 0, lut, lutParams));
+  ASSERT_TRUE(warmCache.Load("lut", 0, lutLoaded, lutParams));
+  std::vector<glm::vec2> lutRead(32 * 32);
+  glGetTextureImage(lutLoaded, 0, GL_RG, GL_FLOAT, static_cast<GLsizei>(lutRead.size() * sizeof(glm::vec2)), lutRead.data());
+  for (size_t i = 0; i < lutRead.size(); i += 97)
+    EXPECT_NEAR(lutRead[i].x, lutTexels[i].x, 1e-3f);
+  EXPECT_EQ(glGetError(), GL_NO_ERROR);
+  unsigned int textures[]{source, loaded, lut, lutLoaded};
+  glDeleteTextures(4, textures);
+  std::filesystem::remove_all(directory);
+}
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
   return RUN_ALL_TESTS();